@@ -0,0 +1,116 @@
+#pragma once
+#include "packet.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief ### Benchmark settings (parsed from the command line).
+ */
+struct EngineBenchOptions {
+    std::string trace_path;                 ///< Recorded stream (./server --trace); empty = synthetic stream
+    uint32_t accounts = 1000;               ///< Synthetic: registered accounts
+    uint64_t transactions = 1000000;        ///< Synthetic: stream length
+    uint32_t max_value = 20;                ///< Synthetic: values are uniform in [1, max_value]
+    uint32_t hot_destinations = 0;          ///< Synthetic: destinations drawn from the first n accounts only (0 = any account)
+    uint64_t seed = 42;                     ///< Synthetic: RNG seed (same seed = same stream)
+    std::vector<size_t> thread_counts;      ///< Runs the stream once per entry (empty = 1, 2, 4, ... hardware threads)
+    std::vector<std::string> policies;      ///< Ledger policy sets to compare: default, lean, minimal (empty = all)
+    std::vector<size_t> group_sizes;        ///< Requests per worker group, one run each (empty = 1 and RUNTIME_WORKER_BATCH)
+};
+
+/**
+ * @brief ### Offline benchmark of the transaction engine (BasicServer::execute_transaction / execute_transaction_group).
+ *
+ * Feeds a stream of (src, dest, value, request_id) straight into the engine of a fresh
+ * ledger, with replies discarded and request logging off, so the numbers only contain the
+ * locking, dedupe and statistics cost (no sockets, no runtime queue, no std::cout).
+ *
+ * Per run:
+ * - Every account of the stream is registered first (execute_discovery, not timed)
+ * - The stream is partitioned by sender across the worker threads, so each sender's
+ *   request_ids still arrive in order (dedupe behaves as with real clients)
+ * - Each thread takes its requests in groups like a runtime worker: ledger.prefetch() on the
+ *   group, then execute_transaction_group() (group size 1 = execute_transaction() alone)
+ * - All threads start together; wall time until the last one finishes is measured
+ * - Every thread count runs once per group size and policy set (Server, LeanServer,
+ *   MinimalServer), so the lines compare them on the same stream
+ *
+ * Before timing, check_groups() runs a fixed mix (no-ops, invalid destinations, duplicates
+ * and transfers of the same sender in one group) and the start of the stream both one by
+ * one and in groups on fresh ledgers; the replies must be identical.
+ *
+ * Request validation and authentication run on the I/O thread before the engine, so they
+ * are measured separately: run_validate() filters the stream in RUNTIME_DRAIN_BATCH
+ * batches with PacketValidator; run_auth() sends the stream, signed, through
+ * SessionAuthenticator in the same batches, then one packet at a time.
+ */
+class EngineBench {
+public:
+    /**
+     * @brief ### Builds the stream (loads the trace or generates a synthetic one).
+     * @param options Benchmark settings.
+     * @throws std::runtime_error If the trace can't be read.
+     */
+    explicit EngineBench(const EngineBenchOptions& options);
+
+    /**
+     * @brief ### Runs the stream once per policy set and thread count, one result line each.
+     */
+    void run();
+
+    /// True if name is a policy set accepted by --policies
+    static bool is_policy_name(const std::string& name);
+
+private:
+    /// One transaction of the stream
+    struct BenchTransaction {
+        uint32_t src_ip;            ///< Sender (network byte order)
+        Packet packet;              ///< TRANSACTION_REQUEST
+    };
+
+    /// Reply statistics of one run
+    struct RunResult {
+        double seconds = 0;             ///< Wall time of the timed section
+        uint64_t ok = 0;                ///< TRANSACTION_ACK for a new request_id
+        uint64_t duplicates = 0;        ///< TRANSACTION_ACK for an already processed request_id
+        uint64_t insufficient = 0;      ///< INSUFFICIENT_BALANCE_ACK
+        uint64_t invalid = 0;           ///< INVALID_CLIENT_ACK
+        uint64_t errors = 0;            ///< ERROR_ACK or no reply
+    };
+
+    void load_trace();
+    void generate_synthetic();
+
+    /// Runs the whole stream on a fresh LedgerType ledger with thread_count workers
+    template<typename LedgerType>
+    RunResult run_once(size_t thread_count, size_t group_size);
+
+    /**
+     * @brief ### Checks that grouped execution replies exactly like one-by-one execution, prints one line.
+     * @throws std::runtime_error If a reply differs.
+     */
+    void check_groups() const;
+
+    /**
+     * @brief ### Runs transactions one by one and in groups of group_size, each on a fresh ledger.
+     * @return Requests whose replies differ (type, request_id or balance).
+     */
+    static size_t count_group_mismatches(const std::vector<uint32_t>& accounts,
+                                         const std::vector<BenchTransaction>& transactions, size_t group_size);
+
+    /// Times malformed request checks of the whole stream (PacketValidator batches), prints one line
+    void run_validate();
+
+    /// Times MAC verification of the whole stream (batched and scalar), prints one line
+    void run_auth();
+
+    /// Dispatches to run_once() with the ledger type of a policy set name
+    RunResult run_policy(const std::string& policy, size_t thread_count, size_t group_size);
+
+    void print_result(const std::string& policy, size_t thread_count, size_t group_size, const RunResult& result) const;
+
+    EngineBenchOptions options;
+    std::vector<uint32_t> account_ips;          ///< Registered before each run
+    std::vector<BenchTransaction> stream;       ///< Transactions in original order
+};
@@ -0,0 +1,101 @@
+#include "engine_bench.h"
+#include <iostream>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+/**
+ * @brief Prints command line usage.
+ */
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [--trace <file>] [--accounts <n>] [--transactions <n>] [--max-value <v>]"
+              << " [--hot-destinations <n>] [--seed <s>] [--threads <n>[,<n>...]] [--policies <name>[,<name>...]] [--group <n>[,<n>...]]" << std::endl;
+    std::cerr << "Policy sets: default (Server), lean (LeanServer), minimal (MinimalServer)" << std::endl;
+}
+
+/**
+ * @brief Benchmark entry point - runs a transaction stream through the engine, no network.
+ *
+ * Usage: ./bench [--trace <file>] [--accounts <n>] [--transactions <n>] [--max-value <v>] [--hot-destinations <n>] [--seed <s>] [--threads <n>[,<n>...]] [--policies <name>[,<name>...]] [--group <n>[,<n>...]]
+ * Examples:
+ *   ./bench                                        # 1M synthetic transfers among 1000 accounts, 1..hw threads
+ *   ./bench --accounts 10 --threads 1,4            # High contention (few accounts)
+ *   ./bench --trace traffic.zt --threads 1,2,4     # Recorded stream (./server --trace)
+ *   ./bench --policies default,lean                # Default vs stripped ledger only
+ *   ./bench --accounts 10000000 --group 1,8,16     # Prefetched lookup groups on a cold account table
+ *   ./bench --hot-destinations 4 --group 1,16      # Many payers, few merchants: shared locks per group
+ */
+int main(int argc, char* argv[]) {
+    EngineBenchOptions options;
+
+    // Parse optional arguments
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--trace" && i + 1 < argc) {
+                options.trace_path = argv[++i];
+            } else if (arg == "--accounts" && i + 1 < argc) {
+                options.accounts = static_cast<uint32_t>(std::stoul(argv[++i]));
+                if (options.accounts == 0) {
+                    std::cerr << "Error: --accounts must be at least 1" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--transactions" && i + 1 < argc) {
+                options.transactions = std::stoull(argv[++i]);
+            } else if (arg == "--max-value" && i + 1 < argc) {
+                options.max_value = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--hot-destinations" && i + 1 < argc) {
+                options.hot_destinations = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--seed" && i + 1 < argc) {
+                options.seed = std::stoull(argv[++i]);
+            } else if (arg == "--threads" && i + 1 < argc) {
+                std::stringstream list(argv[++i]);
+                std::string entry;
+                while (std::getline(list, entry, ',')) {
+                    size_t threads = std::stoul(entry);
+                    if (threads == 0) {
+                        std::cerr << "Error: Thread counts must be at least 1" << std::endl;
+                        return 1;
+                    }
+                    options.thread_counts.push_back(threads);
+                }
+            } else if (arg == "--group" && i + 1 < argc) {
+                std::stringstream list(argv[++i]);
+                std::string entry;
+                while (std::getline(list, entry, ',')) {
+                    size_t group_size = std::stoul(entry);
+                    if (group_size == 0) {
+                        std::cerr << "Error: Group sizes must be at least 1" << std::endl;
+                        return 1;
+                    }
+                    options.group_sizes.push_back(group_size);
+                }
+            } else if (arg == "--policies" && i + 1 < argc) {
+                std::stringstream list(argv[++i]);
+                std::string entry;
+                while (std::getline(list, entry, ',')) {
+                    if (!EngineBench::is_policy_name(entry)) {
+                        std::cerr << "Error: Unknown policy set " << entry << std::endl;
+                        return 1;
+                    }
+                    options.policies.push_back(entry);
+                }
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        EngineBench bench(options);
+        bench.run();
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,358 @@
+#include "engine_bench.h"
+#include "server.h"
+#include "packet_auth.h"
+#include "packet_trace.h"
+#include <atomic>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <unordered_set>
+
+/// Registers every account with the cookie round a real client does
+template<typename LedgerType>
+static void register_accounts(LedgerType& ledger, const std::vector<uint32_t>& accounts) {
+    for (uint32_t ip : accounts) {
+        Packet reply = ledger.execute_discovery(SocketAddress(ip), 0);
+        ledger.execute_discovery(SocketAddress(ip), reply.auth);
+    }
+}
+
+/// Stream prefix replayed by check_groups() (long enough for many full groups, quick to run twice)
+static constexpr size_t GROUP_CHECK_TRANSACTIONS = 10000;
+
+// ===== Constructor =====
+
+EngineBench::EngineBench(const EngineBenchOptions& options) : options(options) {
+    if (options.trace_path.empty()) {
+        generate_synthetic();
+    } else {
+        load_trace();
+    }
+
+    if (this->options.thread_counts.empty()) {
+        // Default sweep: powers of two up to the hardware thread count
+        size_t hardware_threads = std::max(1u, std::thread::hardware_concurrency());
+        for (size_t threads = 1; threads < hardware_threads; threads *= 2) {
+            this->options.thread_counts.push_back(threads);
+        }
+        this->options.thread_counts.push_back(hardware_threads);
+    }
+
+    if (this->options.policies.empty()) {
+        this->options.policies = {"default", "lean", "minimal"};
+    }
+
+    if (this->options.group_sizes.empty()) {
+        this->options.group_sizes = {1, RUNTIME_WORKER_BATCH};
+    }
+}
+
+void EngineBench::load_trace() {
+    PacketTraceReader reader;
+    if (!reader.open(options.trace_path)) {
+        throw std::runtime_error("Cannot read trace file " + options.trace_path);
+    }
+
+    // Discovered clients become accounts; only transactions are timed
+    std::unordered_set<uint32_t> seen;
+    TraceRecord record;
+    while (reader.next(record)) {
+        if (record.packet.type == DISCOVERY && seen.insert(record.source_ip).second) {
+            account_ips.push_back(record.source_ip);
+        } else if (record.packet.type == TRANSACTION_REQUEST) {
+            stream.push_back({record.source_ip, record.packet});
+        }
+    }
+}
+
+void EngineBench::generate_synthetic() {
+    std::mt19937_64 rng(options.seed);
+    std::uniform_int_distribution<uint32_t> pick_account(0, options.accounts - 1);
+    uint32_t destinations = options.hot_destinations ? std::min(options.hot_destinations, options.accounts) : options.accounts;
+    std::uniform_int_distribution<uint32_t> pick_destination(0, destinations - 1);
+    std::uniform_int_distribution<uint32_t> pick_value(1, std::max(1u, options.max_value));
+
+    // 10.0.0.1, 10.0.0.2, ... (network byte order, like SocketAddress::ip())
+    for (uint32_t i = 0; i < options.accounts; i++) {
+        account_ips.push_back(htonl(0x0A000001 + i));
+    }
+
+    // Each sender numbers its own requests from 1, like a real client
+    std::vector<uint32_t> next_request_id(options.accounts, 1);
+    stream.reserve(options.transactions);
+    for (uint64_t i = 0; i < options.transactions; i++) {
+        uint32_t src = pick_account(rng);
+        uint32_t dest = pick_destination(rng);
+        stream.push_back({account_ips[src], Packet::create_request(
+            TRANSACTION_REQUEST, next_request_id[src]++, account_ips[dest], pick_value(rng))});
+    }
+}
+
+// ===== Benchmark runs =====
+
+void EngineBench::run() {
+    std::cout << "Engine benchmark: " << stream.size() << " transactions, " << account_ips.size() << " accounts ("
+              << (options.trace_path.empty() ? "synthetic" : options.trace_path) << ")" << std::endl;
+
+    check_groups();
+    run_validate();
+    run_auth();
+
+    for (size_t thread_count : options.thread_counts) {
+        for (size_t group_size : options.group_sizes) {
+            for (const std::string& policy : options.policies) {
+                print_result(policy, thread_count, group_size, run_policy(policy, thread_count, group_size));
+            }
+        }
+    }
+}
+
+void EngineBench::check_groups() const {
+    // Fixed mix: replies without a transfer must carry the sender's balance as of their turn,
+    // not after the transfers that follow them in the group
+    uint32_t a = htonl(0xC0A80001);
+    uint32_t b = htonl(0xC0A80002);
+    uint32_t unknown = htonl(0x01020304);
+    std::vector<BenchTransaction> mix = {
+        {a, Packet::create_request(TRANSACTION_REQUEST, 1, b, 0)},          // No-op
+        {a, Packet::create_request(TRANSACTION_REQUEST, 2, unknown, 5)},    // Invalid destination
+        {a, Packet::create_request(TRANSACTION_REQUEST, 3, b, 50)},         // Transfer
+        {a, Packet::create_request(TRANSACTION_REQUEST, 1, b, 0)},          // Duplicate
+        {b, Packet::create_request(TRANSACTION_REQUEST, 1, a, 7)},          // Sender credited
+        {a, Packet::create_request(TRANSACTION_REQUEST, 4, a, 3)},          // Self-transfer
+        {a, Packet::create_request(TRANSACTION_REQUEST, 5, b, 30)},         // Transfer
+        {b, Packet::create_request(TRANSACTION_REQUEST, 2, unknown, 1)},    // Invalid, sender locked
+    };
+    size_t mismatches = count_group_mismatches({a, b}, mix, mix.size());
+
+    std::vector<BenchTransaction> prefix(stream.begin(), stream.begin() + std::min(stream.size(), GROUP_CHECK_TRANSACTIONS));
+    mismatches += count_group_mismatches(account_ips, prefix, RUNTIME_WORKER_BATCH);
+
+    std::cout << "group check  " << mix.size() + prefix.size() << " requests  "
+              << (mismatches == 0 ? "replies match one-by-one" : "MISMATCH") << std::endl;
+    if (mismatches != 0) {
+        throw std::runtime_error(std::to_string(mismatches) + " grouped replies differ from one-by-one execution");
+    }
+}
+
+size_t EngineBench::count_group_mismatches(const std::vector<uint32_t>& accounts,
+                                           const std::vector<BenchTransaction>& transactions, size_t group_size) {
+    Server single(0, accounts.size());
+    Server grouped(0, accounts.size());
+    single.set_request_logging(false);
+    grouped.set_request_logging(false);
+    register_accounts(single, accounts);
+    register_accounts(grouped, accounts);
+
+    size_t mismatches = 0;
+    std::vector<uint32_t> src_ips(group_size);
+    std::vector<Packet> packets(group_size);
+    std::vector<std::optional<Packet>> replies(group_size);
+    for (size_t base = 0; base < transactions.size(); base += group_size) {
+        size_t count = std::min(group_size, transactions.size() - base);
+        for (size_t i = 0; i < count; i++) {
+            src_ips[i] = transactions[base + i].src_ip;
+            packets[i] = transactions[base + i].packet;
+        }
+        grouped.execute_transaction_group(src_ips.data(), packets.data(), count, replies.data());
+
+        for (size_t i = 0; i < count; i++) {
+            std::optional<Packet> expected = single.execute_transaction(src_ips[i], packets[i]);
+            const std::optional<Packet>& reply = replies[i];
+            if (expected.has_value() != reply.has_value() ||
+                (expected && (expected->type != reply->type || expected->request_id != reply->request_id ||
+                              expected->payload.reply.new_balance != reply->payload.reply.new_balance))) {
+                mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+
+void EngineBench::run_validate() {
+    if (stream.empty()) return;
+
+    std::vector<Packet> packets;
+    std::vector<SocketAddress> client_addrs;
+    packets.reserve(stream.size());
+    client_addrs.reserve(stream.size());
+    for (const BenchTransaction& transaction : stream) {
+        packets.push_back(transaction.packet);
+        client_addrs.emplace_back(transaction.src_ip);
+    }
+
+    // Batched, as the runtime's I/O thread does (a well-formed stream: nothing moves)
+    PacketValidator validator;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t kept = 0;
+    for (size_t base = 0; base < packets.size(); base += RUNTIME_DRAIN_BATCH) {
+        size_t count = std::min(RUNTIME_DRAIN_BATCH, packets.size() - base);
+        kept += validator.filter(&packets[base], &client_addrs[base], count);
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "validate batch " << std::setw(3) << RUNTIME_DRAIN_BATCH
+              << " " << std::fixed << std::setprecision(1) << std::setw(7) << seconds * 1e9 / packets.size() << " ns/packet"
+              << "  (kept " << kept << " of " << packets.size() << ")" << std::endl;
+}
+
+void EngineBench::run_auth() {
+    if (stream.empty()) return;
+
+    // Signed as real clients would, with the keys their DISCOVERY_ACK carries
+    SessionAuthenticator authenticator;
+    std::vector<Packet> packets;
+    std::vector<SocketAddress> client_addrs;
+    packets.reserve(stream.size());
+    client_addrs.reserve(stream.size());
+    for (const BenchTransaction& transaction : stream) {
+        packets.push_back(transaction.packet);
+        PacketAuth::sign(packets.back(), authenticator.session_key(transaction.src_ip));
+        client_addrs.emplace_back(transaction.src_ip);
+    }
+
+    // Batched, as the runtime's I/O thread does (nothing is forged, so nothing moves)
+    auto start = std::chrono::steady_clock::now();
+    uint64_t batch_kept = 0;
+    for (size_t base = 0; base < packets.size(); base += RUNTIME_DRAIN_BATCH) {
+        size_t count = std::min(RUNTIME_DRAIN_BATCH, packets.size() - base);
+        batch_kept += authenticator.filter(&packets[base], &client_addrs[base], count,
+                                           [](const Packet&, const SocketAddress&) {});
+    }
+    double batch_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // One packet at a time: scalar key derivation + MAC
+    start = std::chrono::steady_clock::now();
+    uint64_t scalar_kept = 0;
+    for (size_t i = 0; i < packets.size(); i++) {
+        uint64_t key = authenticator.session_key(client_addrs[i].ip());
+        scalar_kept += PacketAuth::mac(key, packets[i]) == packets[i].auth;
+    }
+    double scalar_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "auth    batch " << std::setw(3) << RUNTIME_DRAIN_BATCH
+              << "  " << std::fixed << std::setprecision(1) << std::setw(8) << batch_s * 1e9 / packets.size() << " ns/packet"
+              << "  scalar " << std::setw(8) << scalar_s * 1e9 / packets.size() << " ns/packet"
+              << "  (verified " << batch_kept << " / " << scalar_kept << " of " << packets.size() << ")" << std::endl;
+}
+
+bool EngineBench::is_policy_name(const std::string& name) {
+    return name == "default" || name == "lean" || name == "minimal";
+}
+
+EngineBench::RunResult EngineBench::run_policy(const std::string& policy, size_t thread_count, size_t group_size) {
+    if (policy == "lean") return run_once<LeanServer>(thread_count, group_size);
+    if (policy == "minimal") return run_once<MinimalServer>(thread_count, group_size);
+    return run_once<Server>(thread_count, group_size);
+}
+
+void EngineBench::print_result(const std::string& policy, size_t thread_count, size_t group_size, const RunResult& result) const {
+    double tx_per_s = result.seconds > 0 ? stream.size() / result.seconds : 0;
+    double ns_per_tx = stream.empty() ? 0 : result.seconds * 1e9 / stream.size();
+
+    std::cout << std::left << std::setw(8) << policy << std::right
+              << "threads " << std::setw(3) << thread_count
+              << "  group " << std::setw(3) << group_size
+              << "  " << std::fixed << std::setprecision(3) << result.seconds << " s"
+              << "  " << std::setprecision(0) << std::setw(10) << tx_per_s << " tx/s"
+              << "  " << std::setprecision(1) << std::setw(8) << ns_per_tx << " ns/tx"
+              << "  " << std::setw(8) << ns_per_tx * thread_count << " thread-ns/tx"
+              << "  (ok " << result.ok
+              << ", dup " << result.duplicates
+              << ", insufficient " << result.insufficient
+              << ", invalid " << result.invalid
+              << ", error " << result.errors << ")" << std::endl;
+}
+
+template<typename LedgerType>
+EngineBench::RunResult EngineBench::run_once(size_t thread_count, size_t group_size) {
+    // Fresh ledger per run (port 0: the socket is never used)
+    LedgerType ledger(0, account_ips.size());
+    ledger.set_request_logging(false);
+    register_accounts(ledger, account_ips);
+
+    // Partition by sender so per-sender request_id order is preserved
+    std::vector<std::vector<const BenchTransaction*>> partitions(thread_count);
+    for (const BenchTransaction& transaction : stream) {
+        partitions[ntohl(transaction.src_ip) % thread_count].push_back(&transaction);
+    }
+
+    std::vector<RunResult> results(thread_count);
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t] {
+            RunResult& local = results[t];
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+            }
+
+            const std::vector<const BenchTransaction*>& mine = partitions[t];
+            std::vector<Packet> group_packets(group_size);
+            std::vector<SocketAddress> group_addrs(group_size);
+            std::vector<uint32_t> group_src_ips(group_size);
+            std::vector<std::optional<Packet>> replies(group_size);
+            for (size_t base = 0; base < mine.size(); base += group_size) {
+                size_t count = std::min(group_size, mine.size() - base);
+                if (count > 1) {
+                    // As BasicServer::process_group(): the group's accounts first, then one
+                    // transfer group (each account locked once)
+                    for (size_t i = 0; i < count; i++) {
+                        group_packets[i] = mine[base + i]->packet;
+                        group_addrs[i] = SocketAddress(mine[base + i]->src_ip);
+                        group_src_ips[i] = mine[base + i]->src_ip;
+                    }
+                    ledger.prefetch(group_packets.data(), group_addrs.data(), count);
+                    ledger.execute_transaction_group(group_src_ips.data(), group_packets.data(), count, replies.data());
+                } else {
+                    replies[0] = ledger.execute_transaction(mine[base]->src_ip, mine[base]->packet);
+                }
+
+                for (size_t i = base; i < base + count; i++) {
+                    const BenchTransaction* transaction = mine[i];
+                    const std::optional<Packet>& reply = replies[i - base];
+                    if (!reply) {
+                        local.errors++;
+                        continue;
+                    }
+                    switch (reply->type) {
+                        case TRANSACTION_ACK:
+                            if (reply->request_id == transaction->packet.request_id) local.ok++;
+                            else local.duplicates++;
+                            break;
+                        case INSUFFICIENT_BALANCE_ACK: local.insufficient++; break;
+                        case INVALID_CLIENT_ACK: local.invalid++; break;
+                        default: local.errors++; break;
+                    }
+                }
+            }
+        });
+    }
+
+    // Start all threads at once and time until the last one is done
+    while (ready.load() < thread_count) {
+        std::this_thread::yield();
+    }
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    RunResult total;
+    total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (const RunResult& local : results) {
+        total.ok += local.ok;
+        total.duplicates += local.duplicates;
+        total.insufficient += local.insufficient;
+        total.invalid += local.invalid;
+        total.errors += local.errors;
+    }
+    return total;
+}
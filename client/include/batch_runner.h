@@ -0,0 +1,186 @@
+#pragma once
+#include "udp_socket.h"
+#include "packet.h"
+#include "packet_auth.h"
+#include "server_directory.h"
+#include "load_pacer.h"
+#include "timer_wheel.h"
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/// Most requests in flight when --window is not given
+constexpr uint32_t BATCH_DEFAULT_WINDOW = 16;
+
+/**
+ * @brief ### Batch mode settings (parsed from the command line).
+ */
+struct BatchOptions {
+    std::string input_path;                 ///< Transfers, one "<destination_ip> <value>" per line
+    std::string results_path;               ///< Per-transfer results (empty = <input_path>.results)
+    uint32_t window = BATCH_DEFAULT_WINDOW; ///< Most requests in flight (1..MAX_REQUESTS_IN_FLIGHT, paced below it)
+};
+
+/**
+ * @brief ### Read-only memory mapping of a whole file.
+ *
+ * The batch parser walks the mapping directly: no read() copies, no per-line allocation.
+ */
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /**
+     * @brief ### Maps the file (an empty file maps to an empty range).
+     * @return False if the file can't be opened or mapped.
+     */
+    bool open(const std::string& path);
+
+    const char* begin() const { return data; }
+    const char* end() const { return data + length; }
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#endif
+};
+
+/**
+ * @brief ### Sends a file of transfers with a sliding window of requests in flight.
+ *
+ * Lines use the interactive format ("<destination_ip> <value>"), parsed in place with
+ * std::from_chars; blank lines are skipped, malformed ones reported and skipped.
+ *
+ * Window: request_ids in flight span at most `window` consecutive values (the oldest
+ * unanswered one bounds the newest that may be sent), which keeps every request inside the
+ * server's sequence window, so replies may arrive in any order and each request is applied
+ * exactly once. Each request is retransmitted until answered (timers on a TimerWheel,
+ * expired ones resent in one batch per wakeup); replies are matched by request_id. Every
+ * request is signed with the session key of the current server.
+ *
+ * Pacing: a LoadPacer sizes the usable part of the window (1 to `window`) from the load
+ * hint of every reply and from timeouts (AIMD), and stretches the retransmission timeout
+ * (ACK_TIMEOUT_MS when the server is idle) as its load grows.
+ *
+ * Failover: a wakeup with expired timers and no reply counts as one timeout of the server.
+ * Once the ServerDirectory marks it down, the window stops growing, DISCOVERY goes to the
+ * next candidate, and every request in flight is renumbered onto the new server's sequence
+ * (one offset for the whole window, so slots don't move), signed with the new server's
+ * session key and resent there. Servers keep separate ledgers: a request the old server
+ * applied but never acknowledged is applied again on the new one. If the answer comes from
+ * the server already in use (no other candidate, or a broadcast it answered), the ids are
+ * kept, so it replies to what it already applied instead of applying it twice.
+ *
+ * Output: one results line per sent transfer, in input order
+ * ("<line> <destination_ip> <value> <reply_type> <new_balance> <latency_us>"), and a summary
+ * with throughput, outcome counts and latency percentiles (first send to reply).
+ */
+class BatchRunner {
+public:
+    /**
+     * @brief ### Prepares a run over an already discovered server.
+     * @param socket Client socket (non-blocking, no other reader while run() executes).
+     * @param servers Known servers (failover candidates), updated with replies and timeouts.
+     * @param server_addr Server address from discovery.
+     * @param first_request_id First unused request_id (from DISCOVERY_ACK).
+     * @param session_key Session key from the same DISCOVERY_ACK.
+     * @param options Batch settings (window clamped to 1..MAX_REQUESTS_IN_FLIGHT).
+     */
+    BatchRunner(UDPSocket& socket, ServerDirectory& servers, const SocketAddress& server_addr, uint32_t first_request_id,
+                uint64_t session_key, const BatchOptions& options);
+
+    /**
+     * @brief ### Sends every transfer, writes the results file and prints the summary.
+     * @return False if the input can't be mapped or the results file can't be created.
+     */
+    bool run();
+
+private:
+    /// One request in flight (slot = (request_id - first_request_id) % window), timer included
+    struct Slot : TimerNode {
+        Packet packet;
+        uint64_t line_number = 0;       ///< 1-based input line
+        uint64_t first_send_ns = 0;     ///< Latency origin
+        bool retransmitted = false;     ///< No RTT sample for its reply (Karn's rule)
+        bool answered = false;
+        uint8_t reply_type = 0;
+        uint32_t new_balance = 0;
+        uint64_t latency_ns = 0;
+    };
+
+    /**
+     * @brief ### Parses the next transfer, skipping blank and malformed lines.
+     * @return False at end of input.
+     */
+    bool next_transfer(Slot& slot);
+
+    /// Sends (or resends) a slot's request and re-arms its retransmission timer
+    void transmit(Slot& slot, uint64_t now_ns);
+
+    /// Slot holding a request_id currently in flight
+    Slot& slot_for(uint32_t request_id) { return slots[(request_id - first_request_id) % slots.size()]; }
+
+    /// Reads every pending datagram and answers matching slots
+    void drain_replies(uint64_t now_ns);
+
+    /// Resends the expired slots, or fails over (one more probe while failing over)
+    void handle_timeouts(uint64_t now_ns);
+
+    // ===== Failover =====
+
+    /// Sends DISCOVERY to failover_target and arms discovery_timer
+    void probe_failover_target(uint64_t now_ns);
+
+    /// Moves the window onto the server that answered DISCOVERY (renumbered only if it is another one) and resends what is unanswered
+    void complete_failover(const SocketAddress& new_server, const Packet& discovery_ack, uint64_t now_ns);
+
+    /// The current server answered after all: drops the failover and resends what is unanswered
+    void abort_failover(uint64_t now_ns);
+
+    /// Writes a slot's results line and accounts its outcome
+    void complete(const Slot& slot);
+
+    /// Prints throughput, outcome counts and latency percentiles
+    void print_summary(double elapsed_s) const;
+
+    UDPSocket& socket;
+    ServerDirectory& servers;
+    SocketAddress server_addr;
+    uint64_t session_key;               ///< Current server's key (PacketAuth::sign)
+    BatchOptions options;
+
+    MappedFile input;
+    const char* cursor = nullptr;       ///< Next unparsed byte of the mapping
+    uint64_t line_number = 0;
+    std::ofstream results;
+
+    uint32_t first_request_id;
+    uint32_t base_request_id;           ///< Oldest request not yet completed
+    uint32_t next_request_id;           ///< Next request_id to assign
+    std::vector<Slot> slots;
+    LoadPacer pacer;                    ///< Usable window and retransmission timeout (server load)
+    TimerWheel retransmit_timers;       ///< One timer per unanswered slot, plus discovery_timer
+    std::vector<TimerNode*> expired;    ///< Timers fired by the last advance()
+
+    bool failing_over = false;          ///< Window on hold, DISCOVERY sent to failover_target
+    SocketAddress failover_target;
+    TimerNode discovery_timer;
+    uint64_t discovery_send_ns = 0;
+    bool discovery_retransmitted = false;
+
+    // ===== Summary =====
+    uint64_t malformed_lines = 0;
+    uint64_t retransmissions = 0;
+    uint64_t failovers = 0;
+    uint64_t replies_by_type[256] = {};
+    std::vector<uint64_t> latencies_ns;
+};
@@ -1,14 +1,25 @@
 #pragma once
 #include "udp_socket.h"
 #include "packet.h"
+#include "packet_auth.h"
+#include "batch_runner.h"
+#include "load_pacer.h"
+#include "server_directory.h"
+#include "timer_wheel.h"
 #include <string>
+#include <vector>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <atomic>
 
-/// Timeout duration for ACK reception before retransmitting a request (milliseconds)
+/// Timeout duration for ACK reception before retransmitting a request (milliseconds, idle server:
+/// LoadPacer stretches it with the server's load hint)
 constexpr uint32_t ACK_TIMEOUT_MS = 200;
+constexpr uint64_t ACK_TIMEOUT_NS = ACK_TIMEOUT_MS * uint64_t(1000000);
+
+/// Resolution of the retransmission timer wheel (1 ms)
+constexpr uint64_t RETRANSMIT_TICK_NS = 1000000;
 
 /**
  * @brief ### UDP client implementing stop-and-wait ARQ protocol for reliable communication.
@@ -17,17 +28,34 @@ constexpr uint32_t ACK_TIMEOUT_MS = 200;
  * - Main thread: handles user input and sends requests
  * - Network thread: listens for and processes server responses
  * 
- * Discovery phase: broadcasts UDP packets until a server responds with DISCOVERY_ACK.
- * Transaction phase: sends requests with automatic retransmission until ACK is received.
+ * Discovery phase: broadcasts UDP packets until a server responds with DISCOVERY_ACK, which
+ * also carries the session key that signs every later request (PacketAuth). A server that
+ * doesn't know this address yet answers DISCOVERY_COOKIE first; echoing the cookie in a new
+ * DISCOVERY creates the account (same on failover, and in BatchRunner).
+ * Transaction phase: sends requests with automatic retransmission until ACK is received; the
+ * retransmission timeout follows the load hint of the server's replies (LoadPacer).
+ * Failover: after `failover_after` consecutive timeouts the network thread sends DISCOVERY to
+ * the next server of its ServerDirectory and resends the pending request there, renumbered
+ * from that server's DISCOVERY_ACK (each server keeps its own request_id sequence). Servers
+ * keep separate ledgers, so a request the old server applied without its reply arriving is
+ * applied again on the new one. If the server already in use answers (no other candidate),
+ * the request keeps its id and is only signed again and resent.
+ * Optional push channel: subscribes once, then the network thread prints (and acks) every
+ * CREDIT_NOTIFY the server pushes when this client is credited.
  */
 class Client {
 public:
     /**
      * @brief ### Constructs a Client instance.
      * @param server_port Port number where the server listens (same for discovery and transactions).
-     * @param server_ip Optional server IP address. If empty, client performs broadcast discovery.
+     * @param server_ips Known server IP addresses, preferred first. If empty, client performs
+     *        broadcast discovery (and broadcasts again when failing over).
+     * @param notify_credits Subscribe to CREDIT_NOTIFY pushes after discovery.
+     * @param failover_after Consecutive timeouts before switching to another server.
+     * @throws std::invalid_argument If a server IP address is malformed.
      */
-    Client(uint16_t server_port, const std::string& server_ip = "");
+    Client(uint16_t server_port, const std::vector<std::string>& server_ips = {}, bool notify_credits = false,
+           uint32_t failover_after = FAILOVER_DEFAULT_TIMEOUTS);
 
     /**
      * @brief ### Starts client execution: discovers server, spawns network thread, handles user input.
@@ -39,6 +67,16 @@ public:
      */
     void run();
 
+    /**
+     * @brief ### Discovers the server, then sends every transfer of a batch file (no user input).
+     * 
+     * Replaces the input loop and network thread with BatchRunner (window of requests in
+     * flight). Returns once every transfer is answered.
+     * @param options Batch file, results file and window size.
+     * @return False if the socket can't be created or the batch files can't be opened.
+     */
+    bool run_batch(const BatchOptions& options);
+
 private:
     // ===== Server Discovery =====
     
@@ -53,11 +91,18 @@ private:
     /**
      * @brief ### Connects to a known server IP without broadcast discovery.
      * 
-     * Sends DISCOVERY packets directly to the specified IP address.
-     * Blocks until DISCOVERY_ACK is received from that server.
+     * Sends DISCOVERY packets directly to the first server, moving on to the next known one
+     * after `failover_after` timeouts. Blocks until one of them answers with DISCOVERY_ACK.
      */
     void connect_to_known_server();
 
+    /**
+     * @brief ### Sends SUBSCRIBE until the server answers with SUBSCRIBE_ACK.
+     * 
+     * Runs after discovery, before the network thread starts (same retry loop as discovery).
+     */
+    void subscribe_to_credits();
+
     // ===== Main Execution Loops =====
     
     /**
@@ -70,13 +115,17 @@ private:
     void run_user_input_loop();
 
     /**
-     * @brief ### [Network thread] Listens for server responses and processes ACKs.
+     * @brief ### [Network thread] Listens for server responses, processes ACKs and retransmits.
      * 
      * Runs in infinite loop:
-     * 1. Blocks on socket.receive() waiting for packets
+     * 1. Sleeps until a packet arrives or the next retransmission timer is due
      * 2. Checks if response matches pending_ack_request_id
-     * 3. If match: stops retransmission, prints result, notifies main thread
+     * 3. If match: cancels its timer, prints result, notifies main thread
      * 4. If no match: ignores packet (duplicate or out-of-order)
+     * 5. Fires expired retransmission timers (resends and re-arms them)
+     * 
+     * CREDIT_NOTIFY packets are handled first (their request_id is the server's notification
+     * number, not ours): always acked, printed only once.
      */
     void handle_server_responses();
 
@@ -87,22 +136,59 @@ private:
      * 
      * Stop-and-wait protocol:
      * 1. Sets pending_ack_request_id to packet's ID  
-     * 2. Sends packet to server  
-     * 3. Waits ACK_TIMEOUT_MS for ACK (blocking with condition variable)
-     * 4. If timeout: retransmits (goto step 2)
-     * 5. If ACK received: network thread clears pending_ack_request_id and notifies
+     * 2. Sends packet to server and arms its retransmission timer (LoadPacer::retransmit_timeout_ns())
+     * 3. Waits for ACK (condition variable, no timeout)
+     * 4. Network thread retransmits each time the timer expires
+     * 5. If ACK received: network thread cancels the timer, clears pending_ack_request_id and notifies
      * 6. Exits when pending_ack_request_id == 0
      * 
      * @param packet The request packet to send (TRANSACTION_REQUEST).
      */
     void send_request(const Packet& packet);
 
+    /**
+     * @brief ### [Network thread] Resends the pending request whose timer expired and re-arms it.
+     * 
+     * Caller holds pending_request_mutex. Each expiry counts as a timeout of the current
+     * server (or failover candidate); once it is down, starts (or moves on with) failover.
+     * A failed send aborts the request (as before).
+     */
+    void fire_retransmissions(uint64_t now_ns);
+
+    // ===== Failover (network thread, caller holds pending_request_mutex) =====
+
+    /**
+     * @brief ### Sends DISCOVERY to failover_target and arms the retransmission timer.
+     */
+    void probe_failover_target(uint64_t now_ns);
+
+    /**
+     * @brief ### Switches to the server that answered a failover DISCOVERY.
+     * 
+     * Renumbers the pending request after the new server's last processed request_id,
+     * signs it with the new server's session key, resends it there and re-subscribes to
+     * credit notifications if enabled. If new_server is the current server, the request
+     * keeps its id (the server may already have applied it) and is only signed again and resent.
+     */
+    void complete_failover(const SocketAddress& new_server, const Packet& discovery_ack, uint64_t now_ns);
+
+    /**
+     * @brief ### Sends the pending request (plus SUBSCRIBE while not yet acknowledged).
+     * @return False if the socket send failed.
+     */
+    bool transmit_pending();
+
     // ===== Server Connection State =====
     
     UDPSocket client_socket;                ///< UDP socket with broadcast capability enabled
     SocketAddress server_addr;              ///< Server's address (populated during discovery phase)
     bool has_server_address;                ///< True after DISCOVERY_ACK received, false otherwise
+    ServerDirectory servers;                ///< Known servers and their health (under pending_request_mutex once running)
     uint32_t next_request_id;               ///< Monotonically increasing ID for outgoing requests (starts at 1)
+    uint64_t session_key;                   ///< From the current server's DISCOVERY_ACK, signs every request
+    bool notify_credits;                    ///< Subscribe to CREDIT_NOTIFY after discovery
+    bool subscribed;                        ///< SUBSCRIBE_ACK received from the current server
+    uint32_t last_notify_id;                ///< Last CREDIT_NOTIFY printed (network thread only, filters retransmissions)
 
     // ===== Threading =====
     
@@ -116,4 +202,17 @@ private:
     std::atomic<uint32_t> pending_ack_request_id;	///< Request ID waiting for ACK (0 = none pending)
 													///< Atomic allows lock-free reads in network thread hot path
     Packet pending_request_packet;                  ///< Copy of current request (used for retransmission and printing results)
+
+    // ===== Retransmission timers (protected by pending_request_mutex) =====
+
+    LoadPacer pacer;                                ///< Retransmission timeout from the server's load (window of 1)
+    TimerWheel retransmit_timers;                   ///< Driven by the network thread
+    TimerNode retransmit_timer;                     ///< Timer of the pending request (or of the failover DISCOVERY)
+    uint64_t pending_send_ns;                       ///< Last send of the pending request (or failover DISCOVERY)
+    bool pending_retransmitted;                     ///< No RTT sample for its ACK (Karn's rule)
+
+    // ===== Failover state (protected by pending_request_mutex) =====
+
+    bool failing_over;                              ///< DISCOVERY sent to failover_target, request on hold
+    SocketAddress failover_target;                  ///< Candidate server (or broadcast address)
 };
@@ -0,0 +1,70 @@
+#pragma once
+#include "packet.h"
+#include <cstdint>
+
+/// Below this load hint the server has plenty of headroom: the window grows by one per reply
+constexpr uint8_t PACER_RAMP_BELOW = LOAD_HINT_TARGET / 2;
+
+/**
+ * @brief ### AIMD pacing of a client's requests from the load hint in the server's replies.
+ *
+ * Every reply carries the server's load (ReplyPayload::load). The window of requests that
+ * may be in flight follows it like a TCP congestion window:
+ * - load below PACER_RAMP_BELOW: +1 per reply (the window doubles every round trip, so a
+ *   recovered server is back at full speed after a few round trips)
+ * - load up to LOAD_HINT_TARGET: +1 per window of replies (additive increase)
+ * - load at or above LOAD_HINT_TARGET, or a retransmission timeout: window halved
+ *   (multiplicative decrease), at most once per window of replies, since the replies
+ *   already in flight report the same overload
+ *
+ * Every client sees the same hint, so a whole fleet backs off together before the server's
+ * queue builds up. Retransmissions back off with the load too: retransmit_timeout_ns()
+ * stretches the base timeout up to 3x, so a busy server isn't also flooded with copies of
+ * requests it is still working on.
+ *
+ * Not thread-safe (the owner serializes every call).
+ */
+class LoadPacer {
+public:
+    /**
+     * @param max_window Largest window (at least 1); the window starts at 1.
+     * @param base_timeout_ns Retransmission timeout of an idle server.
+     */
+    LoadPacer(uint32_t max_window, uint64_t base_timeout_ns);
+
+    /// Requests that may be in flight now (1..max_window)
+    uint32_t window() const { return static_cast<uint32_t>(congestion_window); }
+
+    /// Accounts a reply and the load it carried
+    void on_reply(uint8_t load);
+
+    /// Accounts a retransmission timeout (loss counts as overload)
+    void on_timeout();
+
+    /// Now talking to another server (failover): its load is unknown until it replies
+    void server_changed() { last_load = 0; }
+
+    /// Retransmission timeout for the last known load: base_timeout_ns × (1 + load / LOAD_HINT_TARGET)
+    uint64_t retransmit_timeout_ns() const;
+
+    /// Load hint of the last reply
+    uint8_t load() const { return last_load; }
+
+    /// Times the window was halved
+    uint64_t backoffs() const { return backoff_count; }
+
+    /// Smallest window reached after the first backoff (max_window if never backed off)
+    uint32_t min_window() const { return lowest_window; }
+
+private:
+    /// Halves the window unless it was already halved during the current window of replies
+    void back_off();
+
+    uint32_t max_window;
+    uint64_t base_timeout_ns;
+    double congestion_window = 1;
+    uint32_t replies_since_backoff;     ///< Replies since the last halving (gates the next one)
+    uint8_t last_load = 0;
+    uint64_t backoff_count = 0;
+    uint32_t lowest_window;
+};
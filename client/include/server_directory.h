@@ -0,0 +1,82 @@
+#pragma once
+#include "udp_socket.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// Consecutive timeouts after which a server is considered down (--failover-after default)
+constexpr uint32_t FAILOVER_DEFAULT_TIMEOUTS = 3;
+
+/**
+ * @brief ### Health statistics of one known server.
+ */
+struct ServerHealth {
+    SocketAddress addr;
+    uint64_t srtt_ns = 0;               ///< Smoothed RTT (EWMA, weight 1/8; 0 = never measured)
+    uint64_t replies = 0;               ///< Replies received (any type)
+    uint64_t timeouts = 0;              ///< Retransmission timeouts charged to this server
+    uint32_t consecutive_timeouts = 0;  ///< Timeouts since the last reply
+};
+
+/**
+ * @brief ### Ranked list of known servers with RTT and failure statistics.
+ *
+ * Servers come from the command line and from every DISCOVERY_ACK the client sees (a
+ * broadcast discovery may be answered by several servers). A server is down once it misses
+ * `failover_after` timeouts in a row, and up again on its next reply.
+ *
+ * Rank: servers up first, then fewer consecutive timeouts, then lower smoothed RTT (never
+ * measured last). RTT samples follow Karn's rule: callers only report replies to requests
+ * that were sent once. Not thread-safe (the owner serializes every call).
+ */
+class ServerDirectory {
+public:
+    /**
+     * @param failover_after Consecutive timeouts that mark a server down (at least 1).
+     * @param broadcast_addr Probed when no other server is up (broadcast discovery); an
+     *        invalid address (default) disables it.
+     */
+    explicit ServerDirectory(uint32_t failover_after = FAILOVER_DEFAULT_TIMEOUTS,
+                             const SocketAddress& broadcast_addr = SocketAddress());
+
+    /// Adds a server (no-op if already known)
+    void add(const SocketAddress& addr);
+
+    /**
+     * @brief ### Accounts a reply from a server (added if unknown): clears its timeout streak.
+     * @param rtt_ns RTT sample (0 = no sample, e.g. reply to a retransmitted request).
+     */
+    void record_reply(const SocketAddress& addr, uint64_t rtt_ns);
+
+    /**
+     * @brief ### Accounts a retransmission timeout of a server.
+     * @return True if the server is down (time to fail over). A server already down fails
+     *         again on its first timeout, so probing a dead server costs one timeout.
+     */
+    bool record_timeout(const SocketAddress& addr);
+
+    /**
+     * @brief ### Where to send DISCOVERY after `current` failed.
+     *
+     * Best ranked server up other than `current`; otherwise the broadcast address (if
+     * enabled); otherwise the best ranked other server even if down; otherwise `current`.
+     */
+    SocketAddress next_server(const SocketAddress& current) const;
+
+    bool is_broadcast(const SocketAddress& addr) const;
+
+    /// Same IP and port (the server is the same ledger)
+    static bool same_server(const SocketAddress& a, const SocketAddress& b);
+    bool is_down(const ServerHealth& server) const { return server.consecutive_timeouts >= failover_after; }
+
+    /// Every known server, best first
+    std::vector<const ServerHealth*> ranked() const;
+
+private:
+    ServerHealth* find(const SocketAddress& addr);
+    ServerHealth& entry(const SocketAddress& addr);     ///< Adds the server if unknown
+
+    std::vector<ServerHealth> servers;
+    uint32_t failover_after;
+    SocketAddress broadcast_addr;
+};
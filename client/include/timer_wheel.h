@@ -0,0 +1,152 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/// Levels of the wheel and slots per level (64^4 ticks = about 4.6 hours at 1 ms)
+constexpr uint32_t TIMER_WHEEL_LEVELS = 4;
+constexpr uint32_t TIMER_WHEEL_SLOT_BITS = 6;
+constexpr uint32_t TIMER_WHEEL_SLOTS = 1u << TIMER_WHEEL_SLOT_BITS;
+
+/**
+ * @brief ### Intrusive timer, embedded in the object it times (e.g. a request slot).
+ *
+ * Linked into one wheel slot while scheduled; the wheel never allocates. Copying yields an
+ * unscheduled timer (a scheduled node is owned by its slot list).
+ */
+struct TimerNode {
+    TimerNode* prev = nullptr;      ///< Slot list links (nullptr = not scheduled)
+    TimerNode* next = nullptr;
+    uint64_t expires_tick = 0;      ///< Absolute tick at which the timer fires
+
+    TimerNode() = default;
+    TimerNode(const TimerNode&) {}
+    TimerNode& operator=(const TimerNode&) { return *this; }
+
+    bool scheduled() const { return next != nullptr; }
+};
+
+/**
+ * @brief ### Hierarchical timing wheel: O(1) schedule and cancel, expiries fired per tick in batches.
+ *
+ * Level 0 has one slot per tick; each higher level has one slot per full rotation of the
+ * level below. A timer is placed at the lowest level whose span covers its delay, and moves
+ * down (cascades) when the level below wraps, so each timer is touched at most once per
+ * level no matter how many are pending.
+ *
+ * Timers farther than the wheel's span are parked at the horizon and re-placed until due.
+ * Not thread-safe: the owning thread (or a caller-held lock) serializes every call.
+ */
+class TimerWheel {
+public:
+    /**
+     * @brief ### Creates an empty wheel.
+     * @param tick_ns Resolution (timers fire at most one tick late).
+     * @param start_ns Current time (tick 0), same clock as every later call.
+     */
+    TimerWheel(uint64_t tick_ns, uint64_t start_ns);
+
+    TimerWheel(const TimerWheel&) = delete;
+    TimerWheel& operator=(const TimerWheel&) = delete;
+
+    /**
+     * @brief ### Schedules (or reschedules) a timer. O(1).
+     * @param deadline_ns Absolute time; a deadline already passed fires on the next tick.
+     */
+    void schedule(TimerNode& node, uint64_t deadline_ns);
+
+    /**
+     * @brief ### Unschedules a timer (no-op if not scheduled). O(1).
+     */
+    void cancel(TimerNode& node);
+
+    /**
+     * @brief ### Advances to now_ns and fires every expired timer.
+     *
+     * Each expired slot is detached before its callbacks run, so a callback may reschedule
+     * or cancel any timer, including the one it received.
+     * @param on_expired Called as on_expired(TimerNode&) once per expired timer.
+     * @return Number of timers fired.
+     */
+    template<typename Fn>
+    size_t advance(uint64_t now_ns, Fn&& on_expired);
+
+    /**
+     * @brief ### Milliseconds until advance() may have work (for poll/wait timeouts).
+     *
+     * Exact when a timer is due within the current level-0 rotation, otherwise the time to
+     * the next cascade. O(TIMER_WHEEL_SLOTS) at most.
+     * @param max_ms Returned when no timer is scheduled.
+     */
+    int32_t wait_ms(uint64_t now_ns, int32_t max_ms) const;
+
+    /// Scheduled timers
+    size_t size() const { return count; }
+
+    /// Monotonic clock in nanoseconds (the clock every caller of the wheel should use)
+    static uint64_t now_ns();
+
+private:
+    /**
+     * @brief Links a node into the slot matching its expiry (relative to current_tick).
+     * @param earliest_tick Slot assigned to already expired nodes: the next tick for new
+     *        timers, the current one for timers cascading down while it is processed.
+     */
+    void place(TimerNode& node, uint64_t earliest_tick);
+
+    /// Moves every timer of a higher-level slot down to where it now belongs
+    void cascade(uint32_t level, uint32_t index);
+
+    /// Detaches a slot's whole list into `out` (sentinel), leaving the slot empty
+    static void splice_out(TimerNode& slot, TimerNode& out);
+
+    static void unlink(TimerNode& node);
+
+    uint64_t tick_ns;
+    uint64_t start_ns;
+    uint64_t current_tick = 0;          ///< Last tick processed
+    size_t count = 0;
+    TimerNode slots[TIMER_WHEEL_LEVELS][TIMER_WHEEL_SLOTS];    ///< Circular list sentinels
+};
+
+// ===== Template implementation =====
+
+template<typename Fn>
+size_t TimerWheel::advance(uint64_t now_ns, Fn&& on_expired) {
+    uint64_t target_tick = now_ns > start_ns ? (now_ns - start_ns) / tick_ns : 0;
+    if (count == 0) {
+        // Nothing to fire or cascade: jump straight to the present
+        if (target_tick > current_tick) current_tick = target_tick;
+        return 0;
+    }
+
+    size_t fired = 0;
+    while (current_tick < target_tick && count > 0) {
+        current_tick++;
+
+        // A level wraps when every level below it wrapped: refill from the level above
+        uint64_t tick = current_tick;
+        for (uint32_t level = 1; level < TIMER_WHEEL_LEVELS; level++) {
+            if (tick & (TIMER_WHEEL_SLOTS - 1)) break;
+            tick >>= TIMER_WHEEL_SLOT_BITS;
+            cascade(level, static_cast<uint32_t>(tick & (TIMER_WHEEL_SLOTS - 1)));
+        }
+
+        TimerNode expired;
+        splice_out(slots[0][current_tick & (TIMER_WHEEL_SLOTS - 1)], expired);
+        while (expired.next != &expired) {
+            TimerNode& node = *expired.next;
+            unlink(node);
+            count--;
+            if (node.expires_tick > current_tick) {
+                // Parked at the horizon: not due yet
+                place(node, current_tick + 1);
+                count++;
+                continue;
+            }
+            fired++;
+            on_expired(node);
+        }
+    }
+    if (current_tick < target_tick) current_tick = target_tick;
+    return fired;
+}
@@ -1,18 +1,48 @@
 #include "client.h"
 #include <iostream>
 #include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Prints command line usage.
+ */
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " <server_port> [server_ip[,server_ip...]] [--notify] [--failover-after <n>]"
+              << " [--batch <file>] [--window <n>] [--results <file>]" << std::endl;
+}
+
+/**
+ * @brief Splits "a,b,c" into its non-empty parts.
+ */
+static std::vector<std::string> split_list(const std::string& list) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == std::string::npos) comma = list.size();
+        if (comma > start) parts.push_back(list.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return parts;
+}
 
 /**
  * @brief Client entry point - connects to server and sends transactions.
  * 
- * Usage: ./client <server_port> [server_ip]
+ * Usage: ./client <server_port> [server_ip[,server_ip...]] [--notify] [--failover-after <n>]
+ *                 [--batch <file>] [--window <n>] [--results <file>]
  * Examples:
  *   ./client 8080                  # Broadcast discovery
  *   ./client 8080 192.168.1.100    # Direct connection
+ *   ./client 8080 192.168.1.100,192.168.1.101 --failover-after 2  # Second server after 2 timeouts
+ *   ./client 8080 --notify         # Server pushes incoming credits (no polling)
+ *   ./client 8080 127.0.0.1 --batch transfers.txt              # Non-interactive, 16 requests in flight
+ *   ./client 8080 127.0.0.1 --batch transfers.txt --window 32  # Results in transfers.txt.results
  */
 int main(int argc, char* argv[]) {
-    if (argc < 2 || argc > 3) {
-        std::cerr << "Usage: " << argv[0] << " <server_port> [server_ip]" << std::endl;
+    if (argc < 2) {
+        print_usage(argv[0]);
         return 1;
     }
 
@@ -29,9 +59,54 @@ int main(int argc, char* argv[]) {
         return 1;
     }
 
+    // Parse optional arguments
+    std::vector<std::string> server_ips;    // Empty = broadcast discovery
+    bool notify_credits = false;    // Subscribe to credit notifications
+    uint32_t failover_after = FAILOVER_DEFAULT_TIMEOUTS;
+    BatchOptions batch;             // Batch mode if input_path is set
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--notify") {
+                notify_credits = true;
+            } else if (arg == "--failover-after" && i + 1 < argc) {
+                failover_after = static_cast<uint32_t>(std::stoul(argv[++i]));
+                if (failover_after == 0) {
+                    std::cerr << "Error: --failover-after must be at least 1" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--batch" && i + 1 < argc) {
+                batch.input_path = argv[++i];
+            } else if (arg == "--window" && i + 1 < argc) {
+                batch.window = static_cast<uint32_t>(std::stoul(argv[++i]));
+                if (batch.window == 0 || batch.window > MAX_REQUESTS_IN_FLIGHT) {
+                    std::cerr << "Error: Window must be in range 1-" << MAX_REQUESTS_IN_FLIGHT << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--results" && i + 1 < argc) {
+                batch.results_path = argv[++i];
+            } else if (i == 2 && arg.rfind("--", 0) != 0) {
+                server_ips = split_list(arg);
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+    if (notify_credits && !batch.input_path.empty()) {
+        std::cerr << "Error: --notify is not available in batch mode" << std::endl;
+        return 1;
+    }
+
     // Start client
     try {
-        Client client = (argc == 2) ? Client(server_port) : Client(server_port, argv[2]);
+        Client client(server_port, server_ips, notify_credits, failover_after);
+        if (!batch.input_path.empty()) {
+            return client.run_batch(batch) ? 0 : 1;
+        }
         client.run();
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
@@ -0,0 +1,430 @@
+#include "batch_runner.h"
+#include "client.h"
+#include "print_utils.h"
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include <windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+/**
+ * @brief Returns a printable name for a reply type (results file and summary).
+ */
+static const char* packet_type_name(uint8_t type) {
+    switch (type) {
+        case TRANSACTION_ACK: return "TRANSACTION_ACK";
+        case INSUFFICIENT_BALANCE_ACK: return "INSUFFICIENT_BALANCE_ACK";
+        case INVALID_CLIENT_ACK: return "INVALID_CLIENT_ACK";
+        case ERROR_ACK: return "ERROR_ACK";
+        case OUTCOME_UNKNOWN_ACK: return "OUTCOME_UNKNOWN_ACK";
+        default: return "OTHER";
+    }
+}
+
+static bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+/**
+ * @brief Parses "<a.b.c.d> <value>" (already trimmed) without copying or allocating.
+ * @param dest_ip [OUT] Destination in network byte order (same as SocketAddress::ip()).
+ */
+static bool parse_transfer(const char* p, const char* end, uint32_t& dest_ip, uint32_t& value) {
+    uint8_t octets[4];
+    for (int i = 0; i < 4; i++) {
+        unsigned octet = 0;
+        auto [next, ec] = std::from_chars(p, end, octet);
+        if (ec != std::errc() || octet > 255) return false;
+        octets[i] = static_cast<uint8_t>(octet);
+        p = next;
+        if (i < 3) {
+            if (p == end || *p != '.') return false;
+            p++;
+        }
+    }
+    if (p == end || !is_blank(*p)) return false;
+    while (p < end && is_blank(*p)) p++;
+
+    auto [next, ec] = std::from_chars(p, end, value);
+    if (ec != std::errc() || next != end || value > MAX_TRANSFER_VALUE) return false;
+
+    // Dotted order is network byte order
+    std::memcpy(&dest_ip, octets, sizeof(dest_ip));
+    return true;
+}
+
+static std::string format_us(uint64_t ns) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << ns / 1000.0 << " us";
+    return out.str();
+}
+
+// ===== MappedFile =====
+
+MappedFile::~MappedFile() {
+#ifdef _WIN32
+    if (data) UnmapViewOfFile(data);
+    if (mapping_handle) CloseHandle(mapping_handle);
+    if (file_handle) CloseHandle(file_handle);
+#else
+    if (data) munmap(const_cast<char*>(data), length);
+#endif
+}
+
+bool MappedFile::open(const std::string& path) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    file_handle = file;
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) return false;
+    if (size.QuadPart == 0) return true;   // Nothing to map
+
+    mapping_handle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping_handle) return false;
+    data = static_cast<const char*>(MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0));
+    if (!data) return false;
+    length = static_cast<size_t>(size.QuadPart);
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (info.st_size == 0) {
+        ::close(fd);
+        return true;   // mmap() rejects empty ranges
+    }
+
+    void* mapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);   // The mapping keeps the file referenced
+    if (mapping == MAP_FAILED) return false;
+
+    // One forward pass: let the kernel read ahead aggressively
+    madvise(mapping, static_cast<size_t>(info.st_size), MADV_SEQUENTIAL);
+    data = static_cast<const char*>(mapping);
+    length = static_cast<size_t>(info.st_size);
+    return true;
+#endif
+}
+
+// ===== Constructor =====
+
+BatchRunner::BatchRunner(UDPSocket& socket, ServerDirectory& servers, const SocketAddress& server_addr, uint32_t first_request_id,
+                         uint64_t session_key, const BatchOptions& options)
+    : socket(socket), servers(servers), server_addr(server_addr), session_key(session_key), options(options),
+      first_request_id(first_request_id), base_request_id(first_request_id), next_request_id(first_request_id),
+      pacer(std::clamp<uint32_t>(options.window, 1, MAX_REQUESTS_IN_FLIGHT), ACK_TIMEOUT_NS),
+      retransmit_timers(RETRANSMIT_TICK_NS, TimerWheel::now_ns()) {
+    this->options.window = std::clamp<uint32_t>(options.window, 1, MAX_REQUESTS_IN_FLIGHT);
+    slots.resize(this->options.window);
+}
+
+// ===== Main execution =====
+
+bool BatchRunner::run() {
+    if (!input.open(options.input_path)) {
+        std::cerr << "Cannot read batch file " << options.input_path << std::endl;
+        return false;
+    }
+    std::string results_path = options.results_path.empty() ? options.input_path + ".results" : options.results_path;
+    results.open(results_path, std::ios::out | std::ios::trunc);
+    if (!results) {
+        std::cerr << "Cannot create results file " << results_path << std::endl;
+        return false;
+    }
+    cursor = input.begin();
+
+    const std::vector<const UDPSocket*> watched = {&socket};
+    std::vector<size_t> ready;
+    bool input_done = false;
+    auto start = std::chrono::steady_clock::now();
+
+    while (true) {
+        uint64_t now = TimerWheel::now_ns();
+
+        // Fill the paced window: ids in flight never span more than its size (on hold while failing over)
+        while (!input_done && !failing_over && next_request_id - base_request_id < pacer.window()) {
+            Slot& slot = slot_for(next_request_id);
+            if (!next_transfer(slot)) {
+                input_done = true;
+                break;
+            }
+            slot.packet.request_id = next_request_id++;
+            PacketAuth::sign(slot.packet, session_key);
+            slot.answered = false;
+            slot.retransmitted = false;
+            slot.first_send_ns = now;
+            transmit(slot, now);
+        }
+        if (base_request_id == next_request_id) break;   // Input exhausted, nothing in flight
+
+        // Sleep until a reply arrives or the earliest retransmission is due
+        UDPSocket::wait_readable(watched, retransmit_timers.wait_ms(now, ACK_TIMEOUT_MS), ready);
+
+        now = TimerWheel::now_ns();
+        drain_replies(now);
+
+        // Expired timers (answered ones were cancelled): resend, or fail over if the server is down
+        expired.clear();
+        retransmit_timers.advance(now, [this](TimerNode& timer) { expired.push_back(&timer); });
+        if (!expired.empty()) handle_timeouts(now);
+
+        // Complete in request order: frees window space for the next lines
+        while (base_request_id != next_request_id && slot_for(base_request_id).answered) {
+            complete(slot_for(base_request_id));
+            base_request_id++;
+        }
+    }
+
+    double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    results.flush();
+    print_summary(elapsed_s);
+    std::cout << "Results written to " << results_path << std::endl;
+    return true;
+}
+
+// ===== Input parsing =====
+
+bool BatchRunner::next_transfer(Slot& slot) {
+    const char* end = input.end();
+    while (cursor < end) {
+        const char* line_end = static_cast<const char*>(std::memchr(cursor, '\n', static_cast<size_t>(end - cursor)));
+        if (!line_end) line_end = end;
+        const char* first = cursor;
+        const char* last = line_end;
+        cursor = line_end == end ? end : line_end + 1;
+        line_number++;
+
+        while (first < last && is_blank(*first)) first++;
+        while (last > first && is_blank(last[-1])) last--;
+        if (first == last) continue;   // Blank line
+
+        uint32_t dest_ip = 0;
+        uint32_t value = 0;
+        if (!parse_transfer(first, last, dest_ip, value)) {
+            malformed_lines++;
+            std::cerr << "Line " << line_number << ": malformed transfer skipped" << std::endl;
+            continue;
+        }
+
+        slot.line_number = line_number;
+        slot.packet = Packet::create_request(TRANSACTION_REQUEST, 0, dest_ip, value);
+        return true;
+    }
+    return false;
+}
+
+// ===== Network =====
+
+void BatchRunner::transmit(Slot& slot, uint64_t now_ns) {
+    // A failed send is retried by the retransmission timer like a lost datagram
+    socket.send(&slot.packet, sizeof(Packet), server_addr);
+    retransmit_timers.schedule(slot, now_ns + pacer.retransmit_timeout_ns());
+}
+
+void BatchRunner::drain_replies(uint64_t now_ns) {
+    Packet reply;
+    SocketAddress from;
+    int32_t bytes_received;
+    while ((bytes_received = socket.receive(&reply, sizeof(Packet), from)) > 0) {
+        if (bytes_received != static_cast<int32_t>(sizeof(Packet))) continue;
+        if (reply.type == DISCOVERY_COOKIE) {
+            // Failover target doesn't know us yet: echo the cookie (a new RTT sample starts)
+            if (failing_over) {
+                Packet echo_packet = Packet::create_discovery(reply.auth);
+                socket.send(&echo_packet, sizeof(Packet), from);
+                discovery_send_ns = now_ns;
+            }
+            continue;
+        }
+        if (reply.type == DISCOVERY_ACK) {
+            if (failing_over) {
+                complete_failover(from, reply, now_ns);
+            } else {
+                servers.add(from);   // Late answer to a broadcast: one more failover candidate
+            }
+            continue;
+        }
+        if (from.ip() != server_addr.ip()) continue;
+        switch (reply.type) {
+            case TRANSACTION_ACK:
+            case INSUFFICIENT_BALANCE_ACK:
+            case INVALID_CLIENT_ACK:
+            case ERROR_ACK:
+            case OUTCOME_UNKNOWN_ACK:
+                break;
+            default:
+                continue;   // Not a transaction reply
+        }
+
+        // Outside the window: reply to an already completed request (duplicate)
+        if (reply.request_id - base_request_id >= next_request_id - base_request_id) continue;
+
+        Slot& slot = slot_for(reply.request_id);
+        if (slot.answered) continue;
+        slot.answered = true;
+        retransmit_timers.cancel(slot);
+        slot.reply_type = reply.type;
+        slot.new_balance = reply.payload.reply.new_balance;
+        slot.latency_ns = now_ns - slot.first_send_ns;
+        pacer.on_reply(reply.payload.reply.load);
+
+        servers.record_reply(server_addr, slot.retransmitted || failing_over ? 0 : slot.latency_ns);
+        if (failing_over) abort_failover(now_ns);   // Slow, not down
+    }
+}
+
+void BatchRunner::handle_timeouts(uint64_t now_ns) {
+    if (failing_over) {
+        // Only discovery_timer runs while failing over (slot timers are cancelled)
+        if (servers.record_timeout(failover_target)) {
+            failover_target = servers.next_server(failover_target);
+            discovery_retransmitted = false;
+        } else {
+            discovery_retransmitted = true;
+        }
+        probe_failover_target(now_ns);
+        return;
+    }
+
+    // However many slots expired together, the server missed one round: one timeout
+    pacer.on_timeout();
+    if (!servers.record_timeout(server_addr)) {
+        for (TimerNode* timer : expired) {
+            Slot& slot = static_cast<Slot&>(*timer);
+            slot.retransmitted = true;
+            transmit(slot, now_ns);
+        }
+        retransmissions += expired.size();
+        return;
+    }
+
+    // Server down: hold the window and look for another server
+    std::cerr << "Server " << server_addr.ip_string() << " not answering, failing over." << std::endl;
+    failovers++;
+    failing_over = true;
+    for (uint32_t request_id = base_request_id; request_id != next_request_id; request_id++) {
+        retransmit_timers.cancel(slot_for(request_id));
+    }
+    failover_target = servers.next_server(server_addr);
+    discovery_retransmitted = false;
+    probe_failover_target(now_ns);
+}
+
+// ===== Failover =====
+
+void BatchRunner::probe_failover_target(uint64_t now_ns) {
+    Packet discovery_packet = Packet::create_discovery();
+    socket.send(&discovery_packet, sizeof(Packet), failover_target);
+    discovery_send_ns = now_ns;
+    retransmit_timers.schedule(discovery_timer, now_ns + ACK_TIMEOUT_NS);
+}
+
+void BatchRunner::complete_failover(const SocketAddress& new_server, const Packet& discovery_ack, uint64_t now_ns) {
+    servers.record_reply(new_server, discovery_retransmitted ? 0 : now_ns - discovery_send_ns);
+    retransmit_timers.cancel(discovery_timer);
+    failing_over = false;
+    session_key = discovery_ack.auth;
+    PrintUtils::print_discovery_reply(new_server.ip());
+
+    // Same server after all (no other candidate, or it answered the broadcast): it may have
+    // applied requests whose replies were lost, so they keep their ids (0 offset) and get
+    // their original replies instead of being applied again under new ones
+    uint32_t offset = 0;
+    if (!ServerDirectory::same_server(new_server, server_addr)) {
+        // Continue the new server's request_id sequence. Every id moves by the same offset,
+        // so (request_id - first_request_id) and therefore each request's slot stay the same
+        offset = discovery_ack.request_id + 1 - base_request_id;
+        server_addr = new_server;
+        pacer.server_changed();
+    }
+    first_request_id += offset;
+    base_request_id += offset;
+    next_request_id += offset;
+    for (uint32_t request_id = base_request_id; request_id != next_request_id; request_id++) {
+        Slot& slot = slot_for(request_id);
+        slot.packet.request_id = request_id;
+        PacketAuth::sign(slot.packet, session_key);
+        if (slot.answered) continue;
+        slot.retransmitted = true;   // Latency spans the outage: not an RTT sample
+        transmit(slot, now_ns);
+    }
+}
+
+void BatchRunner::abort_failover(uint64_t now_ns) {
+    retransmit_timers.cancel(discovery_timer);
+    failing_over = false;
+    for (uint32_t request_id = base_request_id; request_id != next_request_id; request_id++) {
+        Slot& slot = slot_for(request_id);
+        if (slot.answered) continue;
+        slot.retransmitted = true;
+        transmit(slot, now_ns);
+    }
+}
+
+// ===== Results =====
+
+void BatchRunner::complete(const Slot& slot) {
+    results << slot.line_number << ' '
+            << SocketAddress(slot.packet.payload.request.destination_ip).ip_string() << ' '
+            << slot.packet.payload.request.value << ' '
+            << packet_type_name(slot.reply_type) << ' '
+            << slot.new_balance << ' '
+            << slot.latency_ns / 1000 << '\n';
+    replies_by_type[slot.reply_type]++;
+    latencies_ns.push_back(slot.latency_ns);
+}
+
+void BatchRunner::print_summary(double elapsed_s) const {
+    uint64_t completed = latencies_ns.size();
+    std::cout << "Batch: " << completed << " transfers in " << std::fixed << std::setprecision(3) << elapsed_s
+              << " s (" << std::setprecision(0) << (elapsed_s > 0 ? completed / elapsed_s : 0.0)
+              << " transfers/s), window " << options.window << std::endl;
+    for (int type = 0; type < 256; type++) {
+        if (replies_by_type[type] > 0) {
+            std::cout << "  " << packet_type_name(static_cast<uint8_t>(type)) << " " << replies_by_type[type] << std::endl;
+        }
+    }
+    std::cout << "  Retransmissions " << retransmissions << std::endl;
+    std::cout << "  Pacing window " << pacer.window() << " (min " << pacer.min_window() << "), backoffs "
+              << pacer.backoffs() << ", last load " << static_cast<int>(pacer.load()) << std::endl;
+    if (failovers > 0) std::cout << "  Failovers " << failovers << std::endl;
+    for (const ServerHealth* server : servers.ranked()) {
+        std::cout << "  Server " << server->addr.ip_string() << " replies " << server->replies
+                  << " timeouts " << server->timeouts << " srtt " << format_us(server->srtt_ns)
+                  << (servers.is_down(*server) ? " (down)" : "") << std::endl;
+    }
+    if (malformed_lines > 0) std::cout << "  Malformed lines " << malformed_lines << std::endl;
+    if (latencies_ns.empty()) return;
+
+    std::vector<uint64_t> sorted = latencies_ns;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+    };
+    std::cout << "Latency      p50          p90          p99          max" << std::endl;
+    std::cout << std::setw(7) << "";
+    for (double p : {0.5, 0.9, 0.99}) {
+        std::cout << std::setw(13) << format_us(percentile(p));
+    }
+    std::cout << std::setw(13) << format_us(sorted.back()) << std::endl;
+}
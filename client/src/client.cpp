@@ -2,18 +2,33 @@
 #include "print_utils.h"
 #include <iostream>
 #include <sstream>
+#include <stdexcept>
 #include <chrono>
 
 // ===== Constructor =====
 
-Client::Client(uint16_t server_port, const std::string& server_ip) : next_request_id(1) {
+Client::Client(uint16_t server_port, const std::vector<std::string>& server_ips, bool notify_credits, uint32_t failover_after)
+    : has_server_address(false),
+      // Without known servers, failover broadcasts DISCOVERY again when no other server is up
+      servers(failover_after, server_ips.empty() ? SocketAddress::broadcast(server_port) : SocketAddress()),
+      next_request_id(1), session_key(0), notify_credits(notify_credits), subscribed(false), last_notify_id(0),
+      pacer(1, ACK_TIMEOUT_NS), retransmit_timers(RETRANSMIT_TICK_NS, TimerWheel::now_ns()), pending_send_ns(0),
+      pending_retransmitted(false),
+      failing_over(false) {
     pending_ack_request_id.store(0); // 0 indicates no pending request
     
-    // Pre-configure server address if known IP provided (skips broadcast discovery)
-    if (!server_ip.empty()) {
-        // Validate if address was created successfully (check sin_addr)
-        this->server_addr = SocketAddress(server_ip, server_port);
-        has_server_address = this->server_addr.is_valid();
+    // Pre-configure known servers if IPs provided (skips broadcast discovery), preferred first
+    if (!server_ips.empty()) {
+        for (const std::string& ip : server_ips) {
+            // Validate if address was created successfully (check sin_addr)
+            SocketAddress addr(ip, server_port);
+            if (!addr.is_valid()) {
+                throw std::invalid_argument("Invalid server IP address: " + ip);
+            }
+            servers.add(addr);
+        }
+        this->server_addr = SocketAddress(server_ips.front(), server_port);
+        has_server_address = true;
     } else {
         // No IP provided: will perform broadcast discovery
         this->server_addr = SocketAddress::broadcast(server_port);
@@ -36,6 +51,11 @@ void Client::run() {
     } else {
         discover_server(); // Broadcast DISCOVERY to 255.255.255.255
     }
+
+    // Optional: ask the server to push incoming credits (no polling needed)
+    if (notify_credits) {
+        subscribe_to_credits();
+    }
     
     // Phase 2: Spawn network thread to listen for ACKs asynchronously
     // Main thread will block on user input, network thread handles responses in parallel
@@ -51,13 +71,28 @@ void Client::run() {
     }
 }
 
+bool Client::run_batch(const BatchOptions& options) {
+    if (!client_socket.initialize(0, true)) {
+        std::cerr << "Failed to initialize client socket." << std::endl;
+        return false;
+    }
+
+    // Same discovery as interactive mode (DISCOVERY_ACK gives the first free request_id)
+    if (has_server_address) {
+        connect_to_known_server();
+    } else {
+        discover_server();
+    }
+
+    BatchRunner runner(client_socket, servers, server_addr, next_request_id, session_key, options);
+    return runner.run();
+}
+
 // ===== Server discovery =====
 
 void Client::discover_server() {
     // Discovery packet has request_id = 0 (special value, not counted in next_request_id)
-    Packet discovery_packet;
-    discovery_packet.type = DISCOVERY;
-    discovery_packet.request_id = 0;
+    Packet discovery_packet = Packet::create_discovery();
 
     // Retry loop: send DISCOVERY every ACK_TIMEOUT_MS until server responds
     while (!has_server_address) {
@@ -70,10 +105,22 @@ void Client::discover_server() {
             Packet response_packet;
             SocketAddress received_from_addr;
             if (client_socket.receive(&response_packet, sizeof(Packet), received_from_addr) > 0) {
+                if (response_packet.type == DISCOVERY_COOKIE) {
+                    // New account: prove our address by echoing the cookie to the server that sent it
+                    Packet echo_packet = Packet::create_discovery(response_packet.auth);
+                    client_socket.send(&echo_packet, sizeof(Packet), received_from_addr);
+                    start_time = std::chrono::steady_clock::now();
+                    continue;
+                }
                 if (response_packet.type == DISCOVERY_ACK) {
+                    // First server to answer is also the first RTT sample of the directory
+                    servers.record_reply(received_from_addr, static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count()));
+
                     // Success: store server's address for future transactions
                     this->server_addr = received_from_addr;
                     this->next_request_id = response_packet.request_id + 1; // Sync next_request_id with server's echo
+                    this->session_key = response_packet.auth;               // Signs every following request
                     this->has_server_address = true;
                     PrintUtils::print_discovery_reply(server_addr.ip());
                     return;
@@ -86,27 +133,66 @@ void Client::discover_server() {
 
 void Client::connect_to_known_server() {
     // Same as discover_server() but sends to specific IP instead of broadcast
-    Packet discovery_packet;
-    discovery_packet.type = DISCOVERY;
-    discovery_packet.request_id = 0;
+    Packet discovery_packet = Packet::create_discovery();
 
     // Retry loop: server might not be ready yet or packets might be lost
-    bool received_ack = false;
-    while (!received_ack) {
-        client_socket.send(&discovery_packet, sizeof(Packet), server_addr);
+    SocketAddress target = server_addr;
+    while (true) {
+        client_socket.send(&discovery_packet, sizeof(Packet), target);
         
-        // Wait for DISCOVERY_ACK from the specific server IP
+        // Wait for DISCOVERY_ACK (a multi-homed server may answer from another of its IPs)
         auto start_time = std::chrono::steady_clock::now(); // Start timer
         while (std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(ACK_TIMEOUT_MS)) {
             Packet response_packet;
             SocketAddress received_from_addr;
             if (client_socket.receive(&response_packet, sizeof(Packet), received_from_addr) > 0) {
+                if (response_packet.type == DISCOVERY_COOKIE) {
+                    Packet echo_packet = Packet::create_discovery(response_packet.auth);
+                    client_socket.send(&echo_packet, sizeof(Packet), received_from_addr);
+                    start_time = std::chrono::steady_clock::now();
+                    continue;
+                }
                 if (response_packet.type == DISCOVERY_ACK) {
-                    // Verify response came from expected server (could add IP validation here)
+                    servers.record_reply(received_from_addr, static_cast<uint64_t>(
+                        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start_time).count()));
                     this->server_addr = received_from_addr;
                     this->next_request_id = response_packet.request_id + 1; // Sync next_request_id with server's echo
-                    received_ack = true;
+                    this->session_key = response_packet.auth;               // Signs every following request
                     PrintUtils::print_discovery_reply(server_addr.ip());
+                    return;
+                }
+            }
+        }
+        // If no response, retransmit (to the next known server once this one is down)
+        if (servers.record_timeout(target)) {
+            target = servers.next_server(target);
+        }
+    }
+}
+
+void Client::subscribe_to_credits() {
+    Packet subscribe_packet = Packet::create_request(SUBSCRIBE, 0, 0, 0);
+    PacketAuth::sign(subscribe_packet, session_key);
+
+    // Retry loop: same pattern as discovery (network thread isn't running yet)
+    while (true) {
+        client_socket.send(&subscribe_packet, sizeof(Packet), server_addr);
+
+        auto start_time = std::chrono::steady_clock::now(); // Start timer
+        while (std::chrono::steady_clock::now() - start_time < std::chrono::milliseconds(ACK_TIMEOUT_MS)) {
+            Packet response_packet;
+            SocketAddress received_from_addr;
+            if (client_socket.receive(&response_packet, sizeof(Packet), received_from_addr) > 0) {
+                if (response_packet.type == SUBSCRIBE_ACK) {
+                    std::cout << "Subscribed to credit notifications (balance "
+                              << response_packet.payload.reply.new_balance << ").\n\n";
+                    subscribed = true;
+                    return;
+                }
+                if (response_packet.type == ERROR_ACK) {
+                    std::cerr << "Subscription rejected by server.\n\n";
+                    subscribed = true; // Don't retry with every request
+                    return;
                 }
             }
         }
@@ -159,29 +245,111 @@ void Client::send_request(const Packet& packet) {
     pending_ack_request_id.store(packet.request_id);
     
     // Store packet for two reasons:
-    // 1. Retransmission (if needed within this function)
+    // 1. Retransmission (by the network thread when the timer expires)
     // 2. Printing reply in handle_server_responses() (after ACK arrives)
     pending_request_packet = packet;
+    PacketAuth::sign(pending_request_packet, session_key);
+    pending_send_ns = TimerWheel::now_ns();
+    pending_retransmitted = false;
+
+    // First transmission here, retransmissions from the network thread's timer wheel
+    if (!transmit_pending()) {
+        // Socket send failed (network error), abort this request
+        pending_ack_request_id.store(0); // Clear pending state
+        return;
+    }
+    retransmit_timers.schedule(retransmit_timer, pending_send_ns + pacer.retransmit_timeout_ns());
+
+    // Wait until the network thread clears pending_ack_request_id (ACK received or send failed).
+    // Failover may renumber the request meanwhile, so wait for 0 rather than another id
+    ack_received_cv.wait(lock, [this] { return pending_ack_request_id.load() == 0; });
+}
+
+bool Client::transmit_pending() {
+    // Subscription is per server: repeat it with each request until the current one acks
+    if (notify_credits && !subscribed) {
+        Packet subscribe_packet = Packet::create_request(SUBSCRIBE, 0, 0, 0);
+        PacketAuth::sign(subscribe_packet, session_key);
+        client_socket.send(&subscribe_packet, sizeof(Packet), server_addr);
+    }
+    return client_socket.send(&pending_request_packet, sizeof(Packet), server_addr);
+}
+
+void Client::fire_retransmissions(uint64_t now_ns) {
+    retransmit_timers.advance(now_ns, [this, now_ns](TimerNode& timer) {
+        if (pending_ack_request_id.load() == 0) return;   // Answered meanwhile
 
-    // Stop-and-wait loop: retransmit every ACK_TIMEOUT_MS until ACK arrives
-    while (pending_ack_request_id.load() == packet.request_id) {
-        // Send packet to server
-        if (!client_socket.send(&packet, sizeof(Packet), server_addr)) {
-            // Socket send failed (network error), abort this request
-            pending_ack_request_id.store(0); // Clear pending state
-            return;
+        if (!failing_over) {
+            pacer.on_timeout();
+            if (!servers.record_timeout(server_addr)) {
+                pending_retransmitted = true;
+                if (!transmit_pending()) {
+                    // Socket send failed (network error), abort this request
+                    pending_ack_request_id.store(0);
+                    ack_received_cv.notify_one();
+                    return;
+                }
+                retransmit_timers.schedule(timer, now_ns + pacer.retransmit_timeout_ns());
+                return;
+            }
+
+            // Server down: hold the request and look for another server
+            std::cerr << "Server " << server_addr.ip_string() << " not answering, failing over.\n\n";
+            failing_over = true;
+            failover_target = servers.next_server(server_addr);
+            pending_retransmitted = false;
+        } else if (servers.record_timeout(failover_target)) {
+            // Candidate silent too: move on to the next one
+            failover_target = servers.next_server(failover_target);
+            pending_retransmitted = false;
+        } else {
+            pending_retransmitted = true;
         }
+        probe_failover_target(now_ns);
+    });
+}
 
-        // Wait for ACK with timeout:
-        // - If ACK arrives: network thread calls notify_one(), this wakes up
-        // - If timeout: spurious wakeup, loop condition checks if ACK arrived
-        // - If ACK arrived: pending_ack_request_id is now 0, loop exits
-        ack_received_cv.wait_for(lock, std::chrono::milliseconds(ACK_TIMEOUT_MS));
-        
-        // Loop continues if pending_ack_request_id still equals packet.request_id
-        // (meaning ACK didn't arrive yet, so retransmit)
+// ===== Failover =====
+
+void Client::probe_failover_target(uint64_t now_ns) {
+    Packet discovery_packet = Packet::create_discovery();
+    client_socket.send(&discovery_packet, sizeof(Packet), failover_target);
+    pending_send_ns = now_ns;
+    retransmit_timers.schedule(retransmit_timer, now_ns + ACK_TIMEOUT_NS);
+}
+
+void Client::complete_failover(const SocketAddress& new_server, const Packet& discovery_ack, uint64_t now_ns) {
+    servers.record_reply(new_server, pending_retransmitted ? 0 : now_ns - pending_send_ns);
+    failing_over = false;
+    PrintUtils::print_discovery_reply(new_server.ip());
+
+    // Same server after all (no other candidate, or it answered the broadcast): it may have
+    // applied the request and lost the reply, so the request keeps its id (a new one would
+    // apply it again)
+    bool same_id = ServerDirectory::same_server(new_server, server_addr);
+    if (!same_id) {
+        // Continue the new server's request_id sequence: the held request becomes its next one
+        server_addr = new_server;
+        subscribed = false;
+        next_request_id = discovery_ack.request_id + 1;
+        pacer.server_changed();
+        pending_request_packet.request_id = next_request_id;
+        pending_ack_request_id.store(next_request_id);
+    }
+    // Signed again: the id may have changed, and the server issued the session key anew
+    session_key = discovery_ack.auth;
+    PacketAuth::sign(pending_request_packet, session_key);
+    pending_send_ns = now_ns;
+    pending_retransmitted = same_id;     // Karn: a reply to the same id may answer an earlier send
+
+    if (!transmit_pending()) {
+        // Socket send failed (network error), abort this request
+        retransmit_timers.cancel(retransmit_timer);
+        pending_ack_request_id.store(0);
+        ack_received_cv.notify_one();
+        return;
     }
-    // Exit when pending_ack_request_id == 0 (set by network thread upon ACK)
+    retransmit_timers.schedule(retransmit_timer, now_ns + pacer.retransmit_timeout_ns());
 }
 
 // ===== Response handling thread =====
@@ -190,48 +358,120 @@ void Client::handle_server_responses() {
     Packet response_packet;
     SocketAddress sender_addr;
 
+    const std::vector<const UDPSocket*> watched = {&client_socket};
+    std::vector<size_t> ready;
+
     while (true) {
-        // Blocking receive: wait indefinitely for next packet from server
-        // Socket is in blocking mode, so this doesn't spin CPU
+        // Sleep until a packet arrives or the next retransmission is due (socket is
+        // non-blocking: no spinning on receive). With no timer armed, wake up every
+        // ACK_TIMEOUT_MS so a timer armed meanwhile never fires more than a tick late
+        int32_t timeout_ms;
+        {
+            std::lock_guard<std::mutex> lock(pending_request_mutex);
+            timeout_ms = retransmit_timers.wait_ms(TimerWheel::now_ns(), ACK_TIMEOUT_MS);
+        }
+        UDPSocket::wait_readable(watched, timeout_ms, ready);
+        uint64_t now_ns = TimerWheel::now_ns();
+
         int32_t bytes_received;
-        do {
-            bytes_received = client_socket.receive(&response_packet, sizeof(Packet), sender_addr);
-        } while (bytes_received < 1); // Retry if receive fails (shouldn't happen in blocking mode)
-        
-        // Fast path check: is this ACK for the current pending request?
-        // Uses atomic load WITHOUT mutex for performance (hot path)
-        if (response_packet.request_id == pending_ack_request_id.load()) {
-            {
-                // Acquire mutex to safely clear pending state
-                std::lock_guard<std::mutex> lock(pending_request_mutex);
-                pending_ack_request_id.store(0); // Signal: "ACK received, stop retransmitting"
-            }
-            // Wake up send_request() which is waiting on ack_received_cv
-            ack_received_cv.notify_one();
-
-            // Process different ACK types (all mean request was processed, but with different results)
-            switch (response_packet.type) {
-                case TRANSACTION_ACK:
-                    // Success: print transaction details and new balance
-                    PrintUtils::print_reply(
+        while ((bytes_received = client_socket.receive(&response_packet, sizeof(Packet), sender_addr)) > 0) {
+            // Pushed credit: request_id is the server's notification number, never matched against ours
+            if (response_packet.type == CREDIT_NOTIFY) {
+                // Always ack (our previous ack may have been lost), print only the first copy
+                Packet ack_packet = Packet::create_request(CREDIT_NOTIFY_ACK, response_packet.request_id, 0, 0);
+                {
+                    std::lock_guard<std::mutex> lock(pending_request_mutex);   // session_key changes on failover
+                    PacketAuth::sign(ack_packet, session_key);
+                }
+                client_socket.send(&ack_packet, sizeof(Packet), sender_addr);
+
+                // At most one notification in flight: a retransmission always repeats the last id
+                if (response_packet.request_id != last_notify_id) {
+                    last_notify_id = response_packet.request_id;
+                    PrintUtils::print_credit(
                         sender_addr.ip(),
-                        pending_request_packet.request_id,
-                        pending_request_packet.payload.request.destination_ip,
-                        pending_request_packet.payload.request.value,
-                        response_packet.payload.reply.new_balance
+                        response_packet.request_id,
+                        response_packet.payload.notify.credited,
+                        response_packet.payload.notify.new_balance
                     );
-                    break;
-                case INSUFFICIENT_BALANCE_ACK:
-                    std::cout << "Transaction failed: Insufficient balance.\n\n";
-                    break;
-                case INVALID_CLIENT_ACK:
-                    std::cout << "Transaction failed: Invalid destination client.\n\n";
-                    break;
-                case ERROR_ACK:
-                    std::cout << "Transaction failed: Server error.\n\n";
-                    break;
+                }
+                continue;
             }
+
+            if (response_packet.type == DISCOVERY_COOKIE) {
+                // Failover target doesn't know us yet: echo the cookie (a new RTT sample starts)
+                std::lock_guard<std::mutex> lock(pending_request_mutex);
+                if (failing_over && pending_ack_request_id.load() != 0) {
+                    Packet echo_packet = Packet::create_discovery(response_packet.auth);
+                    client_socket.send(&echo_packet, sizeof(Packet), sender_addr);
+                    pending_send_ns = now_ns;
+                }
+                continue;
+            }
+            if (response_packet.type == DISCOVERY_ACK) {
+                std::lock_guard<std::mutex> lock(pending_request_mutex);
+                if (failing_over && pending_ack_request_id.load() != 0) {
+                    complete_failover(sender_addr, response_packet, now_ns);
+                } else {
+                    servers.add(sender_addr); // Late answer to a broadcast: one more failover candidate
+                }
+                continue;
+            }
+            if (response_packet.type == SUBSCRIBE_ACK) {
+                std::lock_guard<std::mutex> lock(pending_request_mutex);
+                subscribed = true;
+                continue;
+            }
+        
+            // Fast path check: is this ACK for the current pending request (from the current server)?
+            // Uses atomic load WITHOUT mutex for performance (hot path); server_addr only changes in this thread
+            if (response_packet.request_id == pending_ack_request_id.load() && sender_addr.ip() == server_addr.ip()) {
+                {
+                    // Acquire mutex to safely clear pending state
+                    std::lock_guard<std::mutex> lock(pending_request_mutex);
+                    pending_ack_request_id.store(0); // Signal: "ACK received, stop retransmitting"
+                    retransmit_timers.cancel(retransmit_timer);
+                    // A slow server may still answer while we look for another one (no RTT sample then)
+                    bool rtt_sample = !failing_over && !pending_retransmitted;
+                    failing_over = false;
+                    servers.record_reply(server_addr, rtt_sample ? now_ns - pending_send_ns : 0);
+                    pacer.on_reply(response_packet.payload.reply.load);
+                }
+                // Wake up send_request() which is waiting on ack_received_cv
+                ack_received_cv.notify_one();
+
+                // Process different ACK types (all mean request was processed, but with different results)
+                switch (response_packet.type) {
+                    case TRANSACTION_ACK:
+                        // Success: print transaction details and new balance
+                        PrintUtils::print_reply(
+                            sender_addr.ip(),
+                            pending_request_packet.request_id,
+                            pending_request_packet.payload.request.destination_ip,
+                            pending_request_packet.payload.request.value,
+                            response_packet.payload.reply.new_balance
+                        );
+                        break;
+                    case INSUFFICIENT_BALANCE_ACK:
+                        std::cout << "Transaction failed: Insufficient balance.\n\n";
+                        break;
+                    case INVALID_CLIENT_ACK:
+                        std::cout << "Transaction failed: Invalid destination client.\n\n";
+                        break;
+                    case ERROR_ACK:
+                        std::cout << "Transaction failed: Server error.\n\n";
+                        break;
+                    case OUTCOME_UNKNOWN_ACK:
+                        std::cout << "Transaction outcome unknown (processed long ago), balance: "
+                                  << response_packet.payload.reply.new_balance << "\n\n";
+                        break;
+                }
+            }
+            // If request_id doesn't match: ignore packet (duplicate ACK from previous request or out-of-order)
         }
-        // If request_id doesn't match: ignore packet (duplicate ACK from previous request or out-of-order)
+
+        // Batch of expired retransmission timers
+        std::lock_guard<std::mutex> lock(pending_request_mutex);
+        fire_retransmissions(TimerWheel::now_ns());
     }
 }
@@ -0,0 +1,45 @@
+#include "load_pacer.h"
+#include <algorithm>
+
+// ===== Constructor =====
+
+LoadPacer::LoadPacer(uint32_t max_window, uint64_t base_timeout_ns)
+    : max_window(std::max<uint32_t>(max_window, 1)), base_timeout_ns(base_timeout_ns),
+      replies_since_backoff(this->max_window), lowest_window(this->max_window) {}
+
+// ===== Window =====
+
+void LoadPacer::on_reply(uint8_t load) {
+    last_load = load;
+    replies_since_backoff++;
+
+    if (load >= LOAD_HINT_TARGET) {
+        back_off();
+        return;
+    }
+    if (load < PACER_RAMP_BELOW) {
+        congestion_window += 1;                         // Doubles per round trip
+    } else {
+        congestion_window += 1 / congestion_window;     // One more per round trip
+    }
+    congestion_window = std::min(congestion_window, static_cast<double>(max_window));
+}
+
+void LoadPacer::on_timeout() {
+    back_off();
+}
+
+void LoadPacer::back_off() {
+    // Replies of requests sent before the last halving still report the old overload
+    if (replies_since_backoff < window() || congestion_window <= 1) return;
+    congestion_window = std::max(1.0, congestion_window / 2);
+    replies_since_backoff = 0;
+    backoff_count++;
+    lowest_window = std::min(lowest_window, window());
+}
+
+// ===== Retransmission =====
+
+uint64_t LoadPacer::retransmit_timeout_ns() const {
+    return base_timeout_ns + base_timeout_ns * last_load / LOAD_HINT_TARGET;
+}
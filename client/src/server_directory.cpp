@@ -0,0 +1,89 @@
+#include "server_directory.h"
+#include <algorithm>
+
+// ===== Constructor =====
+
+ServerDirectory::ServerDirectory(uint32_t failover_after, const SocketAddress& broadcast_addr)
+    : failover_after(std::max<uint32_t>(failover_after, 1)), broadcast_addr(broadcast_addr) {}
+
+bool ServerDirectory::same_server(const SocketAddress& a, const SocketAddress& b) {
+    return a.ip() == b.ip() && a.port() == b.port();
+}
+
+// ===== Statistics =====
+
+void ServerDirectory::add(const SocketAddress& addr) {
+    entry(addr);
+}
+
+void ServerDirectory::record_reply(const SocketAddress& addr, uint64_t rtt_ns) {
+    ServerHealth& server = entry(addr);
+    server.replies++;
+    server.consecutive_timeouts = 0;
+    if (rtt_ns == 0) return;
+
+    // Same smoothing as TCP's SRTT (RFC 6298): srtt += (sample - srtt) / 8
+    if (server.srtt_ns == 0) {
+        server.srtt_ns = rtt_ns;
+    } else {
+        server.srtt_ns = server.srtt_ns - server.srtt_ns / 8 + rtt_ns / 8;
+    }
+}
+
+bool ServerDirectory::record_timeout(const SocketAddress& addr) {
+    // Broadcast probes have no server to charge: one timeout, then try the next candidate
+    if (is_broadcast(addr)) return true;
+
+    ServerHealth& server = entry(addr);
+    server.timeouts++;
+    server.consecutive_timeouts++;
+    return is_down(server);
+}
+
+// ===== Ranking =====
+
+SocketAddress ServerDirectory::next_server(const SocketAddress& current) const {
+    const ServerHealth* fallback = nullptr;
+    for (const ServerHealth* server : ranked()) {
+        if (same_server(server->addr, current)) continue;
+        if (!is_down(*server)) return server->addr;
+        if (!fallback) fallback = server;
+    }
+    if (broadcast_addr.is_valid() && !is_broadcast(current)) return broadcast_addr;
+    return fallback ? fallback->addr : current;
+}
+
+bool ServerDirectory::is_broadcast(const SocketAddress& addr) const {
+    return broadcast_addr.is_valid() && same_server(addr, broadcast_addr);
+}
+
+std::vector<const ServerHealth*> ServerDirectory::ranked() const {
+    std::vector<const ServerHealth*> order;
+    order.reserve(servers.size());
+    for (const ServerHealth& server : servers) order.push_back(&server);
+
+    std::stable_sort(order.begin(), order.end(), [this](const ServerHealth* a, const ServerHealth* b) {
+        if (is_down(*a) != is_down(*b)) return !is_down(*a);
+        if (a->consecutive_timeouts != b->consecutive_timeouts) return a->consecutive_timeouts < b->consecutive_timeouts;
+        // Never measured (srtt 0) sorts after every measured server
+        return a->srtt_ns - 1 < b->srtt_ns - 1;
+    });
+    return order;
+}
+
+// ===== Lookup =====
+
+ServerHealth* ServerDirectory::find(const SocketAddress& addr) {
+    for (ServerHealth& server : servers) {
+        if (same_server(server.addr, addr)) return &server;
+    }
+    return nullptr;
+}
+
+ServerHealth& ServerDirectory::entry(const SocketAddress& addr) {
+    if (ServerHealth* server = find(addr)) return *server;
+    ServerHealth server;
+    server.addr = addr;
+    servers.push_back(server);
+    return servers.back();
+}
@@ -0,0 +1,107 @@
+#include "timer_wheel.h"
+#include <algorithm>
+#include <chrono>
+
+// ===== Constructor =====
+
+TimerWheel::TimerWheel(uint64_t tick_ns, uint64_t start_ns) : tick_ns(std::max<uint64_t>(tick_ns, 1)), start_ns(start_ns) {
+    for (auto& level : slots) {
+        for (TimerNode& slot : level) {
+            slot.prev = slot.next = &slot;
+        }
+    }
+}
+
+// ===== Scheduling =====
+
+void TimerWheel::schedule(TimerNode& node, uint64_t deadline_ns) {
+    if (node.scheduled()) {
+        unlink(node);
+        count--;
+    }
+    // Round up: a timer never fires before its deadline
+    node.expires_tick = deadline_ns > start_ns ? (deadline_ns - start_ns + tick_ns - 1) / tick_ns : 0;
+    place(node, current_tick + 1);
+    count++;
+}
+
+void TimerWheel::cancel(TimerNode& node) {
+    if (!node.scheduled()) return;
+    unlink(node);
+    count--;
+}
+
+void TimerWheel::place(TimerNode& node, uint64_t earliest_tick) {
+    constexpr uint64_t span = uint64_t(1) << (TIMER_WHEEL_SLOT_BITS * TIMER_WHEEL_LEVELS);
+    uint64_t at = std::max(node.expires_tick, earliest_tick);
+    at = std::min(at, current_tick + span - 1);     // Beyond the span: park at the horizon
+
+    // Lowest level whose span covers the delay
+    uint64_t delta = at - current_tick;
+    uint32_t level = 0;
+    while (level + 1 < TIMER_WHEEL_LEVELS && delta >= (uint64_t(1) << (TIMER_WHEEL_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    TimerNode& slot = slots[level][(at >> (TIMER_WHEEL_SLOT_BITS * level)) & (TIMER_WHEEL_SLOTS - 1)];
+
+    // Append before the sentinel
+    node.prev = slot.prev;
+    node.next = &slot;
+    slot.prev->next = &node;
+    slot.prev = &node;
+}
+
+void TimerWheel::cascade(uint32_t level, uint32_t index) {
+    TimerNode moving;
+    splice_out(slots[level][index], moving);
+    while (moving.next != &moving) {
+        TimerNode& node = *moving.next;
+        unlink(node);
+        place(node, current_tick);
+    }
+}
+
+int32_t TimerWheel::wait_ms(uint64_t now_ns, int32_t max_ms) const {
+    if (count == 0) return max_ms;
+
+    // First non-empty level-0 slot up to the next cascade (inclusive: it fires slot 0)
+    uint64_t boundary = ((current_tick >> TIMER_WHEEL_SLOT_BITS) + 1) << TIMER_WHEEL_SLOT_BITS;
+    uint64_t due_tick = boundary;
+    for (uint64_t tick = current_tick + 1; tick <= boundary; tick++) {
+        const TimerNode& slot = slots[0][tick & (TIMER_WHEEL_SLOTS - 1)];
+        if (slot.next != &slot) {
+            due_tick = tick;
+            break;
+        }
+    }
+
+    uint64_t due_ns = start_ns + due_tick * tick_ns;
+    if (due_ns <= now_ns) return 0;
+    uint64_t ms = (due_ns - now_ns + 999999) / 1000000;
+    return static_cast<int32_t>(std::min<uint64_t>(ms, static_cast<uint64_t>(max_ms)));
+}
+
+uint64_t TimerWheel::now_ns() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+// ===== List helpers =====
+
+void TimerWheel::splice_out(TimerNode& slot, TimerNode& out) {
+    if (slot.next == &slot) {
+        out.prev = out.next = &out;
+        return;
+    }
+    out.next = slot.next;
+    out.prev = slot.prev;
+    out.next->prev = &out;
+    out.prev->next = &out;
+    slot.prev = slot.next = &slot;
+}
+
+void TimerWheel::unlink(TimerNode& node) {
+    node.prev->next = node.next;
+    node.next->prev = node.prev;
+    node.prev = node.next = nullptr;
+}
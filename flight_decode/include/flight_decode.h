@@ -0,0 +1,52 @@
+#pragma once
+#include "flight_recorder.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+/**
+ * @brief ### Decoder settings (parsed from the command line).
+ */
+struct FlightDecodeOptions {
+    std::string dump_path;          ///< Dump written by the server's flight recorder
+    bool list_records = true;       ///< Print every record (false = summary only)
+    size_t slowest = 10;            ///< Slowest requests repeated in the summary
+};
+
+/**
+ * @brief ### Prints a flight recorder dump in human-readable form.
+ *
+ * Each record becomes one line with its stage durations:
+ * - queue: receive -> dispatch (time waiting for a worker)
+ * - lock:  dispatch -> account locks acquired (transfers only)
+ * - reply: last stage -> reply sent
+ * - total: receive -> done
+ *
+ * The summary has latency percentiles and the slowest requests, which is usually where a
+ * stall shows (long queue = workers busy or blocked, long lock = contention on an account).
+ */
+class FlightDecoder {
+public:
+    /**
+     * @brief ### Loads the whole dump.
+     * @param options Decoder settings.
+     * @throws std::runtime_error If the file is missing or not a compatible dump.
+     */
+    explicit FlightDecoder(const FlightDecodeOptions& options);
+
+    /**
+     * @brief ### Prints the header, the records (unless disabled) and the summary.
+     */
+    void print() const;
+
+private:
+    /// One record on one line
+    void print_record(const FlightRecord& record) const;
+
+    /// Percentiles of total/queue latency and the slowest requests
+    void print_summary() const;
+
+    FlightDecodeOptions options;
+    FlightDumpHeader header{};
+    std::vector<FlightRecord> records;   ///< Receive order
+};
@@ -0,0 +1,55 @@
+#include "flight_decode.h"
+#include <iostream>
+#include <string>
+
+/**
+ * @brief Prints command line usage.
+ */
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " <dump_file> [--summary] [--slowest <n>]" << std::endl;
+}
+
+/**
+ * @brief Decoder entry point - prints a flight recorder dump.
+ *
+ * Usage: ./flight_decode <dump_file> [--summary] [--slowest <n>]
+ * Examples:
+ *   ./flight_decode flight-1234-1.zf               # Every record, then the summary
+ *   ./flight_decode flight-1234-1.zf --summary --slowest 20
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    FlightDecodeOptions options;
+    options.dump_path = argv[1];
+
+    // Parse optional arguments
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--summary") {
+                options.list_records = false;
+            } else if (arg == "--slowest" && i + 1 < argc) {
+                options.slowest = static_cast<size_t>(std::stoul(argv[++i]));
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    try {
+        FlightDecoder decoder(options);
+        decoder.print();
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+}
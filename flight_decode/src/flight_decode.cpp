@@ -0,0 +1,140 @@
+#include "flight_decode.h"
+#include "udp_socket.h"
+#include <algorithm>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+/**
+ * @brief Returns a printable name for a packet type.
+ */
+static const char* packet_type_name(uint8_t type) {
+    switch (type) {
+        case 0: return "(no reply)";
+        case DISCOVERY: return "DISCOVERY";
+        case DISCOVERY_ACK: return "DISCOVERY_ACK";
+        case DISCOVERY_COOKIE: return "DISCOVERY_COOKIE";
+        case TRANSACTION_REQUEST: return "TRANSACTION_REQUEST";
+        case TRANSACTION_ACK: return "TRANSACTION_ACK";
+        case INSUFFICIENT_BALANCE_ACK: return "INSUFFICIENT_BALANCE_ACK";
+        case INVALID_CLIENT_ACK: return "INVALID_CLIENT_ACK";
+        case ERROR_ACK: return "ERROR_ACK";
+        case OUTCOME_UNKNOWN_ACK: return "OUTCOME_UNKNOWN_ACK";
+        case SUBSCRIBE: return "SUBSCRIBE";
+        case SUBSCRIBE_ACK: return "SUBSCRIBE_ACK";
+        case CREDIT_NOTIFY_ACK: return "CREDIT_NOTIFY_ACK";
+        default: return "OTHER";
+    }
+}
+
+/**
+ * @brief Formats a nanosecond duration in microseconds.
+ */
+static std::string format_us(uint64_t ns) {
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1) << ns / 1000.0 << " us";
+    return out.str();
+}
+
+// ===== Constructor =====
+
+FlightDecoder::FlightDecoder(const FlightDecodeOptions& options) : options(options) {
+    FlightDumpReader reader;
+    if (!reader.open(options.dump_path)) {
+        throw std::runtime_error("Cannot read flight dump " + options.dump_path);
+    }
+    header = reader.header();
+
+    FlightRecord record;
+    while (reader.next(record)) {
+        records.push_back(record);
+    }
+}
+
+// ===== Output =====
+
+void FlightDecoder::print() const {
+    // Wall-clock origin (records are offsets from it)
+    std::time_t origin_s = static_cast<std::time_t>(header.origin_unix_ns / 1000000000ULL);
+    char origin_str[32];
+    std::strftime(origin_str, sizeof(origin_str), "%Y-%m-%d %H:%M:%S", std::localtime(&origin_s));
+
+    std::cout << "Flight dump: " << records.size() << " records from " << header.thread_count << " workers, "
+              << (header.reason == static_cast<uint32_t>(FlightDumpReason::STALL) ? "stall" : "signal");
+    if (header.trigger_latency_ns > 0) {
+        std::cout << " (trigger " << format_us(header.trigger_latency_ns) << ")";
+    }
+    std::cout << ", recorder started " << origin_str << std::endl;
+    if (records.size() != header.record_count) {
+        std::cout << "Warning: header announces " << header.record_count << " records (file truncated)" << std::endl;
+    }
+
+    if (options.list_records) {
+        std::cout << std::endl;
+        for (const FlightRecord& record : records) {
+            print_record(record);
+        }
+    }
+    print_summary();
+}
+
+void FlightDecoder::print_record(const FlightRecord& record) const {
+    uint64_t queue_ns = record.dispatch_ns - record.receive_ns;
+    uint64_t last_stage_ns = record.lock_ns ? record.lock_ns : record.dispatch_ns;
+
+    std::cout << std::fixed << std::setprecision(6) << std::setw(14) << record.receive_ns / 1e6 << " ms"
+              << "  t" << record.thread_index
+              << "  :" << record.ledger_port
+              << "  " << SocketAddress(record.source_ip).ip_string() << ":" << record.source_port
+              << "  " << packet_type_name(record.request_type) << " id " << record.request_id;
+    if (record.request_type == TRANSACTION_REQUEST) {
+        std::cout << " -> " << SocketAddress(record.destination_ip).ip_string() << " value " << record.value;
+    }
+    std::cout << "  queue " << format_us(queue_ns);
+    if (record.lock_ns) std::cout << "  lock " << format_us(record.lock_ns - record.dispatch_ns);
+    if (record.reply_ns) std::cout << "  reply " << format_us(record.reply_ns - last_stage_ns);
+    std::cout << "  total " << format_us(record.done_ns - record.receive_ns)
+              << "  " << packet_type_name(record.outcome) << std::endl;
+}
+
+void FlightDecoder::print_summary() const {
+    if (records.empty()) return;
+
+    std::vector<uint64_t> totals;
+    std::vector<uint64_t> queues;
+    for (const FlightRecord& record : records) {
+        totals.push_back(record.done_ns - record.receive_ns);
+        queues.push_back(record.dispatch_ns - record.receive_ns);
+    }
+    std::sort(totals.begin(), totals.end());
+    std::sort(queues.begin(), queues.end());
+    auto percentile = [](const std::vector<uint64_t>& sorted, double p) {
+        return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+    };
+
+    std::cout << std::endl << "Latency      p50          p90          p99          max" << std::endl;
+    for (const auto& [name, sorted] : {std::make_pair("total", &totals), std::make_pair("queue", &queues)}) {
+        std::cout << std::left << std::setw(7) << name << std::right;
+        for (double p : {0.5, 0.9, 0.99}) {
+            std::cout << std::setw(13) << format_us(percentile(*sorted, p));
+        }
+        std::cout << std::setw(13) << format_us(sorted->back()) << std::endl;
+    }
+
+    // Slowest requests, slowest first
+    std::vector<const FlightRecord*> slowest;
+    for (const FlightRecord& record : records) slowest.push_back(&record);
+    size_t count = std::min(options.slowest, slowest.size());
+    std::partial_sort(slowest.begin(), slowest.begin() + count, slowest.end(),
+                      [](const FlightRecord* a, const FlightRecord* b) {
+                          return a->done_ns - a->receive_ns > b->done_ns - b->receive_ns;
+                      });
+    if (count > 0) {
+        std::cout << std::endl << "Slowest " << count << ":" << std::endl;
+        for (size_t i = 0; i < count; i++) {
+            print_record(*slowest[i]);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#pragma once
+#include "udp_socket.h"
+#include "packet_auth.h"
+#include "packet_trace.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/// Time replies are still collected after the last packet was sent (milliseconds)
+constexpr uint32_t REPLAY_DRAIN_GRACE_MS = 1000;
+
+/// DISCOVERY rounds sent to obtain session keys before replaying (each waits REPLAY_SESSION_TIMEOUT_MS)
+constexpr uint32_t REPLAY_SESSION_ATTEMPTS = 5;
+constexpr uint32_t REPLAY_SESSION_TIMEOUT_MS = 200;
+
+/**
+ * @brief ### Replay settings (parsed from the command line).
+ */
+struct ReplayOptions {
+    std::string trace_path;                 ///< Trace captured with ./server --trace
+    std::string server_ip;                  ///< Target server
+    uint16_t port_override = 0;             ///< Send everything to this port (0 = each record's ledger port)
+    bool as_fast_as_possible = false;       ///< Ignore capture timing, send back-to-back
+    std::string source_base = "127.1.0.1";  ///< First local IP used for replayed clients
+};
+
+/**
+ * @brief ### Re-sends a captured trace against a server.
+ *
+ * Every client IP seen in the trace (as a sender or as a transfer destination) is mapped
+ * to its own local address, starting at source_base and counting up, and each sender gets
+ * its own socket bound to that address. The server therefore sees the same number of
+ * distinct accounts, and transfers between them still resolve. The default 127.1.0.x range
+ * works on Linux loopback with no setup; against a remote server, use addresses configured
+ * on this host.
+ *
+ * Timing:
+ * - Default: each packet leaves at its captured offset from the first packet
+ * - as_fast_as_possible: back-to-back (saturates the server with the captured traffic shape)
+ *
+ * Sessions: captured MACs belong to the original addresses and server secret, so before the
+ * timed replay every replayed sender sends DISCOVERY to each ledger it talks to (not timed,
+ * replies not counted, DISCOVERY_COOKIE echoed for new accounts) and its requests are signed
+ * again with the session keys returned.
+ * Senders whose ledger never answers keep unsigned requests (dropped by the server).
+ *
+ * Replies are drained on a separate thread (one poll over all sockets) and summarized.
+ */
+class Replayer {
+public:
+    /**
+     * @brief ### Loads the trace and prepares the address mapping.
+     * @param options Replay settings.
+     * @throws std::runtime_error If the trace can't be read or the server/source IPs are invalid.
+     */
+    explicit Replayer(const ReplayOptions& options);
+
+    /**
+     * @brief ### Binds one socket per client, replays the trace and prints a summary.
+     * @return False if the client sockets couldn't be bound.
+     */
+    bool run();
+
+private:
+    /// Replay-side address for an IP of the trace (assigned in order of first appearance)
+    uint32_t map_ip(uint32_t original_ip);
+
+    /// [Drain thread] Counts replies on all client sockets until sending is done
+    void drain_replies();
+
+    /**
+     * @brief ### Obtains a session key per (sender, ledger port) and signs the records with them.
+     * @return Sessions that got no DISCOVERY_ACK (their requests stay unsigned).
+     */
+    size_t establish_sessions();
+
+    /// Key of session_keys (sender socket index, ledger port)
+    static uint64_t session_id(size_t socket, uint16_t port) { return static_cast<uint64_t>(socket) << 16 | port; }
+
+    /// Ledger port a record is sent to
+    uint16_t record_port(const TraceRecord& record) const {
+        return options.port_override != 0 ? options.port_override : record.ledger_port;
+    }
+
+    ReplayOptions options;
+    SocketAddress server_addr;                          ///< Target server (port set per packet)
+    std::vector<TraceRecord> records;                   ///< Whole trace, addresses already mapped (sending never touches the disk)
+    std::vector<uint32_t> record_sockets;               ///< Index in sockets of each record's sender
+
+    std::unordered_map<uint32_t, uint32_t> ip_map;      ///< Trace IP -> replay IP (network byte order)
+    std::unordered_map<uint32_t, size_t> socket_index;  ///< Replay sender IP -> index in sockets
+    std::vector<std::unique_ptr<UDPSocket>> sockets;    ///< One socket per replayed sender
+    std::unordered_map<uint64_t, uint64_t> session_keys; ///< session_id() -> session key from DISCOVERY_ACK
+
+    std::atomic<bool> sending_done{false};              ///< Tells the drain thread to finish
+    uint64_t replies_by_type[256] = {};                 ///< Reply counts (drain thread only)
+    uint64_t replies_total = 0;                         ///< Sum of replies_by_type
+};
@@ -0,0 +1,66 @@
+#include "replay.h"
+#include <iostream>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Prints command line usage.
+ */
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " <trace_file> <server_ip> [--port <port>] [--fast] [--source-base <ip>]" << std::endl;
+}
+
+/**
+ * @brief Replay entry point - re-sends a captured trace against a server.
+ *
+ * Usage: ./replay <trace_file> <server_ip> [--port <port>] [--fast] [--source-base <ip>]
+ * Examples:
+ *   ./replay traffic.zt 127.0.0.1                  # Original timing, original ledger ports
+ *   ./replay traffic.zt 127.0.0.1 --fast           # As fast as possible
+ *   ./replay traffic.zt 127.0.0.1 --port 9000      # All ledgers' traffic to port 9000
+ *   ./replay traffic.zt 10.0.0.5 --source-base 10.0.1.1   # Clients use 10.0.1.1, 10.0.1.2, ...
+ */
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    ReplayOptions options;
+    options.trace_path = argv[1];
+    options.server_ip = argv[2];
+
+    // Parse optional arguments
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--port" && i + 1 < argc) {
+                int port = std::stoi(argv[++i]);
+                if (port <= 0 || port > 65535) {
+                    std::cerr << "Error: Port must be in range 1-65535" << std::endl;
+                    return 1;
+                }
+                options.port_override = static_cast<uint16_t>(port);
+            } else if (arg == "--fast") {
+                options.as_fast_as_possible = true;
+            } else if (arg == "--source-base" && i + 1 < argc) {
+                options.source_base = argv[++i];
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    // Load trace and replay it
+    try {
+        Replayer replayer(options);
+        return replayer.run() ? 0 : 1;
+    } catch (const std::exception& e) {
+        std::cerr << "Fatal error: " << e.what() << std::endl;
+        return 1;
+    }
+}
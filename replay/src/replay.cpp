@@ -0,0 +1,211 @@
+#include "replay.h"
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <stdexcept>
+#include <thread>
+
+/**
+ * @brief Returns a printable name for a packet type (reply summary).
+ */
+static const char* packet_type_name(uint8_t type) {
+    switch (type) {
+        case DISCOVERY_ACK: return "DISCOVERY_ACK";
+        case DISCOVERY_COOKIE: return "DISCOVERY_COOKIE";
+        case TRANSACTION_ACK: return "TRANSACTION_ACK";
+        case INSUFFICIENT_BALANCE_ACK: return "INSUFFICIENT_BALANCE_ACK";
+        case INVALID_CLIENT_ACK: return "INVALID_CLIENT_ACK";
+        case ERROR_ACK: return "ERROR_ACK";
+        case OUTCOME_UNKNOWN_ACK: return "OUTCOME_UNKNOWN_ACK";
+        case SUBSCRIBE_ACK: return "SUBSCRIBE_ACK";
+        case CREDIT_NOTIFY: return "CREDIT_NOTIFY";
+        default: return "OTHER";
+    }
+}
+
+// ===== Constructor =====
+
+Replayer::Replayer(const ReplayOptions& options) : options(options), server_addr(options.server_ip) {
+    if (!server_addr.is_valid()) {
+        throw std::runtime_error("Invalid server IP address");
+    }
+    if (!SocketAddress(options.source_base).is_valid()) {
+        throw std::runtime_error("Invalid source base IP address");
+    }
+
+    PacketTraceReader reader;
+    if (!reader.open(options.trace_path)) {
+        throw std::runtime_error("Cannot read trace file " + options.trace_path);
+    }
+
+    // Load everything up front and rewrite addresses once (the send loop only sends)
+    TraceRecord record;
+    while (reader.next(record)) {
+        record.source_ip = map_ip(record.source_ip);
+        auto sender = socket_index.emplace(record.source_ip, socket_index.size()).first;
+        record_sockets.push_back(static_cast<uint32_t>(sender->second));
+        if (record.packet.type == TRANSACTION_REQUEST) {
+            // Destinations follow the same mapping, so transfers still reach the replayed accounts
+            record.packet.payload.request.destination_ip = map_ip(record.packet.payload.request.destination_ip);
+        }
+        records.push_back(record);
+    }
+}
+
+uint32_t Replayer::map_ip(uint32_t original_ip) {
+    auto it = ip_map.find(original_ip);
+    if (it != ip_map.end()) return it->second;
+
+    // base + n in host order, stored in network byte order like every IP in the protocol
+    uint32_t base = ntohl(SocketAddress(options.source_base).ip());
+    uint32_t replay_ip = htonl(base + static_cast<uint32_t>(ip_map.size()));
+    ip_map.emplace(original_ip, replay_ip);
+    return replay_ip;
+}
+
+// ===== Main execution =====
+
+bool Replayer::run() {
+    if (records.empty()) {
+        std::cout << "Trace is empty, nothing to replay." << std::endl;
+        return true;
+    }
+
+    // One socket per sender, bound to its mapped address (server keys accounts by IP)
+    sockets.resize(socket_index.size());
+    for (const auto& [local_ip, index] : socket_index) {
+        sockets[index] = std::make_unique<UDPSocket>();
+        if (!sockets[index]->initialize(0, false, local_ip)) {
+            std::cerr << "Failed to bind replay socket to " << SocketAddress(local_ip).ip_string() << std::endl;
+            return false;
+        }
+    }
+
+    size_t missing_sessions = establish_sessions();
+    if (missing_sessions > 0) {
+        std::cerr << "Warning: " << missing_sessions << " sessions got no DISCOVERY_ACK, their requests will be dropped" << std::endl;
+    }
+
+    std::thread drain_thread(&Replayer::drain_replies, this);
+
+    // ===== Send loop =====
+    uint64_t sent = 0;
+    uint64_t send_failures = 0;
+    uint64_t first_timestamp_ns = records.front().timestamp_ns;
+    auto replay_start = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < records.size(); i++) {
+        const TraceRecord& record = records[i];
+        if (!options.as_fast_as_possible) {
+            // Keep the captured inter-arrival times (offsets from the first packet, no drift)
+            std::this_thread::sleep_until(replay_start + std::chrono::nanoseconds(record.timestamp_ns - first_timestamp_ns));
+        }
+
+        SocketAddress dest_addr(server_addr.ip(), record_port(record));
+        if (sockets[record_sockets[i]]->send(&record.packet, sizeof(record.packet), dest_addr)) {
+            sent++;
+        } else {
+            send_failures++;
+        }
+    }
+    double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - replay_start).count();
+
+    sending_done.store(true);
+    drain_thread.join();
+
+    // ===== Summary =====
+    std::cout << "Replayed " << sent << " packets from " << sockets.size() << " clients in "
+              << std::fixed << std::setprecision(3) << elapsed_s << " s ("
+              << std::setprecision(0) << (elapsed_s > 0 ? sent / elapsed_s : 0.0) << " packets/s)";
+    if (send_failures > 0) std::cout << ", " << send_failures << " send failures";
+    std::cout << std::endl;
+
+    std::cout << "Replies received: " << replies_total << std::endl;
+    for (int type = 0; type < 256; type++) {
+        if (replies_by_type[type] > 0) {
+            std::cout << "  " << packet_type_name(static_cast<uint8_t>(type)) << " " << replies_by_type[type] << std::endl;
+        }
+    }
+    return true;
+}
+
+// ===== Sessions =====
+
+size_t Replayer::establish_sessions() {
+    // Every (sender, ledger) pair with requests to sign
+    std::unordered_map<uint64_t, SocketAddress> pending;   // session_id -> ledger address
+    for (size_t i = 0; i < records.size(); i++) {
+        if (!PacketAuth::requires_mac(records[i].packet.type)) continue;
+        uint16_t port = record_port(records[i]);
+        pending.emplace(session_id(record_sockets[i], port), SocketAddress(server_addr.ip(), port));
+    }
+
+    std::vector<const UDPSocket*> watched;
+    for (const auto& socket : sockets) watched.push_back(socket.get());
+    std::vector<size_t> ready;
+    Packet discovery_packet = Packet::create_discovery();
+
+    for (uint32_t attempt = 0; attempt < REPLAY_SESSION_ATTEMPTS && !pending.empty(); attempt++) {
+        for (const auto& [id, ledger_addr] : pending) {
+            sockets[id >> 16]->send(&discovery_packet, sizeof(discovery_packet), ledger_addr);
+        }
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(REPLAY_SESSION_TIMEOUT_MS);
+        while (!pending.empty()) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+            if (remaining <= 0 || !UDPSocket::wait_readable(watched, static_cast<int32_t>(remaining), ready)) break;
+
+            Packet reply;
+            SocketAddress from;
+            for (size_t index : ready) {
+                while (sockets[index]->receive(&reply, sizeof(reply), from) > 0) {
+                    if (reply.type == DISCOVERY_COOKIE) {
+                        // New account on this ledger: echo the cookie (answered within this attempt)
+                        Packet echo_packet = Packet::create_discovery(reply.auth);
+                        sockets[index]->send(&echo_packet, sizeof(echo_packet), from);
+                        continue;
+                    }
+                    if (reply.type != DISCOVERY_ACK) continue;
+                    uint64_t id = session_id(index, from.port());
+                    if (pending.erase(id) > 0) session_keys[id] = reply.auth;
+                }
+            }
+        }
+    }
+
+    // Sign once here: the send loop only sends
+    for (size_t i = 0; i < records.size(); i++) {
+        auto key = session_keys.find(session_id(record_sockets[i], record_port(records[i])));
+        if (key != session_keys.end() && PacketAuth::requires_mac(records[i].packet.type)) {
+            PacketAuth::sign(records[i].packet, key->second);
+        }
+    }
+    return pending.size();
+}
+
+// ===== Reply drain thread =====
+
+void Replayer::drain_replies() {
+    std::vector<const UDPSocket*> watched;
+    for (const auto& socket : sockets) watched.push_back(socket.get());
+
+    std::vector<size_t> ready;
+    Packet reply;
+    SocketAddress from;
+    auto done_at = std::chrono::steady_clock::time_point::max();
+
+    while (std::chrono::steady_clock::now() < done_at) {
+        // Grace period starts once the last packet is sent
+        if (done_at == std::chrono::steady_clock::time_point::max() && sending_done.load()) {
+            done_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(REPLAY_DRAIN_GRACE_MS);
+        }
+
+        if (!UDPSocket::wait_readable(watched, 100, ready)) break;
+        for (size_t index : ready) {
+            while (sockets[index]->receive(&reply, sizeof(reply), from) > 0) {
+                replies_by_type[static_cast<uint8_t>(reply.type)]++;
+                replies_total++;
+            }
+        }
+    }
+}
@@ -0,0 +1,150 @@
+#pragma once
+#include "packet.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// Default latency target of the runtime (receive to reply, per request)
+constexpr uint32_t DEFAULT_LATENCY_TARGET_US = 1000;
+
+/// Batching parameters are recomputed at most this often (by the I/O thread)
+constexpr uint64_t BATCH_CONTROL_INTERVAL_NS = 10'000'000;
+
+/// Smoothing horizon of the load estimates: an older sample has weight < 1/e
+constexpr uint64_t BATCH_SMOOTHING_NS = 50'000'000;
+
+/// Smallest drain batch (fewer datagrams per wakeup would only add poll calls)
+constexpr size_t BATCH_DRAIN_MIN = 8;
+
+/// Worker utilization from which a worker waits for its group to fill (below it, the wait only adds latency)
+constexpr double BATCH_WAIT_MIN_UTILIZATION = 0.5;
+
+/// Once waits stop collecting requests, waiting is retried only this often
+constexpr uint64_t BATCH_WAIT_RETRY_NS = 1'000'000'000;
+
+/**
+ * @brief ### Batching parameters in effect and the load they were chosen for.
+ */
+struct BatchParameters {
+    size_t drain_batch;         ///< Datagrams read from one socket per wakeup (receive stage)
+    size_t worker_batch;        ///< Most requests a worker takes at once (execute stage, and its reply batch)
+    uint64_t max_wait_ns;       ///< How long an idle worker waits for its group to fill (0 = never)
+    double arrival_rate;        ///< Received datagrams per second (smoothed)
+    double queue_depth;         ///< Requests waiting for a worker (smoothed)
+    uint64_t latency_ns;        ///< Receive to reply per request (smoothed mean)
+    uint8_t load_hint;          ///< Load sent to clients in every reply (see load_hint())
+};
+
+/**
+ * @brief ### Chooses the runtime's batch sizes and flush delay from observed load.
+ *
+ * Fixed sizes are wrong at both ends: at low load a request should never wait for others,
+ * at high load bigger batches amortize syscalls, queue locking and account locks. The I/O
+ * thread and the workers report what they did (record_drain(), record_group()); every
+ * BATCH_CONTROL_INTERVAL_NS the I/O thread calls update(), which derives from the smoothed
+ * arrival rate, queue depth and per-request costs:
+ * - worker_batch: a group's replies leave together, so the group's service time adds to
+ *   its first request's latency; it is kept within half the latency target
+ * - drain_batch: drained requests are queued only once the whole batch is read and checked;
+ *   the drain time is kept within a quarter of the target
+ * - max_wait_ns: with workers at least BATCH_WAIT_MIN_UTILIZATION busy, an idle worker waits
+ *   for its group to fill, as long as it expects to fill it within a quarter of the target.
+ *   Rate alone can't tell whether more requests will come (closed-loop clients send their
+ *   next request only after this reply), so waits that collect less than one request on
+ *   average are suspended for BATCH_WAIT_RETRY_NS
+ *
+ * When the queue holds more than one full group per worker, requests wait longer in the
+ * queue than in any batch: both batches go to their maximum and nobody waits, which gives
+ * the highest throughput until the backlog is gone.
+ *
+ * The same estimates give the load hint stamped into replies (ReplyPayload::load), so
+ * clients can slow down before the queue builds up.
+ *
+ * Thread-safety: record_*() and the getters from any thread (relaxed atomics); update() from
+ * one thread only.
+ */
+class BatchController {
+public:
+    /**
+     * @brief ### Starts with the largest batches and no wait (nothing observed yet).
+     * @param worker_count Worker threads of the runtime (1+).
+     * @param latency_target_us Receive-to-reply target per request.
+     */
+    BatchController(size_t worker_count, uint32_t latency_target_us = DEFAULT_LATENCY_TARGET_US);
+
+    // Non-copyable: shared by the I/O thread and the workers
+    BatchController(const BatchController&) = delete;
+    BatchController& operator=(const BatchController&) = delete;
+
+    /// Changes the latency target (takes effect at the next update())
+    void set_latency_target(uint32_t latency_target_us) {
+        latency_target_ns.store(static_cast<uint64_t>(latency_target_us) * 1000, std::memory_order_relaxed);
+    }
+
+    /// [I/O thread] One drained batch: datagrams received and the time spent until they were queued
+    void record_drain(size_t received, uint64_t elapsed_ns);
+
+    /**
+     * @brief ### [Worker thread] One executed group.
+     * @param service_ns Time to execute the group and send its replies.
+     * @param latency_sum_ns Sum of receive-to-reply times of its requests.
+     */
+    void record_group(size_t count, uint64_t service_ns, uint64_t latency_sum_ns);
+
+    /// [Worker thread] One wait for a group to fill: requests that arrived during it
+    void record_wait(size_t collected);
+
+    /**
+     * @brief ### [I/O thread] Recomputes the parameters if BATCH_CONTROL_INTERVAL_NS has elapsed.
+     * @param now_ns Current time (flight recorder clock, like the receive timestamps).
+     * @param queue_depth Requests queued right now.
+     * @return True if the parameters were recomputed.
+     */
+    bool update(uint64_t now_ns, size_t queue_depth);
+
+    /// [I/O thread] True if update() would recompute now (lets the caller skip measuring the queue)
+    bool update_due(uint64_t now_ns) const { return now_ns - last_update_ns >= BATCH_CONTROL_INTERVAL_NS; }
+
+    size_t drain_batch() const { return current_drain_batch.load(std::memory_order_relaxed); }
+    size_t worker_batch() const { return current_worker_batch.load(std::memory_order_relaxed); }
+    uint64_t max_wait_ns() const { return current_max_wait_ns.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief ### Load hint for replies: LOAD_HINT_TARGET × the worse of two ratios (capped at LOAD_HINT_MAX).
+     *
+     * Mean latency / latency target, and queue depth / one latency-sized group per worker
+     * (the backlog threshold). 0 when idle.
+     */
+    uint8_t load_hint() const { return current_load_hint.load(std::memory_order_relaxed); }
+
+    /// [I/O thread] Parameters in effect and the smoothed load behind them
+    BatchParameters snapshot() const;
+
+private:
+    size_t worker_count;
+    std::atomic<uint64_t> latency_target_ns;
+
+    // ===== Reported since the last update (any thread) =====
+    std::atomic<uint64_t> arrivals{0};
+    std::atomic<uint64_t> io_ns{0};
+    std::atomic<uint64_t> served{0};
+    std::atomic<uint64_t> service_ns{0};
+    std::atomic<uint64_t> latency_ns{0};
+    std::atomic<uint64_t> waits{0};
+    std::atomic<uint64_t> collected{0};
+
+    // ===== Smoothed estimates (update() only) =====
+    uint64_t last_update_ns = 0;
+    double arrival_rate = 0;            ///< Datagrams per second
+    double queue_depth = 0;             ///< Queued requests
+    double io_ns_per_packet = 0;        ///< I/O thread time per received datagram
+    double service_ns_per_request = 0;  ///< Worker time per request
+    double mean_latency_ns = 0;         ///< Receive to reply
+    uint64_t waits_suspended_until_ns = 0;  ///< No waiting before (waits didn't pay off)
+
+    // ===== Chosen parameters (read by the I/O thread and the workers) =====
+    std::atomic<size_t> current_drain_batch;
+    std::atomic<size_t> current_worker_batch;
+    std::atomic<uint64_t> current_max_wait_ns{0};
+    std::atomic<uint8_t> current_load_hint{0};
+};
@@ -0,0 +1,96 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+/**
+ * @brief ### Lock-free Bloom filter of 32-bit keys (insert-only, blocked).
+ *
+ * Answers "certainly absent" with one atomic load, no lock and no epoch guard, so a lookup
+ * of a key that was never added costs about one cache miss. "Maybe present" answers must
+ * be confirmed by the exact structure.
+ *
+ * Layout: every key maps to ONE 64-bit word and sets PROBES bits inside it (a blocked
+ * Bloom filter). add() is a single fetch_or, may_contain() a single load and mask test.
+ *
+ * Sizing: BITS_PER_KEY bits per expected key (~0.5% false positives at that count), at
+ * least MIN_WORDS words. The size is fixed: beyond the expected count the false positive
+ * rate rises gradually, which only sends more lookups to the exact structure.
+ *
+ * Keys can't be removed: a removed key stays "maybe present" (same cost as a false positive).
+ *
+ * Thread-safety: add() and may_contain() may run concurrently from any thread. A key
+ * added before an operation that publishes it (e.g. the map insert) is seen by every
+ * thread that observes that operation.
+ */
+class ConcurrentBloomFilter {
+public:
+    /// Filter bits per expected key
+    static constexpr size_t BITS_PER_KEY = 16;
+
+    /// Smallest filter (also used with expected_keys = 0): 128 KiB
+    static constexpr size_t MIN_WORDS = size_t(1) << 14;
+
+    /// Bits set per key inside its word
+    static constexpr int PROBES = 4;
+
+    /**
+     * @brief ### Allocates an empty filter sized for expected_keys.
+     * @param expected_keys Keys the filter should hold at its nominal false positive rate.
+     */
+    explicit ConcurrentBloomFilter(size_t expected_keys) {
+        size_t word_count = MIN_WORDS;
+        while (word_count * 64 < expected_keys * BITS_PER_KEY) {
+            word_count *= 2;
+        }
+        words.reset(new std::atomic<uint64_t>[word_count]);
+        for (size_t i = 0; i < word_count; i++) {
+            words[i].store(0, std::memory_order_relaxed);
+        }
+        word_mask = word_count - 1;
+    }
+
+    // Non-copyable: shared by all threads of its owner
+    ConcurrentBloomFilter(const ConcurrentBloomFilter&) = delete;
+    ConcurrentBloomFilter& operator=(const ConcurrentBloomFilter&) = delete;
+
+    /// Adds a key (idempotent)
+    void add(uint32_t key) {
+        uint64_t h = hash(key);
+        words[word_index(h)].fetch_or(bit_mask(h), std::memory_order_release);
+    }
+
+    /// False: key was never added. True: key was added, or a false positive
+    bool may_contain(uint32_t key) const {
+        uint64_t h = hash(key);
+        uint64_t mask = bit_mask(h);
+        return (words[word_index(h)].load(std::memory_order_acquire) & mask) == mask;
+    }
+
+private:
+    /// 64-bit mix of the key (splitmix64 finalizer): sequential IPs spread over all words
+    static uint64_t hash(uint32_t key) {
+        uint64_t h = key + 0x9E3779B97F4A7C15ull;
+        h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ull;
+        h = (h ^ (h >> 27)) * 0x94D049BB133111EBull;
+        return h ^ (h >> 31);
+    }
+
+    /// Word of the key: hash bits above the probe bits
+    size_t word_index(uint64_t h) const {
+        return static_cast<size_t>(h >> (6 * PROBES)) & word_mask;
+    }
+
+    /// Bits of the key inside its word: PROBES 6-bit positions from the low hash bits
+    static uint64_t bit_mask(uint64_t h) {
+        uint64_t mask = 0;
+        for (int i = 0; i < PROBES; i++) {
+            mask |= uint64_t(1) << ((h >> (6 * i)) & 63);
+        }
+        return mask;
+    }
+
+    std::unique_ptr<std::atomic<uint64_t>[]> words;     ///< Filter bits (power-of-2 word count)
+    size_t word_mask;                                   ///< Word count - 1
+};
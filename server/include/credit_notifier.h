@@ -0,0 +1,129 @@
+#pragma once
+#include "udp_socket.h"
+#include "packet.h"
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+
+/// Credits to the same receiver within this window are merged into one CREDIT_NOTIFY (milliseconds)
+constexpr uint32_t NOTIFY_BATCH_WINDOW_MS = 20;
+
+/// Timeout before an unacknowledged CREDIT_NOTIFY is retransmitted (milliseconds)
+constexpr uint32_t NOTIFY_RETRANSMIT_MS = 200;
+
+/// Retransmissions of one CREDIT_NOTIFY before the subscriber is considered gone
+constexpr uint32_t NOTIFY_MAX_RETRANSMITS = 10;
+
+/**
+ * @brief ### Pushes CREDIT_NOTIFY datagrams to subscribed receivers.
+ *
+ * Replaces client polling (repeated DISCOVERY or zero-value transfers) for incoming funds.
+ *
+ * Per subscriber:
+ * - Credits are accumulated for NOTIFY_BATCH_WINDOW_MS, then sent as one notification
+ *   (sum of credits + balance read at send time)
+ * - Stop-and-wait delivery: at most one notification in flight, retransmitted every
+ *   NOTIFY_RETRANSMIT_MS until the client echoes it with CREDIT_NOTIFY_ACK. Credits that
+ *   arrive meanwhile go into the next batch, so a slow client gets fewer, larger notifications
+ * - After NOTIFY_MAX_RETRANSMITS the subscription is dropped (on_lost callback)
+ *
+ * Threading:
+ * - notify_credit()/acknowledge()/subscribe() are called by worker threads
+ * - run() is the sender thread (sleeps until the earliest batch or retransmit deadline)
+ * - All subscription state is protected by one mutex. Only subscribed receivers reach it:
+ *   the server keeps a subscribed flag in the packed account word and checks it for free
+ *   inside the transfer.
+ */
+class CreditNotifier {
+public:
+    /// Reads a receiver's current balance (nullopt if the account no longer exists)
+    using BalanceReader = std::function<std::optional<uint32_t>(uint32_t client_ip)>;
+
+    /// Called with the notifier lock held, right before a subscription is dropped for lack of
+    /// acks (must not call back into the notifier)
+    using LostHandler = std::function<void(uint32_t client_ip)>;
+
+    /**
+     * @brief ### Constructs a notifier sending through the server's socket.
+     * @param socket Server socket (UDPSocket::send is thread-safe).
+     * @param read_balance Balance lookup used when a notification is built.
+     * @param on_lost Invoked when a subscriber stopped acknowledging notifications.
+     */
+    CreditNotifier(UDPSocket& socket, BalanceReader read_balance, LostHandler on_lost);
+
+    /**
+     * @brief ### [Sender thread] Sends due batches and retransmissions (never returns).
+     */
+    void run();
+
+    /**
+     * @brief ### Registers a subscriber or refreshes its last known address.
+     *
+     * Pending credits and the notification in flight are kept (a re-subscribe after a
+     * client restart just redirects them).
+     *
+     * @param client_ip Receiver account (network byte order).
+     * @param client_addr Address notifications are sent to.
+     * @param confirm Optional, run under the notifier lock once the subscription exists (e.g. to
+     *        set the account's subscribed flag, so a concurrent drop and its LostHandler can't
+     *        interleave with it); if it returns false the subscription is dropped.
+     * @return False if confirm declined (nothing subscribed), true otherwise.
+     */
+    bool subscribe(uint32_t client_ip, const SocketAddress& client_addr, const std::function<bool()>& confirm = nullptr);
+
+    /**
+     * @brief ### Drops a subscription and any undelivered credits (e.g. account closed).
+     * @param client_ip Receiver account (network byte order).
+     */
+    void unsubscribe(uint32_t client_ip);
+
+    /**
+     * @brief ### Queues a credit for the receiver's next notification batch.
+     *
+     * Ignored if the receiver isn't subscribed.
+     *
+     * @param client_ip Credited account (network byte order).
+     * @param value Amount credited.
+     */
+    void notify_credit(uint32_t client_ip, uint32_t value);
+
+    /**
+     * @brief ### Handles CREDIT_NOTIFY_ACK: releases the notification in flight.
+     *
+     * Stale or duplicate acks (id doesn't match the one in flight) are ignored.
+     *
+     * @param client_ip Acknowledging account (network byte order).
+     * @param notify_id request_id echoed by the client.
+     */
+    void acknowledge(uint32_t client_ip, uint32_t notify_id);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    /// Delivery state of one subscriber (protected by mutex)
+    struct Subscription {
+        SocketAddress addr;                 ///< Last known address of the receiver
+        uint32_t next_notify_id = 1;        ///< Id of the next notification (client deduplicates by id)
+
+        uint64_t pending_credit = 0;        ///< Credits not yet covered by a sent notification
+        Clock::time_point batch_opened;     ///< When the first pending credit arrived
+
+        bool awaiting_ack = false;          ///< A notification is in flight
+        Packet in_flight;                   ///< Copy of the notification in flight (for retransmission)
+        Clock::time_point last_sent;        ///< Last (re)transmission of in_flight
+        uint32_t retransmits = 0;           ///< Retransmissions of in_flight so far
+    };
+
+    UDPSocket& socket;                      ///< Server socket (shared with worker threads)
+    BalanceReader read_balance;             ///< Balance lookup for new notifications
+    LostHandler on_lost;                    ///< Subscription dropped after NOTIFY_MAX_RETRANSMITS
+
+    std::mutex mutex;                       ///< Protects subscriptions
+    std::condition_variable work_cv;        ///< Wakes run() when a batch opens or an ack frees a slot
+    bool wake_pending = false;              ///< Set with work_cv notifications (no lost wakeups while run() sends)
+    std::unordered_map<uint32_t, Subscription> subscriptions;   ///< Subscribers keyed by IP
+};
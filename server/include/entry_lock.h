@@ -0,0 +1,362 @@
+#pragma once
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #include <immintrin.h>
+#endif
+
+#ifdef ZIP_LOCK_CONTENTION
+/**
+ * @brief ### Snapshot of one lock mode's contention on an entry.
+ */
+struct LockContentionStats {
+    uint64_t contended = 0;         ///< Acquisitions that had to wait
+    uint64_t wait_ns = 0;           ///< Total time spent waiting
+    uint64_t max_wait_ns = 0;       ///< Longest single wait
+};
+
+/**
+ * @brief ### Contention counters of one lock mode (read or write) of an entry.
+ *
+ * Compiled only with -DZIP_LOCK_CONTENTION=ON: the two counter sets add 48 bytes to every
+ * entry. Only the blocking path records (an uncontended acquisition reads no clock).
+ * Relaxed atomics let reports read them without any lock.
+ */
+struct LockContention {
+    std::atomic<uint64_t> contended{0};     ///< See LockContentionStats
+    std::atomic<uint64_t> wait_ns{0};       ///< See LockContentionStats
+    std::atomic<uint64_t> max_wait_ns{0};   ///< See LockContentionStats
+
+    /// Adds one wait that started at wait_start and just ended (caller is the only recorder, e.g. holds the entry mutex)
+    void record(std::chrono::steady_clock::time_point wait_start) {
+        uint64_t waited = elapsed_ns(wait_start);
+        contended.store(contended.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        wait_ns.store(wait_ns.load(std::memory_order_relaxed) + waited, std::memory_order_relaxed);
+        if (waited > max_wait_ns.load(std::memory_order_relaxed)) {
+            max_wait_ns.store(waited, std::memory_order_relaxed);
+        }
+    }
+
+    /// Same as record(), for waits that may end on several threads at once (shared acquisitions)
+    void record_shared(std::chrono::steady_clock::time_point wait_start) {
+        uint64_t waited = elapsed_ns(wait_start);
+        contended.fetch_add(1, std::memory_order_relaxed);
+        wait_ns.fetch_add(waited, std::memory_order_relaxed);
+        uint64_t longest = max_wait_ns.load(std::memory_order_relaxed);
+        while (waited > longest && !max_wait_ns.compare_exchange_weak(longest, waited, std::memory_order_relaxed)) {
+            // longest reloaded, retry while ours is still longer
+        }
+    }
+
+    /// Current values
+    LockContentionStats snapshot() const {
+        LockContentionStats stats;
+        stats.contended = contended.load(std::memory_order_relaxed);
+        stats.wait_ns = wait_ns.load(std::memory_order_relaxed);
+        stats.max_wait_ns = max_wait_ns.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    static uint64_t elapsed_ns(std::chrono::steady_clock::time_point start) {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+};
+
+/// Start of a lock wait (clock read only when contention is recorded)
+inline std::chrono::steady_clock::time_point lock_wait_start() { return std::chrono::steady_clock::now(); }
+#else
+inline std::chrono::steady_clock::time_point lock_wait_start() { return {}; }
+#endif
+
+/**
+ * @brief ### Per-entry reader-writer lock with writer preference (prevents writer starvation).
+ *
+ * Default lock policy of LockedMap entries: waiters sleep on a condition variable, so it
+ * stays cheap under oversubscription (more runnable threads than cores).
+ *
+ * Writer preference policy:
+ * - Readers wait if ANY writers are waiting (prevents writer starvation)
+ * - Writers wait only for active readers to finish
+ * - Without this, continuous readers could starve writers indefinitely
+ *
+ * Lock states:
+ * - active_readers > 0, writer_active = false: Multiple readers active
+ * - active_readers = 0, writer_active = true: Single writer active
+ * - Both = 0: Entry unlocked, available for locking
+ *
+ * Lock policy contract (LockedMap<K, V, Lock>): lock_read(), unlock_read(), lock_write(),
+ * try_lock_write(), unlock_write(), and read_contention / write_contention counters
+ * (ZIP_LOCK_CONTENTION builds).
+ */
+class CondvarRWLock {
+public:
+    /**
+     * @brief ### Acquires read lock (shared, multiple readers allowed).
+     *
+     * Blocks if:
+     * - A writer is currently active (writer_active = true)
+     * - Any writers are waiting (waiting_writers > 0, writer preference policy)
+     *
+     * Multiple readers can hold locks simultaneously (active_readers incremented).
+     * Read operations don't modify data, so concurrent reads are safe.
+     */
+    void lock_read();
+
+    /**
+     * @brief ### Releases read lock.
+     *
+     * Decrements active_readers counter.
+     * If this was the last reader (active_readers becomes 0), notifies waiting writers.
+     */
+    void unlock_read();
+
+    /**
+     * @brief ### Acquires write lock (exclusive, only one writer allowed).
+     *
+     * Blocks if:
+     * - A writer is currently active (writer_active = true)
+     * - Any readers are active (active_readers > 0)
+     *
+     * Increments waiting_writers before waiting (blocks new readers, writer preference).
+     * Only one writer can hold lock at a time (exclusive access for modification).
+     */
+    void lock_write();
+
+    /**
+     * @brief ### Acquires write lock only if free right now (never waits, not counted as contention).
+     * @return True if the write lock is now held.
+     */
+    bool try_lock_write();
+
+    /**
+     * @brief ### Releases write lock.
+     *
+     * Sets writer_active = false and notifies ALL waiting threads.
+     * Both readers and writers wake up and compete for next lock acquisition.
+     */
+    void unlock_write();
+
+#ifdef ZIP_LOCK_CONTENTION
+    // ===== Contention profile (see LockContention) =====
+    LockContention read_contention;     ///< lock_read() calls that waited
+    LockContention write_contention;    ///< lock_write() calls that waited
+#endif
+
+private:
+    // ===== Reader-writer lock state =====
+    uint32_t active_readers = 0;    ///< Number of threads currently holding read lock (can be > 1)
+    bool writer_active = false;     ///< True if a thread currently holds write lock (exclusive, max 1)
+    uint32_t waiting_writers = 0;   ///< Number of threads waiting to acquire write lock (for priority)
+
+    // ===== Synchronization primitives =====
+    std::mutex mutex;               ///< Protects the lock state variables (active_readers, writer_active, etc.)
+    std::condition_variable cv;     ///< Signals when lock state changes (wakes waiting readers/writers)
+};
+
+/**
+ * @brief ### Spinning reader-writer lock in one atomic word, with writer preference.
+ *
+ * Lean lock policy: an uncontended acquisition or release is a single atomic operation
+ * (no mutex, no condition variable, no notify). Waiters spin with a CPU pause hint, so it
+ * only suits pools with at most one worker per core and short critical sections, such as
+ * the balance transfer of LockedMap::atomic_pair_operation().
+ *
+ * Word layout: bits 0-15 active readers, bits 16-30 waiting writers, bit 31 writer active.
+ * New readers wait while a writer is active or waiting (same preference as CondvarRWLock).
+ */
+class SpinRWLock {
+public:
+    /// Acquires read lock (spins while a writer is active or waiting)
+    void lock_read();
+
+    /// Releases read lock (one atomic decrement)
+    void unlock_read() { state.fetch_sub(1, std::memory_order_release); }
+
+    /// Acquires write lock (announces itself as waiting writer if not immediately free)
+    void lock_write();
+
+    /// Acquires write lock only if free (one CAS, never spins)
+    bool try_lock_write() {
+        uint32_t current = 0;
+        return state.compare_exchange_strong(current, WRITER_ACTIVE, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    /// Releases write lock (one atomic decrement)
+    void unlock_write() { state.fetch_sub(WRITER_ACTIVE, std::memory_order_release); }
+
+#ifdef ZIP_LOCK_CONTENTION
+    // ===== Contention profile (see LockContention) =====
+    LockContention read_contention;     ///< lock_read() calls that spun
+    LockContention write_contention;    ///< lock_write() calls that spun
+#endif
+
+private:
+    static constexpr uint32_t READER_MASK = 0x0000FFFFu;
+    static constexpr uint32_t WRITER_WAITING = 0x00010000u;    ///< One waiting writer
+    static constexpr uint32_t WAITING_MASK = 0x7FFF0000u;
+    static constexpr uint32_t WRITER_ACTIVE = 0x80000000u;
+
+    /// Tells the core we are spinning (frees pipeline resources for a sibling hyperthread)
+    static void cpu_relax() {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+        _mm_pause();
+#elif defined(__aarch64__)
+        __asm__ __volatile__("yield");
+#endif
+    }
+
+    std::atomic<uint32_t> state{0};
+};
+
+// ===== CondvarRWLock implementations =====
+
+inline void CondvarRWLock::lock_read() {
+    // Contended = state mutex busy or lock not immediately available (clock only read then)
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    bool contended = !lock.owns_lock();
+    std::chrono::steady_clock::time_point wait_start;
+    if (contended) {
+        wait_start = lock_wait_start();
+        lock.lock();
+    }
+
+    // Wait while:
+    // 1. A writer is active (writer_active = true), OR
+    // 2. Writers are waiting (waiting_writers > 0, writer preference policy)
+    // This prevents reader starvation of writers (writer preference)
+    auto can_read = [&]{ return !writer_active && waiting_writers == 0; };
+    if (!can_read()) {
+        if (!contended) {
+            contended = true;
+            wait_start = lock_wait_start();
+        }
+        cv.wait(lock, can_read);
+    }
+
+    active_readers++;  // Increment reader count (multiple readers allowed)
+#ifdef ZIP_LOCK_CONTENTION
+    if (contended) read_contention.record(wait_start);
+#endif
+}
+
+inline void CondvarRWLock::unlock_read() {
+    std::unique_lock<std::mutex> lock(mutex);
+    active_readers--;  // Decrement reader count
+
+    // If this was the last reader, notify waiting writers
+    // (Writers wait for active_readers == 0)
+    if (active_readers == 0) {
+        cv.notify_all();  // Wake all waiting threads (writers will compete)
+    }
+}
+
+inline void CondvarRWLock::lock_write() {
+    // Contended = state mutex busy or lock not immediately available (clock only read then)
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    bool contended = !lock.owns_lock();
+    std::chrono::steady_clock::time_point wait_start;
+    if (contended) {
+        wait_start = lock_wait_start();
+        lock.lock();
+    }
+
+    // Increment waiting_writers BEFORE waiting
+    // This blocks new readers (writer preference policy)
+    waiting_writers++;
+
+    // Wait while:
+    // 1. A writer is active (writer_active = true), OR
+    // 2. Readers are active (active_readers > 0)
+    // Only one writer can be active at a time (exclusive access)
+    auto can_write = [&]{ return !writer_active && active_readers == 0; };
+    if (!can_write()) {
+        if (!contended) {
+            contended = true;
+            wait_start = lock_wait_start();
+        }
+        cv.wait(lock, can_write);
+    }
+
+    waiting_writers--;  // We're no longer waiting (about to become active)
+    writer_active = true;  // Mark this thread as the active writer
+#ifdef ZIP_LOCK_CONTENTION
+    if (contended) write_contention.record(wait_start);
+#endif
+}
+
+inline bool CondvarRWLock::try_lock_write() {
+    std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+    // Queued writers keep their turn: only a completely idle lock is taken
+    if (!lock.owns_lock() || writer_active || active_readers > 0 || waiting_writers > 0) return false;
+    writer_active = true;
+    return true;
+}
+
+inline void CondvarRWLock::unlock_write() {
+    std::unique_lock<std::mutex> lock(mutex);
+    writer_active = false;  // Release exclusive write access
+
+    // Notify all waiting threads (both readers and writers)
+    // They will compete for next lock acquisition
+    cv.notify_all();
+}
+
+// ===== SpinRWLock implementations =====
+
+inline void SpinRWLock::lock_read() {
+    // Fast path: no writer active or waiting, one CAS
+    uint32_t current = state.load(std::memory_order_relaxed);
+    if (!(current & (WRITER_ACTIVE | WAITING_MASK)) &&
+        state.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return;
+    }
+
+#ifdef ZIP_LOCK_CONTENTION
+    auto wait_start = lock_wait_start();
+#endif
+    while (true) {
+        current = state.load(std::memory_order_relaxed);
+        if (!(current & (WRITER_ACTIVE | WAITING_MASK)) &&
+            state.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+            break;
+        }
+        cpu_relax();
+    }
+#ifdef ZIP_LOCK_CONTENTION
+    // Several readers may finish waiting together: shared recording
+    read_contention.record_shared(wait_start);
+#endif
+}
+
+inline void SpinRWLock::lock_write() {
+    // Fast path: lock free, one CAS
+    uint32_t current = 0;
+    if (state.compare_exchange_strong(current, WRITER_ACTIVE, std::memory_order_acquire, std::memory_order_relaxed)) {
+        return;
+    }
+
+    // Announce the wait first: new readers back off (writer preference)
+#ifdef ZIP_LOCK_CONTENTION
+    auto wait_start = lock_wait_start();
+#endif
+    state.fetch_add(WRITER_WAITING, std::memory_order_relaxed);
+    while (true) {
+        current = state.load(std::memory_order_relaxed);
+        if (!(current & (WRITER_ACTIVE | READER_MASK)) &&
+            state.compare_exchange_weak(current, current - WRITER_WAITING + WRITER_ACTIVE,
+                                        std::memory_order_acquire, std::memory_order_relaxed)) {
+            break;
+        }
+        cpu_relax();
+    }
+#ifdef ZIP_LOCK_CONTENTION
+    // Exclusive now: the only thread recording write contention
+    write_contention.record(wait_start);
+#endif
+}
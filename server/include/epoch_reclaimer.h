@@ -0,0 +1,214 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief ### Epoch-based memory reclamation for lock-free readers.
+ *
+ * Lets a writer unlink an object that lock-free readers may still be using, and frees it
+ * only once no reader can reach it anymore. Readers pay two thread-local stores per
+ * critical section (no shared refcount, no contended cache line).
+ *
+ * Protocol:
+ * - Readers wrap every access in a Guard, which announces the current global epoch
+ * - Writers unlink an object first, then retire() it (tagged with the current epoch)
+ * - The global epoch advances only when every pinned thread has announced it
+ * - An object retired in epoch e is freed once the global epoch reaches e + 2
+ *   (every reader that could have seen it has left its critical section)
+ *
+ * Threads register lazily on their first Guard; records are recycled when threads exit,
+ * so the short-lived worker threads of the server don't grow the registry.
+ *
+ * A single process-wide domain (instance()) is shared by all LockedMaps.
+ */
+class EpochReclaimer {
+    struct Record;  // Per-thread announcement (defined below)
+
+public:
+    /// Retired objects kept before retire() triggers a collect()
+    static constexpr size_t COLLECT_THRESHOLD = 64;
+
+    /**
+     * @brief ### Returns the process-wide reclamation domain.
+     *
+     * Intentionally never destroyed: detached worker threads may still hold guards at exit.
+     */
+    static EpochReclaimer& instance() {
+        static EpochReclaimer* domain = new EpochReclaimer();
+        return *domain;
+    }
+
+    /**
+     * @brief ### RAII critical section: objects reachable inside it are not freed until it ends.
+     *
+     * Nestable (only the outermost guard announces/clears the epoch).
+     */
+    class Guard {
+    public:
+        Guard();
+        ~Guard();
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        Record* record;  ///< Calling thread's record (owned by the domain)
+    };
+
+    /**
+     * @brief ### Schedules an already unlinked object for deletion.
+     *
+     * @param object Object no longer reachable by new readers.
+     * @param deleter Function that frees object (called once no reader can hold it).
+     */
+    void retire(void* object, void (*deleter)(void*));
+
+    /**
+     * @brief ### Tries to advance the global epoch and frees every object that became safe.
+     *
+     * Cheap when nothing is pending. Called by retire() and by periodic maintenance.
+     */
+    void collect();
+
+    /// Number of retired objects not freed yet
+    size_t pending() const;
+
+private:
+    /// Per-thread announcement (own cache line: only the owning thread writes it)
+    struct alignas(64) Record {
+        std::atomic<uint64_t> epoch{0};     ///< Announced epoch (0 = not in a critical section)
+        std::atomic<bool> in_use{false};    ///< Owned by a live thread
+        uint32_t nesting = 0;               ///< Guard depth (touched only by the owner)
+        Record* next = nullptr;             ///< Registry link (append-only list)
+    };
+
+    /// Retired object waiting for its grace period
+    struct Retired {
+        void* object;
+        void (*deleter)(void*);
+        uint64_t epoch;     ///< Global epoch when retired
+    };
+
+    EpochReclaimer() = default;
+
+    /// Returns the calling thread's record (registering on first use)
+    Record* local_record();
+
+    /// Claims a free record or appends a new one to the registry
+    Record* acquire_record();
+
+    std::atomic<uint64_t> global_epoch{1};  ///< Current epoch (starts at 1, 0 means quiescent)
+    std::atomic<Record*> records{nullptr};  ///< Registry of thread records (never shrinks)
+
+    mutable std::mutex retire_mutex;        ///< Protects retired list and epoch advancement
+    std::vector<Retired> retired;           ///< Objects waiting to be freed
+};
+
+// ===== EpochReclaimer implementations =====
+
+inline EpochReclaimer::Record* EpochReclaimer::acquire_record() {
+    // Reuse a record released by an exited thread
+    for (Record* record = records.load(std::memory_order_acquire); record; record = record->next) {
+        bool expected = false;
+        if (!record->in_use.load(std::memory_order_relaxed) &&
+            record->in_use.compare_exchange_strong(expected, true, std::memory_order_acq_rel)) {
+            return record;
+        }
+    }
+
+    // None free: append a new one (lock-free push, records are never unlinked)
+    Record* record = new Record();
+    record->in_use.store(true, std::memory_order_relaxed);
+    Record* head = records.load(std::memory_order_relaxed);
+    do {
+        record->next = head;
+    } while (!records.compare_exchange_weak(head, record, std::memory_order_release, std::memory_order_relaxed));
+    return record;
+}
+
+inline EpochReclaimer::Record* EpochReclaimer::local_record() {
+    // Releases the record when the thread exits so another thread can reuse it
+    struct LocalSlot {
+        Record* record = nullptr;
+        ~LocalSlot() {
+            if (record) record->in_use.store(false, std::memory_order_release);
+        }
+    };
+    static thread_local LocalSlot slot;
+
+    if (!slot.record) slot.record = acquire_record();
+    return slot.record;
+}
+
+inline EpochReclaimer::Guard::Guard() {
+    EpochReclaimer& domain = EpochReclaimer::instance();
+    record = domain.local_record();
+
+    if (record->nesting++ == 0) {
+        // Announce, then fence: later reads of shared pointers can't move above the announcement
+        record->epoch.store(domain.global_epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+}
+
+inline EpochReclaimer::Guard::~Guard() {
+    if (--record->nesting == 0) {
+        record->epoch.store(0, std::memory_order_release);  // Leave critical section
+    }
+}
+
+inline void EpochReclaimer::retire(void* object, void (*deleter)(void*)) {
+    size_t waiting;
+    {
+        std::lock_guard<std::mutex> lock(retire_mutex);
+        std::atomic_thread_fence(std::memory_order_seq_cst);  // Unlink happens-before the epoch tag
+        retired.push_back({object, deleter, global_epoch.load(std::memory_order_acquire)});
+        waiting = retired.size();
+    }
+    if (waiting >= COLLECT_THRESHOLD) collect();
+}
+
+inline void EpochReclaimer::collect() {
+    std::vector<Retired> ready;
+    {
+        std::lock_guard<std::mutex> lock(retire_mutex);
+        if (retired.empty()) return;
+
+        // Advance only if every thread inside a critical section has seen the current epoch
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t current = global_epoch.load(std::memory_order_acquire);
+        bool can_advance = true;
+        for (Record* record = records.load(std::memory_order_acquire); record; record = record->next) {
+            uint64_t announced = record->epoch.load(std::memory_order_acquire);
+            if (announced != 0 && announced != current) {
+                can_advance = false;
+                break;
+            }
+        }
+        if (can_advance) {
+            current++;
+            global_epoch.store(current, std::memory_order_release);
+        }
+
+        // Objects retired two epochs ago can no longer be referenced
+        size_t kept = 0;
+        for (Retired& item : retired) {
+            if (item.epoch + 2 <= current) {
+                ready.push_back(item);
+            } else {
+                retired[kept++] = item;
+            }
+        }
+        retired.resize(kept);
+    }
+
+    // Free outside the lock (deleters may be arbitrarily expensive)
+    for (Retired& item : ready) item.deleter(item.object);
+}
+
+inline size_t EpochReclaimer::pending() const {
+    std::lock_guard<std::mutex> lock(retire_mutex);
+    return retired.size();
+}
@@ -1,81 +1,108 @@
 #pragma once
-#include <unordered_map>
+#include "split_ordered_index.h"
+#include "perf_counters.h"
+#include "entry_lock.h"
 #include <mutex>
-#include <condition_variable>
 #include <functional>
 #include <optional>
 #include <memory>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <vector>
 
 /**
- * @brief ### Per-entry reader-writer lock with writer preference (prevents writer starvation).
+ * @brief ### Opt-in trait for values that fit in a single 64-bit atomic word.
  * 
- * Each Entry in LockedMap has its own independent lock, enabling fine-grained concurrency.
- * Multiple threads can read the same entry simultaneously, but writes are exclusive.
+ * By default LockedMap stores values behind the entry's reader-writer lock. Specializing
+ * this trait with `enabled = true` and pack()/unpack() switches the entry to a
+ * std::atomic<uint64_t> so single-entry operations (read(), update()) become one atomic
+ * load or CAS with no entry mutex at all.
  * 
- * Writer preference policy:
- * - Readers wait if ANY writers are waiting (prevents writer starvation)
- * - Writers wait only for active readers to finish
- * - Without this, continuous readers could starve writers indefinitely
+ * Packed words are split into two 32-bit lanes (low, high). Pair operations still take
+ * the ordered write locks and only publish the lanes they changed, so callers must ensure
+ * that update() and atomic_pair_operation() never modify the same lane concurrently.
  * 
- * Lock states:
- * - active_readers > 0, writer_active = false: Multiple readers active
- * - active_readers = 0, writer_active = true: Single writer active
- * - Both = 0: Entry unlocked, available for locking
+ * Specialization contract:
+ * - static constexpr bool enabled = true;
+ * - static uint64_t pack(const V& value);
+ * - static V unpack(uint64_t word);
  * 
- * @tparam V Type of the stored value (can be any copyable type).
+ * @tparam V Value type stored in LockedMap.
  */
 template<typename V>
-struct Entry {
-    V value;                        ///< The actual stored data (protected by locks below)
-    
-    // ===== Reader-writer lock state =====
-    uint32_t active_readers = 0;    ///< Number of threads currently holding read lock (can be > 1)
-    bool writer_active = false;     ///< True if a thread currently holds write lock (exclusive, max 1)
-    uint32_t waiting_writers = 0;   ///< Number of threads waiting to acquire write lock (for priority)
-    
-    // ===== Synchronization primitives =====
-    std::mutex mutex;               ///< Protects the lock state variables (active_readers, writer_active, etc.)
-    std::condition_variable cv;     ///< Signals when lock state changes (wakes waiting readers/writers)
+struct AtomicWordTraits {
+    static constexpr bool enabled = false;
+};
 
-    /**
-     * @brief ### Acquires read lock (shared, multiple readers allowed).
-     * 
-     * Blocks if:
-     * - A writer is currently active (writer_active = true)
-     * - Any writers are waiting (waiting_writers > 0, writer preference policy)
-     * 
-     * Multiple readers can hold locks simultaneously (active_readers incremented).
-     * Read operations don't modify data, so concurrent reads are safe.
-     */
-    void lock_read();
+/**
+ * @brief ### Storage for an Entry's value (plain value guarded by the entry lock).
+ */
+template<typename V, bool Packed = AtomicWordTraits<V>::enabled>
+struct EntryStorage {
+    V value;                        ///< The actual stored data (protected by the entry lock)
+};
 
-    /**
-     * @brief ### Releases read lock.
-     * 
-     * Decrements active_readers counter.
-     * If this was the last reader (active_readers becomes 0), notifies waiting writers.
-     */
-    void unlock_read();
+/**
+ * @brief ### Storage for an Entry's value packed into one atomic word (see AtomicWordTraits).
+ */
+template<typename V>
+struct EntryStorage<V, true> {
+    std::atomic<uint64_t> word{0};  ///< Packed value (AtomicWordTraits<V>::pack), read and CAS'd lock-free
+};
 
-    /**
-     * @brief ### Acquires write lock (exclusive, only one writer allowed).
-     * 
-     * Blocks if:
-     * - A writer is currently active (writer_active = true)
-     * - Any readers are active (active_readers > 0)
-     * 
-     * Increments waiting_writers before waiting (blocks new readers, writer preference).
-     * Only one writer can hold lock at a time (exclusive access for modification).
-     */
-    void lock_write();
+/**
+ * @brief ### Outcome of LockedMap::claim_sequence().
+ */
+enum class SequenceClaim : uint8_t {
+    NOT_FOUND,  ///< Key doesn't exist (nothing claimed)
+    DUPLICATE,  ///< Sequence number already claimed, or too old to tell (nothing changed)
+    CLAIMED     ///< Sequence number was new and is now claimed
+};
 
-    /**
-     * @brief ### Releases write lock.
-     * 
-     * Sets writer_active = false and notifies ALL waiting threads.
-     * Both readers and writers wake up and compete for next lock acquisition.
-     */
-    void unlock_write();
+/// Sequence numbers below an entry's highest claim that are still tracked individually
+/// (one bit each, packed with the highest claim in one atomic word)
+constexpr uint32_t SEQUENCE_WINDOW = 32;
+
+/// Outcome of a claimed sequence number not recorded yet (LockedMap::record_outcome() codes are 1-3)
+constexpr uint8_t SEQUENCE_OUTCOME_PENDING = 0;
+
+/**
+ * @brief ### One map entry: value storage plus its own reader-writer lock (lock policy).
+ * 
+ * Each Entry in LockedMap has its own independent lock, enabling fine-grained concurrency.
+ * Multiple threads can read the same entry simultaneously, but writes are exclusive.
+ * The lock is a policy (CondvarRWLock by default, SpinRWLock for lean builds, see entry_lock.h).
+ * 
+ * Values with an AtomicWordTraits specialization live in an atomic word instead
+ * (see EntryStorage); the lock then only orders pair operations and write().
+ * 
+ * Each entry also carries a sequence gate, independent of the lock and value, used for
+ * idempotency (duplicate requests are rejected with a single atomic load). The gate keeps
+ * the highest claim plus a bitmap of the SEQUENCE_WINDOW numbers below it, so claims that
+ * arrive out of order (pipelined requests) are still accepted exactly once. Next to it, the
+ * outcome of each recent claim (a 2-bit code chosen by the caller, e.g. the reply type) is
+ * kept, so a duplicate can be answered with the original result.
+ * 
+ * Removal: LockedMap::erase marks the entry removed under its write lock, so operations
+ * that reach it afterwards treat it as missing; its memory is reclaimed by EpochReclaimer.
+ * 
+ * @tparam V Type of the stored value (can be any copyable type).
+ * @tparam Lock Reader-writer lock policy (lock_read/unlock_read/lock_write/try_lock_write/unlock_write + contention counters in ZIP_LOCK_CONTENTION builds).
+ */
+template<typename V, typename Lock = CondvarRWLock>
+struct Entry : EntryStorage<V>, Lock {
+    // ===== Sequence gate (idempotency) and lifecycle =====
+    /// Low 32 bits: highest sequence number claimed so far; high 32 bits: bit i set if
+    /// (highest - 1 - i) was claimed (see LockedMap::claim_sequence)
+    /// Own cache line: claims and duplicate checks never contend with the value or lock state
+    alignas(64) std::atomic<uint64_t> sequence{0};
+    /// Per sequence % SEQUENCE_WINDOW: generation (sequence / SEQUENCE_WINDOW, low 6 bits) << 2 | outcome
+    /// code (see LockedMap::record_outcome); same cache line as the gate, no extra entry size
+    std::atomic<uint8_t> outcomes[SEQUENCE_WINDOW] = {};
+    std::atomic<uint32_t> last_active{0};   ///< Activity stamp of the last claim/insert (see LockedMap::set_activity_stamp)
+    std::atomic<bool> removed{false};       ///< Set under write lock by LockedMap::erase (entry is a tombstone)
 };
 
 /**
@@ -88,25 +115,33 @@ struct Entry {
  * - Multiple threads can read/write different entries simultaneously (fine-grained locking)
  * - Multiple threads can read the same entry simultaneously (reader-writer lock)
  * - Only one thread can write to an entry at a time (exclusive write access)
- * - Map structure modifications (inserts) use separate map_mutex (coarse-grained)
+ * - Lookups are lock-free (SplitOrderedIndex): they never wait, not even while the index grows
+ * - Map structure modifications (inserts, erases, reserve) are serialized by map_mutex
+ * 
+ * Memory reclamation:
+ * - Every operation runs inside an EpochReclaimer::Guard (thread-local, no refcount per lookup)
+ * - erase() retires entries; they are freed once no operation can still reference them
  * 
  * Deadlock prevention:
  * - atomic_pair_operation() locks entries in fixed order (by pointer address)
+ * - atomic_group_operation() only waits for a lock in that same order (try-locks otherwise)
  * - Prevents circular wait condition (AB-BA deadlock)
  * 
  * Use case: Server's client map where transactions lock 2 entries simultaneously.
  * 
- * @tparam K Key type (must be hashable for unordered_map).
+ * @tparam K Key type (must be hashable with std::hash).
  * @tparam V Value type (must be copyable for read() operation).
+ * @tparam Lock Entry lock policy (see Entry).
  */
-template<typename K, typename V>
+template<typename K, typename V, typename Lock = CondvarRWLock>
 class LockedMap {
 public:
     /**
      * @brief ### Inserts a new key-value pair if key doesn't exist (idempotent).
      * 
-     * Acquires map_mutex to safely modify map structure.
-     * Creates new Entry with default reader-writer lock state.
+     * Acquires map_mutex to serialize index writers (lookups keep running lock-free).
+     * Creates new Entry with default reader-writer lock state, fully initialized before
+     * it becomes visible to other threads. Index growth is incremental (no rehash stall).
      * 
      * @param key Key to insert.
      * @param value Value to associate with key.
@@ -116,10 +151,84 @@ public:
      */
     bool insert(const K& key, const V& value);
 
+    /**
+     * @brief ### Removes a key, returning its final value (account closure).
+     * 
+     * Takes the entry's write lock, marks it removed and captures its value, so no pair
+     * operation can modify it afterwards (their changes would otherwise be lost with it).
+     * The entry is then unlinked under map_mutex and retired to EpochReclaimer, which
+     * frees it once threads still holding it are done.
+     * 
+     * @param key Key to remove.
+     * @return Value at removal, std::nullopt if key not found.
+     * 
+     * Note: Lock-free update() calls racing the removal may be lost with the entry.
+     */
+    std::optional<V> erase(const K& key);
+
+    /**
+     * @brief ### Removes every entry whose activity stamp is older than a cutoff (expiry).
+     * 
+     * Scans the index lock-free, then erases each candidate individually (map_mutex is
+     * only held per removal, so registrations keep flowing during a sweep).
+     * 
+     * @param idle_before Entries with last activity stamp < idle_before are removed.
+     * @param on_erase Callback receiving (key, final value) for each removed entry.
+     * @return Number of entries removed.
+     */
+    size_t erase_idle(uint32_t idle_before, const std::function<void(const K&, const V&)>& on_erase);
+
+    /**
+     * @brief ### Sets the stamp recorded as "last activity" by subsequent operations.
+     * 
+     * The owner advances it with a coarse clock (e.g. seconds since start).
+     * insert(), claim_sequence() and read(key, sequence) stamp the entry they touch;
+     * erase_idle() compares against these stamps.
+     * 
+     * @param stamp Current activity stamp.
+     */
+    void set_activity_stamp(uint32_t stamp) { activity_stamp.store(stamp, std::memory_order_relaxed); }
+
+    /**
+     * @brief ### Presizes the index for a known number of keys.
+     * 
+     * Allocates and initializes all buckets up front, so inserts up to expected_count
+     * never grow the index. Acquires map_mutex (serialized with insert()).
+     * 
+     * @param expected_count Number of keys expected to be stored.
+     */
+    void reserve(size_t expected_count);
+
+    /**
+     * @brief ### Returns the number of keys stored (approximate during concurrent inserts).
+     */
+    size_t size() const { return index.size(); }
+
+#ifdef ZIP_LOCK_CONTENTION
+    /// Contention profile of one entry (see most_contended())
+    struct EntryContention {
+        K key;                          ///< Entry's key
+        LockContentionStats read;       ///< lock_read() waits
+        LockContentionStats write;      ///< lock_write() waits
+        uint64_t total_wait_ns() const { return read.wait_ns + write.wait_ns; }
+    };
+
+    /**
+     * @brief ### Returns the entries that waited longest for their locks (cumulative).
+     * 
+     * Lock-free scan of the index (no map_mutex, no entry lock); entries that never waited
+     * are skipped.
+     * 
+     * @param count Maximum entries returned.
+     * @return Entries sorted by total wait time, longest first.
+     */
+    std::vector<EntryContention> most_contended(size_t count) const;
+#endif
+
     /**
      * @brief ### Checks if a key exists in the map (read-only query).
      * 
-     * Acquires map_mutex briefly to check existence.
+     * Lock-free index lookup (no map_mutex).
      * Does NOT acquire entry's reader-writer lock (only checks map structure).
      * 
      * @param key Key to check.
@@ -130,10 +239,25 @@ public:
      */
     bool exists(const K& key) const;
 
+    /**
+     * @brief ### Pulls the entries of a group of keys into cache ahead of operations on them.
+     *
+     * Resolves all keys together (SplitOrderedIndex::find_batch), then prefetches each live
+     * entry's value/lock line and its sequence gate line. Purely a hint: changes nothing,
+     * missing keys are skipped, and operations stay correct if entries move or are erased.
+     * Pays off when the entries are cold (many accounts): the group's misses overlap
+     * instead of each operation stalling on its own.
+     *
+     * @param keys Keys about to be operated on (duplicates allowed).
+     * @param count Number of keys.
+     */
+    void prefetch(const K* keys, size_t count) const;
+
     /**
      * @brief ### Reads the value associated with a key (returns a copy).
      * 
      * Acquires entry's read lock (allows concurrent reads, blocks if writer active).
+     * Packed values (AtomicWordTraits) are read with a single atomic load instead.
      * Returns copy of value to allow safe access after lock release.
      * 
      * @param key Key to read.
@@ -144,6 +268,15 @@ public:
      */
     std::optional<V> read(const K& key);
 
+    /**
+     * @brief ### Reads the value and the entry's sequence gate with a single lookup.
+     * 
+     * @param key Key to read.
+     * @param sequence [OUT] Highest sequence number claimed on the entry (0 = none yet).
+     * @return std::optional containing value copy if key exists, std::nullopt if not found.
+     */
+    std::optional<V> read(const K& key, uint32_t& sequence);
+
     /**
      * @brief ### Writes a new value to an existing key (replace operation).
      * 
@@ -159,6 +292,59 @@ public:
      */
     bool write(const K& key, const V& value);
 
+    /**
+     * @brief ### Read-modify-write of a single entry (compare-and-swap for packed values).
+     * 
+     * Callback receives a copy of the current value, may modify it, and returns true to
+     * commit or false to leave the entry untouched.
+     * 
+     * - Packed values (AtomicWordTraits): one CAS on the entry word, no entry mutex. If the
+     *   CAS loses a race the callback runs again on the fresh value, so it must only write
+     *   to captured state that is fully overwritten on each call.
+     * - Other values: runs once under the entry's write lock.
+     * 
+     * @param key Key to update (must already exist in map).
+     * @param fn Callback receiving (V& value), returns true to commit the modified copy.
+     * @return True if key exists (whether or not fn committed), false if key not found.
+     * 
+     * Use case: Duplicate check and request_id claim in a single atomic step.
+     */
+    bool update(const K& key, const std::function<bool(V&)>& fn);
+
+    /**
+     * @brief ### Claims a sequence number on an entry's idempotency gate (lock-free).
+     * 
+     * A sequence number is claimed if it is greater than the highest claimed one, or if it
+     * lies within SEQUENCE_WINDOW below it and was not claimed yet (reordered request).
+     * Anything else is reported as a duplicate, including numbers older than the window.
+     * 
+     * Cost:
+     * - Duplicate: one atomic load (no store, no entry lock, value word untouched)
+     * - New sequence: one CAS (retried only if another claim raced on the same entry)
+     * 
+     * @param key Key whose gate is claimed.
+     * @param sequence Sequence number to claim (e.g. packet request_id).
+     * @param last_claimed [OUT] Highest sequence claimed before this call (unchanged if NOT_FOUND).
+     * @return SequenceClaim::CLAIMED, DUPLICATE, or NOT_FOUND if key missing.
+     * 
+     * Use case: Reject retransmitted requests without touching the balance.
+     */
+    SequenceClaim claim_sequence(const K& key, uint32_t sequence, uint32_t& last_claimed);
+
+    /**
+     * @brief ### Records the outcome of a claimed sequence number (for duplicates of it, lock-free).
+     * @param outcome Caller's code, 1-3 (SEQUENCE_OUTCOME_PENDING until recorded).
+     */
+    void record_outcome(const K& key, uint32_t sequence, uint8_t outcome);
+
+    /**
+     * @brief ### Outcome recorded for a claimed sequence number (lock-free).
+     * @return The code given to record_outcome(), SEQUENCE_OUTCOME_PENDING while the claim's
+     *         owner hasn't recorded it yet, or nullopt if it is no longer known (older than
+     *         SEQUENCE_WINDOW, its slot reused by a later claim, or key missing).
+     */
+    std::optional<uint8_t> sequence_outcome(const K& key, uint32_t sequence);
+
     /**
      * @brief ### Atomically performs an operation on two entries (transaction primitive).
      * 
@@ -172,6 +358,10 @@ public:
      * 
      * Special case: If key1 == key2 (self-operation), acquires single write lock.
      * 
+     * Packed values (AtomicWordTraits): the callback runs on copies taken under the locks,
+     * then only the 32-bit lanes it changed are published with CAS, so concurrent update()
+     * calls on the other lane are never lost.
+     * 
      * @param key1 First key (must exist in map).
      * @param key2 Second key (must exist in map).
      * @param fn Callback function receiving (V& value1, V& value2) for modification.
@@ -187,167 +377,453 @@ public:
     bool atomic_pair_operation(const K& key1, const K& key2,
                                const std::function<void(V&, V&)>& fn);
 
+    /// Most keys one atomic_group_operation() can lock
+    static constexpr size_t GROUP_MAX_KEYS = 64;
+
+    /**
+     * @brief ### Atomically operates on several entries, each locked once.
+     * 
+     * Generalizes atomic_pair_operation() to a group: the callback applies any number of
+     * changes while every entry is locked, e.g. a batch of transfers where many payers
+     * credit the same merchant: the merchant's lock is taken once for the whole batch
+     * instead of once per transfer.
+     * 
+     * Locking: every lock is first tried in the given order (try_lock_write(), no wait, no
+     * sort). If one is taken, the locks held so far are released and all of them are taken
+     * in the pair operation order (Entry pointer address, blocking), so group and pair
+     * operations never deadlock each other.
+     * 
+     * Packed values: same lane-merge publication as atomic_pair_operation().
+     * 
+     * @param keys Distinct keys (at most GROUP_MAX_KEYS, all must exist in map).
+     * @param count Number of keys.
+     * @param fn Callback receiving values, with values[i] the value of keys[i] (modifiable).
+     * @return True if every key exists and the operation ran, false otherwise (nothing changed).
+     */
+    bool atomic_group_operation(const K* keys, size_t count, const std::function<void(V* values)>& fn);
+
 private:
-    /// Map of entries, each with independent reader-writer lock
-    /// Key = client IP, Value = shared_ptr<Entry<ClientInfo>>
-    std::unordered_map<K, std::shared_ptr<Entry<V>>> data;
+    /// Index of entries, each with independent reader-writer lock
+    /// Key = client IP, Value = Entry<ClientInfo> (stored inline in the index node)
+    SplitOrderedIndex<K, Entry<V, Lock>> index;
     
-    /// Protects map structure modifications (insert, find operations)
+    /// Serializes index writers (insert, erase, reserve); lookups never take it
     /// NOT used for protecting individual entry values (entries have own locks)
     std::mutex map_mutex;
 
+    /// Current activity stamp copied into entries on activity (see set_activity_stamp)
+    std::atomic<uint32_t> activity_stamp{0};
+
+    /// Guard type protecting entries from reclamation during an operation
+    using Guard = EpochReclaimer::Guard;
+
+    /// Outcome slot value of a sequence: generation (6 bits, tells reused slots apart) and 2-bit code
+    static uint8_t outcome_tag(uint32_t sequence, uint8_t outcome) {
+        return static_cast<uint8_t>((((sequence / SEQUENCE_WINDOW) & 0x3F) << 2) | (outcome & 0x3));
+    }
+
+    /// Records activity on an entry (skips the store when the stamp is unchanged)
+    void stamp_activity(Entry<V, Lock>& entry) {
+        uint32_t stamp = activity_stamp.load(std::memory_order_relaxed);
+        if (entry.last_active.load(std::memory_order_relaxed) != stamp) {
+            entry.last_active.store(stamp, std::memory_order_relaxed);
+        }
+    }
+
     /**
-     * @brief Helper to safely retrieve Entry shared_ptr (internal use only).
+     * @brief Marks an entry removed and unlinks it (internal use only).
      * 
-     * Acquires map_mutex, looks up key, returns shared_ptr or nullptr.
-     * Shared_ptr keeps Entry alive even if map_mutex is released.
+     * @param key Key of the entry.
+     * @param idle_before Only remove if last activity stamp < idle_before (UINT32_MAX = always).
+     * @return Value at removal, std::nullopt if missing, already removed or active.
+     */
+    std::optional<V> remove_entry(const K& key, uint32_t idle_before);
+
+    /// True when V is stored in a single atomic word (see AtomicWordTraits)
+    static constexpr bool packed = AtomicWordTraits<V>::enabled;
+
+    /**
+     * @brief Publishes the lanes of a packed word changed by a pair operation (internal use only).
+     * 
+     * Lanes equal in before/after keep whatever value is currently stored (they may have
+     * been changed by a concurrent update()), changed lanes are overwritten with after.
+     * 
+     * @param entry Entry whose word is updated (caller holds its write lock).
+     * @param before Word snapshot the callback started from.
+     * @param after Word produced by the callback.
+     */
+    static void publish_changed_lanes(Entry<V, Lock>& entry, uint64_t before, uint64_t after) {
+        uint64_t changed = before ^ after;
+        uint64_t mask = ((changed & 0x00000000FFFFFFFFull) ? 0x00000000FFFFFFFFull : 0)
+                      | ((changed & 0xFFFFFFFF00000000ull) ? 0xFFFFFFFF00000000ull : 0);
+        if (mask == 0) return;  // Callback didn't modify this entry
+
+        uint64_t current = entry.word.load(std::memory_order_acquire);
+        while (!entry.word.compare_exchange_weak(current, (current & ~mask) | (after & mask),
+                                                 std::memory_order_acq_rel, std::memory_order_acquire)) {
+            // current reloaded by compare_exchange_weak, retry merge
+        }
+    }
+
+    /**
+     * @brief Helper to retrieve a live Entry (internal use only).
+     * 
+     * Lock-free index lookup. The caller must hold a Guard: the pointer stays valid until
+     * the guard ends, even if the entry is erased meanwhile.
      * 
      * @param key Key to look up.
-     * @return shared_ptr to Entry if found, nullptr otherwise.
+     * @return Pointer to Entry if found and not removed, nullptr otherwise.
      */
-    std::shared_ptr<Entry<V>> get_entry(const K& key) {
-        std::lock_guard<std::mutex> lock(map_mutex);
-        auto it = data.find(key);
-        if (it == data.end()) return nullptr;
-        return it->second;
+    Entry<V, Lock>* get_entry(const K& key) const {
+        Entry<V, Lock>* entry = index.find(key);
+        if (!entry || entry->removed.load(std::memory_order_acquire)) return nullptr;
+        return entry;
     }
 };
 
-// ===== Entry implementations =====
+// ===== LockedMap implementations =====
 
-template<typename V>
-void Entry<V>::lock_read() {
-    std::unique_lock<std::mutex> lock(mutex);
-    
-    // Wait while:
-    // 1. A writer is active (writer_active = true), OR
-    // 2. Writers are waiting (waiting_writers > 0, writer preference policy)
-    // This prevents reader starvation of writers (writer preference)
-    cv.wait(lock, [&]{ return !writer_active && waiting_writers == 0; });
+template<typename K, typename V, typename Lock>
+bool LockedMap<K,V,Lock>::insert(const K& key, const V& value) {
+    PERF_SCOPE(PerfRegion::LOCKED_MAP);
+    Guard guard;
+    std::lock_guard<std::mutex> lock(map_mutex);  // Serialize index writers
     
-    active_readers++;  // Increment reader count (multiple readers allowed)
-}
+    // Inserts only if key doesn't exist (check + insert under map_mutex)
+    // The value is initialized before the entry is published to lock-free readers
+    auto init = [&](Entry<V, Lock>& new_entry) {
+        if constexpr (packed) {
+            new_entry.word.store(AtomicWordTraits<V>::pack(value), std::memory_order_relaxed);
+        } else {
+            new_entry.value = value;
+        }
+        new_entry.last_active.store(activity_stamp.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    };
+    auto [entry, inserted] = index.insert(key, init);
 
-template<typename V>
-void Entry<V>::unlock_read() {
-    std::unique_lock<std::mutex> lock(mutex);
-    active_readers--;  // Decrement reader count
-    
-    // If this was the last reader, notify waiting writers
-    // (Writers wait for active_readers == 0)
-    if (active_readers == 0) {
-        cv.notify_all();  // Wake all waiting threads (writers will compete)
+    // Removed entry whose erase() hasn't unlinked it yet: replace it with a fresh one
+    if (!inserted && entry->removed.load(std::memory_order_acquire)) {
+        index.erase(key, entry);
+        inserted = index.insert(key, init).second;
     }
-}
-
-template<typename V>
-void Entry<V>::lock_write() {
-    std::unique_lock<std::mutex> lock(mutex);
-    
-    // Increment waiting_writers BEFORE waiting
-    // This blocks new readers (writer preference policy)
-    waiting_writers++;
-    
-    // Wait while:
-    // 1. A writer is active (writer_active = true), OR
-    // 2. Readers are active (active_readers > 0)
-    // Only one writer can be active at a time (exclusive access)
-    cv.wait(lock, [&]{ return !writer_active && active_readers == 0; });
+    // If not inserted, key already exists (no modification, idempotent)
     
-    waiting_writers--;  // We're no longer waiting (about to become active)
-    writer_active = true;  // Mark this thread as the active writer
+    return inserted;
 }
 
-template<typename V>
-void Entry<V>::unlock_write() {
-    std::unique_lock<std::mutex> lock(mutex);
-    writer_active = false;  // Release exclusive write access
-    
-    // Notify all waiting threads (both readers and writers)
-    // They will compete for next lock acquisition
-    cv.notify_all();
+template<typename K, typename V, typename Lock>
+void LockedMap<K,V,Lock>::reserve(size_t expected_count) {
+    std::lock_guard<std::mutex> lock(map_mutex);  // Serialize index writers
+    index.reserve(expected_count);
 }
 
-// ===== LockedMap implementations =====
+template<typename K, typename V, typename Lock>
+bool LockedMap<K,V,Lock>::exists(const K& key) const {
+    PERF_SCOPE(PerfRegion::LOCKED_MAP);
+    Guard guard;
+    return get_entry(key) != nullptr;  // Lock-free lookup
+}
 
-template<typename K, typename V>
-bool LockedMap<K,V>::insert(const K& key, const V& value) {
-    std::lock_guard<std::mutex> lock(map_mutex);  // Protect map structure modification
-    
-    // try_emplace: inserts only if key doesn't exist (atomic check + insert)
-    // Returns pair<iterator, bool> where bool = true if inserted
-    auto [it, inserted] = data.try_emplace(key, std::make_shared<Entry<V>>());
-    
-    if (inserted) {
-        // New entry created, initialize its value
-        it->second->value = value;
+template<typename K, typename V, typename Lock>
+void LockedMap<K,V,Lock>::prefetch(const K* keys, size_t count) const {
+    PERF_SCOPE(PerfRegion::LOCKED_MAP);
+    constexpr size_t group_size = SplitOrderedIndex<K, Entry<V, Lock>>::FIND_BATCH_GROUP;
+    Entry<V, Lock>* entries[group_size];
+    Guard guard;  // Nodes walked by find_batch() must not be freed meanwhile
+    for (size_t base = 0; base < count; base += group_size) {
+        size_t group = std::min(group_size, count - base);
+        index.find_batch(keys + base, group, entries);
+        for (size_t i = 0; i < group; i++) {
+            if (!entries[i]) continue;
+            prefetch_address(entries[i]);             // Value word and lock state
+            prefetch_address(&entries[i]->sequence);  // Sequence gate (own cache line)
+        }
     }
-    // If not inserted, key already exists (no modification, idempotent)
-    
-    return inserted;
 }
 
-template<typename K, typename V>
-bool LockedMap<K,V>::exists(const K& key) const {
-    std::lock_guard<std::mutex> lock(map_mutex);  // Protect map structure read
-    return data.find(key) != data.end();
+template<typename K, typename V, typename Lock>
+std::optional<V> LockedMap<K,V,Lock>::read(const K& key) {
+    PERF_SCOPE(PerfRegion::LOCKED_MAP);
+    // Get entry (lock-free index lookup, guard keeps it alive until we return)
+    Guard guard;
+    Entry<V, Lock>* entry_ptr = get_entry(key);
+    if (!entry_ptr) return std::nullopt;  // Key doesn't exist
+    
+    // Packed value: a single atomic load, no entry lock needed
+    if constexpr (packed) {
+        return AtomicWordTraits<V>::unpack(entry_ptr->word.load(std::memory_order_acquire));
+    } else {
+        // Acquire read lock on entry (allows concurrent reads)
+        entry_ptr->lock_read();
+        V value_copy = entry_ptr->value;  // Copy value while locked
+        entry_ptr->unlock_read();
+        
+        return value_copy;  // Return copy (safe to use after unlock)
+    }
 }
 
-template<typename K, typename V>
-std::optional<V> LockedMap<K,V>::read(const K& key) {
-    // Get shared_ptr to entry (acquires map_mutex briefly)
-    std::shared_ptr<Entry<V>> entry_ptr = get_entry(key);
+template<typename K, typename V, typename Lock>
+std::optional<V> LockedMap<K,V,Lock>::read(const K& key, uint32_t& sequence) {
+    PERF_SCOPE(PerfRegion::LOCKED_MAP);
+    Guard guard;
+    Entry<V, Lock>* entry_ptr = get_entry(key);
     if (!entry_ptr) return std::nullopt;  // Key doesn't exist
-    
-    // Acquire read lock on entry (allows concurrent reads)
-    // map_mutex is already released here (fine-grained locking)
-    entry_ptr->lock_read();
-    V value_copy = entry_ptr->value;  // Copy value while locked
-    entry_ptr->unlock_read();
-    
-    return value_copy;  // Return copy (safe to use after unlock)
+
+    stamp_activity(*entry_ptr);
+    sequence = static_cast<uint32_t>(entry_ptr->sequence.load(std::memory_order_acquire));
+    if constexpr (packed) {
+        return AtomicWordTraits<V>::unpack(entry_ptr->word.load(std::memory_order_acquire));
+    } else {
+        entry_ptr->lock_read();
+        V value_copy = entry_ptr->value;
+        entry_ptr->unlock_read();
+        return value_copy;
+    }
 }
 
-template<typename K, typename V>
-bool LockedMap<K,V>::write(const K& key, const V& value) {
-    // Get shared_ptr to entry (acquires map_mutex briefly)
-    std::shared_ptr<Entry<V>> entry_ptr = get_entry(key);
+template<typename K, typename V, typename Lock>
+bool LockedMap<K,V,Lock>::write(const K& key, const V& value) {
+    PERF_SCOPE(PerfRegion::LOCKED_MAP);
+    // Get entry (lock-free index lookup, guard keeps it alive until we return)
+    Guard guard;
+    Entry<V, Lock>* entry_ptr = get_entry(key);
     if (!entry_ptr) return false;  // Key doesn't exist
     
     // Acquire write lock on entry (exclusive access)
-    // map_mutex is already released here (fine-grained locking)
     entry_ptr->lock_write();
-    entry_ptr->value = value;  // Modify value while locked
+    if (entry_ptr->removed.load(std::memory_order_relaxed)) {
+        // Erased while we waited for the lock
+        entry_ptr->unlock_write();
+        return false;
+    }
+    if constexpr (packed) {
+        entry_ptr->word.store(AtomicWordTraits<V>::pack(value), std::memory_order_release);
+    } else {
+        entry_ptr->value = value;  // Modify value while locked
+    }
     entry_ptr->unlock_write();
     
     return true;
 }
 
-template<typename K, typename V>
-bool LockedMap<K,V>::atomic_pair_operation(const K& key1, const K& key2,
-                                            const std::function<void(V&, V&)>& fn) {
-    // Step 1: Get shared_ptrs for both entries (acquires map_mutex briefly)
-    std::shared_ptr<Entry<V>> entry1, entry2;
+template<typename K, typename V, typename Lock>
+bool LockedMap<K,V,Lock>::update(const K& key, const std::function<bool(V&)>& fn) {
+    PERF_SCOPE(PerfRegion::LOCKED_MAP);
+    // Get entry (lock-free index lookup, guard keeps it alive until we return)
+    Guard guard;
+    Entry<V, Lock>* entry_ptr = get_entry(key);
+    if (!entry_ptr) return false;  // Key doesn't exist
+
+    if constexpr (packed) {
+        // CAS loop: callback works on a copy, commit only if nobody changed the word meanwhile
+        uint64_t current = entry_ptr->word.load(std::memory_order_acquire);
+        while (true) {
+            V value_copy = AtomicWordTraits<V>::unpack(current);
+            if (!fn(value_copy)) return true;  // Callback declined, nothing to publish
+
+            if (entry_ptr->word.compare_exchange_weak(current, AtomicWordTraits<V>::pack(value_copy),
+                                                      std::memory_order_acq_rel, std::memory_order_acquire)) {
+                return true;
+            }
+            // Lost the race: current holds the fresh word, rerun callback on it
+        }
+    } else {
+        // Exclusive access for the whole read-modify-write
+        entry_ptr->lock_write();
+        if (entry_ptr->removed.load(std::memory_order_relaxed)) {
+            // Erased while we waited for the lock
+            entry_ptr->unlock_write();
+            return false;
+        }
+        V value_copy = entry_ptr->value;
+        if (fn(value_copy)) {
+            entry_ptr->value = value_copy;
+        }
+        entry_ptr->unlock_write();
+        return true;
+    }
+}
+
+template<typename K, typename V, typename Lock>
+std::optional<V> LockedMap<K,V,Lock>::remove_entry(const K& key, uint32_t idle_before) {
+    Guard guard;
+    Entry<V, Lock>* entry_ptr = get_entry(key);
+    if (!entry_ptr) return std::nullopt;  // Key doesn't exist (or already removed)
+
+    // Write lock: waits for in-flight pair operations, blocks new ones
+    entry_ptr->lock_write();
+    if (entry_ptr->removed.load(std::memory_order_relaxed) ||
+        entry_ptr->last_active.load(std::memory_order_relaxed) >= idle_before) {
+        // Lost a race with another erase, or became active since the idle scan
+        entry_ptr->unlock_write();
+        return std::nullopt;
+    }
+    entry_ptr->removed.store(true, std::memory_order_release);  // Later lookups treat it as missing
+    V final_value;
+    if constexpr (packed) {
+        final_value = AtomicWordTraits<V>::unpack(entry_ptr->word.load(std::memory_order_acquire));
+    } else {
+        final_value = entry_ptr->value;
+    }
+    entry_ptr->unlock_write();
+
+    // Unlink this exact entry (a fresh one may already replace it) and retire it
     {
         std::lock_guard<std::mutex> lock(map_mutex);
-        auto it1 = data.find(key1);
-        auto it2 = data.find(key2);
-        
-        // Both keys must exist for atomic operation
-        if (it1 == data.end() || it2 == data.end())
-            return false;
-        
-        entry1 = it1->second;
-        entry2 = it2->second;
+        index.erase(key, entry_ptr);
     }
-    // map_mutex released here (fine-grained locking)
+    return final_value;
+}
+
+template<typename K, typename V, typename Lock>
+std::optional<V> LockedMap<K,V,Lock>::erase(const K& key) {
+    return remove_entry(key, UINT32_MAX);
+}
+
+#ifdef ZIP_LOCK_CONTENTION
+template<typename K, typename V, typename Lock>
+std::vector<typename LockedMap<K,V,Lock>::EntryContention> LockedMap<K,V,Lock>::most_contended(size_t count) const {
+    std::vector<EntryContention> contended;
+    {
+        Guard guard;
+        index.for_each([&](const K& key, Entry<V, Lock>& entry) {
+            EntryContention profile{key, entry.read_contention.snapshot(), entry.write_contention.snapshot()};
+            if (profile.read.contended > 0 || profile.write.contended > 0) {
+                contended.push_back(profile);
+            }
+        });
+    }
+
+    auto longer_wait = [](const EntryContention& a, const EntryContention& b) {
+        return a.total_wait_ns() > b.total_wait_ns();
+    };
+    count = std::min(count, contended.size());
+    std::partial_sort(contended.begin(), contended.begin() + count, contended.end(), longer_wait);
+    contended.resize(count);
+    return contended;
+}
+#endif
+
+template<typename K, typename V, typename Lock>
+size_t LockedMap<K,V,Lock>::erase_idle(uint32_t idle_before, const std::function<void(const K&, const V&)>& on_erase) {
+    // Step 1: Collect candidates with a lock-free scan (no map_mutex held)
+    std::vector<K> candidates;
+    {
+        Guard guard;
+        index.for_each([&](const K& key, Entry<V, Lock>& entry) {
+            if (!entry.removed.load(std::memory_order_relaxed) &&
+                entry.last_active.load(std::memory_order_relaxed) < idle_before) {
+                candidates.push_back(key);
+            }
+        });
+    }
+
+    // Step 2: Remove each one (rechecks activity under the entry's write lock)
+    size_t removed_count = 0;
+    for (const K& key : candidates) {
+        std::optional<V> final_value = remove_entry(key, idle_before);
+        if (final_value) {
+            on_erase(key, *final_value);
+            removed_count++;
+        }
+    }
+    return removed_count;
+}
+
+template<typename K, typename V, typename Lock>
+SequenceClaim LockedMap<K,V,Lock>::claim_sequence(const K& key, uint32_t sequence, uint32_t& last_claimed) {
+    PERF_SCOPE(PerfRegion::LOCKED_MAP);
+    Guard guard;
+    Entry<V, Lock>* entry_ptr = get_entry(key);
+    if (!entry_ptr) return SequenceClaim::NOT_FOUND;  // Key doesn't exist
+
+    stamp_activity(*entry_ptr);
+
+    uint64_t gate = entry_ptr->sequence.load(std::memory_order_acquire);
+    while (true) {
+        uint32_t highest = static_cast<uint32_t>(gate);
+        uint64_t window = gate >> 32;
+        last_claimed = highest;
+
+        uint64_t next;
+        if (sequence > highest) {
+            // New highest: the window slides down by the distance, old highest enters it
+            uint64_t shift = sequence - highest;
+            window = shift > SEQUENCE_WINDOW ? 0 : (((window << shift) | (uint64_t(1) << (shift - 1))) & 0xFFFFFFFFu);
+            next = (window << 32) | sequence;
+        } else {
+            // At or below the highest: new only if inside the window and its bit is clear
+            uint32_t distance = highest - sequence;
+            if (distance == 0 || distance > SEQUENCE_WINDOW) return SequenceClaim::DUPLICATE;
+            uint64_t bit = uint64_t(1) << (distance - 1 + 32);
+            if (gate & bit) return SequenceClaim::DUPLICATE;
+            next = gate | bit;
+        }
+
+        // Lost a race with another claim on this entry: gate reloaded, decide again
+        if (entry_ptr->sequence.compare_exchange_weak(gate, next,
+                                                      std::memory_order_acq_rel, std::memory_order_acquire)) {
+            // Slot now belongs to this claim: whatever an older sequence left there has another generation
+            entry_ptr->outcomes[sequence % SEQUENCE_WINDOW].store(outcome_tag(sequence, SEQUENCE_OUTCOME_PENDING),
+                                                                 std::memory_order_release);
+            return SequenceClaim::CLAIMED;
+        }
+    }
+}
+
+template<typename K, typename V, typename Lock>
+void LockedMap<K,V,Lock>::record_outcome(const K& key, uint32_t sequence, uint8_t outcome) {
+    Guard guard;
+    Entry<V, Lock>* entry_ptr = get_entry(key);
+    if (!entry_ptr) return;
+    entry_ptr->outcomes[sequence % SEQUENCE_WINDOW].store(outcome_tag(sequence, outcome), std::memory_order_release);
+}
+
+template<typename K, typename V, typename Lock>
+std::optional<uint8_t> LockedMap<K,V,Lock>::sequence_outcome(const K& key, uint32_t sequence) {
+    Guard guard;
+    Entry<V, Lock>* entry_ptr = get_entry(key);
+    if (!entry_ptr) return std::nullopt;
+
+    uint32_t highest = static_cast<uint32_t>(entry_ptr->sequence.load(std::memory_order_acquire));
+    if (sequence > highest || highest - sequence >= SEQUENCE_WINDOW) return std::nullopt;
+    uint8_t tag = entry_ptr->outcomes[sequence % SEQUENCE_WINDOW].load(std::memory_order_acquire);
+    if ((tag >> 2) != (outcome_tag(sequence, 0) >> 2)) return std::nullopt;   // Slot holds another sequence
+    return static_cast<uint8_t>(tag & 0x3);
+}
+
+template<typename K, typename V, typename Lock>
+bool LockedMap<K,V,Lock>::atomic_pair_operation(const K& key1, const K& key2,
+                                            const std::function<void(V&, V&)>& fn) {
+    PERF_SCOPE(PerfRegion::LOCKED_MAP);
+
+    // Step 1: Look up both entries (lock-free index lookups, guard keeps them alive)
+    Guard guard;
+    Entry<V, Lock>* entry1 = get_entry(key1);
+    Entry<V, Lock>* entry2 = get_entry(key2);
+    
+    // Both keys must exist for atomic operation
+    if (!entry1 || !entry2)
+        return false;
 
     // Step 2: Handle self-operation (same key for both parameters)
     // Example: transfer from account to itself (no-op, but valid)
-    if (entry1.get() == entry2.get()) {
-        Entry<V>* single = entry1.get();
+    if (entry1 == entry2) {
+        Entry<V, Lock>* single = entry1;
         single->lock_write();
-        fn(single->value, single->value);  // Callback receives same reference twice
+        if (single->removed.load(std::memory_order_relaxed)) {
+            // Erased while we waited for the lock
+            single->unlock_write();
+            return false;
+        }
+        if constexpr (packed) {
+            uint64_t before = single->word.load(std::memory_order_acquire);
+            V value_copy = AtomicWordTraits<V>::unpack(before);
+            fn(value_copy, value_copy);  // Callback receives same reference twice
+            publish_changed_lanes(*single, before, AtomicWordTraits<V>::pack(value_copy));
+        } else {
+            fn(single->value, single->value);  // Callback receives same reference twice
+        }
         single->unlock_write();
         return true;
     }
@@ -357,23 +833,42 @@ bool LockedMap<K,V>::atomic_pair_operation(const K& key1, const K& key2,
     // Example: Thread 1 locks (A, B), Thread 2 locks (B, A)
     //          Without ordering: potential AB-BA deadlock
     //          With ordering: both threads lock lower address first
-    Entry<V>* first;
-    Entry<V>* second;
-    if (entry1.get() < entry2.get()) {
-        first = entry1.get();
-        second = entry2.get();
+    Entry<V, Lock>* first;
+    Entry<V, Lock>* second;
+    if (entry1 < entry2) {
+        first = entry1;
+        second = entry2;
     } else {
-        first = entry2.get();
-        second = entry1.get();
+        first = entry2;
+        second = entry1;
     }
 
     // Step 4: Lock both entries for writing (in ordered sequence)
     first->lock_write();   // Acquire first lock
     second->lock_write();  // Acquire second lock (no deadlock possible)
 
+    // Either entry erased while we waited: its value is final, abort without changes
+    if (first->removed.load(std::memory_order_relaxed) || second->removed.load(std::memory_order_relaxed)) {
+        second->unlock_write();
+        first->unlock_write();
+        return false;
+    }
+
     // Step 5: Execute callback with references to values
     // Callback can modify both values atomically (both locked)
-    fn(entry1->value, entry2->value);
+    if constexpr (packed) {
+        // Lanes touched by pair operations can't change while we hold both locks,
+        // so the snapshot is consistent for them; other lanes are merged on publish
+        uint64_t before1 = entry1->word.load(std::memory_order_acquire);
+        uint64_t before2 = entry2->word.load(std::memory_order_acquire);
+        V value1 = AtomicWordTraits<V>::unpack(before1);
+        V value2 = AtomicWordTraits<V>::unpack(before2);
+        fn(value1, value2);
+        publish_changed_lanes(*entry1, before1, AtomicWordTraits<V>::pack(value1));
+        publish_changed_lanes(*entry2, before2, AtomicWordTraits<V>::pack(value2));
+    } else {
+        fn(entry1->value, entry2->value);
+    }
 
     // Step 6: Unlock in reverse order (not strictly necessary, but good practice)
     second->unlock_write();
@@ -381,3 +876,74 @@ bool LockedMap<K,V>::atomic_pair_operation(const K& key1, const K& key2,
     
     return true;
 }
+
+template<typename K, typename V, typename Lock>
+bool LockedMap<K,V,Lock>::atomic_group_operation(const K* keys, size_t count,
+                                              const std::function<void(V* values)>& fn) {
+    PERF_SCOPE(PerfRegion::LOCKED_MAP);
+    if (count > GROUP_MAX_KEYS) return false;
+
+    // Step 1: Look up every entry (lock-free, guard keeps them alive)
+    Guard guard;
+    Entry<V, Lock>* entries[GROUP_MAX_KEYS];
+    for (size_t i = 0; i < count; i++) {
+        entries[i] = get_entry(keys[i]);
+        if (!entries[i]) return false;
+    }
+
+    // Step 2: Try every lock in the given order; if one is busy, release and lock in the
+    // pair operation order (ascending address) instead, waiting as needed
+    size_t held = 0;
+    while (held < count && entries[held]->try_lock_write()) {
+        held++;
+    }
+    if (held < count) {
+        for (size_t i = held; i-- > 0;) {
+            entries[i]->unlock_write();
+        }
+        Entry<V, Lock>* ordered[GROUP_MAX_KEYS];
+        std::copy(entries, entries + count, ordered);
+        std::sort(ordered, ordered + count);
+        for (size_t i = 0; i < count; i++) {
+            ordered[i]->lock_write();
+        }
+    }
+    auto unlock_all = [&] {
+        for (size_t i = count; i-- > 0;) {
+            entries[i]->unlock_write();
+        }
+    };
+
+    // Any entry erased while we waited: its value is final, abort without changes
+    for (size_t i = 0; i < count; i++) {
+        if (entries[i]->removed.load(std::memory_order_relaxed)) {
+            unlock_all();
+            return false;
+        }
+    }
+
+    // Step 3: Run the callback on copies, then write back (only changed lanes if packed)
+    V values[GROUP_MAX_KEYS];
+    if constexpr (packed) {
+        uint64_t before[GROUP_MAX_KEYS];
+        for (size_t i = 0; i < count; i++) {
+            before[i] = entries[i]->word.load(std::memory_order_acquire);
+            values[i] = AtomicWordTraits<V>::unpack(before[i]);
+        }
+        fn(values);
+        for (size_t i = 0; i < count; i++) {
+            publish_changed_lanes(*entries[i], before[i], AtomicWordTraits<V>::pack(values[i]));
+        }
+    } else {
+        for (size_t i = 0; i < count; i++) {
+            values[i] = entries[i]->value;
+        }
+        fn(values);
+        for (size_t i = 0; i < count; i++) {
+            entries[i]->value = values[i];
+        }
+    }
+
+    unlock_all();
+    return true;
+}
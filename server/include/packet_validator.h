@@ -0,0 +1,84 @@
+#pragma once
+#include "packet.h"
+#include "udp_socket.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/// Packets checked together by PacketValidator: one byte each, 16 fill one SSE2/NEON register
+constexpr size_t VALIDATE_LANES = 16;
+
+/**
+ * @brief ### Why PacketValidator dropped a datagram.
+ */
+enum class DropReason : uint8_t {
+    SIZE,           ///< Datagram size isn't sizeof(Packet) (counted by the ledger's receive_request())
+    TYPE,           ///< Not a client request type (server replies, unknown values)
+    BOUNDS,         ///< Field out of protocol range (see PacketValidator)
+    DUPLICATE,      ///< Same sender and same bytes as an earlier packet of the batch
+    COUNT
+};
+
+/**
+ * @brief ### Per-reason drop counters (snapshot of PacketValidator).
+ */
+struct DropCounts {
+    uint64_t counts[static_cast<size_t>(DropReason::COUNT)] = {};
+
+    uint64_t operator[](DropReason reason) const { return counts[static_cast<size_t>(reason)]; }
+
+    uint64_t total() const {
+        uint64_t sum = 0;
+        for (uint64_t count : counts) sum += count;
+        return sum;
+    }
+};
+
+/**
+ * @brief ### Drops malformed requests from a received batch before authentication and dispatch.
+ *
+ * A request is kept only if:
+ * - Its type is one a client sends (DISCOVERY, TRANSACTION_REQUEST, SUBSCRIBE, CREDIT_NOTIFY_ACK)
+ * - Its fields are in protocol range: DISCOVERY has request_id 0; TRANSACTION_REQUEST
+ *   and CREDIT_NOTIFY_ACK have request_id 1+; a transfer value is at most MAX_TRANSFER_VALUE
+ * - No earlier packet of the batch came from the same address with the same bytes
+ *   (a retransmission burst gets one reply, not one worker task per copy)
+ *
+ * Type and range checks run VALIDATE_LANES packets at a time in structure-of-arrays form:
+ * each check input is reduced to one byte per packet, so a check is one compare instruction
+ * on a GCC/Clang vector type for all lanes, with no branch per packet (scalar fallback on
+ * other compilers). Duplicates are found with a small hash table per batch.
+ *
+ * Counters are relaxed atomics: written by the I/O thread, read by anyone (snapshot()).
+ */
+class PacketValidator {
+public:
+    /**
+     * @brief ### Drops malformed requests from a received batch, keeping the order of the others.
+     *
+     * Compacts packets/client_addrs in place and counts every drop by reason.
+     * @param count Requests in the batch (any count).
+     * @return Number of requests kept (now at the front of both arrays).
+     */
+    size_t filter(Packet* packets, SocketAddress* client_addrs, size_t count);
+
+    /// Counts a drop decided elsewhere (e.g. DropReason::SIZE by the receive loop)
+    void count_drop(DropReason reason) {
+        dropped[static_cast<size_t>(reason)].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// Drops counted so far, per reason
+    DropCounts snapshot() const;
+
+    /// Printable name of a reason ("size", "type", "bounds", "duplicate")
+    static const char* reason_name(DropReason reason);
+
+private:
+    /**
+     * @brief ### Type and range checks of up to VALIDATE_LANES packets at once.
+     * @param verdicts [OUT] Per packet: DropReason::COUNT if well-formed, else why it isn't.
+     */
+    static void check_lanes(const Packet* packets, size_t count, DropReason* verdicts);
+
+    std::atomic<uint64_t> dropped[static_cast<size_t>(DropReason::COUNT)] = {};
+};
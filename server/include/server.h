@@ -1,139 +1,481 @@
 #pragma once
 #include "udp_socket.h"
+#include "bloom_filter.h"
 #include "locked_map.h"
 #include "packet.h"
-#include <mutex>
+#include "credit_notifier.h"
+#include "server_policies.h"
+#include "server_runtime.h"
+#include "packet_validator.h"
+#include "session_auth.h"
+#include <atomic>
+#include <chrono>
+#include <optional>
 
 /// Initial balance assigned to newly discovered clients (prevents negative balances on first transaction)
 constexpr uint32_t CLIENT_INITIAL_BALANCE = 100;
 
+/// Interval between idle-account sweeps when account expiry is enabled (seconds)
+constexpr uint32_t ACCOUNT_SWEEP_INTERVAL_S = 1;
+
+#ifdef ZIP_LOCK_CONTENTION
+/// Accounts listed by each lock contention report
+constexpr size_t CONTENTION_REPORT_TOP_N = 10;
+#endif
+
+/// Accounts below which prefetch() does nothing: the entries stay in the core's caches and a
+/// group lookup would only add work (crossover measured at 5k-10k accounts with a 2 MiB L2)
+constexpr size_t PREFETCH_MIN_ACCOUNTS = 8192;
+
+/// Minimum time between two reports of dropped malformed requests (a junk flood prints one line per interval)
+constexpr uint32_t DROP_REPORT_INTERVAL_S = 10;
+
+/// Most transfers executed under one set of account locks (sender + destination each: 2 keys per transfer)
+constexpr size_t TRANSACTION_GROUP_MAX = 32;
+
 /**
  * @brief ### Per-client state maintained by the server.
  * 
- * Tracks request ID for idempotency (duplicate detection) and current balance.
- * Stored in LockedMap with per-entry reader-writer locks for concurrent access.
+ * Tracks the client's current balance, stored in LockedMap as a packed atomic word.
+ * The last processed request ID (idempotency) lives in the entry's own sequence gate
+ * (LockedMap::claim_sequence), so duplicate checks never touch the balance.
  */
 struct ClientInfo {
-    uint32_t last_processed_request_id = 0;		///< Last processed request ID (for duplicate detection)
-                                                ///< 0 = no requests processed yet
     uint32_t balance = CLIENT_INITIAL_BALANCE;  ///< Current balance (decremented on send, incremented on receive)
+    bool notify_credits = false;                ///< Subscribed to CREDIT_NOTIFY pushes (SUBSCRIBE)
+};
+
+/**
+ * @brief ### Packs ClientInfo into one 64-bit word so LockedMap serves it lock-free.
+ * 
+ * Layout: low lane = balance, high lane bit 0 = notify_credits.
+ * The balance is only modified by LockedMap::atomic_pair_operation() (ordered locks),
+ * notify_credits only by LockedMap::update() (CAS), so the two never write the same lane.
+ * Reads are a single atomic load.
+ */
+template<>
+struct AtomicWordTraits<ClientInfo> {
+    static constexpr bool enabled = true;
+
+    static uint64_t pack(const ClientInfo& info) {
+        return static_cast<uint64_t>(info.notify_credits) << 32 | info.balance;
+    }
+
+    static ClientInfo unpack(uint64_t word) {
+        ClientInfo info;
+        info.balance = static_cast<uint32_t>(word);
+        info.notify_credits = (word >> 32) & 1;
+        return info;
+    }
 };
 
 /**
- * @brief ### Multi-threaded UDP server implementing the ZIP transaction protocol.
+ * @brief ### One ledger of the ZIP transaction protocol (UDP port + accounts + statistics).
+ * 
+ * Policy-based: every configurable mechanism is a template parameter of the policy set,
+ * resolved at compile time (no runtime branching on configuration in the request path):
+ * - Policies::Lock: entry lock of the clients map (CondvarRWLock, SpinRWLock)
+ * - Policies::Stats: ledger statistics (MutexStats, AtomicStats)
+ * - Policies::Log: per-request console output (ConsoleLog, NullLog)
+ * - Policies::Dispatch: protocol features (FullDispatch, TransferDispatch)
+ * Server is the default set (the historical behaviour); LeanServer and MinimalServer are
+ * stripped variants (see server_policies.h). All three are instantiated in server.cpp.
  * 
  * Architecture:
- * - Main thread: listens for incoming packets and spawns worker threads
- * - Worker threads: process requests concurrently (one thread per request)
+ * - All state is per instance: several Servers (ledgers) can live in one process
+ * - I/O and workers come from a ServerRuntime shared by every hosted ledger: its I/O thread
+ *   reads this ledger's socket (receive_request()) and its workers call process_group()
  * - Shared state: LockedMap (clients) with fine-grained locking per client
  * 
  * Concurrency guarantees:
  * - Multiple transactions can execute in parallel if they involve different clients
  * - Transactions involving the same client(s) are serialized via LockedMap locks
- * - Bank statistics (s_num_transactions, s_total_transferred, s_total_balance) protected by s_stats_mutex
+ * - Bank statistics (num_transactions, total_transferred, total_balance) kept by the Stats policy
  * 
  * Protocol phases:
- * 1. Discovery: Client broadcasts DISCOVERY, server responds with DISCOVERY_ACK
+ * 1. Discovery: Client broadcasts DISCOVERY, server responds with DISCOVERY_ACK. An unknown
+ *    address first gets a DISCOVERY_COOKIE and is registered when it echoes the cookie, so
+ *    a spoofed-source flood allocates no accounts
  * 2. Transactions: Client sends TRANSACTION_REQUEST, server validates and responds with appropriate ACK
+ * 
+ * Push channel (optional): a client sends SUBSCRIBE once, then receives batched CREDIT_NOTIFY
+ * datagrams whenever it is credited (CreditNotifier thread), instead of polling for funds.
+ * 
+ * Authentication: DISCOVERY_ACK carries the client's session key; every later request must
+ * carry its MAC (packet_auth.h) or it is dropped by authenticate() before dispatch.
+ * 
+ * @tparam Policies Policy set (DefaultServerPolicies, LeanServerPolicies, MinimalServerPolicies).
  */
-class Server {
+template<typename Policies>
+class BasicServer final : public Ledger {
 public:
     /**
      * @brief ### Constructs the Server instance and binds to the specified port.
      * @param port UDP port to listen on (same port for discovery and transactions).
+     * @param expected_clients Known account count used to presize the clients index and the
+     *        registered IP filter (0 = grow on demand, default filter size).
      */
-    Server(uint16_t port);
+    BasicServer(uint16_t port, size_t expected_clients = 0);
 
     /**
-     * @brief ### Starts the server's main execution loop (blocks indefinitely).
+     * @brief ### Runs this ledger alone on its own ServerRuntime (blocks indefinitely).
      * 
-     * Initializes socket and enters listening loop.
-     * Never returns unless socket initialization fails.
+     * Equivalent to hosting it as the only ledger of a runtime with one worker per hardware thread.
      */
     void run();
 
-private:
-    // ===== Main Execution =====
-    
     /**
-     * @brief ### [Main thread] Infinite loop that receives packets and spawns worker threads.
+     * @brief ### Prints the initial state and starts background threads (notifier, expiry sweeper).
+     * 
+     * Called once by ServerRuntime::run() before requests are dispatched.
+     */
+    void start() override;
+
+    /**
+     * @brief ### Reads one request from the socket without blocking.
      * 
-     * For each incoming packet:
-     * 1. Blocks on socket.receive() waiting for next packet
-     * 2. Spawns detached thread running process_request()
-     * 3. Immediately returns to listening (doesn't wait for thread to finish)
+     * Datagrams of the wrong size are discarded (no response sent, counted as DropReason::SIZE).
      * 
-     * Worker threads handle request processing asynchronously.
+     * @param packet [OUT] Received request.
+     * @param client_addr [OUT] Sender's address.
+     * @return True if a valid-sized request was read, false if the socket has no more data.
      */
-    void run_listening_loop();
-    
+    bool receive_request(Packet& packet, SocketAddress& client_addr) override;
+
     /**
      * @brief ### [Worker thread] Dispatches request to appropriate handler based on packet type.
      * 
-     * Thread lifecycle:
-     * 1. Spawned by run_listening_loop() for each incoming packet
-     * 2. Detached immediately (no join() required)
-     * 3. Processes request and terminates automatically
+     * Called by process_group() for every request not run in a transfer group; safe to run
+     * concurrently for any mix of clients.
      * 
      * @param packet The request packet received from client.
      * @param client_addr Client's address (used for sending ACK response).
      */
     void process_request(const Packet& packet, const SocketAddress& client_addr);
 
-    // ===== Request Handlers =====
-    
     /**
-     * @brief ### Handles DISCOVERY packet: registers client and sends DISCOVERY_ACK.
+     * @brief ### [Worker thread] Handles a group of requests taken from the runtime queue (in order).
+     * 
+     * Prefetches the group's accounts (prefetch(), groups of 2+), then:
+     * - Each run of 2+ consecutive TRANSACTION_REQUESTs goes through
+     *   execute_transaction_group(): every account of the run is locked once
+     * - Every other request goes through process_request(), between the runs, so
+     *   the results are those of handling the requests one by one in arrival order
+     * 
+     * Flight records of a grouped transfer share the group's dispatch and lock times.
+     */
+    void process_group(FlightRecorder& recorder, const Packet* packets, const SocketAddress* client_addrs,
+                       const uint64_t* receive_ns, size_t count) override;
+
+    /**
+     * @brief ### [I/O thread] Drops malformed requests (PacketValidator): wrong type, fields out of range, copies.
+     * 
+     * Every drop is counted by reason (dropped_requests()); a summary line is printed when
+     * new drops occurred, at most every DROP_REPORT_INTERVAL_S.
+     * @return Requests kept (front of both arrays).
+     */
+    size_t validate(Packet* packets, SocketAddress* client_addrs, size_t count) override;
+
+    /// Malformed requests dropped so far, per reason (validate() and receive_request())
+    DropCounts dropped_requests() const { return validator.snapshot(); }
+
+    /**
+     * @brief ### [I/O thread] Drops requests whose MAC doesn't match their sender's session key.
+     * 
+     * Verifies the batch AUTH_LANES requests at a time (SessionAuthenticator), logs each
+     * dropped one and compacts the rest in place.
+     * @return Requests kept (front of both arrays).
+     */
+    size_t authenticate(Packet* packets, SocketAddress* client_addrs, size_t count) override;
+
+    /**
+     * @brief ### Prefetches the accounts of a group of requests (LockedMap::prefetch).
+     *
+     * Every sender, plus the destination of every transfer that passes registered_ips
+     * (unknown destinations are rejected without a lookup anyway). No-op below
+     * PREFETCH_MIN_ACCOUNTS accounts.
+     */
+    void prefetch(const Packet* packets, const SocketAddress* client_addrs, size_t count);
+
+    /// Load stamped into every reply from now on (ReplyPayload::load, set by ServerRuntime)
+    void set_load_hint(uint8_t load) override { load_hint.store(load, std::memory_order_relaxed); }
+
+    /// Socket of this ledger (polled by ServerRuntime)
+    const UDPSocket& socket() const override { return server_socket; }
+
+    /// UDP port of this ledger
+    uint16_t listen_port() const override { return port; }
+
+    // ===== Transaction Engine (no socket I/O, used by handlers and benchmarks) =====
+
+    /**
+     * @brief ### Registers a client (if new and proven) and builds its reply.
      * 
      * Behavior:
-     * - If client doesn't exist: inserts into clients map with initial balance
-     * - If client exists: does nothing (idempotent)
-     * - Always sends DISCOVERY_ACK response (even if client already registered)
+     * - If client doesn't exist and cookie isn't valid for its address: returns a
+     *   DISCOVERY_COOKIE, touching no state (no entry, no index lock)
+     * - If client doesn't exist and echoes a valid cookie: inserts into clients map with initial balance
+     * - If client exists: does nothing (idempotent), except refreshing the notification
+     *   address of a subscribed client (its last known address)
      * 
-     * @param client_addr Client's IP address (used as key in clients map).
+     * @param client_addr Client's address (IP is the key in clients map).
+     * @param cookie Packet::auth of the DISCOVERY (cookie echoed from a DISCOVERY_COOKIE, or 0).
+     * @return DISCOVERY_ACK with the client's balance, last processed request_id and session key,
+     *         or DISCOVERY_COOKIE with the cookie to echo.
      */
-    void handle_discovery(const SocketAddress& client_addr);
+    Packet execute_discovery(const SocketAddress& client_addr, uint64_t cookie);
 
     /**
-     * @brief ### Handles TRANSACTION_REQUEST: validates, executes, and sends appropriate ACK.
+     * @brief ### Validates and executes a TRANSACTION_REQUEST, returning the ACK to send.
      * 
      * Validation steps:
-     * 1. Check if destination client exists -> INVALID_CLIENT_ACK if not
-     * 2. Check for duplicate request (request_id <= last_processed_request_id) -> send cached response
-     * 3. Check sender has sufficient balance -> INSUFFICIENT_BALANCE_ACK if not
+     * 1. Check for duplicate request and claim request_id on the sequence gate -> original reply type
+     *    with the current balance if duplicate (see duplicate_transaction_reply())
+     * 2. Check if destination client exists (registered_ips filter, then the index) -> INVALID_CLIENT_ACK if not
+     * 3. Check sender has sufficient balance (inside the pair lock) -> INSUFFICIENT_BALANCE_ACK if not
      * 4. Execute transaction atomically (debit sender, credit receiver)
-     * 5. Update bank statistics under s_stats_mutex
-     * 6. Send TRANSACTION_ACK with new sender balance
+     * 5. Update bank statistics (Stats policy)
+     * 6. Queue a CREDIT_NOTIFY if the receiver is subscribed (flag read inside the pair lock;
+     *    compiled out without Dispatch::credit_notifications)
+     * 7. Return TRANSACTION_ACK with new sender balance
+     * 
+     * The reply type is remembered on the sequence gate for retransmissions of the request.
      * 
      * Concurrency:
+     * - Duplicate check and request_id claim are one atomic operation on the sequence gate
+     * - Zero-value and self-transfers only add an atomic load of the packed balance (no entry mutex)
      * - Uses LockedMap::atomic_pair_operation() to lock both sender and receiver
      * - Prevents deadlocks via fixed locking order (lower IP locked first)
      * - Self-transactions (sender == receiver) acquire single lock
      * 
+     * @param src_client_ip Sender's IP (network byte order, source of funds).
+     * @param packet Transaction packet containing destination IP and value.
+     * @return Reply to send, or nullopt if an account was closed mid-transaction or the
+     *         request is a duplicate of one still running (no reply).
+     */
+    std::optional<Packet> execute_transaction(uint32_t src_client_ip, const Packet& packet);
+
+    /**
+     * @brief ### Executes several TRANSACTION_REQUESTs as one group: each account locked once.
+     * 
+     * Same replies, balances and statistics as calling execute_transaction() for each
+     * request in order, with one LockedMap::atomic_group_operation() instead of one pair
+     * operation per transfer:
+     * 1. Lock-free, in order: claim each request_id and classify the request (duplicate,
+     *    no-op, invalid destination or transfer), as execute_transaction() steps 1-2 do
+     * 2. Lock the distinct accounts of the group's transfers, each once (an account shared
+     *    by several transfers, e.g. a merchant paid by many clients, has one lock): tried in
+     *    the order they were collected (try_lock_write(), no sort), and only if one is busy
+     *    taken in address order like a pair operation. Then apply every transfer in request
+     *    order in a tight loop (balance check, debit, credit)
+     * 3. Statistics, notifications, log and replies, in request order
+     * 
+     * Duplicates, no-ops and invalid destinations take no lock (a group of retransmissions
+     * takes no balance lock) and reply with the sender's balance as of their turn: read in
+     * step 2, in order, if a transfer of the group locks the sender, else lock-free in step 3
+     * (no transfer of the group changes it).
+     * 
+     * If an account is closed before its lock is taken, nothing is applied and the claimed
+     * requests run one by one (as execute_transaction() after its claim).
+     * 
+     * @param src_client_ips Sender of each request (network byte order).
+     * @param packets TRANSACTION_REQUESTs, in arrival order.
+     * @param count Requests (any count: processed TRANSACTION_GROUP_MAX at a time).
+     * @param replies [OUT] replies[i] = execute_transaction() result for packets[i].
+     * @param locked [OUT] Optional: locked[i] = request i was resolved under the group's locks.
+     */
+    void execute_transaction_group(const uint32_t* src_client_ips, const Packet* packets, size_t count,
+                                   std::optional<Packet>* replies, bool* locked = nullptr);
+
+    /**
+     * @brief ### Enables/disables per-request console output of the engine (on by default).
+     * 
+     * Benchmarks turn it off so they measure locking, dedupe and stats, not std::cout.
+     * No-op with NullLog (nothing to turn off).
+     */
+    void set_request_logging(bool enabled) { log.set_enabled(enabled); }
+
+    /**
+     * @brief ### Enables expiry of idle accounts (closed by a background sweeper started in start()).
+     * 
+     * An account is idle when it sent no DISCOVERY or TRANSACTION_REQUEST for idle_timeout_s.
+     * Closed balances go to the balance sink, so total_balance stays equal to the sum of
+     * live balances. The sink account itself never expires.
+     * 
+     * @param idle_timeout_s Seconds of inactivity before an account is closed (0 = never expire).
+     * @param balance_sink_ip Account credited with closed balances (network byte order).
+     *                        0 (or unregistered sink) = funds leave the bank (subtracted from total_balance).
+     */
+    void enable_account_expiry(uint32_t idle_timeout_s, uint32_t balance_sink_ip = 0);
+
+    /**
+     * @brief ### Closes an account and moves its balance to the balance sink.
+     * 
+     * In-flight transactions on the account finish first; later ones get ERROR_ACK
+     * (sender closed) or INVALID_CLIENT_ACK (destination closed). The entry's memory is
+     * reclaimed once no worker thread still references it.
+     * 
+     * @param client_ip Account to close (network byte order).
+     * @return True if the account existed and was closed.
+     */
+    bool close_account(uint32_t client_ip);
+
+#ifdef ZIP_LOCK_CONTENTION
+    /**
+     * @brief ### Enables a periodic report of the most contended accounts (thread started in start()).
+     * 
+     * Lists the CONTENTION_REPORT_TOP_N accounts with the longest cumulative lock wait
+     * (contended acquisitions, total and max wait; see LockContention). Only pair
+     * operations and write() take entry locks, so these are the accounts serializing transfers.
+     * 
+     * @param interval_s Seconds between reports (0 = no report).
+     */
+    void enable_contention_report(uint32_t interval_s) { contention_report_s = interval_s; }
+#endif
+
+private:
+    // ===== Request Handlers =====
+    
+    /**
+     * @brief ### Handles DISCOVERY packet: runs execute_discovery() and sends its reply.
+     * @param packet DISCOVERY packet (auth carries the echoed cookie, if any).
+     * @param client_addr Client's address (IP is the key in clients map).
+     */
+    void handle_discovery(const Packet& packet, const SocketAddress& client_addr);
+
+    /**
+     * @brief ### Handles TRANSACTION_REQUEST: runs execute_transaction() and sends its ACK.
      * @param packet Transaction packet containing destination IP and value.
-     * @param client_addr Sender's address (source of funds).
+     * @param client_addr Sender's address (source of funds, reply destination).
      */
     void handle_transaction(const Packet& packet, const SocketAddress& client_addr);
 
+    /**
+     * @brief ### Handles consecutive TRANSACTION_REQUESTs: runs execute_transaction_group(), sends the ACKs in one batch.
+     * @param count Requests (at most TRANSACTION_GROUP_MAX).
+     */
+    void handle_transaction_group(FlightRecorder& recorder, const Packet* packets, const SocketAddress* client_addrs,
+                                  const uint64_t* receive_ns, size_t count);
+
+    /**
+     * @brief ### Reply to a retransmitted TRANSACTION_REQUEST (request_id already claimed).
+     *
+     * Same type as the original reply (remembered on the sender's sequence gate), so a
+     * rejected transfer stays rejected; OUTCOME_UNKNOWN_ACK once the gate no longer knows it.
+     * @param balance Sender's balance to report (as of this request's turn).
+     * @return The reply, or nullopt while the original is still running (its own reply follows).
+     */
+    std::optional<Packet> duplicate_transaction_reply(uint32_t src_client_ip, const Packet& packet, uint32_t balance);
+
+    /// Records the type of a claimed request's reply on the sender's sequence gate (for its duplicates)
+    void remember_outcome(uint32_t src_client_ip, const Packet& packet, const std::optional<Packet>& reply_packet);
+
+    /**
+     * @brief ### Rest of execute_transaction() once request_id is claimed (from the zero-value check on).
+     * @return Reply to send, or nullopt if an account was closed mid-transaction.
+     */
+    std::optional<Packet> execute_claimed_transaction(uint32_t src_client_ip, const Packet& packet);
+
+    /**
+     * @brief ### Handles SUBSCRIBE: enables credit notifications and sends SUBSCRIBE_ACK.
+     * 
+     * Only dispatched with Dispatch::credit_notifications (otherwise SUBSCRIBE gets ERROR_ACK).
+     * 
+     * Registers the sender's address with the notifier first, then sets notify_credits on
+     * the account (CAS on the high lane), so a transfer that sees the flag always finds
+     * the subscription. Repeated SUBSCRIBEs only refresh the address.
+     * Unregistered clients get ERROR_ACK (they must send DISCOVERY first).
+     * 
+     * @param client_addr Subscriber's address (notifications are pushed there).
+     */
+    void handle_subscribe(const SocketAddress& client_addr);
+
+    /**
+     * @brief ### Sends a reply to a request (with the current load hint) and stamps it in the flight recorder.
+     * @param reply_packet Reply.
+     * @param client_addr Requester's address.
+     */
+    void send_reply(const Packet& reply_packet, const SocketAddress& client_addr);
+
+    /**
+     * @brief ### Clears an account's notify_credits flag (CreditNotifier LostHandler, runs under the notifier lock).
+     * @param client_ip Account (network byte order).
+     */
+    void clear_subscription(uint32_t client_ip);
+
+    // ===== Account Expiry =====
+
+    /**
+     * @brief ### [Sweeper thread] Advances the activity clock and closes idle accounts.
+     * 
+     * Every ACCOUNT_SWEEP_INTERVAL_S: stamps the clients map with the current time, closes
+     * accounts idle for idle_timeout_s and lets EpochReclaimer free retired entries.
+     */
+    void run_expiry_loop();
+
+    /**
+     * @brief ### Moves a closed account's final balance to the sink and updates statistics.
+     * 
+     * @param client_ip Closed account (network byte order).
+     * @param final_info Account state captured at removal.
+     */
+    void settle_closed_account(uint32_t client_ip, const ClientInfo& final_info);
+
+    /// Prints the ledger statistics (PrintUtils::print_server_state)
+    void print_state() const;
+
+#ifdef ZIP_LOCK_CONTENTION
+    /**
+     * @brief ### [Report thread] Prints the most contended accounts every contention_report_s.
+     */
+    void run_contention_report_loop();
+#endif
+
     // ===== Server State =====
     
     uint16_t port;				///< UDP port for listening (shared for discovery and transactions)
     UDPSocket server_socket;	///< Blocking UDP socket (receive() blocks until packet arrives)
 
-    // ===== Shared State (accessed by multiple worker threads) =====
+    CreditNotifier notifier;    ///< Pushes CREDIT_NOTIFY to subscribed receivers (own sender thread)
+    SessionAuthenticator authenticator;     ///< Session keys and request MAC checks
+    PacketValidator validator;              ///< Malformed request checks and drop counters
+
+    std::atomic<uint8_t> load_hint{0};  ///< Stamped into replies (set_load_hint())
+    uint64_t reported_drops = 0;    ///< [I/O thread] Drop total at the last report
+    std::chrono::steady_clock::time_point last_drop_report;     ///< [I/O thread] Time of the last report
+
+    typename Policies::Log log;     ///< Per-request output (set_request_logging())
+
+    uint32_t idle_timeout_s = 0;    ///< Seconds of inactivity before an account is closed (0 = expiry disabled)
+    uint32_t balance_sink_ip = 0;   ///< Account receiving closed balances (0 = funds leave the bank)
+#ifdef ZIP_LOCK_CONTENTION
+    uint32_t contention_report_s = 0;   ///< Seconds between lock contention reports (0 = disabled)
+#endif
+
+    // ===== Ledger State (accessed by multiple worker threads) =====
     
-    /// Map of all registered clients, keyed by IP address (network byte order)
+    /// Map of this ledger's registered clients, keyed by IP address (network byte order)
     /// Uses fine-grained per-entry locks for concurrent transaction processing
-    static LockedMap<uint32_t, ClientInfo> clients;
-    
-    /// Global bank statistics (protected by s_stats_mutex)
-    static uint32_t s_num_transactions;		///< Total transactions processed successfully (excludes duplicates and failures)
-    static uint64_t s_total_transferred;  	///< Sum of all transaction values (cumulative, never decreases)
-    static uint64_t s_total_balance;      	///< Sum of all client balances (should remain constant = num_clients * INITIAL_BALANCE)
+    LockedMap<uint32_t, ClientInfo, typename Policies::Lock> clients;
 
-    // ===== Synchronization =====
+    /// Every IP ever registered in clients (added before the insert): unknown transfer
+    /// destinations are rejected without an index lookup
+    ConcurrentBloomFilter registered_ips;
     
-    /// Protects global statistics (s_num_transactions, s_total_transferred, s_total_balance)
-    /// Not needed for clients map (LockedMap has internal locking)
-    static std::mutex s_stats_mutex;
+    /// Ledger statistics: num_transactions, total_transferred, total_balance (thread-safe policy)
+    typename Policies::Stats stats;
 };
+
+/// Default ledger (condition-variable locks, mutex stats, console log, full protocol)
+using Server = BasicServer<DefaultServerPolicies>;
+
+/// Stripped production ledger (spin locks, atomic stats, no per-request log)
+using LeanServer = BasicServer<LeanServerPolicies>;
+
+/// Lean ledger without the credit notification channel
+using MinimalServer = BasicServer<MinimalServerPolicies>;
+
+// Instantiated once in server.cpp
+extern template class BasicServer<DefaultServerPolicies>;
+extern template class BasicServer<LeanServerPolicies>;
+extern template class BasicServer<MinimalServerPolicies>;
@@ -0,0 +1,187 @@
+#pragma once
+#include "entry_lock.h"
+#include "packet.h"
+#include "print_utils.h"
+#include "udp_socket.h"
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <mutex>
+
+/**
+ * @brief ### Ledger statistics as printed by PrintUtils.
+ */
+struct LedgerStats {
+    uint32_t num_transactions = 0;      ///< Total transactions processed successfully (excludes duplicates and failures)
+    uint64_t total_transferred = 0;     ///< Sum of all transaction values (cumulative, never decreases)
+    uint64_t total_balance = 0;         ///< Sum of all client balances (changes only on registration and closure)
+};
+
+// ===== Stats policies =====
+// Contract: add_balance(), remove_balance(), record_transfer(), snapshot()
+
+/**
+ * @brief ### Statistics under one mutex (default): every snapshot is consistent.
+ */
+class MutexStats {
+public:
+    void add_balance(uint64_t amount) {
+        std::lock_guard<std::mutex> lock(mutex);
+        totals.total_balance += amount;
+    }
+
+    void remove_balance(uint64_t amount) {
+        std::lock_guard<std::mutex> lock(mutex);
+        totals.total_balance -= amount;
+    }
+
+    /// One successful transfer (total_balance doesn't change: money only moved)
+    void record_transfer(uint64_t value) {
+        std::lock_guard<std::mutex> lock(mutex);
+        totals.num_transactions++;
+        totals.total_transferred += value;
+    }
+
+    LedgerStats snapshot() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return totals;
+    }
+
+private:
+    mutable std::mutex mutex;   ///< Shared by every worker of the ledger
+    LedgerStats totals;
+};
+
+/**
+ * @brief ### Statistics as relaxed atomic counters: a transfer costs two fetch_adds, no mutex.
+ *
+ * Each counter is exact, but a snapshot taken during transfers may mix counters from
+ * slightly different instants (fine for monitoring output).
+ */
+class AtomicStats {
+public:
+    void add_balance(uint64_t amount) { total_balance.fetch_add(amount, std::memory_order_relaxed); }
+    void remove_balance(uint64_t amount) { total_balance.fetch_sub(amount, std::memory_order_relaxed); }
+
+    void record_transfer(uint64_t value) {
+        num_transactions.fetch_add(1, std::memory_order_relaxed);
+        total_transferred.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    LedgerStats snapshot() const {
+        LedgerStats stats;
+        stats.num_transactions = num_transactions.load(std::memory_order_relaxed);
+        stats.total_transferred = total_transferred.load(std::memory_order_relaxed);
+        stats.total_balance = total_balance.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    // Own cache line: every transfer writes here, keep it away from neighbouring members
+    alignas(64) std::atomic<uint32_t> num_transactions{0};
+    std::atomic<uint64_t> total_transferred{0};
+    std::atomic<uint64_t> total_balance{0};
+};
+
+// ===== Log policies =====
+// Contract: set_enabled(), received(), rejected(), request()
+
+/**
+ * @brief ### Synchronous console output of every request (default).
+ */
+class ConsoleLog {
+public:
+    /// Turns the per-transaction lines on/off (the "Received" lines always print)
+    void set_enabled(bool enabled) { this->enabled = enabled; }
+
+    /// "Received <type> from <ip>" before a request is handled
+    void received(const char* type_name, const SocketAddress& client_addr) {
+        std::cout << "\nReceived " << type_name << " from " << client_addr.ip_string() << std::endl;
+    }
+
+    /// Request dropped by authentication (bad or missing MAC), printed by the I/O thread
+    void rejected(const Packet& packet, const SocketAddress& client_addr) {
+        std::cout << "\nDropped unauthenticated packet (type " << static_cast<int>(packet.type)
+                  << ") from " << client_addr.ip_string() << std::endl;
+    }
+
+    /// Transaction summary (PrintUtils::print_request) with the ledger's current statistics
+    template<typename Stats>
+    void request(uint32_t client_ip, const Packet& packet, bool is_duplicate, const Stats& stats) {
+        if (!enabled) return;
+        LedgerStats totals = stats.snapshot();
+        PrintUtils::print_request(client_ip, packet, is_duplicate, totals.num_transactions,
+                                  totals.total_transferred, totals.total_balance);
+    }
+
+private:
+    bool enabled = true;
+};
+
+/**
+ * @brief ### No per-request output: every call is an empty inline function.
+ *
+ * Startup state and account closures are still printed (they are not per request).
+ */
+class NullLog {
+public:
+    void set_enabled(bool) {}
+    void received(const char*, const SocketAddress&) {}
+    void rejected(const Packet&, const SocketAddress&) {}
+
+    template<typename Stats>
+    void request(uint32_t, const Packet&, bool, const Stats&) {}
+};
+
+// ===== Dispatch policies =====
+// Contract: static constexpr bool credit_notifications
+
+/**
+ * @brief ### Full protocol (default): discovery, transactions and the CREDIT_NOTIFY push channel.
+ */
+struct FullDispatch {
+    static constexpr bool credit_notifications = true;
+};
+
+/**
+ * @brief ### Discovery and transactions only: SUBSCRIBE gets ERROR_ACK, the notifier never runs.
+ *
+ * Transfers skip the receiver's subscription check and the notification queue.
+ */
+struct TransferDispatch {
+    static constexpr bool credit_notifications = false;
+};
+
+// ===== Policy sets (BasicServer<Policies>) =====
+
+/**
+ * @brief ### Default server: condition-variable entry locks, mutex stats, console log, full protocol.
+ */
+struct DefaultServerPolicies {
+    using Lock = CondvarRWLock;
+    using Stats = MutexStats;
+    using Log = ConsoleLog;
+    using Dispatch = FullDispatch;
+};
+
+/**
+ * @brief ### Stripped production server: spin entry locks, atomic stats, no per-request log.
+ *
+ * Same protocol as the default. Suits one worker per core (spinning waiters).
+ */
+struct LeanServerPolicies {
+    using Lock = SpinRWLock;
+    using Stats = AtomicStats;
+    using Log = NullLog;
+    using Dispatch = FullDispatch;
+};
+
+/**
+ * @brief ### Lean server without the push channel (transfers only).
+ */
+struct MinimalServerPolicies {
+    using Lock = SpinRWLock;
+    using Stats = AtomicStats;
+    using Log = NullLog;
+    using Dispatch = TransferDispatch;
+};
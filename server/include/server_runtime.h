@@ -0,0 +1,194 @@
+#pragma once
+#include "udp_socket.h"
+#include "packet.h"
+#include "packet_trace.h"
+#include "flight_recorder.h"
+#include "batch_controller.h"
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstddef>
+
+/**
+ * @brief ### What ServerRuntime needs from a hosted ledger (any BasicServer instantiation).
+ *
+ * A few virtual calls per drained batch (validate(), authenticate()) and one per worker group (process_group())
+ * at the runtime boundary; everything behind them is resolved at compile time by the
+ * ledger's policies.
+ */
+class Ledger {
+public:
+    virtual ~Ledger() = default;
+
+    /// Prints the initial state and starts background threads (called once by run())
+    virtual void start() = 0;
+
+    /// Reads one request without blocking (false once the socket is drained)
+    virtual bool receive_request(Packet& packet, SocketAddress& client_addr) = 0;
+
+    /// Drops malformed requests from a drained batch (compacts in place), returns how many are kept
+    virtual size_t validate(Packet* packets, SocketAddress* client_addrs, size_t count) = 0;
+
+    /// Drops forged requests from a validated batch (compacts in place), returns how many are kept
+    virtual size_t authenticate(Packet* packets, SocketAddress* client_addrs, size_t count) = 0;
+
+    /**
+     * @brief ### [Worker thread] Handles a group of requests in arrival order.
+     *
+     * Records each request in recorder (FlightRecorder::Scope) with its receive time.
+     * Results must be those of handling the requests one by one in order.
+     */
+    virtual void process_group(FlightRecorder& recorder, const Packet* packets, const SocketAddress* client_addrs,
+                               const uint64_t* receive_ns, size_t count) = 0;
+
+    /// [I/O thread] Load to stamp into every reply from now on (see BatchController::load_hint())
+    virtual void set_load_hint(uint8_t load) = 0;
+
+    /// Socket polled by the I/O thread
+    virtual const UDPSocket& socket() const = 0;
+
+    /// UDP port (trace and flight recorder tag)
+    virtual uint16_t listen_port() const = 0;
+};
+
+/// Most datagrams read from one ledger socket per wakeup before serving the next one (fairness under flood)
+constexpr size_t RUNTIME_DRAIN_BATCH = 64;
+
+/// Most requests a worker takes from the queue at once (their accounts are prefetched and locked together)
+constexpr size_t RUNTIME_WORKER_BATCH = 16;
+
+/**
+ * @brief ### Shared I/O and worker runtime hosting any number of ledgers in one process.
+ *
+ * Each ledger is an independent Server (own port, accounts and statistics; any policy
+ * set, see Ledger). Instead of one spinning receive loop and one thread per request per
+ * ledger, the runtime has:
+ * - One I/O thread (run()) sleeping on every ledger socket at once (UDPSocket::wait_readable)
+ * - A fixed pool of worker threads executing Ledger::process_group() for any ledger
+ *
+ * Each drained batch is validated, then authenticated, by its ledger on the I/O thread
+ * before anything is queued, so malformed and forged requests never reach a worker or the
+ * accounts.
+ *
+ * Workers take queued requests in groups (their fair share of the queue, at most
+ * RUNTIME_WORKER_BATCH) and hand each ledger its share in one call: the ledger prefetches
+ * the accounts of the whole group, so the cache misses of its lookups overlap, and runs
+ * consecutive transfers under one set of account locks (see BasicServer::process_group()).
+ *
+ * Batch sizes adapt to the load (see BatchController): the drain batch (up to
+ * RUNTIME_DRAIN_BATCH), the worker group (up to RUNTIME_WORKER_BATCH, which also bounds a
+ * ledger's reply batch) and how long an idle worker waits for its group to fill are chosen
+ * against a latency target. Light load gets small batches and no wait, a backlog the
+ * largest batches. The controller's load hint is passed on to every ledger for its replies,
+ * so clients pace themselves on it.
+ *
+ * Ledgers are keyed by port: a datagram is processed by the ledger owning the socket it
+ * arrived on, so the wire protocol is unchanged.
+ *
+ * Usage:
+ *   ServerRuntime runtime(workers);
+ *   runtime.host(ledger_a);   // Servers outlive the runtime (not owned)
+ *   runtime.host(ledger_b);
+ *   runtime.run();            // Never returns
+ */
+class ServerRuntime {
+public:
+    /**
+     * @brief ### Creates the runtime (workers are started by run()).
+     * @param worker_count Worker threads shared by all ledgers (0 = one per hardware thread).
+     */
+    explicit ServerRuntime(size_t worker_count = 0);
+
+    ServerRuntime(const ServerRuntime&) = delete;
+    ServerRuntime& operator=(const ServerRuntime&) = delete;
+
+    /**
+     * @brief ### Adds a ledger to the runtime (must be called before run()).
+     * @param ledger Initialized server; must stay alive as long as the runtime runs.
+     */
+    void host(Ledger& ledger);
+
+    /**
+     * @brief ### Records every authenticated request of every ledger into a trace file.
+     *
+     * Capture happens on the I/O thread right after authentication (see PacketTraceWriter);
+     * must be called before run().
+     *
+     * @param path Trace file to create (replay it with the replay tool).
+     * @return False if the file couldn't be created.
+     */
+    bool enable_trace(const std::string& path);
+
+    /**
+     * @brief ### Flight recorder of the last requests per worker (always on).
+     *
+     * Configure it (stall threshold, dump directory) before run(); dumps on SIGUSR1.
+     */
+    FlightRecorder& flight_recorder() { return recorder; }
+
+    /**
+     * @brief ### Adaptive batching of the I/O thread and the workers.
+     *
+     * Set the latency target (BatchController::set_latency_target()) before run().
+     */
+    BatchController& batch_controller() { return controller; }
+
+    /**
+     * @brief ### Prints the batching parameters every interval_s while they change (must be called before run()).
+     * @param interval_s Report interval in seconds (0 = disabled).
+     */
+    void enable_batch_report(uint32_t interval_s) { batch_report_s = interval_s; }
+
+    /**
+     * @brief ### Starts every ledger's background threads and the workers, then runs the I/O loop.
+     *
+     * Never returns (unless polling fails, which only happens with closed sockets).
+     */
+    void run();
+
+private:
+    /// One received datagram waiting for a worker
+    struct Task {
+        Ledger* ledger;                 ///< Ledger owning the socket it arrived on
+        Packet packet;                  ///< Request (size already validated)
+        SocketAddress client_addr;      ///< Sender (reply destination)
+        uint64_t receive_ns;            ///< Receive time (flight recorder clock)
+    };
+
+    /**
+     * @brief ### [Worker thread] Executes queued requests forever, a group at a time.
+     */
+    void run_worker();
+
+    /**
+     * @brief ### [I/O thread] Queues a drained batch of one ledger under one lock and wakes workers.
+     */
+    void submit(Ledger* ledger, const Packet* packets, const SocketAddress* client_addrs, size_t count, uint64_t receive_ns);
+
+    /**
+     * @brief ### [I/O thread] Lets the batch controller follow the load, passes its load hint to the ledgers, prints the report when due.
+     */
+    void update_batching();
+
+    size_t worker_count;                ///< Pool size (resolved in constructor)
+    std::vector<Ledger*> ledgers;       ///< Hosted ledgers (not owned)
+    std::vector<std::thread> workers;   ///< Shared worker pool
+    PacketTraceWriter trace;            ///< Optional capture of received requests (enable_trace())
+    FlightRecorder recorder;            ///< Recent requests with stage timestamps (flight_recorder())
+    BatchController controller;         ///< Batch sizes and flush delay (batch_controller())
+    uint32_t batch_report_s = 0;        ///< Batching report interval (0 = disabled)
+    uint64_t last_batch_report_ns = 0;  ///< Time of the last batching report
+    BatchParameters reported_batching = {};  ///< Parameters of the last batching report
+
+    std::mutex queue_mutex;             ///< Protects tasks
+    std::condition_variable queue_cv;   ///< Signals workers when tasks arrive
+    std::deque<Task> tasks;             ///< Received requests in arrival order
+    bool collecting = false;            ///< A worker is waiting for its group to fill (others stay asleep)
+
+    // ===== I/O thread batch (one ledger's drain at a time) =====
+    Packet batch_packets[RUNTIME_DRAIN_BATCH];
+    SocketAddress batch_addrs[RUNTIME_DRAIN_BATCH];
+};
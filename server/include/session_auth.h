@@ -0,0 +1,102 @@
+#pragma once
+#include "packet.h"
+#include "packet_auth.h"
+#include "udp_socket.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/// Discovery cookie lifetime unit: a cookie is accepted in the epoch it was issued and the next one
+constexpr uint64_t COOKIE_EPOCH_S = 30;
+
+/// Packets verified together by SessionAuthenticator (one SipHash state per lane): 8 fill
+/// AVX2/AVX-512 registers; without them requests are verified one by one, AUTH_LANES per call
+#if defined(__AVX2__)
+constexpr size_t AUTH_LANES = 8;
+#else
+constexpr size_t AUTH_LANES = 4;
+#endif
+
+/**
+ * @brief ### Issues session keys and verifies request MACs of one ledger (see packet_auth.h).
+ *
+ * Stateless: a client's session key is SipHash-2-4 of its IP under the ledger's random
+ * secret (drawn at construction), so nothing is stored per account and keys survive account
+ * expiry. A restarted ledger has a new secret: clients get dropped until their failover
+ * sends DISCOVERY again and picks up the new key.
+ *
+ * With AVX2/AVX-512 (-DZIP_NATIVE_ARCH=ON), verification runs AUTH_LANES packets at a time
+ * in structure-of-arrays form: key derivation and MAC run on GCC/Clang vector types (one
+ * SIMD instruction per step for all lanes). SipHash needs 64-bit rotates, which SSE2 has to
+ * emulate slower than scalar code, so other targets (and compilers) pick the scalar
+ * verifier at compile time.
+ * Requests that don't carry a MAC (DISCOVERY, ignored types) go through the lanes too and pass.
+ *
+ * Discovery cookies (SYN-cookie style) come from a second secret: an unknown address gets a
+ * cookie bound to its IP, port and the current epoch, and only a DISCOVERY echoing it
+ * creates an account. Checking one needs no stored state either.
+ *
+ * Thread-safe for concurrent use (the secrets never change after construction).
+ */
+class SessionAuthenticator {
+public:
+    /// Draws the ledger secrets from std::random_device
+    SessionAuthenticator();
+
+    /// Session key of a client (sent in its DISCOVERY_ACK)
+    uint64_t session_key(uint32_t client_ip) const;
+
+    /// Cookie for an unknown address (sent in DISCOVERY_COOKIE), valid COOKIE_EPOCH_S to 2 * COOKIE_EPOCH_S
+    uint64_t discovery_cookie(const SocketAddress& client_addr) const;
+
+    /// True if cookie was issued to this exact address (IP and port) in the current or previous epoch
+    bool valid_cookie(const SocketAddress& client_addr, uint64_t cookie) const;
+
+    /**
+     * @brief ### Checks up to AUTH_LANES requests at once.
+     * @param valid [OUT] valid[i] = packets[i] needs no MAC or its MAC matches its sender.
+     */
+    void verify_lanes(const Packet* packets, const SocketAddress* client_addrs, size_t count, bool* valid) const;
+
+    /**
+     * @brief ### Drops forged requests from a received batch, keeping the order of the others.
+     *
+     * Compacts packets/client_addrs in place.
+     * @param on_rejected Called with each dropped request (before it is overwritten).
+     * @return Number of requests kept (now at the front of both arrays).
+     */
+    template<typename OnRejected>
+    size_t filter(Packet* packets, SocketAddress* client_addrs, size_t count, OnRejected&& on_rejected) const {
+        size_t kept = 0;
+        for (size_t base = 0; base < count; base += AUTH_LANES) {
+            size_t lanes = std::min(AUTH_LANES, count - base);
+            bool valid[AUTH_LANES];
+            verify_lanes(packets + base, client_addrs + base, lanes, valid);
+
+            for (size_t i = base; i < base + lanes; i++) {
+                if (!valid[i - base]) {
+                    on_rejected(packets[i], client_addrs[i]);
+                    continue;
+                }
+                if (kept != i) {
+                    packets[kept] = packets[i];
+                    client_addrs[kept] = client_addrs[i];
+                }
+                kept++;
+            }
+        }
+        return kept;
+    }
+
+private:
+    /// Cookie of an address for one epoch
+    uint64_t cookie_for(const SocketAddress& client_addr, uint64_t epoch) const;
+
+    /// Current cookie epoch (steady clock seconds / COOKIE_EPOCH_S)
+    static uint64_t cookie_epoch();
+
+    uint64_t secret0;           ///< Ledger secret, SipHash key half k0
+    uint64_t secret1;           ///< Ledger secret, SipHash key half k1
+    uint64_t cookie_secret0;    ///< Cookie secret, SipHash key half k0
+    uint64_t cookie_secret1;    ///< Cookie secret, SipHash key half k1
+};
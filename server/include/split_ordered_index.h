@@ -0,0 +1,482 @@
+#pragma once
+#include "epoch_reclaimer.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+/// Starts loading the cache line of address (a hint: never faults, even on nullptr or freed memory)
+inline void prefetch_address(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    (void)address;
+#endif
+}
+
+/**
+ * @brief ### Hash index with lock-free lookups that grows incrementally (split-ordered list).
+ *
+ * All nodes live in ONE singly linked list sorted by bit-reversed hash ("split order").
+ * The bucket table only holds shortcuts into that list (dummy nodes), so growing the table
+ * never moves or rehashes a node:
+ * - Doubling the bucket count is a single atomic store (O(1), no stall)
+ * - A new bucket is initialized lazily by splicing one dummy node after its parent's dummy
+ * - Until then, lookups for that bucket simply start from the parent bucket
+ *
+ * Concurrency:
+ * - find(), find_batch() and for_each() are lock-free and never wait, not even while the table grows
+ * - insert(), erase() and reserve() must be serialized by the caller (one writer at a time)
+ * - Writers publish every change with a single release store, so readers always see a valid list
+ *
+ * Bucket directory:
+ * - Segment 0 holds the first INITIAL_BUCKETS buckets
+ * - Segment i >= 1 holds the next INITIAL_BUCKETS * 2^(i-1) buckets
+ * - Segments are allocated on first use and never copied (no directory resize)
+ *
+ * Memory reclamation:
+ * - erase() unlinks a node and retires it to EpochReclaimer instead of freeing it
+ * - Readers must hold an EpochReclaimer::Guard while using pointers from find()/insert()/for_each()
+ * - A retired node is freed only after every guard that could have reached it has ended
+ * - Dummy nodes and bucket segments are kept (a few bytes per bucket of the peak size)
+ *
+ * @tparam K Key type (must be hashable with std::hash and equality comparable).
+ * @tparam T Value type stored inline in each node (constructed in place, never moved).
+ */
+template<typename K, typename T>
+class SplitOrderedIndex {
+public:
+    /// Bucket count of a fresh index (power of 2)
+    static constexpr size_t INITIAL_BUCKETS = 16;
+
+    /// Average nodes per bucket before the bucket count doubles
+    static constexpr size_t MAX_LOAD_FACTOR = 2;
+
+    /// Lookups find_batch() keeps in flight together (longer batches run in groups of this size)
+    static constexpr size_t FIND_BATCH_GROUP = 32;
+
+    SplitOrderedIndex();
+    ~SplitOrderedIndex();
+
+    // Non-copyable: nodes are referenced by raw pointers
+    SplitOrderedIndex(const SplitOrderedIndex&) = delete;
+    SplitOrderedIndex& operator=(const SplitOrderedIndex&) = delete;
+
+    /**
+     * @brief ### Looks up a key (lock-free, safe to call concurrently with a writer).
+     *
+     * @param key Key to look up.
+     * @return Pointer to the stored value, nullptr if key not found.
+     */
+    T* find(const K& key) const;
+
+    /**
+     * @brief ### Looks up several keys with their cache misses overlapped (group prefetching).
+     *
+     * Each stage runs over the whole group before the next one starts, prefetching what the
+     * next stage will read: hash every key and prefetch its bucket slot, then read the bucket
+     * dummies, then walk all lists in lockstep (one hop per key per round, prefetching every
+     * next node). A group of lookups costs about one memory round trip per stage instead of
+     * one per node per key. Same results as calling find() for each key.
+     *
+     * @param keys Keys to look up (duplicates allowed).
+     * @param count Number of keys.
+     * @param results [OUT] results[i] = find(keys[i]).
+     */
+    void find_batch(const K* keys, size_t count, T** results) const;
+
+    /**
+     * @brief ### Inserts a key if missing (writers must be serialized by the caller).
+     *
+     * The node is fully initialized by init before it becomes visible to readers.
+     *
+     * @param key Key to insert.
+     * @param init Callback receiving (T& value) for the new node, run before publication.
+     * @return Pair of (pointer to value, true if inserted / false if key already existed).
+     */
+    std::pair<T*, bool> insert(const K& key, const std::function<void(T&)>& init);
+
+    /**
+     * @brief ### Unlinks a key and retires its node (writers must be serialized by the caller).
+     *
+     * Readers already positioned on the node can keep traversing from it; the node is freed
+     * by EpochReclaimer once no guard can reference it anymore.
+     *
+     * @param key Key to remove.
+     * @param expected If non-null, only remove the node holding this value (guards against
+     *                 removing a newer node inserted under the same key).
+     * @return True if a node was unlinked, false if not found (or not the expected node).
+     */
+    bool erase(const K& key, const T* expected = nullptr);
+
+    /**
+     * @brief ### Visits every stored key/value (lock-free, caller holds an EpochReclaimer::Guard).
+     *
+     * Concurrent inserts/erases may or may not be observed.
+     *
+     * @param fn Callback receiving (const K& key, T& value).
+     */
+    void for_each(const std::function<void(const K&, T&)>& fn) const;
+
+    /**
+     * @brief ### Presizes the bucket table for an expected number of keys (writer operation).
+     *
+     * Allocates the segments and initializes every bucket up front, so later inserts up
+     * to expected_count never initialize buckets or grow the table.
+     * Never shrinks the table.
+     *
+     * @param expected_count Number of keys expected to be stored.
+     */
+    void reserve(size_t expected_count);
+
+    /// Number of keys stored (approximate while a writer is active)
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+
+    /// Current number of buckets (power of 2)
+    size_t bucket_count() const { return buckets.load(std::memory_order_acquire); }
+
+private:
+    /// List node (dummy nodes mark bucket starts, order_key is even)
+    struct Node {
+        uint64_t order_key;                 ///< Split-order key (bit-reversed hash)
+        std::atomic<Node*> next{nullptr};   ///< Next node in ascending order_key order
+        explicit Node(uint64_t order_key) : order_key(order_key) {}
+    };
+
+    /// Node holding a key/value pair (order_key is odd)
+    struct ValueNode : Node {
+        K key;      ///< Stored key (compared on order_key match)
+        T value;    ///< Stored value (constructed in place)
+        ValueNode(uint64_t order_key, const K& key) : Node(order_key), key(key) {}
+    };
+
+    /// Enough segments for INITIAL_BUCKETS * 2^47 buckets (never reached in practice)
+    static constexpr size_t SEGMENT_COUNT = 48;
+
+    using Bucket = std::atomic<Node*>;
+
+    Node head{0};                                   ///< Dummy node of bucket 0 (start of the list)
+    std::atomic<Bucket*> segments[SEGMENT_COUNT];   ///< Bucket directory (see class comment)
+    std::atomic<size_t> buckets{INITIAL_BUCKETS};   ///< Current bucket count (power of 2)
+    std::atomic<size_t> count{0};                   ///< Number of value nodes
+
+    // ===== Split-order helpers =====
+
+    /// Mixes std::hash output (identity for integers, e.g. IPs share their low bits)
+    static uint64_t hash_of(const K& key) {
+        uint64_t h = static_cast<uint64_t>(std::hash<K>{}(key));
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdull;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ull;
+        h ^= h >> 33;
+        return h;
+    }
+
+    static uint64_t reverse_bits(uint64_t x) {
+        x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+        x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+        x = ((x >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+        x = ((x >> 8) & 0x00FF00FF00FF00FFull) | ((x & 0x00FF00FF00FF00FFull) << 8);
+        x = ((x >> 16) & 0x0000FFFF0000FFFFull) | ((x & 0x0000FFFF0000FFFFull) << 16);
+        return (x >> 32) | (x << 32);
+    }
+
+    /// Order key of a value node (top hash bit forced to 1, so the reversed key is odd)
+    static uint64_t value_key(uint64_t hash) { return reverse_bits(hash | (1ull << 63)); }
+
+    /// Order key of a bucket's dummy node (even, sorts before all values of the bucket)
+    static uint64_t dummy_key(size_t bucket) { return reverse_bits(static_cast<uint64_t>(bucket)); }
+
+    static size_t floor_log2(size_t x) {
+#if defined(__GNUC__) || defined(__clang__)
+        return sizeof(unsigned long long) * 8 - 1 - static_cast<size_t>(__builtin_clzll(x));
+#else
+        size_t r = 0;
+        while (x >>= 1) r++;
+        return r;
+#endif
+    }
+
+    /// Parent bucket: same bucket index with its highest set bit cleared
+    static size_t parent_of(size_t bucket) { return bucket & ~(size_t(1) << floor_log2(bucket)); }
+
+    static size_t segment_size(size_t segment) {
+        return segment == 0 ? INITIAL_BUCKETS : INITIAL_BUCKETS << (segment - 1);
+    }
+
+    static void locate(size_t bucket, size_t& segment, size_t& offset) {
+        if (bucket < INITIAL_BUCKETS) {
+            segment = 0;
+            offset = bucket;
+            return;
+        }
+        size_t high = floor_log2(bucket);
+        segment = high - floor_log2(INITIAL_BUCKETS) + 1;
+        offset = bucket - (size_t(1) << high);
+    }
+
+    // ===== Bucket access =====
+
+    /// Slot of bucket in the directory, nullptr if its segment isn't allocated yet (reader safe)
+    Bucket* bucket_slot(size_t bucket) const;
+
+    /// Dummy node of bucket, nullptr if not initialized yet (reader safe)
+    Node* load_bucket(size_t bucket) const;
+
+    /// First initialized bucket on the path to bucket 0 (reader safe)
+    Node* nearest_bucket(size_t bucket) const;
+
+    /// Returns bucket's dummy node, splicing it (and missing ancestors) into the list if needed (writer only)
+    Node* initialize_bucket(size_t bucket);
+
+    /// Deleter passed to EpochReclaimer::retire()
+    static void delete_value_node(void* node) { delete static_cast<ValueNode*>(node); }
+};
+
+// ===== SplitOrderedIndex implementations =====
+
+template<typename K, typename T>
+SplitOrderedIndex<K,T>::SplitOrderedIndex() {
+    for (auto& segment : segments) segment.store(nullptr, std::memory_order_relaxed);
+
+    // Segment 0 always exists, bucket 0 is the list head
+    Bucket* first = new Bucket[INITIAL_BUCKETS];
+    for (size_t i = 0; i < INITIAL_BUCKETS; i++) first[i].store(nullptr, std::memory_order_relaxed);
+    first[0].store(&head, std::memory_order_relaxed);
+    segments[0].store(first, std::memory_order_release);
+}
+
+template<typename K, typename T>
+SplitOrderedIndex<K,T>::~SplitOrderedIndex() {
+    // Free every node after the head (odd order_key = value node)
+    Node* node = head.next.load(std::memory_order_relaxed);
+    while (node) {
+        Node* next = node->next.load(std::memory_order_relaxed);
+        if (node->order_key & 1) {
+            delete static_cast<ValueNode*>(node);
+        } else {
+            delete node;
+        }
+        node = next;
+    }
+    for (auto& segment : segments) delete[] segment.load(std::memory_order_relaxed);
+}
+
+template<typename K, typename T>
+typename SplitOrderedIndex<K,T>::Bucket* SplitOrderedIndex<K,T>::bucket_slot(size_t bucket) const {
+    size_t segment, offset;
+    locate(bucket, segment, offset);
+    Bucket* buckets_of_segment = segments[segment].load(std::memory_order_acquire);
+    if (!buckets_of_segment) return nullptr;  // Segment not allocated yet
+    return &buckets_of_segment[offset];
+}
+
+template<typename K, typename T>
+typename SplitOrderedIndex<K,T>::Node* SplitOrderedIndex<K,T>::load_bucket(size_t bucket) const {
+    Bucket* slot = bucket_slot(bucket);
+    return slot ? slot->load(std::memory_order_acquire) : nullptr;
+}
+
+template<typename K, typename T>
+typename SplitOrderedIndex<K,T>::Node* SplitOrderedIndex<K,T>::nearest_bucket(size_t bucket) const {
+    // Uninitialized buckets fall back to their parent (bucket 0 is always initialized)
+    Node* dummy = load_bucket(bucket);
+    while (!dummy) {
+        bucket = parent_of(bucket);
+        dummy = load_bucket(bucket);
+    }
+    return dummy;
+}
+
+template<typename K, typename T>
+typename SplitOrderedIndex<K,T>::Node* SplitOrderedIndex<K,T>::initialize_bucket(size_t bucket) {
+    Node* dummy = load_bucket(bucket);
+    if (dummy) return dummy;
+
+    // Parent first: the new dummy is spliced into the parent's part of the list
+    Node* parent = initialize_bucket(parent_of(bucket));
+
+    dummy = new Node(dummy_key(bucket));
+    Node* pred = parent;
+    Node* cur = pred->next.load(std::memory_order_relaxed);
+    while (cur && cur->order_key < dummy->order_key) {
+        pred = cur;
+        cur = cur->next.load(std::memory_order_relaxed);
+    }
+    dummy->next.store(cur, std::memory_order_relaxed);
+    pred->next.store(dummy, std::memory_order_release);  // Publish to readers
+
+    // Record shortcut (allocate segment on first use)
+    size_t segment, offset;
+    locate(bucket, segment, offset);
+    Bucket* buckets_of_segment = segments[segment].load(std::memory_order_relaxed);
+    if (!buckets_of_segment) {
+        size_t n = segment_size(segment);
+        buckets_of_segment = new Bucket[n];
+        for (size_t i = 0; i < n; i++) buckets_of_segment[i].store(nullptr, std::memory_order_relaxed);
+        segments[segment].store(buckets_of_segment, std::memory_order_release);
+    }
+    buckets_of_segment[offset].store(dummy, std::memory_order_release);
+    return dummy;
+}
+
+template<typename K, typename T>
+T* SplitOrderedIndex<K,T>::find(const K& key) const {
+    uint64_t hash = hash_of(key);
+    uint64_t order_key = value_key(hash);
+
+    // Start at the key's bucket (or its nearest initialized ancestor)
+    size_t bucket = static_cast<size_t>(hash) & (buckets.load(std::memory_order_acquire) - 1);
+    const Node* node = nearest_bucket(bucket)->next.load(std::memory_order_acquire);
+
+    // List is sorted: stop as soon as we pass the key's position
+    while (node && node->order_key <= order_key) {
+        if (node->order_key == order_key) {
+            const ValueNode* value_node = static_cast<const ValueNode*>(node);
+            if (value_node->key == key) return const_cast<T*>(&value_node->value);
+        }
+        node = node->next.load(std::memory_order_acquire);
+    }
+    return nullptr;
+}
+
+template<typename K, typename T>
+void SplitOrderedIndex<K,T>::find_batch(const K* keys, size_t count, T** results) const {
+    uint64_t order_keys[FIND_BATCH_GROUP];
+    size_t bucket_of[FIND_BATCH_GROUP];
+    const Node* cursors[FIND_BATCH_GROUP];
+    size_t bucket_mask = buckets.load(std::memory_order_acquire) - 1;
+
+    for (size_t base = 0; base < count; base += FIND_BATCH_GROUP) {
+        size_t group = std::min(FIND_BATCH_GROUP, count - base);
+
+        // Stage 1: hash every key, prefetch its bucket slot
+        for (size_t i = 0; i < group; i++) {
+            uint64_t hash = hash_of(keys[base + i]);
+            order_keys[i] = value_key(hash);
+            bucket_of[i] = static_cast<size_t>(hash) & bucket_mask;
+            prefetch_address(bucket_slot(bucket_of[i]));
+        }
+
+        // Stage 2: bucket dummies (or nearest initialized ancestors), prefetch them
+        for (size_t i = 0; i < group; i++) {
+            cursors[i] = nearest_bucket(bucket_of[i]);
+            prefetch_address(cursors[i]);
+        }
+
+        // Stage 3: first node after each dummy
+        for (size_t i = 0; i < group; i++) {
+            cursors[i] = cursors[i]->next.load(std::memory_order_acquire);
+            prefetch_address(cursors[i]);
+            results[base + i] = nullptr;
+        }
+
+        // Stage 4: walk all lists in lockstep until every key is found or passed (as find())
+        for (size_t walking = group; walking > 0;) {
+            walking = 0;
+            for (size_t i = 0; i < group; i++) {
+                const Node* node = cursors[i];
+                if (!node) continue;
+                if (node->order_key > order_keys[i]) {
+                    cursors[i] = nullptr;  // Passed the key's position: not found
+                    continue;
+                }
+                if (node->order_key == order_keys[i]) {
+                    const ValueNode* value_node = static_cast<const ValueNode*>(node);
+                    if (value_node->key == keys[base + i]) {
+                        results[base + i] = const_cast<T*>(&value_node->value);
+                        cursors[i] = nullptr;
+                        continue;
+                    }
+                }
+                cursors[i] = node->next.load(std::memory_order_acquire);
+                prefetch_address(cursors[i]);
+                walking++;
+            }
+        }
+    }
+}
+
+template<typename K, typename T>
+std::pair<T*, bool> SplitOrderedIndex<K,T>::insert(const K& key, const std::function<void(T&)>& init) {
+    uint64_t hash = hash_of(key);
+    uint64_t order_key = value_key(hash);
+    size_t bucket_total = buckets.load(std::memory_order_relaxed);
+
+    // Find insert position: after the last node with order_key <= ours
+    Node* pred = initialize_bucket(static_cast<size_t>(hash) & (bucket_total - 1));
+    Node* cur = pred->next.load(std::memory_order_relaxed);
+    while (cur && cur->order_key <= order_key) {
+        if (cur->order_key == order_key && static_cast<ValueNode*>(cur)->key == key) {
+            return {&static_cast<ValueNode*>(cur)->value, false};  // Already present
+        }
+        pred = cur;
+        cur = cur->next.load(std::memory_order_relaxed);
+    }
+
+    // Fully initialize the node before it becomes reachable
+    ValueNode* node = new ValueNode(order_key, key);
+    init(node->value);
+    node->next.store(cur, std::memory_order_relaxed);
+    pred->next.store(node, std::memory_order_release);  // Publish to readers
+
+    // Grow: doubling is just a new bucket count, buckets are split lazily on first insert
+    size_t new_count = count.fetch_add(1, std::memory_order_relaxed) + 1;
+    if (new_count > bucket_total * MAX_LOAD_FACTOR && (bucket_total << 1) != 0) {
+        buckets.store(bucket_total << 1, std::memory_order_release);
+    }
+    return {&node->value, true};
+}
+
+template<typename K, typename T>
+bool SplitOrderedIndex<K,T>::erase(const K& key, const T* expected) {
+    uint64_t hash = hash_of(key);
+    uint64_t order_key = value_key(hash);
+    size_t bucket_total = buckets.load(std::memory_order_relaxed);
+
+    Node* pred = initialize_bucket(static_cast<size_t>(hash) & (bucket_total - 1));
+    Node* cur = pred->next.load(std::memory_order_relaxed);
+    while (cur && cur->order_key <= order_key) {
+        if (cur->order_key == order_key) {
+            ValueNode* value_node = static_cast<ValueNode*>(cur);
+            if (value_node->key == key && (!expected || &value_node->value == expected)) {
+                // Unlink: readers on cur still see a valid next pointer
+                pred->next.store(cur->next.load(std::memory_order_relaxed), std::memory_order_release);
+                count.fetch_sub(1, std::memory_order_relaxed);
+                EpochReclaimer::instance().retire(value_node, &SplitOrderedIndex::delete_value_node);
+                return true;
+            }
+        }
+        pred = cur;
+        cur = cur->next.load(std::memory_order_relaxed);
+    }
+    return false;
+}
+
+template<typename K, typename T>
+void SplitOrderedIndex<K,T>::for_each(const std::function<void(const K&, T&)>& fn) const {
+    for (Node* node = head.next.load(std::memory_order_acquire); node; node = node->next.load(std::memory_order_acquire)) {
+        if (node->order_key & 1) {
+            ValueNode* value_node = static_cast<ValueNode*>(node);
+            fn(value_node->key, value_node->value);
+        }
+    }
+}
+
+template<typename K, typename T>
+void SplitOrderedIndex<K,T>::reserve(size_t expected_count) {
+    size_t target = buckets.load(std::memory_order_relaxed);
+    while (target * MAX_LOAD_FACTOR < expected_count && (target << 1) != 0) target <<= 1;
+
+    // Initialize in ascending order: every parent is ready before its children
+    for (size_t bucket = 0; bucket < target; bucket++) initialize_bucket(bucket);
+    buckets.store(target, std::memory_order_release);
+}
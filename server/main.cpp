@@ -1,36 +1,154 @@
 #include "server.h"
+#include "server_runtime.h"
+#include "udp_socket.h"
 #include <iostream>
 #include <cstdint>
+#include <string>
+#include <sstream>
+#include <vector>
+#include <memory>
+
+// Ledger type of this build (-DZIP_LEAN_SERVER=ON: spin locks, atomic stats, no per-request log)
+#ifdef ZIP_LEAN_SERVER
+using ServedLedger = LeanServer;
+#else
+using ServedLedger = Server;
+#endif
 
 /**
- * @brief Server entry point - starts multi-threaded UDP server.
- * 
- * Usage: ./server <port>
- * Example: ./server 8080
+ * @brief Prints command line usage.
+ */
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " <port>[,<port>...] [expected_clients] [--idle-timeout <seconds>] [--balance-sink <ip>] [--workers <n>] [--trace <file>] [--stall-ms <ms>] [--flight-dir <dir>] [--contention-report <seconds>] [--latency-target-us <us>] [--batch-report <seconds>]" << std::endl;
+}
+
+/**
+ * @brief Server entry point - starts one or more ledgers on a shared runtime.
+ *
+ * Usage: ./server <port>[,<port>...] [expected_clients] [--idle-timeout <seconds>] [--balance-sink <ip>] [--workers <n>] [--trace <file>] [--stall-ms <ms>] [--flight-dir <dir>] [--contention-report <seconds>] [--latency-target-us <us>] [--batch-report <seconds>]
+ * Every port is an independent ledger (own accounts and statistics); all ledgers share
+ * one I/O thread and one worker pool. Options apply to every ledger.
+ * Builds configured with -DZIP_LEAN_SERVER=ON serve LeanServer ledgers (no per-request output).
+ * --contention-report needs a build configured with -DZIP_LOCK_CONTENTION=ON.
+ * Examples:
+ *   ./server 8080                                  # Clients index grows on demand
+ *   ./server 8080,8081,8082 --workers 4            # Three ledgers served by 4 workers
+ *   ./server 8080 --trace traffic.zt               # Record received packets for ./replay
+ *   ./server 8080 --stall-ms 50                    # Dump recent requests when one takes > 50 ms
+ *   ./server 8080 --contention-report 10           # Every 10 s: accounts waiting longest for locks
+ *   ./server 8080 --latency-target-us 200 --batch-report 5   # Tighter batching target, parameters every 5 s
+ *   ./server 8080 1000000                          # Presize clients index for 1M accounts
+ *   ./server 8080 --idle-timeout 3600              # Close accounts idle for 1h (funds retired)
+ *   ./server 8080 --idle-timeout 3600 --balance-sink 10.0.0.1   # Closed balances go to 10.0.0.1
  */
 int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <port>" << std::endl;
+    if (argc < 2) {
+        print_usage(argv[0]);
         return 1;
     }
 
-    // Parse and validate port
-    uint16_t port = 0;
-    try {
-        port = static_cast<uint16_t>(std::stoi(argv[1]));
-        if (port == 0) {
-            std::cerr << "Error: Port must be in range 1-65535" << std::endl;
+    // Parse and validate ports (one ledger each)
+    std::vector<uint16_t> ports;
+    std::stringstream port_list(argv[1]);
+    std::string port_str;
+    while (std::getline(port_list, port_str, ',')) {
+        try {
+            int port = std::stoi(port_str);
+            if (port <= 0 || port > 65535) {
+                std::cerr << "Error: Port must be in range 1-65535" << std::endl;
+                return 1;
+            }
+            ports.push_back(static_cast<uint16_t>(port));
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid port number" << std::endl;
             return 1;
         }
-    } catch (const std::exception&) {
-        std::cerr << "Error: Invalid port number" << std::endl;
+    }
+    if (ports.empty()) {
+        print_usage(argv[0]);
         return 1;
     }
 
-    // Start server
+    // Parse optional arguments
+    size_t expected_clients = 0;    // Presizes the clients index (0 = grow on demand)
+    uint32_t idle_timeout_s = 0;    // Account expiry (0 = disabled)
+    uint32_t balance_sink_ip = 0;   // Receives closed balances (0 = retire funds)
+    size_t worker_count = 0;        // Shared worker pool size (0 = one per hardware thread)
+    std::string trace_path;         // Packet capture file (empty = no capture)
+    uint32_t stall_ms = 0;          // Flight recorder dump threshold (0 = SIGUSR1 only)
+    std::string flight_dir = ".";   // Flight recorder dump directory
+    uint32_t contention_report_s = 0;   // Lock contention report interval (0 = disabled)
+    uint32_t latency_target_us = DEFAULT_LATENCY_TARGET_US;     // Adaptive batching target
+    uint32_t batch_report_s = 0;        // Batching parameters report interval (0 = disabled)
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        try {
+            if (arg == "--idle-timeout" && i + 1 < argc) {
+                idle_timeout_s = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--balance-sink" && i + 1 < argc) {
+                SocketAddress sink_addr(argv[++i]);
+                if (!sink_addr.is_valid()) {
+                    std::cerr << "Error: Invalid balance sink IP address" << std::endl;
+                    return 1;
+                }
+                balance_sink_ip = sink_addr.ip();
+            } else if (arg == "--trace" && i + 1 < argc) {
+                trace_path = argv[++i];
+            } else if (arg == "--stall-ms" && i + 1 < argc) {
+                stall_ms = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--flight-dir" && i + 1 < argc) {
+                flight_dir = argv[++i];
+            } else if (arg == "--contention-report" && i + 1 < argc) {
+                contention_report_s = static_cast<uint32_t>(std::stoul(argv[++i]));
+#ifndef ZIP_LOCK_CONTENTION
+                if (contention_report_s > 0) {
+                    std::cerr << "Error: --contention-report needs a build configured with -DZIP_LOCK_CONTENTION=ON" << std::endl;
+                    return 1;
+                }
+#endif
+            } else if (arg == "--latency-target-us" && i + 1 < argc) {
+                latency_target_us = static_cast<uint32_t>(std::stoul(argv[++i]));
+                if (latency_target_us == 0) {
+                    std::cerr << "Error: Latency target must be at least 1 us" << std::endl;
+                    return 1;
+                }
+            } else if (arg == "--batch-report" && i + 1 < argc) {
+                batch_report_s = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--workers" && i + 1 < argc) {
+                worker_count = static_cast<size_t>(std::stoul(argv[++i]));
+            } else if (i == 2 && arg.rfind("--", 0) != 0) {
+                expected_clients = static_cast<size_t>(std::stoull(arg));
+            } else {
+                print_usage(argv[0]);
+                return 1;
+            }
+        } catch (const std::exception&) {
+            std::cerr << "Error: Invalid value for " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    // Start ledgers on a shared runtime
     try {
-        Server server(port);
-        server.run();
+        std::vector<std::unique_ptr<ServedLedger>> ledgers;
+        ServerRuntime runtime(worker_count);
+        for (uint16_t port : ports) {
+            ledgers.push_back(std::make_unique<ServedLedger>(port, expected_clients));
+            ledgers.back()->enable_account_expiry(idle_timeout_s, balance_sink_ip);
+#ifdef ZIP_LOCK_CONTENTION
+            ledgers.back()->enable_contention_report(contention_report_s);
+#endif
+            runtime.host(*ledgers.back());
+        }
+        if (!trace_path.empty() && !runtime.enable_trace(trace_path)) {
+            std::cerr << "Error: Cannot create trace file " << trace_path << std::endl;
+            return 1;
+        }
+        runtime.flight_recorder().set_stall_threshold(stall_ms);
+        runtime.flight_recorder().set_dump_directory(flight_dir);
+        runtime.batch_controller().set_latency_target(latency_target_us);
+        runtime.enable_batch_report(batch_report_s);
+        runtime.run();
     } catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << std::endl;
         return 1;
@@ -0,0 +1,126 @@
+#include "batch_controller.h"
+#include "server_runtime.h"
+#include <algorithm>
+#include <cmath>
+
+/// Moves a smoothed estimate toward a new sample (weight grows with the time it covers)
+static void smooth(double& estimate, double sample, double weight) {
+    estimate += (sample - estimate) * weight;
+}
+
+/// Largest batch whose cost (per-item cost × size) stays within budget_ns, clamped to [min, max]
+static size_t batch_within(double budget_ns, double cost_ns, size_t min, size_t max) {
+    if (cost_ns <= 0) return max;   // Nothing measured yet
+    double fits = std::floor(budget_ns / cost_ns);
+    return static_cast<size_t>(std::clamp(fits, static_cast<double>(min), static_cast<double>(max)));
+}
+
+// ===== Constructor =====
+
+BatchController::BatchController(size_t worker_count, uint32_t latency_target_us)
+    : worker_count(std::max<size_t>(1, worker_count)),
+      latency_target_ns(static_cast<uint64_t>(latency_target_us) * 1000),
+      current_drain_batch(RUNTIME_DRAIN_BATCH),
+      current_worker_batch(RUNTIME_WORKER_BATCH) {}
+
+// ===== Observations =====
+
+void BatchController::record_drain(size_t received, uint64_t elapsed_ns) {
+    arrivals.fetch_add(received, std::memory_order_relaxed);
+    io_ns.fetch_add(elapsed_ns, std::memory_order_relaxed);
+}
+
+void BatchController::record_group(size_t count, uint64_t service_ns, uint64_t latency_sum_ns) {
+    served.fetch_add(count, std::memory_order_relaxed);
+    this->service_ns.fetch_add(service_ns, std::memory_order_relaxed);
+    latency_ns.fetch_add(latency_sum_ns, std::memory_order_relaxed);
+}
+
+void BatchController::record_wait(size_t collected) {
+    waits.fetch_add(1, std::memory_order_relaxed);
+    this->collected.fetch_add(collected, std::memory_order_relaxed);
+}
+
+// ===== Control =====
+
+bool BatchController::update(uint64_t now_ns, size_t queue_depth) {
+    if (last_update_ns == 0) {
+        last_update_ns = now_ns;    // First call: start the first interval
+        return false;
+    }
+    if (!update_due(now_ns)) return false;
+    uint64_t elapsed_ns = now_ns - last_update_ns;
+    last_update_ns = now_ns;
+
+    // Samples of the interval (an idle interval after a long sleep weighs fully)
+    uint64_t interval_arrivals = arrivals.exchange(0, std::memory_order_relaxed);
+    uint64_t interval_io_ns = io_ns.exchange(0, std::memory_order_relaxed);
+    uint64_t interval_served = served.exchange(0, std::memory_order_relaxed);
+    uint64_t interval_service_ns = service_ns.exchange(0, std::memory_order_relaxed);
+    uint64_t interval_latency_ns = latency_ns.exchange(0, std::memory_order_relaxed);
+    uint64_t interval_waits = waits.exchange(0, std::memory_order_relaxed);
+    uint64_t interval_collected = collected.exchange(0, std::memory_order_relaxed);
+    double weight = 1.0 - std::exp(-static_cast<double>(elapsed_ns) / BATCH_SMOOTHING_NS);
+
+    smooth(arrival_rate, interval_arrivals * 1e9 / elapsed_ns, weight);
+    smooth(this->queue_depth, static_cast<double>(queue_depth), weight);
+    if (interval_arrivals > 0) {
+        smooth(io_ns_per_packet, static_cast<double>(interval_io_ns) / interval_arrivals, weight);
+    }
+    if (interval_served > 0) {
+        smooth(service_ns_per_request, static_cast<double>(interval_service_ns) / interval_served, weight);
+        smooth(mean_latency_ns, static_cast<double>(interval_latency_ns) / interval_served, weight);
+    } else {
+        smooth(mean_latency_ns, 0, weight);     // Idle: the next replies shouldn't carry an old overload
+    }
+
+    // Waits that didn't collect one request each on average only added latency
+    if (interval_waits > 0 && interval_collected < interval_waits) {
+        waits_suspended_until_ns = now_ns + BATCH_WAIT_RETRY_NS;
+    }
+
+    double target_ns = static_cast<double>(latency_target_ns.load(std::memory_order_relaxed));
+    size_t worker_batch = batch_within(target_ns / 2, service_ns_per_request, 1, RUNTIME_WORKER_BATCH);
+    size_t drain_batch = batch_within(target_ns / 4, io_ns_per_packet, BATCH_DRAIN_MIN, RUNTIME_DRAIN_BATCH);
+    uint64_t max_wait_ns = 0;
+
+    // Backlog (more queued than one latency-sized group per worker): queueing delay dominates,
+    // the largest batches drain it fastest. Judged against the latency-sized group, not the
+    // current one, so the choice doesn't flip back as soon as it takes effect
+    double backlog_depth = static_cast<double>(worker_count * worker_batch);
+    bool backlog = this->queue_depth > backlog_depth;
+
+    // Load hint: the worse of latency against its target and queue against the backlog threshold
+    double load_ratio = std::max(mean_latency_ns / target_ns, this->queue_depth / backlog_depth);
+    double load = std::min(static_cast<double>(LOAD_HINT_MAX), LOAD_HINT_TARGET * load_ratio);
+
+    if (backlog) {
+        worker_batch = RUNTIME_WORKER_BATCH;
+        drain_batch = RUNTIME_DRAIN_BATCH;
+    } else {
+        // Busy enough that groups form: wait for the next requests of the group, if they come soon
+        double utilization = arrival_rate * service_ns_per_request / 1e9 / worker_count;
+        if (utilization >= BATCH_WAIT_MIN_UTILIZATION && worker_batch > 1 && now_ns >= waits_suspended_until_ns) {
+            double fill_ns = (worker_batch - 1) * 1e9 / arrival_rate;
+            max_wait_ns = static_cast<uint64_t>(std::min(fill_ns, target_ns / 4));
+        }
+    }
+
+    current_drain_batch.store(drain_batch, std::memory_order_relaxed);
+    current_worker_batch.store(worker_batch, std::memory_order_relaxed);
+    current_max_wait_ns.store(max_wait_ns, std::memory_order_relaxed);
+    current_load_hint.store(static_cast<uint8_t>(load), std::memory_order_relaxed);
+    return true;
+}
+
+BatchParameters BatchController::snapshot() const {
+    BatchParameters parameters;
+    parameters.drain_batch = drain_batch();
+    parameters.worker_batch = worker_batch();
+    parameters.max_wait_ns = max_wait_ns();
+    parameters.arrival_rate = arrival_rate;
+    parameters.queue_depth = queue_depth;
+    parameters.latency_ns = static_cast<uint64_t>(mean_latency_ns);
+    parameters.load_hint = load_hint();
+    return parameters;
+}
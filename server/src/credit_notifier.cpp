@@ -0,0 +1,140 @@
+#include "credit_notifier.h"
+#include <algorithm>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// ===== Constructor =====
+
+CreditNotifier::CreditNotifier(UDPSocket& socket, BalanceReader read_balance, LostHandler on_lost)
+    : socket(socket), read_balance(std::move(read_balance)), on_lost(std::move(on_lost)) {}
+
+// ===== Subscription management =====
+
+bool CreditNotifier::subscribe(uint32_t client_ip, const SocketAddress& client_addr, const std::function<bool()>& confirm) {
+    std::lock_guard<std::mutex> lock(mutex);
+    // operator[] creates the subscription on first call, later calls only redirect it
+    subscriptions[client_ip].addr = client_addr;
+    if (!confirm || confirm()) return true;
+    subscriptions.erase(client_ip);
+    return false;
+}
+
+void CreditNotifier::unsubscribe(uint32_t client_ip) {
+    std::lock_guard<std::mutex> lock(mutex);
+    subscriptions.erase(client_ip);
+}
+
+// ===== Worker thread entry points =====
+
+void CreditNotifier::notify_credit(uint32_t client_ip, uint32_t value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = subscriptions.find(client_ip);
+    if (it == subscriptions.end()) return;  // Unsubscribed meanwhile
+
+    Subscription& sub = it->second;
+    if (sub.pending_credit == 0) {
+        // First credit of a new batch: the window starts now
+        sub.batch_opened = Clock::now();
+        if (!sub.awaiting_ack) {
+            wake_pending = true;
+            work_cv.notify_one();
+        }
+    }
+    sub.pending_credit += value;
+}
+
+void CreditNotifier::acknowledge(uint32_t client_ip, uint32_t notify_id) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = subscriptions.find(client_ip);
+    if (it == subscriptions.end()) return;
+
+    Subscription& sub = it->second;
+    if (!sub.awaiting_ack || sub.in_flight.request_id != notify_id) return;  // Stale or duplicate ack
+
+    sub.awaiting_ack = false;
+    if (sub.pending_credit > 0) {
+        // Credits queued behind the acked notification can go out now
+        wake_pending = true;
+        work_cv.notify_one();
+    }
+}
+
+// ===== Sender thread =====
+
+void CreditNotifier::run() {
+    std::vector<std::pair<Packet, SocketAddress>> outgoing;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        Clock::time_point now = Clock::now();
+        Clock::time_point next_deadline = Clock::time_point::max();
+
+        for (auto it = subscriptions.begin(); it != subscriptions.end();) {
+            Subscription& sub = it->second;
+
+            if (sub.awaiting_ack) {
+                // ===== Retransmission of the notification in flight =====
+                if (now - sub.last_sent >= std::chrono::milliseconds(NOTIFY_RETRANSMIT_MS)) {
+                    if (sub.retransmits >= NOTIFY_MAX_RETRANSMITS) {
+                        // Receiver stopped answering: drop the subscription (credits stay in the balance).
+                        // Flag cleared under the lock, before the drop: a SUBSCRIBE racing it either
+                        // still finds this subscription or sets the flag again on a new one
+                        on_lost(it->first);
+                        it = subscriptions.erase(it);
+                        continue;
+                    }
+                    sub.retransmits++;
+                    sub.last_sent = now;
+                    outgoing.emplace_back(sub.in_flight, sub.addr);
+                }
+                next_deadline = std::min(next_deadline, sub.last_sent + std::chrono::milliseconds(NOTIFY_RETRANSMIT_MS));
+            } else if (sub.pending_credit > 0) {
+                // ===== New notification once the batching window closed =====
+                Clock::time_point batch_due = sub.batch_opened + std::chrono::milliseconds(NOTIFY_BATCH_WINDOW_MS);
+                if (now < batch_due) {
+                    next_deadline = std::min(next_deadline, batch_due);
+                } else {
+                    std::optional<uint32_t> balance = read_balance(it->first);
+                    if (!balance) {
+                        // Account closed before the batch went out
+                        it = subscriptions.erase(it);
+                        continue;
+                    }
+
+                    // Credits beyond 32 bits stay pending for the next notification
+                    uint32_t credited = static_cast<uint32_t>(std::min<uint64_t>(
+                        sub.pending_credit, std::numeric_limits<uint32_t>::max()));
+                    sub.pending_credit -= credited;
+                    sub.batch_opened = now;
+
+                    sub.in_flight = Packet::create_notify(sub.next_notify_id++, credited, *balance);
+                    sub.awaiting_ack = true;
+                    sub.retransmits = 0;
+                    sub.last_sent = now;
+                    outgoing.emplace_back(sub.in_flight, sub.addr);
+                    next_deadline = std::min(next_deadline, now + std::chrono::milliseconds(NOTIFY_RETRANSMIT_MS));
+                }
+            }
+            ++it;
+        }
+
+        // Send outside the lock (workers keep queueing credits meanwhile)
+        if (!outgoing.empty()) {
+            lock.unlock();
+            for (const auto& [packet, addr] : outgoing) {
+                socket.send(&packet, sizeof(packet), addr);
+            }
+            outgoing.clear();
+            lock.lock();
+        }
+
+        // Sleep until the earliest deadline, or until a worker opens a batch / frees a slot
+        if (next_deadline == Clock::time_point::max()) {
+            work_cv.wait(lock, [this] { return wake_pending; });
+        } else {
+            work_cv.wait_until(lock, next_deadline, [this] { return wake_pending; });
+        }
+        wake_pending = false;
+    }
+}
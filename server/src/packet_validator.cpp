@@ -0,0 +1,177 @@
+#include "packet_validator.h"
+#include <algorithm>
+#include <cstring>
+
+/// Kept packets per duplicate window (a longer batch restarts the table, so duplicates are
+/// only found within the window)
+static constexpr size_t DUPLICATE_WINDOW = 64;
+
+/// Duplicate table slots (power of 2, at most half full)
+static constexpr int DUPLICATE_TABLE_BITS = 7;
+static constexpr size_t DUPLICATE_TABLE_SIZE = size_t(1) << DUPLICATE_TABLE_BITS;
+static_assert(DUPLICATE_TABLE_SIZE >= 2 * DUPLICATE_WINDOW, "duplicate table more than half full");
+
+#if defined(__GNUC__)
+/// One byte per packet, VALIDATE_LANES packets in one 128-bit vector (GCC/Clang vector
+/// extension: a single SSE2/NEON register; wider lanes would be split into scalar code)
+typedef int8_t LaneBytes __attribute__((vector_size(VALIDATE_LANES)));
+#endif
+
+/// Table slot of a request: multiplicative hash of sender IP, request_id and type (copies
+/// of a request always collide; other fields are only compared on a hit)
+static size_t duplicate_slot(const Packet& packet, uint32_t client_ip) {
+    uint64_t key = (static_cast<uint64_t>(client_ip) << 32 | packet.request_id) ^ packet.type;
+    return static_cast<size_t>((key * 0x9E3779B97F4A7C15ull) >> (64 - DUPLICATE_TABLE_BITS));
+}
+
+/// Same sender and same fields (padding bytes ignored)
+static bool same_datagram(const Packet& a, const SocketAddress& a_addr, const Packet& b, const SocketAddress& b_addr) {
+    return a.type == b.type && a.request_id == b.request_id &&
+           a.payload.request.destination_ip == b.payload.request.destination_ip &&
+           a.payload.request.value == b.payload.request.value && a.auth == b.auth &&
+           a_addr.ip() == b_addr.ip() && a_addr.port() == b_addr.port();
+}
+
+// ===== Batch filter =====
+
+size_t PacketValidator::filter(Packet* packets, SocketAddress* client_addrs, size_t count) {
+    uint8_t table[DUPLICATE_TABLE_SIZE] = {};   // Kept index - window_start + 1, 0 = empty
+    size_t window_start = 0;
+    size_t kept = 0;
+    uint64_t drops[static_cast<size_t>(DropReason::COUNT)] = {};    // Published once per batch
+
+    for (size_t base = 0; base < count; base += VALIDATE_LANES) {
+        size_t lanes = std::min(VALIDATE_LANES, count - base);
+        DropReason verdicts[VALIDATE_LANES];
+        check_lanes(packets + base, lanes, verdicts);
+
+        for (size_t i = base; i < base + lanes; i++) {
+            if (verdicts[i - base] != DropReason::COUNT) {
+                drops[static_cast<size_t>(verdicts[i - base])]++;
+                continue;
+            }
+
+            if (kept - window_start == DUPLICATE_WINDOW) {
+                std::memset(table, 0, sizeof(table));
+                window_start = kept;
+            }
+
+            // Earlier copy among the kept packets of this window?
+            size_t slot = duplicate_slot(packets[i], client_addrs[i].ip());
+            bool duplicate = false;
+            while (table[slot] != 0) {
+                size_t earlier = window_start + table[slot] - 1;
+                if (same_datagram(packets[earlier], client_addrs[earlier], packets[i], client_addrs[i])) {
+                    duplicate = true;
+                    break;
+                }
+                slot = (slot + 1) & (DUPLICATE_TABLE_SIZE - 1);
+            }
+            if (duplicate) {
+                drops[static_cast<size_t>(DropReason::DUPLICATE)]++;
+                continue;
+            }
+
+            if (kept != i) {
+                packets[kept] = packets[i];
+                client_addrs[kept] = client_addrs[i];
+            }
+            table[slot] = static_cast<uint8_t>(kept - window_start + 1);
+            kept++;
+        }
+    }
+
+    for (size_t r = 0; r < static_cast<size_t>(DropReason::COUNT); r++) {
+        if (drops[r] != 0) {
+            dropped[r].fetch_add(drops[r], std::memory_order_relaxed);
+        }
+    }
+    return kept;
+}
+
+void PacketValidator::check_lanes(const Packet* packets, size_t count, DropReason* verdicts) {
+#if defined(__GNUC__)
+    // Gather one byte per check input, then whole-vector loads (unused lanes hold zeros:
+    // type 0, dropped and ignored). Element-wise vector access would go through memory
+    int8_t type_bytes[VALIDATE_LANES] = {};
+    int8_t has_id_bytes[VALIDATE_LANES] = {};
+    int8_t value_high_bytes[VALIDATE_LANES] = {};
+    for (size_t l = 0; l < count; l++) {
+        type_bytes[l] = static_cast<int8_t>(packets[l].type);
+        has_id_bytes[l] = static_cast<int8_t>(packets[l].request_id != 0);
+        value_high_bytes[l] = static_cast<int8_t>(packets[l].payload.request.value >> 24);
+    }
+    LaneBytes types;
+    LaneBytes has_id;
+    LaneBytes value_high;
+    std::memcpy(&types, type_bytes, sizeof(types));
+    std::memcpy(&has_id, has_id_bytes, sizeof(has_id));
+    std::memcpy(&value_high, value_high_bytes, sizeof(value_high));
+
+    // One compare per check for all lanes (-1 = true, 0 = false). MAX_TRANSFER_VALUE is
+    // the signed maximum, so the value bound is the sign of its top byte
+    static_assert(MAX_TRANSFER_VALUE == 0x7FFFFFFF, "value bound is a sign test");
+    LaneBytes is_discovery = types == static_cast<int8_t>(DISCOVERY);
+    LaneBytes is_transfer = types == static_cast<int8_t>(TRANSACTION_REQUEST);
+    LaneBytes is_subscribe = types == static_cast<int8_t>(SUBSCRIBE);
+    LaneBytes is_notify_ack = types == static_cast<int8_t>(CREDIT_NOTIFY_ACK);
+    LaneBytes id_set = has_id != 0;
+    LaneBytes type_ok = is_discovery | is_transfer | is_subscribe | is_notify_ack;
+    LaneBytes bounds_ok = (is_discovery & ~id_set)
+                        | (is_transfer & id_set & (value_high >= 0))
+                        | is_subscribe
+                        | (is_notify_ack & id_set);
+
+    // Verdict bytes selected with the masks, stored straight into verdicts
+    static_assert(sizeof(DropReason) == 1, "verdicts are stored as one byte per lane");
+    LaneBytes lane_verdicts = (~type_ok & static_cast<int8_t>(DropReason::TYPE))
+                            | (type_ok & ~bounds_ok & static_cast<int8_t>(DropReason::BOUNDS))
+                            | (type_ok & bounds_ok & static_cast<int8_t>(DropReason::COUNT));
+    int8_t verdict_bytes[VALIDATE_LANES];
+    std::memcpy(verdict_bytes, &lane_verdicts, sizeof(lane_verdicts));
+    std::memcpy(verdicts, verdict_bytes, count);
+#else
+    // No vector extension: one packet at a time, same checks
+    for (size_t l = 0; l < count; l++) {
+        const Packet& packet = packets[l];
+        bool has_id = packet.request_id != 0;
+        switch (packet.type) {
+            case DISCOVERY:
+                verdicts[l] = has_id ? DropReason::BOUNDS : DropReason::COUNT;
+                break;
+            case TRANSACTION_REQUEST:
+                verdicts[l] = has_id && packet.payload.request.value <= MAX_TRANSFER_VALUE ? DropReason::COUNT : DropReason::BOUNDS;
+                break;
+            case SUBSCRIBE:
+                verdicts[l] = DropReason::COUNT;
+                break;
+            case CREDIT_NOTIFY_ACK:
+                verdicts[l] = has_id ? DropReason::COUNT : DropReason::BOUNDS;
+                break;
+            default:
+                verdicts[l] = DropReason::TYPE;
+                break;
+        }
+    }
+#endif
+}
+
+// ===== Counters =====
+
+DropCounts PacketValidator::snapshot() const {
+    DropCounts counts;
+    for (size_t r = 0; r < static_cast<size_t>(DropReason::COUNT); r++) {
+        counts.counts[r] = dropped[r].load(std::memory_order_relaxed);
+    }
+    return counts;
+}
+
+const char* PacketValidator::reason_name(DropReason reason) {
+    switch (reason) {
+        case DropReason::SIZE: return "size";
+        case DropReason::TYPE: return "type";
+        case DropReason::BOUNDS: return "bounds";
+        case DropReason::DUPLICATE: return "duplicate";
+        default: return "unknown";
+    }
+}
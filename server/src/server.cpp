@@ -1,202 +1,812 @@
 #include "server.h"
 #include "print_utils.h"
+#include "flight_recorder.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <atomic>
 #include <iostream>
 #include <optional>
 #include <thread>
+#include <chrono>
 
-// ===== Static member initialization =====
+// A pipelined client's oldest request must stay inside the sequence gate's window
+static_assert(MAX_REQUESTS_IN_FLIGHT <= SEQUENCE_WINDOW, "requests in flight exceed the server's sequence window");
 
-LockedMap<uint32_t, ClientInfo> Server::clients;
-uint32_t Server::s_num_transactions = 0;
-uint64_t Server::s_total_transferred = 0;
-uint64_t Server::s_total_balance = 0;
-std::mutex Server::s_stats_mutex;
+// A transfer group locks its senders and destinations in one LockedMap group operation
+static_assert(2 * TRANSACTION_GROUP_MAX <= LockedMap<uint32_t, ClientInfo>::GROUP_MAX_KEYS,
+              "transfer group exceeds the accounts one group operation can lock");
+
+/// Open addressing table of the distinct accounts of a transfer group (power of 2, 2 accounts per transfer at most)
+static constexpr size_t ACCOUNT_TABLE_SIZE = 4 * TRANSACTION_GROUP_MAX;
+static constexpr int ACCOUNT_TABLE_SHIFT = 25;  // 32 - log2(ACCOUNT_TABLE_SIZE): top hash bits
+static_assert(ACCOUNT_TABLE_SIZE == size_t(1) << (32 - ACCOUNT_TABLE_SHIFT), "account table size and shift disagree");
+static constexpr uint8_t NO_ACCOUNT_SLOT = 0xFF;
+
+/// Outcome code remembered on the sender's sequence gate for a reply type (SEQUENCE_OUTCOME_PENDING if none)
+static uint8_t outcome_code(PacketType type) {
+    switch (type) {
+        case TRANSACTION_ACK: return 1;
+        case INSUFFICIENT_BALANCE_ACK: return 2;
+        case INVALID_CLIENT_ACK: return 3;
+        default: return SEQUENCE_OUTCOME_PENDING;
+    }
+}
+
+/// Reply type of a remembered outcome code (inverse of outcome_code())
+static PacketType outcome_reply_type(uint8_t outcome) {
+    static const PacketType types[] = {OUTCOME_UNKNOWN_ACK, TRANSACTION_ACK, INSUFFICIENT_BALANCE_ACK, INVALID_CLIENT_ACK};
+    return types[outcome & 0x3];
+}     // Sender of a request without transfer isn't in the group's lock set
+
+#ifdef ZIP_PERF_COUNTERS
+/// Hardware counter averages next to the stats output, every PERF_REPORT_INTERVAL handled requests
+static void count_measured_transactions(size_t count) {
+    static std::atomic<uint64_t> measured_transactions{0};
+    uint64_t before = measured_transactions.fetch_add(count);
+    if (before / PERF_REPORT_INTERVAL != (before + count) / PERF_REPORT_INTERVAL) {
+        PerfTotals totals[static_cast<size_t>(PerfRegion::COUNT)];
+        PerfCounters::snapshot(totals);
+        PrintUtils::print_perf_counters(totals);
+    }
+}
+#endif
 
 // ===== Constructor =====
 
-Server::Server(uint16_t port) : port(port) {
+template<typename Policies>
+BasicServer<Policies>::BasicServer(uint16_t port, size_t expected_clients)
+    : port(port),
+      notifier(server_socket,
+               [this](uint32_t client_ip) -> std::optional<uint32_t> {
+                   std::optional<ClientInfo> info = clients.read(client_ip);
+                   if (!info) return std::nullopt;
+                   return info->balance;
+               },
+               [this](uint32_t client_ip) { clear_subscription(client_ip); }),
+      registered_ips(expected_clients) {
     // Bind socket to port (throws if port already in use or permission denied)
     if (!server_socket.initialize(port, true)) {
         throw std::runtime_error("Failed to initialize UDP socket");
     }
+
+    // Presize clients index so a registration wave never grows it
+    if (expected_clients > 0) {
+        clients.reserve(expected_clients);
+    }
 }
 
 // ===== Main execution =====
 
-void Server::run() {
+template<typename Policies>
+void BasicServer<Policies>::run() {
+    // Single-ledger process: a private runtime serving only this ledger
+    ServerRuntime runtime;
+    runtime.host(*this);
+    runtime.run();
+}
+
+template<typename Policies>
+void BasicServer<Policies>::start() {
     // Print initial state (empty bank at startup)
-    PrintUtils::print_server_state(s_num_transactions, s_total_transferred, s_total_balance);
-    
-    // Enter infinite listening loop (never returns)
-    run_listening_loop();
+    print_state();
+
+    // Credit notification sender (sleeps until a subscriber is credited)
+    if constexpr (Policies::Dispatch::credit_notifications) {
+        std::thread(&CreditNotifier::run, &notifier).detach();
+    }
+
+    // Background sweeper for idle accounts (only if expiry enabled)
+    if (idle_timeout_s > 0) {
+        std::thread(&BasicServer::run_expiry_loop, this).detach();
+    }
+
+#ifdef ZIP_LOCK_CONTENTION
+    // Periodic top-N lock contention report (only if enabled)
+    if (contention_report_s > 0) {
+        std::thread(&BasicServer::run_contention_report_loop, this).detach();
+    }
+#endif
 }
 
-void Server::run_listening_loop() {
-    SocketAddress client_addr;
-    Packet packet;
-    
+template<typename Policies>
+bool BasicServer<Policies>::receive_request(Packet& packet, SocketAddress& client_addr) {
     while (true) {
-        // Blocking receive: waits indefinitely for next packet
+        // Non-blocking receive: 0 = drained, -1 = socket error
         int32_t bytes_received = server_socket.receive(&packet, sizeof(packet), client_addr);
-        
+        if (bytes_received <= 0) return false;
+
         // Validate packet size (prevents processing truncated/malformed packets)
-        // Process valid packets in separate detached threads for concurrency
-        if (bytes_received == sizeof(packet)) {
-            // Spawn worker thread: processes request and terminates automatically
-            // Detached: main thread doesn't wait for completion, continues listening immediately
-            std::thread(&Server::process_request, this, packet, client_addr).detach();
-        }
+        if (bytes_received == sizeof(packet)) return true;
         // Invalid packets are silently discarded (no response sent)
+        validator.count_drop(DropReason::SIZE);
+    }
+}
+
+// ===== Validation and authentication =====
+
+template<typename Policies>
+size_t BasicServer<Policies>::validate(Packet* packets, SocketAddress* client_addrs, size_t count) {
+    size_t kept = validator.filter(packets, client_addrs, count);
+
+    // Summary instead of one line per junk packet (a flood would flood the console too)
+    auto now = std::chrono::steady_clock::now();
+    if (now - last_drop_report >= std::chrono::seconds(DROP_REPORT_INTERVAL_S)) {
+        DropCounts drops = validator.snapshot();
+        if (drops.total() != reported_drops) {
+            PrintUtils::print_dropped(port, drops[DropReason::SIZE], drops[DropReason::TYPE],
+                                      drops[DropReason::BOUNDS], drops[DropReason::DUPLICATE]);
+            reported_drops = drops.total();
+            last_drop_report = now;
+        }
+    }
+    return kept;
+}
+
+template<typename Policies>
+size_t BasicServer<Policies>::authenticate(Packet* packets, SocketAddress* client_addrs, size_t count) {
+    return authenticator.filter(packets, client_addrs, count, [this](const Packet& packet, const SocketAddress& client_addr) {
+        log.rejected(packet, client_addr);
+    });
+}
+
+// ===== Account prefetch =====
+
+template<typename Policies>
+void BasicServer<Policies>::prefetch(const Packet* packets, const SocketAddress* client_addrs, size_t count) {
+    if (clients.size() < PREFETCH_MIN_ACCOUNTS) return;
+
+    uint32_t account_ips[2 * RUNTIME_WORKER_BATCH];
+    for (size_t base = 0; base < count; base += RUNTIME_WORKER_BATCH) {
+        size_t group = std::min(RUNTIME_WORKER_BATCH, count - base);
+        size_t key_count = 0;
+        for (size_t i = base; i < base + group; i++) {
+            account_ips[key_count++] = client_addrs[i].ip();
+            uint32_t dest_client_ip = packets[i].payload.request.destination_ip;
+            if (packets[i].type == TRANSACTION_REQUEST && registered_ips.may_contain(dest_client_ip)) {
+                account_ips[key_count++] = dest_client_ip;
+            }
+        }
+        clients.prefetch(account_ips, key_count);
     }
 }
 
 // ===== Request routing =====
 
-void Server::process_request(const Packet& packet, const SocketAddress& client_addr) {
+template<typename Policies>
+void BasicServer<Policies>::process_group(FlightRecorder& recorder, const Packet* packets, const SocketAddress* client_addrs,
+                                          const uint64_t* receive_ns, size_t count) {
+    // A single request has nothing to overlap with: its own lookups come first anyway
+    if (count > 1) {
+        prefetch(packets, client_addrs, count);
+    }
+
+    for (size_t start = 0; start < count;) {
+        // Consecutive transfers share their locks; any other request ends the run and keeps its place
+        size_t end = start;
+        while (end < count && end - start < TRANSACTION_GROUP_MAX && packets[end].type == TRANSACTION_REQUEST) end++;
+        if (end - start >= 2) {
+            handle_transaction_group(recorder, packets + start, client_addrs + start, receive_ns + start, end - start);
+            start = end;
+            continue;
+        }
+
+        // Stages after dispatch are stamped by the handlers (lock, reply); committed at scope exit
+        FlightRecorder::Scope flight(recorder, receive_ns[start], packets[start], client_addrs[start], port);
+        process_request(packets[start], client_addrs[start]);
+        start++;
+    }
+}
+
+template<typename Policies>
+void BasicServer<Policies>::process_request(const Packet& packet, const SocketAddress& client_addr) {
     // Dispatch to appropriate handler based on packet type
     switch (packet.type) {
         case DISCOVERY:
-            std::cout << "\nReceived DISCOVERY from " << client_addr.ip_string() << std::endl;
-            handle_discovery(client_addr);
+            log.received("DISCOVERY", client_addr);
+            handle_discovery(packet, client_addr);
             break;
         case TRANSACTION_REQUEST:
-            std::cout << "\nReceived TRANSACTION_REQUEST from " << client_addr.ip_string() << std::endl;
+            log.received("TRANSACTION_REQUEST", client_addr);
             handle_transaction(packet, client_addr);
             break;
+        case SUBSCRIBE:
+            log.received("SUBSCRIBE", client_addr);
+            if constexpr (Policies::Dispatch::credit_notifications) {
+                handle_subscribe(client_addr);
+            } else {
+                // Push channel compiled out: client falls back to polling
+                Packet reply_packet = Packet::create_reply(ERROR_ACK, 0, 0);
+                send_reply(reply_packet, client_addr);
+            }
+            break;
+        case CREDIT_NOTIFY_ACK:
+            // Not logged: one per pushed notification
+            if constexpr (Policies::Dispatch::credit_notifications) {
+                notifier.acknowledge(client_addr.ip(), packet.request_id);
+            }
+            break;
         // Other packet types (ACKs) are ignored (server doesn't expect ACKs from clients)
     }
 }
 
 // ===== Discovery handler =====
 
-void Server::handle_discovery(const SocketAddress& client_addr) {    
-    // Attempt to register new client (insert returns false if already exists)
-    if (clients.insert(client_addr.ip(), ClientInfo())) {
-        // New client registered: update global balance to reflect new account
-        // Lock required because s_total_balance is shared across all worker threads
-        std::lock_guard<std::mutex> stats_lock(s_stats_mutex);
-        s_total_balance += CLIENT_INITIAL_BALANCE;
-
-        // Send ACK with default initial values (balance = 100, last_request_id = 0)
-        ClientInfo default_info;
-        Packet reply_packet = Packet::create_reply(DISCOVERY_ACK, default_info.last_processed_request_id, default_info.balance);
-        server_socket.send(&reply_packet, sizeof(reply_packet), client_addr);
-        return;
+template<typename Policies>
+void BasicServer<Policies>::handle_discovery(const Packet& packet, const SocketAddress& client_addr) {
+    Packet reply_packet = execute_discovery(client_addr, packet.auth);
+    send_reply(reply_packet, client_addr);
+}
+
+template<typename Policies>
+Packet BasicServer<Policies>::execute_discovery(const SocketAddress& client_addr, uint64_t cookie) {
+    // Known client: read current state (atomic loads of balance and sequence gate)
+    uint32_t last_processed_request_id = 0;
+    std::optional<ClientInfo> existing = clients.read(client_addr.ip(), last_processed_request_id);
+
+    if (!existing) {
+        // Unknown address: nothing is allocated until it echoes a cookie sent to it
+        // (a spoofed source never receives one)
+        if (!authenticator.valid_cookie(client_addr, cookie)) {
+            Packet reply_packet = Packet::create_reply(DISCOVERY_COOKIE, 0, 0);
+            reply_packet.auth = authenticator.discovery_cookie(client_addr);
+            return reply_packet;
+        }
+
+        // Filter first: a transfer that finds the account must never be rejected by the filter
+        registered_ips.add(client_addr.ip());
+
+        // Attempt to register new client (insert returns false if already exists)
+        if (clients.insert(client_addr.ip(), ClientInfo())) {
+            // New client registered: update global balance to reflect new account
+            // (shared across all worker threads, the Stats policy is thread-safe)
+            stats.add_balance(CLIENT_INITIAL_BALANCE);
+
+            // ACK with default initial values (balance = 100, last_request_id = 0)
+            ClientInfo default_info;
+            Packet reply_packet = Packet::create_reply(DISCOVERY_ACK, 0, default_info.balance);
+            reply_packet.auth = authenticator.session_key(client_addr.ip());
+            return reply_packet;
+        }
+
+        // Registered meanwhile by a duplicate DISCOVERY
+        existing = clients.read(client_addr.ip(), last_processed_request_id);
     }
-    
-    // Client already exists: read current state (uses LockedMap read lock)
-    // Unwrap optional (guaranteed to exist since insert() returned false)
-    ClientInfo client_info = *clients.read(client_addr.ip());
 
-    // Send ACK with current client state (idempotent: repeated discoveries get same response)
-    Packet reply_packet = Packet::create_reply(DISCOVERY_ACK, client_info.last_processed_request_id, client_info.balance);
-    server_socket.send(&reply_packet, sizeof(reply_packet), client_addr);
+    // Falls back to defaults if the account was closed right after insert() returned false
+    ClientInfo client_info = existing.value_or(ClientInfo());
+
+    // Subscribed client may have restarted on a new port: push notifications to the new one
+    if constexpr (Policies::Dispatch::credit_notifications) {
+        if (client_info.notify_credits) {
+            notifier.subscribe(client_addr.ip(), client_addr);
+        }
+    }
+
+    // ACK with current client state (idempotent: repeated discoveries get same response)
+    Packet reply_packet = Packet::create_reply(DISCOVERY_ACK, last_processed_request_id, client_info.balance);
+    reply_packet.auth = authenticator.session_key(client_addr.ip());
+    return reply_packet;
 }
 
 // ===== Transaction handler =====
 
-void Server::handle_transaction(const Packet& packet, const SocketAddress& client_addr) {
-    // Extract IPs in host byte order (packet stores network byte order)
-    uint32_t src_client_ip = client_addr.ip();
-    uint32_t dest_client_ip = packet.payload.request.destination_ip;
+template<typename Policies>
+void BasicServer<Policies>::handle_transaction(const Packet& packet, const SocketAddress& client_addr) {
+    {
+        PERF_SCOPE(PerfRegion::TRANSACTION);
+        std::optional<Packet> reply_packet = execute_transaction(client_addr.ip(), packet);
+        if (reply_packet) {
+            send_reply(*reply_packet, client_addr);
+        }
+    }
+
+#ifdef ZIP_PERF_COUNTERS
+    count_measured_transactions(1);
+#endif
+}
+
+template<typename Policies>
+void BasicServer<Policies>::handle_transaction_group(FlightRecorder& recorder, const Packet* packets,
+                                                     const SocketAddress* client_addrs, const uint64_t* receive_ns,
+                                                     size_t count) {
+    uint64_t dispatch_ns = recorder.now_ns();
+    uint32_t src_client_ips[TRANSACTION_GROUP_MAX];
+    std::optional<Packet> replies[TRANSACTION_GROUP_MAX];
+    bool locked[TRANSACTION_GROUP_MAX];
+    for (size_t i = 0; i < count; i++) {
+        log.received("TRANSACTION_REQUEST", client_addrs[i]);
+        src_client_ips[i] = client_addrs[i].ip();
+    }
+
+    uint64_t lock_ns;
+    {
+        // Same work as handle_transaction() (execution and replies), counted once per request
+        PERF_SCOPE(PerfRegion::TRANSACTION, count);
+        execute_transaction_group(src_client_ips, packets, count, replies, locked);
+        lock_ns = recorder.now_ns();
+
+        // The group's replies leave together (one syscall for the batch, see UDPSocket::send_batch())
+        Packet reply_packets[TRANSACTION_GROUP_MAX];
+        SocketAddress reply_addrs[TRANSACTION_GROUP_MAX];
+        size_t reply_count = 0;
+        uint8_t load = load_hint.load(std::memory_order_relaxed);
+        for (size_t i = 0; i < count; i++) {
+            if (replies[i]) {
+                reply_packets[reply_count] = *replies[i];
+                reply_packets[reply_count].payload.reply.load = load;
+                reply_addrs[reply_count] = client_addrs[i];
+                reply_count++;
+            }
+        }
+        server_socket.send_batch(reply_packets, sizeof(Packet), reply_addrs, reply_count);
+    }
 
-    // ===== Validation Step 1: Source client must exist =====
-    ClientInfo src_client;
-    auto src_opt = clients.read(src_client_ip);
-    if (!src_opt) {
+    // One flight record per request, stamped with the group's times
+    for (size_t i = 0; i < count; i++) {
+        FlightRecorder::Scope flight(recorder, receive_ns[i], packets[i], client_addrs[i], port, dispatch_ns);
+        if (locked[i]) {
+            FlightRecorder::mark_lock_acquired(lock_ns);
+        }
+        if (replies[i]) {
+            FlightRecorder::mark_reply_sent(static_cast<uint8_t>(replies[i]->type));
+        }
+    }
+
+#ifdef ZIP_PERF_COUNTERS
+    count_measured_transactions(count);
+#endif
+}
+
+template<typename Policies>
+std::optional<Packet> BasicServer<Policies>::execute_transaction(uint32_t src_client_ip, const Packet& packet) {
+    // ===== Validation Steps 1+2: Source must exist, duplicate check + request_id claim =====
+    // Single atomic operation on the sender's sequence gate: either the request is a
+    // retransmission (request_id already claimed) or its id is claimed, with no window in between
+    uint32_t last_processed_request_id = 0;
+    SequenceClaim claim = clients.claim_sequence(src_client_ip, packet.request_id, last_processed_request_id);
+    if (claim == SequenceClaim::NOT_FOUND) {
         // Source not registered: should never happen if client followed discovery protocol
-        Packet reply_packet = Packet::create_reply(ERROR_ACK, packet.request_id, 0);
-        server_socket.send(&reply_packet, sizeof(reply_packet), client_addr);
-        return;
+        return Packet::create_reply(ERROR_ACK, packet.request_id, 0);
     }
-    src_client = *src_opt;
 
-    // ===== Validation Step 2: Check for duplicate request (idempotency) =====
-    // If request_id <= last_processed, this is a retransmission of a request we already handled
-    if (packet.request_id <= src_client.last_processed_request_id) {
-        // Send cached response (same ACK as original, prevents double-spending)
-        PrintUtils::print_request(src_client_ip, packet, true, s_num_transactions, s_total_transferred, s_total_balance);
-        Packet reply_packet = Packet::create_reply(TRANSACTION_ACK, src_client.last_processed_request_id, src_client.balance);
-        server_socket.send(&reply_packet, sizeof(reply_packet), client_addr);
-        return;
+    if (claim == SequenceClaim::DUPLICATE) {
+        ClientInfo src_client = clients.read(src_client_ip).value_or(ClientInfo());
+        return duplicate_transaction_reply(src_client_ip, packet, src_client.balance);
     }
+    std::optional<Packet> reply_packet = execute_claimed_transaction(src_client_ip, packet);
+    remember_outcome(src_client_ip, packet, reply_packet);
+    return reply_packet;
+}
 
-    // ===== Update last_processed_request_id BEFORE validation =====
-    // This prevents race condition where same request_id could be processed twice
-    // Example: Two threads process same packet simultaneously, both pass duplicate check
-    // By updating here, second thread will see request as duplicate when it reads
-    src_client.last_processed_request_id = packet.request_id;
-    if (!clients.write(src_client_ip, src_client)) {
-        // Write failed (shouldn't happen unless client was deleted)
-        return;
+template<typename Policies>
+std::optional<Packet> BasicServer<Policies>::duplicate_transaction_reply(uint32_t src_client_ip, const Packet& packet,
+                                                                         uint32_t balance) {
+    // Same reply type as the original (remembered on the sequence gate, nothing applied again)
+    std::optional<uint8_t> outcome = clients.sequence_outcome(src_client_ip, packet.request_id);
+    if (outcome == SEQUENCE_OUTCOME_PENDING) {
+        return std::nullopt;    // Original still running: its own reply is on the way
     }
 
+    // Echoes the request's own id: pipelined clients match replies per request
+    log.request(src_client_ip, packet, true, stats);
+    PacketType type = outcome ? outcome_reply_type(*outcome) : OUTCOME_UNKNOWN_ACK;
+    return Packet::create_reply(type, packet.request_id, balance);
+}
+
+template<typename Policies>
+void BasicServer<Policies>::remember_outcome(uint32_t src_client_ip, const Packet& packet,
+                                             const std::optional<Packet>& reply_packet) {
+    if (reply_packet && outcome_code(reply_packet->type) != SEQUENCE_OUTCOME_PENDING) {
+        clients.record_outcome(src_client_ip, packet.request_id, outcome_code(reply_packet->type));
+    }
+}
+
+template<typename Policies>
+std::optional<Packet> BasicServer<Policies>::execute_claimed_transaction(uint32_t src_client_ip, const Packet& packet) {
+    // Destination IP as sent by the client (network byte order, like the map keys)
+    uint32_t dest_client_ip = packet.payload.request.destination_ip;
+
+    // Current balance: single atomic load of the packed ClientInfo (no entry lock)
+    ClientInfo src_client = clients.read(src_client_ip).value_or(ClientInfo());
+
     // ===== Edge Case: Zero-value transaction (no-op) =====
     if (packet.payload.request.value == 0) {
         // Valid request, but no balance change needed
-        Packet reply_packet = Packet::create_reply(TRANSACTION_ACK, packet.request_id, src_client.balance);
-        server_socket.send(&reply_packet, sizeof(reply_packet), client_addr);
-        return;
+        return Packet::create_reply(TRANSACTION_ACK, packet.request_id, src_client.balance);
     }
 
     // ===== Validation Step 3: Destination client must exist =====
-    ClientInfo dest_client;
-    auto dest_opt = clients.read(dest_client_ip);
-    if (!dest_opt) {
+    // Never-registered IPs (typos, scans) stop at the filter: one atomic load, no index lookup
+    if (!registered_ips.may_contain(dest_client_ip) || !clients.exists(dest_client_ip)) {
         // Destination not registered: client tried to send to non-existent account
-        Packet reply_packet = Packet::create_reply(INVALID_CLIENT_ACK, src_client.last_processed_request_id, src_client.balance);
-        server_socket.send(&reply_packet, sizeof(reply_packet), client_addr);
-        return;
-    } else {
-        dest_client = *dest_opt;
+        return Packet::create_reply(INVALID_CLIENT_ACK, packet.request_id, src_client.balance);
     }
 
     // ===== Edge Case: Self-transfer (no-op) =====
     if (src_client_ip == dest_client_ip) {
         // Sending money to yourself: valid but no balance change
-        Packet reply_packet = Packet::create_reply(TRANSACTION_ACK, src_client.last_processed_request_id, src_client.balance);
-        server_socket.send(&reply_packet, sizeof(reply_packet), client_addr);
-        return;
-    }
-
-    // ===== Validation Step 4: Sufficient balance check =====
-    if (src_client.balance < packet.payload.request.value) {
-        // Insufficient funds: transaction rejected
-        Packet reply_packet = Packet::create_reply(INSUFFICIENT_BALANCE_ACK, src_client.last_processed_request_id, src_client.balance);
-        server_socket.send(&reply_packet, sizeof(reply_packet), client_addr);
-        return;
+        return Packet::create_reply(TRANSACTION_ACK, packet.request_id, src_client.balance);
     }
 
-    // ===== Execute atomic transfer between accounts =====
+    // ===== Validation Step 4 + atomic transfer between accounts =====
     // atomic_pair_operation acquires write locks on BOTH accounts simultaneously
     // Prevents deadlock via fixed locking order (lower IP address locked first)
-    // Lambda executes with exclusive access to both ClientInfo structs
+    // Lambda executes with exclusive access to both balances, so the sufficient-balance
+    // check can't race a concurrent debit of the same sender
     uint32_t client_new_balance;
+    bool has_funds = false;
+    bool notify_dest = false;
     if (!clients.atomic_pair_operation(src_client_ip, dest_client_ip, [&](ClientInfo& src, ClientInfo& dest) {
+        FlightRecorder::mark_lock_acquired();
+        client_new_balance = src.balance;
+        has_funds = src.balance >= packet.payload.request.value;
+        if (!has_funds) return;  // Insufficient funds: leave both accounts untouched
+
         // Debit sender
         src.balance -= packet.payload.request.value;
         // Credit receiver
         dest.balance += packet.payload.request.value;
+        // Subscription flag comes for free with the receiver's word
+        if constexpr (Policies::Dispatch::credit_notifications) {
+            notify_dest = dest.notify_credits;
+        }
         // Capture new balance for ACK response (needed outside lambda scope)
         client_new_balance = src.balance;
     })) {
         // Operation failed (one of the clients was deleted mid-transaction, rare race condition)
-        return;
+        return std::nullopt;
     }
 
-    // ===== Update global bank statistics =====
-    // Lock required: s_num_transactions, s_total_transferred, s_total_balance are shared
-    // Note: s_total_balance doesn't change (money just moved between accounts)
-    {
-        std::lock_guard<std::mutex> stats_lock(s_stats_mutex);
-        s_num_transactions++;                           // Increment successful transaction count
-        s_total_transferred += packet.payload.request.value; // Accumulate total money moved
+    if (!has_funds) {
+        // Insufficient funds: transaction rejected
+        return Packet::create_reply(INSUFFICIENT_BALANCE_ACK, packet.request_id, client_new_balance);
     }
 
-    // ===== Send success ACK with new balance =====
-    Packet reply_packet = Packet::create_reply(TRANSACTION_ACK, src_client.last_processed_request_id, client_new_balance);
-    server_socket.send(&reply_packet, sizeof(reply_packet), client_addr);
+    // ===== Update global bank statistics =====
+    // Counts the transfer and its value
+    // Note: total_balance doesn't change (money just moved between accounts)
+    stats.record_transfer(packet.payload.request.value);
+
+    // ===== Push credit to a subscribed receiver (batched by the notifier thread) =====
+    if constexpr (Policies::Dispatch::credit_notifications) {
+        if (notify_dest) {
+            notifier.notify_credit(dest_client_ip, packet.payload.request.value);
+        }
+    }
 
     // Print transaction summary (uses updated stats from above)
-    PrintUtils::print_request(src_client_ip, packet, false, s_num_transactions, s_total_transferred, s_total_balance);
+    log.request(src_client_ip, packet, false, stats);
+
+    // ===== Success ACK with new balance =====
+    return Packet::create_reply(TRANSACTION_ACK, packet.request_id, client_new_balance);
 }
+
+// ===== Grouped transactions =====
+
+template<typename Policies>
+void BasicServer<Policies>::execute_transaction_group(const uint32_t* src_client_ips, const Packet* packets, size_t count,
+                                                      std::optional<Packet>* replies, bool* locked) {
+    // Larger groups: consecutive chunks, in order
+    if (count > TRANSACTION_GROUP_MAX) {
+        for (size_t base = 0; base < count; base += TRANSACTION_GROUP_MAX) {
+            execute_transaction_group(src_client_ips + base, packets + base, std::min(TRANSACTION_GROUP_MAX, count - base),
+                                      replies + base, locked ? locked + base : nullptr);
+        }
+        return;
+    }
+
+    // What each request does, decided lock-free in arrival order
+    enum class Step : uint8_t {
+        DONE,       // Reply already known (unregistered sender)
+        DUPLICATE,  // Retransmission: cached response
+        NO_OP,      // Zero value or self-transfer: TRANSACTION_ACK with the balance
+        INVALID,    // Unregistered destination: INVALID_CLIENT_ACK
+        TRANSFER    // Balance check, debit and credit under the group's locks
+    };
+    Step steps[TRANSACTION_GROUP_MAX];
+
+    // Distinct accounts of the group (open addressing on the IP, at most a quarter full): an
+    // account repeated in the group (merchant, busy payer) gets one slot and is locked once
+    uint32_t account_ips[2 * TRANSACTION_GROUP_MAX];
+    size_t account_count = 0;
+    uint8_t account_table[ACCOUNT_TABLE_SIZE] = {};     // Slot + 1, 0 = empty
+    auto table_index = [&](uint32_t client_ip) -> size_t {
+        size_t h = (client_ip * 0x9E3779B1u) >> ACCOUNT_TABLE_SHIFT;
+        while (account_table[h] != 0 && account_ips[account_table[h] - 1] != client_ip) {
+            h = (h + 1) & (ACCOUNT_TABLE_SIZE - 1);
+        }
+        return h;
+    };
+    auto account_slot = [&](uint32_t client_ip) -> uint8_t {
+        size_t h = table_index(client_ip);
+        if (account_table[h] == 0) {
+            account_ips[account_count] = client_ip;
+            account_table[h] = static_cast<uint8_t>(++account_count);
+        }
+        return account_table[h] - 1;
+    };
+    uint8_t src_slots[TRANSACTION_GROUP_MAX];       // Requests without a transfer: NO_ACCOUNT_SLOT if the sender isn't locked
+    uint8_t dest_slots[TRANSACTION_GROUP_MAX];
+
+    // ===== Phase 1: claim request_ids and classify (execute_transaction() checks, same order) =====
+    for (size_t i = 0; i < count; i++) {
+        const Packet& packet = packets[i];
+        uint32_t dest_client_ip = packet.payload.request.destination_ip;
+        if (locked) locked[i] = false;
+
+        uint32_t last_processed_request_id = 0;
+        SequenceClaim claim = clients.claim_sequence(src_client_ips[i], packet.request_id, last_processed_request_id);
+        if (claim == SequenceClaim::NOT_FOUND) {
+            replies[i] = Packet::create_reply(ERROR_ACK, packet.request_id, 0);
+            steps[i] = Step::DONE;
+            continue;
+        }
+
+        // Only transfers take locks: a flood of duplicates never touches the balance locks
+        if (claim == SequenceClaim::DUPLICATE) {
+            steps[i] = Step::DUPLICATE;
+        } else if (packet.payload.request.value == 0) {
+            steps[i] = Step::NO_OP;
+        } else if (!registered_ips.may_contain(dest_client_ip) || !clients.exists(dest_client_ip)) {
+            steps[i] = Step::INVALID;
+        } else if (src_client_ips[i] == dest_client_ip) {
+            steps[i] = Step::NO_OP;
+        } else {
+            steps[i] = Step::TRANSFER;
+            src_slots[i] = account_slot(src_client_ips[i]);
+            dest_slots[i] = account_slot(dest_client_ip);
+        }
+    }
+
+    // Requests without a transfer reply with the sender's balance as of their turn: read in
+    // order inside Phase 2 if a transfer of the group locks the sender, else lock-free in
+    // Phase 3 (no transfer of the group changes it, as with execute_transaction())
+    for (size_t i = 0; i < count; i++) {
+        if (steps[i] == Step::DONE || steps[i] == Step::TRANSFER) continue;
+        size_t h = table_index(src_client_ips[i]);
+        src_slots[i] = account_table[h] != 0 ? account_table[h] - 1 : NO_ACCOUNT_SLOT;
+    }
+
+    // ===== Phase 2: every transfer in order under the group's locks (tight loop, no other work) =====
+    uint32_t balances[TRANSACTION_GROUP_MAX];
+    bool has_funds[TRANSACTION_GROUP_MAX] = {};
+    bool notify_dest[TRANSACTION_GROUP_MAX] = {};
+    bool applied = account_count == 0 || clients.atomic_group_operation(account_ips, account_count, [&](ClientInfo* accounts) {
+        for (size_t i = 0; i < count; i++) {
+            if (steps[i] == Step::DONE) continue;
+            if (steps[i] != Step::TRANSFER) {
+                if (src_slots[i] != NO_ACCOUNT_SLOT) balances[i] = accounts[src_slots[i]].balance;
+                continue;
+            }
+            uint32_t value = packets[i].payload.request.value;
+            ClientInfo& src = accounts[src_slots[i]];
+            ClientInfo& dest = accounts[dest_slots[i]];
+            has_funds[i] = src.balance >= value;
+            if (has_funds[i]) {
+                src.balance -= value;
+                dest.balance += value;
+                if constexpr (Policies::Dispatch::credit_notifications) {
+                    notify_dest[i] = dest.notify_credits;
+                }
+            }
+            balances[i] = src.balance;
+        }
+    });
+
+    if (!applied) {
+        // An account was closed before its lock was taken (rare): nothing was applied, so run
+        // the already claimed requests one by one
+        for (size_t i = 0; i < count; i++) {
+            if (steps[i] == Step::DUPLICATE) {
+                ClientInfo src_client = clients.read(src_client_ips[i]).value_or(ClientInfo());
+                replies[i] = duplicate_transaction_reply(src_client_ips[i], packets[i], src_client.balance);
+            } else if (steps[i] != Step::DONE) {
+                replies[i] = execute_claimed_transaction(src_client_ips[i], packets[i]);
+                remember_outcome(src_client_ips[i], packets[i], replies[i]);
+            }
+        }
+        return;
+    }
+
+    // ===== Phase 3: statistics, notifications, log and replies, in request order =====
+    for (size_t i = 0; i < count; i++) {
+        const Packet& packet = packets[i];
+        if ((steps[i] == Step::DUPLICATE || steps[i] == Step::NO_OP || steps[i] == Step::INVALID) &&
+            src_slots[i] == NO_ACCOUNT_SLOT) {
+            // Sender not locked: single atomic load of the packed ClientInfo (no entry lock)
+            balances[i] = clients.read(src_client_ips[i]).value_or(ClientInfo()).balance;
+        }
+        switch (steps[i]) {
+            case Step::DONE:
+                break;
+            case Step::DUPLICATE:
+                replies[i] = duplicate_transaction_reply(src_client_ips[i], packet, balances[i]);
+                break;
+            case Step::NO_OP:
+                replies[i] = Packet::create_reply(TRANSACTION_ACK, packet.request_id, balances[i]);
+                break;
+            case Step::INVALID:
+                replies[i] = Packet::create_reply(INVALID_CLIENT_ACK, packet.request_id, balances[i]);
+                break;
+            case Step::TRANSFER:
+                if (locked) locked[i] = true;
+                if (!has_funds[i]) {
+                    replies[i] = Packet::create_reply(INSUFFICIENT_BALANCE_ACK, packet.request_id, balances[i]);
+                    break;
+                }
+                stats.record_transfer(packet.payload.request.value);
+                if constexpr (Policies::Dispatch::credit_notifications) {
+                    if (notify_dest[i]) {
+                        notifier.notify_credit(packet.payload.request.destination_ip, packet.payload.request.value);
+                    }
+                }
+                log.request(src_client_ips[i], packet, false, stats);
+                replies[i] = Packet::create_reply(TRANSACTION_ACK, packet.request_id, balances[i]);
+                break;
+        }
+        // Remembered in request order: a duplicate later in the group finds it
+        if (steps[i] != Step::DONE && steps[i] != Step::DUPLICATE) {
+            remember_outcome(src_client_ips[i], packet, replies[i]);
+        }
+    }
+}
+
+// ===== Subscription handler =====
+
+template<typename Policies>
+void BasicServer<Policies>::handle_subscribe(const SocketAddress& client_addr) {
+    uint32_t client_ip = client_addr.ip();
+
+    // Subscription must exist before the flag: a transfer that sees the flag queues the credit on it.
+    // The flag is set under the notifier lock, which also covers dropping a lost subscription
+    // and clearing its flag, so an ACKed subscriber always has both
+    if (!notifier.subscribe(client_ip, client_addr, [&] {
+        // Set the flag on the high lane (CAS, never races the balance lane written by transfers)
+        return clients.update(client_ip, [](ClientInfo& info) {
+            if (info.notify_credits) return false;  // Already subscribed: only the address was refreshed
+            info.notify_credits = true;
+            return true;
+        });
+    })) {
+        // Not registered: client must send DISCOVERY first
+        Packet reply_packet = Packet::create_reply(ERROR_ACK, 0, 0);
+        send_reply(reply_packet, client_addr);
+        return;
+    }
+
+    ClientInfo client_info = clients.read(client_ip).value_or(ClientInfo());
+    Packet reply_packet = Packet::create_reply(SUBSCRIBE_ACK, 0, client_info.balance);
+    send_reply(reply_packet, client_addr);
+}
+
+// ===== Replies =====
+
+template<typename Policies>
+void BasicServer<Policies>::send_reply(const Packet& reply_packet, const SocketAddress& client_addr) {
+    Packet stamped_packet = reply_packet;
+    stamped_packet.payload.reply.load = load_hint.load(std::memory_order_relaxed);
+    server_socket.send(&stamped_packet, sizeof(stamped_packet), client_addr);
+    FlightRecorder::mark_reply_sent(static_cast<uint8_t>(reply_packet.type));
+}
+
+template<typename Policies>
+void BasicServer<Policies>::clear_subscription(uint32_t client_ip) {
+    clients.update(client_ip, [](ClientInfo& info) {
+        if (!info.notify_credits) return false;
+        info.notify_credits = false;
+        return true;
+    });
+}
+
+// ===== Account closure and expiry =====
+
+template<typename Policies>
+void BasicServer<Policies>::enable_account_expiry(uint32_t idle_timeout_s, uint32_t balance_sink_ip) {
+    this->idle_timeout_s = idle_timeout_s;
+    this->balance_sink_ip = balance_sink_ip;
+}
+
+template<typename Policies>
+bool BasicServer<Policies>::close_account(uint32_t client_ip) {
+    // erase() waits for in-flight pair operations and captures the final balance
+    std::optional<ClientInfo> final_info = clients.erase(client_ip);
+    if (!final_info) return false;  // Unknown or already closed
+
+    settle_closed_account(client_ip, *final_info);
+    return true;
+}
+
+template<typename Policies>
+void BasicServer<Policies>::settle_closed_account(uint32_t client_ip, const ClientInfo& final_info) {
+    // Credit the sink (single-entry pair operation: balance lane is only written under the entry lock)
+    bool credited_to_sink = false;
+    if (balance_sink_ip != 0 && balance_sink_ip != client_ip) {
+        bool notify_sink = false;
+        credited_to_sink = clients.atomic_pair_operation(balance_sink_ip, balance_sink_ip, [&](ClientInfo& sink, ClientInfo&) {
+            sink.balance += final_info.balance;
+            notify_sink = sink.notify_credits;
+        });
+        if constexpr (Policies::Dispatch::credit_notifications) {
+            if (notify_sink && final_info.balance > 0) {
+                notifier.notify_credit(balance_sink_ip, final_info.balance);
+            }
+        }
+    }
+
+    // No sink: closed funds leave the bank, keep total_balance equal to the live balances
+    if (!credited_to_sink) {
+        stats.remove_balance(final_info.balance);
+    }
+
+    // Entry (and its notify_credits flag) is gone, drop undelivered notifications
+    if constexpr (Policies::Dispatch::credit_notifications) {
+        notifier.unsubscribe(client_ip);
+    }
+
+    std::cout << "\nClosed account " << SocketAddress(client_ip).ip_string()
+              << " balance " << final_info.balance
+              << (credited_to_sink ? " -> sink " + SocketAddress(balance_sink_ip).ip_string() : std::string(" -> retired"))
+              << std::endl;
+    print_state();
+}
+
+template<typename Policies>
+void BasicServer<Policies>::print_state() const {
+    LedgerStats totals = stats.snapshot();
+    PrintUtils::print_server_state(totals.num_transactions, totals.total_transferred, totals.total_balance);
+}
+
+template<typename Policies>
+void BasicServer<Policies>::run_expiry_loop() {
+    auto start_time = std::chrono::steady_clock::now();
+
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::seconds(ACCOUNT_SWEEP_INTERVAL_S));
+
+        // Coarse activity clock: seconds since the sweeper started
+        uint32_t now_s = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::steady_clock::now() - start_time).count());
+        clients.set_activity_stamp(now_s);
+
+        // Keep the sink alive (reading with the sequence gate stamps activity)
+        if (balance_sink_ip != 0) {
+            uint32_t sink_sequence;
+            clients.read(balance_sink_ip, sink_sequence);
+        }
+
+        if (now_s > idle_timeout_s) {
+            clients.erase_idle(now_s - idle_timeout_s, [this](const uint32_t& client_ip, const ClientInfo& final_info) {
+                settle_closed_account(client_ip, final_info);
+            });
+        }
+
+        // Free entries retired by closures once no worker can still reference them
+        EpochReclaimer::instance().collect();
+    }
+}
+
+// ===== Lock Contention Report =====
+
+#ifdef ZIP_LOCK_CONTENTION
+template<typename Policies>
+void BasicServer<Policies>::run_contention_report_loop() {
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::seconds(contention_report_s));
+
+        // Cumulative since startup: a steadily climbing account is a persistent hot spot
+        auto contended = clients.most_contended(CONTENTION_REPORT_TOP_N);
+        PrintUtils::print_contention_header(port, contended.size());
+        for (size_t rank = 0; rank < contended.size(); rank++) {
+            const auto& entry = contended[rank];
+            PrintUtils::print_contention(rank + 1, entry.key, entry.read.contended, entry.write.contended,
+                                         entry.total_wait_ns(), std::max(entry.read.max_wait_ns, entry.write.max_wait_ns));
+        }
+    }
+}
+#endif
+
+// ===== Explicit instantiations (the policy sets served by main and the benchmarks) =====
+
+template class BasicServer<DefaultServerPolicies>;
+template class BasicServer<LeanServerPolicies>;
+template class BasicServer<MinimalServerPolicies>;
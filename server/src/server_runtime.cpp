@@ -0,0 +1,200 @@
+#include "server_runtime.h"
+#include "print_utils.h"
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+
+/// Pool size for a requested worker count (0 = one per hardware thread)
+static size_t resolve_worker_count(size_t worker_count) {
+    // hardware_concurrency() may report 0 when unknown
+    return worker_count != 0 ? worker_count : std::max(1u, std::thread::hardware_concurrency());
+}
+
+// ===== Constructor =====
+
+ServerRuntime::ServerRuntime(size_t worker_count)
+    : worker_count(resolve_worker_count(worker_count)), controller(this->worker_count) {}
+
+void ServerRuntime::host(Ledger& ledger) {
+    ledgers.push_back(&ledger);
+}
+
+bool ServerRuntime::enable_trace(const std::string& path) {
+    return trace.open(path);
+}
+
+// ===== Main execution =====
+
+void ServerRuntime::run() {
+    // Ledger background threads (notifier, expiry) and initial state output
+    for (Ledger* ledger : ledgers) {
+        ledger->start();
+    }
+
+    // SIGUSR1 / stall dumps of recent requests
+    recorder.start();
+
+    // Worker pool shared by all ledgers (runs for the whole process lifetime)
+    for (size_t i = 0; i < worker_count; i++) {
+        workers.emplace_back(&ServerRuntime::run_worker, this);
+    }
+
+    std::vector<const UDPSocket*> sockets;
+    for (Ledger* ledger : ledgers) {
+        sockets.push_back(&ledger->socket());
+    }
+
+    std::vector<size_t> ready;
+
+    while (true) {
+        // Sleep until any ledger socket has data (no spinning, one thread for all ledgers)
+        if (!UDPSocket::wait_readable(sockets, -1, ready)) {
+            std::cerr << "Fatal error: failed to poll ledger sockets" << std::endl;
+            break;
+        }
+
+        // Batch sizes follow the load (recomputed at most every BATCH_CONTROL_INTERVAL_NS)
+        update_batching();
+        size_t drain_batch = controller.drain_batch();
+
+        // Drain each readable socket up to the drain batch, then move on
+        for (size_t index : ready) {
+            Ledger* ledger = ledgers[index];
+            uint64_t drain_start_ns = recorder.now_ns();
+            size_t received = 0;
+            while (received < drain_batch && ledger->receive_request(batch_packets[received], batch_addrs[received])) {
+                received++;
+            }
+
+            // Malformed requests dropped first (cheapest checks), then the MACs of the rest
+            // checked together; forged requests are dropped here
+            size_t valid = ledger->validate(batch_packets, batch_addrs, received);
+            size_t accepted = ledger->authenticate(batch_packets, batch_addrs, valid);
+            if (trace.is_open()) {
+                for (size_t n = 0; n < accepted; n++) {
+                    trace.record(batch_packets[n], batch_addrs[n], ledger->listen_port());
+                }
+            }
+            uint64_t queued_ns = recorder.now_ns();
+            submit(ledger, batch_packets, batch_addrs, accepted, queued_ns);
+            controller.record_drain(received, queued_ns - drain_start_ns);
+        }
+    }
+
+    // Only reached on a polling failure: workers are detached so the process can exit
+    for (std::thread& worker : workers) {
+        worker.detach();
+    }
+}
+
+void ServerRuntime::update_batching() {
+    uint64_t now_ns = recorder.now_ns();
+    if (!controller.update_due(now_ns)) return;
+
+    size_t queue_depth;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        queue_depth = tasks.size();
+    }
+    if (!controller.update(now_ns, queue_depth)) return;
+    uint8_t load_hint = controller.load_hint();
+    for (Ledger* ledger : ledgers) {
+        ledger->set_load_hint(load_hint);
+    }
+    if (batch_report_s == 0) return;
+
+    // Report when due and the parameters moved (an idle server stays quiet)
+    if (now_ns - last_batch_report_ns < static_cast<uint64_t>(batch_report_s) * 1'000'000'000) return;
+    BatchParameters batching = controller.snapshot();
+    if (batching.drain_batch == reported_batching.drain_batch && batching.worker_batch == reported_batching.worker_batch &&
+        batching.max_wait_ns == reported_batching.max_wait_ns && batching.arrival_rate < 1 && reported_batching.arrival_rate < 1) {
+        return;
+    }
+    PrintUtils::print_batching(batching.drain_batch, batching.worker_batch, batching.max_wait_ns / 1000,
+                               static_cast<uint64_t>(batching.arrival_rate), static_cast<uint64_t>(batching.queue_depth),
+                               batching.latency_ns / 1000, batching.load_hint);
+    reported_batching = batching;
+    last_batch_report_ns = now_ns;
+}
+
+// ===== Worker pool =====
+
+void ServerRuntime::submit(Ledger* ledger, const Packet* packets, const SocketAddress* client_addrs, size_t count, uint64_t receive_ns) {
+    if (count == 0) return;
+
+    bool wake_all;
+    {
+        std::lock_guard<std::mutex> lock(queue_mutex);
+        for (size_t n = 0; n < count; n++) {
+            tasks.push_back({ledger, packets[n], client_addrs[n], receive_ns});
+        }
+        // A collecting worker must see its group grow, whichever sleeper the notification reaches
+        wake_all = collecting || count > 1;
+    }
+    if (wake_all) {
+        queue_cv.notify_all();
+    } else {
+        queue_cv.notify_one();
+    }
+}
+
+void ServerRuntime::run_worker() {
+    Ledger* group_ledgers[RUNTIME_WORKER_BATCH];
+    Packet packets[RUNTIME_WORKER_BATCH];
+    SocketAddress client_addrs[RUNTIME_WORKER_BATCH];
+    uint64_t receive_ns[RUNTIME_WORKER_BATCH];
+
+    while (true) {
+        size_t taken;
+        {
+            std::unique_lock<std::mutex> lock(queue_mutex);
+            queue_cv.wait(lock, [this] { return !tasks.empty() && !collecting; });
+
+            size_t group_max = controller.worker_batch();
+            uint64_t max_wait_ns = controller.max_wait_ns();
+            if (max_wait_ns > 0 && tasks.size() < group_max) {
+                // Flush delay (busy server): let the group fill rather than run a partial one,
+                // bounded by the controller's share of the latency target
+                collecting = true;
+                size_t waiting = tasks.size();
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::nanoseconds(max_wait_ns);
+                queue_cv.wait_until(lock, deadline, [this, group_max] { return tasks.size() >= group_max; });
+                collecting = false;
+                controller.record_wait(tasks.size() - waiting);
+                taken = std::min(tasks.size(), group_max);
+                if (tasks.size() > taken) {
+                    queue_cv.notify_one();  // Sleepers skipped the queue while the group was collecting
+                }
+            } else {
+                // Fair share of the queue: a burst is spread over the workers, not taken by the first awake
+                size_t share = (tasks.size() + worker_count - 1) / worker_count;
+                taken = std::min(share, group_max);
+            }
+            for (size_t n = 0; n < taken; n++) {
+                const Task& task = tasks.front();
+                group_ledgers[n] = task.ledger;
+                packets[n] = task.packet;
+                client_addrs[n] = task.client_addr;
+                receive_ns[n] = task.receive_ns;
+                tasks.pop_front();
+            }
+        }
+
+        // Consecutive requests of the same ledger form one group
+        uint64_t start_ns = recorder.now_ns();
+        for (size_t start = 0; start < taken;) {
+            size_t end = start + 1;
+            while (end < taken && group_ledgers[end] == group_ledgers[start]) end++;
+            group_ledgers[start]->process_group(recorder, packets + start, client_addrs + start, receive_ns + start, end - start);
+            start = end;
+        }
+
+        // Service time and receive-to-reply latency for the batch controller
+        uint64_t done_ns = recorder.now_ns();
+        uint64_t latency_sum_ns = 0;
+        for (size_t n = 0; n < taken; n++) {
+            latency_sum_ns += done_ns - receive_ns[n];
+        }
+        controller.record_group(taken, done_ns - start_ns, latency_sum_ns);
+    }
+}
@@ -0,0 +1,142 @@
+#include "session_auth.h"
+#include <chrono>
+#include <random>
+
+// Lanes only pay off with 64-bit vector rotates (AVX2/AVX-512): emulated on SSE2, they are
+// slower than one packet at a time
+#if defined(__GNUC__) && (defined(__AVX2__) || defined(__AVX512F__))
+#define SESSION_AUTH_LANES_VECTOR 1
+#endif
+
+#ifdef SESSION_AUTH_LANES_VECTOR
+/// AUTH_LANES 64-bit words in one vector (GCC/Clang vector extension: AVX-512, AVX2 or SSE2 ops)
+typedef uint64_t LaneWords __attribute__((vector_size(AUTH_LANES * sizeof(uint64_t))));
+
+// Vectors only passed by reference: their by-value ABI depends on the enabled instruction set
+static inline void rotl_lanes(LaneWords& x, int bits) {
+    x = (x << bits) | (x >> (64 - bits));
+}
+
+static inline void sip_round_lanes(LaneWords& v0, LaneWords& v1, LaneWords& v2, LaneWords& v3) {
+    v0 += v1; rotl_lanes(v1, 13); v1 ^= v0; rotl_lanes(v0, 32);
+    v2 += v3; rotl_lanes(v3, 16); v3 ^= v2;
+    v0 += v3; rotl_lanes(v3, 21); v3 ^= v0;
+    v2 += v1; rotl_lanes(v1, 17); v1 ^= v2; rotl_lanes(v2, 32);
+}
+
+/**
+ * @brief SipHash-2-4 of AUTH_LANES independent messages, one per lane.
+ *
+ * Same computation as PacketAuth::siphash24(), every step applied to all lanes at once.
+ * @param words words[w] = word w of every lane's message (word_count words each).
+ * @param out [OUT] Hash of each lane.
+ */
+static void siphash24_lanes(const LaneWords& k0, const LaneWords& k1, const LaneWords* words, size_t word_count, LaneWords& out) {
+    LaneWords v0 = k0 ^ PacketAuth::SIP_INIT_0;
+    LaneWords v1 = k1 ^ PacketAuth::SIP_INIT_1;
+    LaneWords v2 = k0 ^ PacketAuth::SIP_INIT_2;
+    LaneWords v3 = k1 ^ PacketAuth::SIP_INIT_3;
+
+    for (size_t w = 0; w < word_count; w++) {
+        v3 ^= words[w];
+        sip_round_lanes(v0, v1, v2, v3);
+        sip_round_lanes(v0, v1, v2, v3);
+        v0 ^= words[w];
+    }
+
+    uint64_t last = static_cast<uint64_t>(word_count * 8) << 56;
+    v3 ^= last;
+    sip_round_lanes(v0, v1, v2, v3);
+    sip_round_lanes(v0, v1, v2, v3);
+    v0 ^= last;
+
+    v2 ^= 0xff;
+    for (int i = 0; i < 4; i++) {
+        sip_round_lanes(v0, v1, v2, v3);
+    }
+    out = v0 ^ v1 ^ v2 ^ v3;
+}
+#endif
+
+// ===== Constructor =====
+
+SessionAuthenticator::SessionAuthenticator() {
+    std::random_device entropy;
+    secret0 = (static_cast<uint64_t>(entropy()) << 32) | entropy();
+    secret1 = (static_cast<uint64_t>(entropy()) << 32) | entropy();
+    cookie_secret0 = (static_cast<uint64_t>(entropy()) << 32) | entropy();
+    cookie_secret1 = (static_cast<uint64_t>(entropy()) << 32) | entropy();
+}
+
+// ===== Keys and verification =====
+
+uint64_t SessionAuthenticator::session_key(uint32_t client_ip) const {
+    uint64_t word = client_ip;
+    return PacketAuth::siphash24(secret0, secret1, &word, 1);
+}
+
+// ===== Discovery cookies =====
+
+uint64_t SessionAuthenticator::discovery_cookie(const SocketAddress& client_addr) const {
+    return cookie_for(client_addr, cookie_epoch());
+}
+
+bool SessionAuthenticator::valid_cookie(const SocketAddress& client_addr, uint64_t cookie) const {
+    if (cookie == 0) return false;  // First DISCOVERY of a client
+    uint64_t epoch = cookie_epoch();
+    return cookie == cookie_for(client_addr, epoch) || cookie == cookie_for(client_addr, epoch - 1);
+}
+
+uint64_t SessionAuthenticator::cookie_for(const SocketAddress& client_addr, uint64_t epoch) const {
+    uint64_t words[2] = {client_addr.ip() | (static_cast<uint64_t>(client_addr.port()) << 32), epoch};
+    return PacketAuth::siphash24(cookie_secret0, cookie_secret1, words, 2);
+}
+
+uint64_t SessionAuthenticator::cookie_epoch() {
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(now).count()) / COOKIE_EPOCH_S;
+}
+
+// ===== Request verification =====
+
+void SessionAuthenticator::verify_lanes(const Packet* packets, const SocketAddress* client_addrs, size_t count, bool* valid) const {
+    uint64_t macs[AUTH_LANES];
+#ifdef SESSION_AUTH_LANES_VECTOR
+    // Gather into lanes (unused lanes hash zeros, cheaper than a scalar tail)
+    LaneWords ips = {};
+    LaneWords messages[PacketAuth::MESSAGE_WORDS] = {};
+    for (size_t l = 0; l < count; l++) {
+        ips[l] = client_addrs[l].ip();
+        uint64_t words[PacketAuth::MESSAGE_WORDS];
+        PacketAuth::message_words(packets[l], words);
+        for (size_t w = 0; w < PacketAuth::MESSAGE_WORDS; w++) {
+            messages[w][l] = words[w];
+        }
+    }
+
+    // Session keys of the senders (same derivation as session_key()), then MACs under them
+    LaneWords secret0_lanes = {};
+    LaneWords secret1_lanes = {};
+    secret0_lanes += secret0;
+    secret1_lanes += secret1;
+    LaneWords keys;
+    siphash24_lanes(secret0_lanes, secret1_lanes, &ips, 1, keys);
+    LaneWords tweaked_keys = keys ^ PacketAuth::SESSION_KEY_TWEAK;
+    LaneWords lane_macs;
+    siphash24_lanes(keys, tweaked_keys, messages, PacketAuth::MESSAGE_WORDS, lane_macs);
+    for (size_t l = 0; l < count; l++) {
+        macs[l] = lane_macs[l];
+    }
+#else
+    // No 64-bit vector rotates (or no vector extension): one packet at a time, MAC-less types skipped
+    for (size_t l = 0; l < count; l++) {
+        if (PacketAuth::requires_mac(packets[l].type)) {
+            macs[l] = PacketAuth::mac(session_key(client_addrs[l].ip()), packets[l]);
+        }
+    }
+#endif
+
+    for (size_t l = 0; l < count; l++) {
+        valid[l] = !PacketAuth::requires_mac(packets[l].type) || macs[l] == packets[l].auth;
+    }
+}
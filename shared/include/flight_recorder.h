@@ -0,0 +1,240 @@
+#pragma once
+#include "packet.h"
+#include "udp_socket.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Default ring size per worker thread (64 bytes each: 256 KB per thread)
+constexpr size_t FLIGHT_RECORDS_PER_THREAD = 4096;
+
+/// Minimum time between two latency-triggered dumps (a stall storm writes one file, not hundreds)
+constexpr uint32_t FLIGHT_STALL_DUMP_INTERVAL_MS = 1000;
+
+/// How often the dumper thread checks for a pending SIGUSR1 (signal handlers can't notify)
+constexpr uint32_t FLIGHT_DUMP_POLL_MS = 100;
+
+/// Current dump file format
+constexpr uint32_t FLIGHT_FORMAT_VERSION = 1;
+
+/**
+ * @brief ### Why a dump was written.
+ */
+enum class FlightDumpReason : uint32_t {
+    SIGNAL = 1,     ///< SIGUSR1 (operator request)
+    STALL = 2       ///< A request exceeded the latency threshold
+};
+
+/**
+ * @brief ### One request with its per-stage timestamps (64 bytes).
+ *
+ * Times are nanoseconds since the recorder started (steady clock; see FlightDumpHeader for
+ * the wall-clock origin). A stage that didn't happen is 0.
+ */
+struct FlightRecord {
+    uint64_t receive_ns;            ///< Datagram read by the I/O thread
+    uint64_t dispatch_ns;           ///< Worker picked it from the queue
+    uint64_t lock_ns;               ///< Account locks acquired (transfers only; grouped transfers: group's locks released)
+    uint64_t reply_ns;              ///< Reply handed to the socket
+    uint64_t done_ns;               ///< Worker finished the request
+    uint32_t source_ip;             ///< Sender (network byte order)
+    uint32_t destination_ip;        ///< Transfer destination (network byte order, 0 otherwise)
+    uint32_t request_id;            ///< Request id as sent
+    uint32_t value;                 ///< Transfer value as sent
+    uint16_t source_port;           ///< Sender port (host byte order)
+    uint16_t ledger_port;           ///< Ledger that served it (host byte order)
+    uint8_t request_type;           ///< PacketType of the request
+    uint8_t outcome;                ///< PacketType of the reply (0 = no reply)
+    uint16_t thread_index;          ///< Recording worker (order of first request)
+};
+
+static_assert(sizeof(FlightRecord) == 64, "FlightRecord layout is part of the dump file format");
+
+/**
+ * @brief ### Header at the start of every dump file, followed by record_count records.
+ */
+struct FlightDumpHeader {
+    char magic[8];                  ///< "ZIPFLITE"
+    uint32_t version;               ///< FLIGHT_FORMAT_VERSION
+    uint32_t record_size;           ///< sizeof(FlightRecord)
+    uint64_t origin_unix_ns;        ///< Wall-clock time of timestamp 0
+    uint32_t reason;                ///< FlightDumpReason
+    uint32_t thread_count;          ///< Worker rings included
+    uint64_t trigger_latency_ns;    ///< STALL: latency of the triggering request (0 otherwise)
+    uint64_t record_count;          ///< Records that follow (sorted by receive_ns)
+};
+
+/**
+ * @brief ### Always-on flight recorder of the most recent requests, dumped on demand.
+ *
+ * Each worker thread owns a ring of the last records_per_thread requests, written with no
+ * lock and no allocation (a per-slot sequence number lets the dumper skip slots being
+ * overwritten). A dump writes every ring, merged by receive time, to a binary file:
+ * - On SIGUSR1 (POSIX only)
+ * - When a request takes longer than the stall threshold from receive to done
+ *   (at most once per FLIGHT_STALL_DUMP_INTERVAL_MS)
+ *
+ * Stage timestamps come from the request's worker thread: Scope opens the record,
+ * mark_lock_acquired() and mark_reply_sent() fill stages from deep in the request path
+ * (no-ops on threads without an open record, e.g. benchmarks), and Scope's destructor
+ * commits it. Decode dumps with the flight_decode tool.
+ */
+class FlightRecorder {
+public:
+    /**
+     * @brief ### Creates a stopped recorder.
+     * @param records_per_thread Ring size per worker thread.
+     */
+    explicit FlightRecorder(size_t records_per_thread = FLIGHT_RECORDS_PER_THREAD);
+    ~FlightRecorder();
+
+    FlightRecorder(const FlightRecorder&) = delete;
+    FlightRecorder& operator=(const FlightRecorder&) = delete;
+
+    /**
+     * @brief ### Sets the latency that triggers a dump (call before start()).
+     * @param threshold_ms Receive-to-done latency in milliseconds (0 = signal dumps only).
+     */
+    void set_stall_threshold(uint32_t threshold_ms);
+
+    /**
+     * @brief ### Sets the directory dump files are written to (call before start()).
+     * @param directory Existing directory (default: current directory).
+     */
+    void set_dump_directory(const std::string& directory);
+
+    /**
+     * @brief ### Installs the SIGUSR1 handler and starts the dumper thread.
+     */
+    void start();
+
+    /// Nanoseconds since the recorder was created (record timestamp base)
+    uint64_t now_ns() const;
+
+    /**
+     * @brief ### Records one request on the calling worker thread for its lifetime.
+     *
+     * Usage:
+     *   FlightRecorder::Scope flight(recorder, receive_ns, packet, client_addr, ledger_port);
+     *   ledger->process_request(packet, client_addr);   // marks stages
+     */
+    class Scope {
+    public:
+        Scope(FlightRecorder& recorder, uint64_t receive_ns, const Packet& packet,
+              const SocketAddress& client_addr, uint16_t ledger_port);
+
+        /// Same, for a request already executed as part of a group: dispatch_ns is when the group started
+        Scope(FlightRecorder& recorder, uint64_t receive_ns, const Packet& packet,
+              const SocketAddress& client_addr, uint16_t ledger_port, uint64_t dispatch_ns);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        FlightRecorder& recorder;
+        FlightRecord record{};
+    };
+
+    /**
+     * @brief ### Stamps the lock stage of the calling thread's open record (if any).
+     */
+    static void mark_lock_acquired();
+
+    /**
+     * @brief ### Stamps the lock stage with a time taken earlier (grouped transfers, see Scope).
+     * @param lock_ns Recorder time (now_ns()).
+     */
+    static void mark_lock_acquired(uint64_t lock_ns);
+
+    /**
+     * @brief ### Stamps the reply stage and outcome of the calling thread's open record (if any).
+     * @param reply_type PacketType of the reply sent.
+     */
+    static void mark_reply_sent(uint8_t reply_type);
+
+private:
+    /// One ring slot: sequence is odd while the record is being written
+    struct Slot {
+        std::atomic<uint64_t> sequence{0};
+        FlightRecord record{};
+    };
+
+    /// One worker thread's ring (single writer)
+    struct ThreadRing {
+        explicit ThreadRing(size_t capacity, uint16_t index) : slots(capacity), index(index) {}
+        std::vector<Slot> slots;
+        uint64_t next = 0;          ///< Records written so far (writer only)
+        uint16_t index;             ///< FlightRecord::thread_index
+    };
+
+    /// [Worker thread] Ring of the calling thread (created on its first request)
+    ThreadRing& thread_ring();
+
+    /// [Worker thread] Publishes a finished record and checks the stall threshold
+    void commit(const FlightRecord& record);
+
+    /// [Dumper thread] Waits for requests and writes dumps
+    void run_dumper();
+
+    /// [Dumper thread] Writes all rings to a new dump file
+    void dump(FlightDumpReason reason, uint64_t trigger_latency_ns);
+
+    size_t records_per_thread;                      ///< Ring capacity
+    uint64_t stall_threshold_ns = 0;                ///< 0 = disabled
+    std::string dump_directory = ".";               ///< Where dump files go
+    std::chrono::steady_clock::time_point origin;   ///< Timestamp 0
+    uint64_t origin_unix_ns;                        ///< Wall-clock time of origin
+
+    std::mutex rings_mutex;                         ///< Protects rings (registration and dump)
+    std::vector<std::unique_ptr<ThreadRing>> rings; ///< One per worker that recorded something
+
+    std::mutex dump_mutex;                          ///< Protects the stall request fields
+    std::condition_variable dump_cv;                ///< Wakes the dumper on a stall
+    bool stall_pending = false;                     ///< Stall dump requested
+    uint64_t stall_latency_ns = 0;                  ///< Latency of the triggering request
+    std::chrono::steady_clock::time_point last_stall_dump;
+    uint32_t dump_count = 0;                        ///< Dump file sequence number
+    std::atomic<bool> stopping{false};              ///< Tells the dumper to exit
+    std::thread dumper;                             ///< Background dump writer
+};
+
+/**
+ * @brief ### Reader for dump files written by FlightRecorder.
+ */
+class FlightDumpReader {
+public:
+    FlightDumpReader() = default;
+    ~FlightDumpReader();
+
+    FlightDumpReader(const FlightDumpReader&) = delete;
+    FlightDumpReader& operator=(const FlightDumpReader&) = delete;
+
+    /**
+     * @brief ### Opens a dump and validates its header.
+     * @param path Dump file.
+     * @return False if the file is missing or not a compatible dump.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief ### Reads the next record.
+     * @param record [OUT] Next record (receive order).
+     * @return False at end of file (or on a truncated last record).
+     */
+    bool next(FlightRecord& record);
+
+    /// Header of the open dump
+    const FlightDumpHeader& header() const { return file_header; }
+
+private:
+    std::FILE* file = nullptr;          ///< Input file
+    FlightDumpHeader file_header{};     ///< Validated header
+};
@@ -0,0 +1,165 @@
+#pragma once
+#include "udp_socket.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+/// Environment variable holding the impairment spec (read once, on the first send)
+constexpr const char* IMPAIRMENT_ENV_VAR = "ZIP_IMPAIR";
+
+/**
+ * @brief ### Shape of the random extra delay added to each datagram.
+ */
+enum class DelayDistribution : uint8_t {
+    UNIFORM,    ///< delay +/- jitter, flat
+    NORMAL,     ///< Gaussian around delay, jitter = standard deviation
+    PARETO      ///< delay + heavy tail scaled by jitter (occasional very late packets)
+};
+
+/**
+ * @brief ### Impairment settings, netem-like.
+ *
+ * Spec string (comma-separated key=value, any subset):
+ *   loss=5,dup=1,reorder=10,delay=20,jitter=5,dist=normal,gap=10,seed=7
+ * - loss, dup, reorder: probabilities in percent (a trailing '%' is accepted)
+ * - delay, jitter, gap: milliseconds
+ * - dist: uniform | normal | pareto
+ * - seed: RNG seed (0 = random per process; fixed = same decisions for the same send order)
+ */
+struct ImpairmentConfig {
+    double loss_percent = 0;            ///< Datagram silently dropped
+    double duplicate_percent = 0;       ///< Datagram sent twice (each copy delayed independently)
+    double reorder_percent = 0;         ///< Datagram held back an extra reorder_gap_ms, so later ones overtake it
+    uint32_t delay_ms = 0;              ///< Base one-way delay
+    uint32_t jitter_ms = 0;             ///< Spread of the delay (see DelayDistribution)
+    uint32_t reorder_gap_ms = 10;       ///< Extra hold-back of reordered datagrams
+    DelayDistribution distribution = DelayDistribution::UNIFORM;
+    uint64_t seed = 0;                  ///< RNG seed (0 = random)
+
+    /**
+     * @brief ### Parses a spec string (see struct documentation).
+     * @param spec Spec string, e.g. "loss=5,delay=20,jitter=5".
+     * @param config [OUT] Parsed settings (unchanged on failure).
+     * @return False on an unknown key or malformed value.
+     */
+    static bool parse(const std::string& spec, ImpairmentConfig& config);
+
+    /**
+     * @brief ### Returns true if any impairment is configured.
+     */
+    bool enabled() const;
+
+    /**
+     * @brief ### Returns the settings in spec format (for startup logs).
+     */
+    std::string to_string() const;
+};
+
+/**
+ * @brief ### Process-wide impairment of outgoing UDP datagrams, for testing on one machine.
+ *
+ * Loopback never drops or reorders, so retransmission and duplicate handling can't be
+ * measured without help. When enabled, every UDPSocket::send() in the process goes through
+ * here and may be dropped, duplicated, delayed or reordered. Only sends are impaired:
+ * set ZIP_IMPAIR on the client for the request path and on the server for the reply path.
+ *
+ * Enabling:
+ * - Environment: ZIP_IMPAIR="loss=5,delay=20,jitter=5" (read on the first send)
+ * - Code: NetImpairment::configure(config) before sockets start sending
+ *
+ * Delayed datagrams wait in a due-time queue drained by one background thread (started on
+ * the first delayed datagram). Closing a socket discards its pending datagrams. With no
+ * impairment configured, send() only pays one relaxed atomic load.
+ */
+class NetImpairment {
+public:
+    /**
+     * @brief ### Returns true if sends must go through impair() (reads the environment once).
+     */
+    static bool active();
+
+    /**
+     * @brief ### Replaces the settings (call before traffic starts; overrides the environment).
+     * @param config Settings; a config with nothing enabled turns impairment off.
+     */
+    static void configure(const ImpairmentConfig& config);
+
+    /**
+     * @brief ### Applies loss/duplication/delay/reordering to one datagram.
+     *
+     * Datagrams without delay are sent right away on the calling thread.
+     *
+     * @param socket Sending socket (must stay open until its pending datagrams are sent or forgotten).
+     * @param data Datagram bytes (copied if delayed).
+     * @param size Datagram size.
+     * @param dest_addr Destination.
+     * @return False only if an immediate send failed (drops look like successful sends, as on a real network).
+     */
+    static bool impair(UDPSocket& socket, const void* data, size_t size, const SocketAddress& dest_addr);
+
+    /**
+     * @brief ### Discards pending delayed datagrams of a socket (called when it closes).
+     * @param socket Socket being closed.
+     */
+    static void forget(const UDPSocket& socket);
+
+    /// Counters since start (for test summaries)
+    struct Stats {
+        uint64_t sent = 0;          ///< Datagrams handed to impair()
+        uint64_t dropped = 0;       ///< Lost
+        uint64_t duplicated = 0;    ///< Extra copies sent
+        uint64_t delayed = 0;       ///< Copies that went through the delay queue
+        uint64_t reordered = 0;     ///< Copies held back by reorder_gap_ms
+    };
+
+    /**
+     * @brief ### Returns a snapshot of the counters.
+     */
+    static Stats stats();
+
+private:
+    /// One datagram copy waiting for its due time
+    struct Pending {
+        std::chrono::steady_clock::time_point due;  ///< When to send
+        uint64_t sequence;                          ///< Tie-break: equal due times keep send order
+        UDPSocket* socket;                          ///< Sender (entries removed by forget())
+        SocketAddress dest_addr;                    ///< Destination
+        std::vector<uint8_t> data;                  ///< Datagram copy
+
+        bool operator>(const Pending& other) const {
+            return due != other.due ? due > other.due : sequence > other.sequence;
+        }
+    };
+
+    NetImpairment();
+
+    /// Never destroyed: the delay thread may still run during static destruction
+    static NetImpairment& instance();
+
+    /// Extra delay of one copy (locked: uses the shared RNG)
+    std::chrono::microseconds draw_delay();
+
+    /// Random decision with a percent probability (locked)
+    bool chance(double percent);
+
+    /// [Delay thread] Sends queued copies when they are due
+    void run_delay_thread();
+
+    std::atomic<bool> enabled{false};   ///< Hot-path flag checked by active()
+    ImpairmentConfig config;            ///< Current settings (protected by mutex)
+
+    std::mutex mutex;                   ///< Protects config, rng, queue, counters and the thread start
+    std::condition_variable queue_cv;   ///< Wakes the delay thread on new or earlier entries
+    std::vector<Pending> queue;         ///< Min-heap on (due, sequence) (vector so forget() can erase)
+    uint64_t next_sequence = 0;         ///< Pending::sequence source
+    bool thread_started = false;        ///< Delay thread runs (detached, for the process lifetime)
+
+    std::mt19937_64 rng;                ///< Decisions and delays
+    Stats counters;                     ///< See Stats
+};
@@ -6,11 +6,15 @@
  * 
  * Values are powers of 2 to allow bitmasking in future extensions.
  * Currently unused for bitmasking, but provides clear separation between types.
+ * 
+ * Types with the high bit set (0x80) belong to the server push channel (credit
+ * notifications). They are numbered sequentially inside that range.
  */
 enum PacketType : uint8_t {
     // Discovery phase
     DISCOVERY = 1,                  ///< Client -> Server: Request to register/discover server
     DISCOVERY_ACK = 2,              ///< Server -> Client: Confirmation with client's current state
+    DISCOVERY_COOKIE = 3,           ///< Server -> Client: Unknown address, repeat DISCOVERY echoing this cookie
     
     // Transaction phase
     TRANSACTION_REQUEST = 4,        ///< Client -> Server: Request to transfer funds
@@ -19,9 +23,30 @@ enum PacketType : uint8_t {
     TRANSACTION_ACK = 8,            ///< Server -> Client: Transaction successful
     INSUFFICIENT_BALANCE_ACK = 16,  ///< Server -> Client: Transaction rejected (not enough funds)
     INVALID_CLIENT_ACK = 32,        ///< Server -> Client: Transaction rejected (destination doesn't exist)
-    ERROR_ACK = 64                  ///< Server -> Client: Transaction rejected (server error)
+    ERROR_ACK = 64,                 ///< Server -> Client: Transaction rejected (server error)
+    OUTCOME_UNKNOWN_ACK = 128,      ///< Server -> Client: Retransmission of a request processed too long ago
+                                    ///< to recall its result (applied or rejected: check the balance)
+
+    // Push channel (credit notifications)
+    SUBSCRIBE = 0x81,               ///< Client -> Server: Push CREDIT_NOTIFY when this client is credited
+    SUBSCRIBE_ACK = 0x82,           ///< Server -> Client: Subscription active, with client's current balance
+    CREDIT_NOTIFY = 0x83,           ///< Server -> Client: Batch of incoming credits (retransmitted until acked)
+    CREDIT_NOTIFY_ACK = 0x84        ///< Client -> Server: Confirms a CREDIT_NOTIFY (echoes its request_id)
 };
 
+/// Requests a client may have in flight (request_ids spanning at most this many values):
+/// the server accepts any unclaimed request_id that close to the highest one it has seen
+constexpr uint32_t MAX_REQUESTS_IN_FLIGHT = 32;
+
+/// Largest transfer value a request may carry (the signed range of the client's input):
+/// the server drops requests above it before dispatch
+constexpr uint32_t MAX_TRANSFER_VALUE = 0x7FFFFFFF;
+
+/// Load hint of a server at its latency target (ReplyPayload::load): below it the server has
+/// headroom, above it requests queue up (LOAD_HINT_MAX = twice the target or worse)
+constexpr uint8_t LOAD_HINT_TARGET = 128;
+constexpr uint8_t LOAD_HINT_MAX = 255;
+
 /**
  * @brief ### Payload for transaction request packets (client -> server).
  * 
@@ -30,7 +55,7 @@ enum PacketType : uint8_t {
  */
 struct RequestPayload {
     uint32_t destination_ip;    ///< Destination client's IP (network byte order, use ntohl() to read)
-    uint32_t value;             ///< Amount to transfer (non-negative, validated by server)
+    uint32_t value;             ///< Amount to transfer (0 to MAX_TRANSFER_VALUE, validated by server)
 };
 
 /**
@@ -42,6 +67,19 @@ struct RequestPayload {
 struct ReplyPayload {
     uint32_t new_balance;       ///< Sender's balance after transaction (or current balance for DISCOVERY_ACK)
                                 ///< For error ACKs, contains balance before failed transaction attempt
+    uint8_t load;               ///< Server load when the reply was sent (0 = idle, LOAD_HINT_TARGET = at its
+                                ///< latency target), set by the server's send path; clients pace on it
+};
+
+/**
+ * @brief ### Payload for credit notifications (server -> client).
+ * 
+ * Used when packet.type == CREDIT_NOTIFY.
+ * One notification summarizes every credit received during a batching window.
+ */
+struct NotifyPayload {
+    uint32_t credited;          ///< Sum of the credits covered by this notification
+    uint32_t new_balance;       ///< Receiver's balance when the notification was sent
 };
 
 /**
@@ -53,12 +91,16 @@ struct ReplyPayload {
  * - request_id is managed by client (monotonically increasing, starts at 1)
  * - Server uses request_id for duplicate detection (idempotency)
  * - Payload is a union (only one variant is valid depending on packet type)
+ * - auth carries the request MAC (client -> server) or the session key (DISCOVERY_ACK),
+ *   see packet_auth.h
  * 
- * Size: 1 byte (type) + 4 bytes (request_id) + 8 bytes (union) = 13 bytes
+ * Size: 1 byte (type) + 4 bytes (request_id) + 8 bytes (union) + 8 bytes (auth) = 21 bytes
+ * of fields, 24 bytes on the wire with alignment padding
  */
 struct Packet {
     PacketType type;            ///< Discriminator for the Payload union (determines which variant is valid)
     uint32_t request_id;        ///< Sequence number for idempotency (0 = DISCOVERY, 1+ = transactions)
+                                ///< For CREDIT_NOTIFY: server's per-receiver notification number (1+)
     
     /**
      * @brief ### Tagged union containing packet-specific data.
@@ -66,14 +108,21 @@ struct Packet {
      * Only one member is valid at a time:
      * - request: valid when type is TRANSACTION_REQUEST
      * - reply: valid when type is any ACK variant
+     * - notify: valid when type is CREDIT_NOTIFY
      * 
-     * DISCOVERY packets don't use the payload (both variants are ignored).
+     * DISCOVERY packets don't use the payload (all variants are ignored).
      */
     union {
         RequestPayload request; ///< Valid for TRANSACTION_REQUEST packets
         ReplyPayload reply;     ///< Valid for all ACK packets (DISCOVERY_ACK, TRANSACTION_ACK, etc.)
+        NotifyPayload notify;   ///< Valid for CREDIT_NOTIFY packets
     } payload;
 
+    /// TRANSACTION_REQUEST, SUBSCRIBE, CREDIT_NOTIFY_ACK: MAC under the session key (PacketAuth::sign)
+    /// DISCOVERY_ACK: the client's session key. DISCOVERY_COOKIE: the cookie, echoed by the
+    /// next DISCOVERY (0 on a first DISCOVERY). Other types: 0
+    uint64_t auth;
+
     /**
      * @brief ### Factory method for creating request packets (client -> server).
      * 
@@ -93,6 +142,18 @@ struct Packet {
         p.request_id = request_id;
         p.payload.request.destination_ip = dest_ip;
         p.payload.request.value = value;
+        p.auth = 0;  // Unsigned: PacketAuth::sign() once the session key is known
+        return p;
+    }
+
+    /**
+     * @brief ### Factory method for DISCOVERY packets.
+     * @param cookie auth of the server's DISCOVERY_COOKIE to echo (0 for a first DISCOVERY).
+     * @return Initialized DISCOVERY packet ready to send
+     */
+    static Packet create_discovery(uint64_t cookie = 0) {
+        Packet p = create_request(DISCOVERY, 0, 0, 0);
+        p.auth = cookie;
         return p;
     }
 
@@ -101,10 +162,13 @@ struct Packet {
      * 
      * Use this for all ACK types:
      * - DISCOVERY_ACK: balance = current client balance
+     * - DISCOVERY_COOKIE: balance = 0
+     * - SUBSCRIBE_ACK: balance = current client balance
      * - TRANSACTION_ACK: balance = sender's new balance after debit
      * - INSUFFICIENT_BALANCE_ACK: balance = sender's balance (unchanged)
      * - INVALID_CLIENT_ACK: balance = sender's balance (unchanged)
      * - ERROR_ACK: balance = sender's balance (unchanged)
+     * - OUTCOME_UNKNOWN_ACK: balance = sender's current balance
      * 
      * @param type ACK packet type (DISCOVERY_ACK, TRANSACTION_ACK, etc.)
      * @param request_id Echo of the request_id from the original request
@@ -116,6 +180,26 @@ struct Packet {
         p.type = type;
         p.request_id = request_id;
         p.payload.reply.new_balance = balance;
+        p.payload.reply.load = 0;   // Stamped when sent
+        p.auth = 0;
+        return p;
+    }
+
+    /**
+     * @brief ### Factory method for credit notifications (server -> client).
+     * 
+     * @param notify_id Per-receiver notification number (client acks it with CREDIT_NOTIFY_ACK)
+     * @param credited Sum of the credits covered by this notification
+     * @param new_balance Receiver's current balance
+     * @return Initialized CREDIT_NOTIFY packet ready to send
+     */
+    static Packet create_notify(uint32_t notify_id, uint32_t credited, uint32_t new_balance) {
+        Packet p;
+        p.type = CREDIT_NOTIFY;
+        p.request_id = notify_id;
+        p.payload.notify.credited = credited;
+        p.payload.notify.new_balance = new_balance;
+        p.auth = 0;
         return p;
     }
 };
@@ -0,0 +1,104 @@
+#pragma once
+#include "packet.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+/**
+ * @brief ### Per-packet authentication of client requests (SipHash-2-4 MAC).
+ *
+ * Accounts are keyed by source IP, so without a MAC any host could spoof a client's
+ * address and spend its balance. Each ledger derives a 64-bit session key per client IP
+ * from its own random secret and returns it in DISCOVERY_ACK (Packet::auth). From then on
+ * the client signs every TRANSACTION_REQUEST, SUBSCRIBE and CREDIT_NOTIFY_ACK with it, and
+ * the ledger drops requests whose MAC doesn't match before they reach the accounts.
+ *
+ * Threat model: off-path spoofing. The key travels in clear to the client's address, so a
+ * host that can read the client's traffic can also sign for it. DISCOVERY stays
+ * unauthenticated (it is how the key is obtained, and its reply goes to the claimed IP).
+ *
+ * The MAC covers the packet fields (type, request_id, payload), never the padding bytes.
+ * A SipHash key is 128 bits; a session key k is used as (k, k ^ SESSION_KEY_TWEAK), so it
+ * fits in DISCOVERY_ACK while keeping 64 bits of secret.
+ */
+namespace PacketAuth {
+    /// Second key half of a session (ASCII "ZIPSESSN")
+    constexpr uint64_t SESSION_KEY_TWEAK = 0x5A49505345535345ull;
+
+    /// 64-bit words of message MACed per request
+    constexpr size_t MESSAGE_WORDS = 2;
+
+    // SipHash initialization constants ("somepseudorandomlygeneratedbytes")
+    constexpr uint64_t SIP_INIT_0 = 0x736f6d6570736575ull;
+    constexpr uint64_t SIP_INIT_1 = 0x646f72616e646f6dull;
+    constexpr uint64_t SIP_INIT_2 = 0x6c7967656e657261ull;
+    constexpr uint64_t SIP_INIT_3 = 0x7465646279746573ull;
+
+    inline uint64_t rotl(uint64_t x, int bits) {
+        return (x << bits) | (x >> (64 - bits));
+    }
+
+    /// One SipRound on the four state words
+    inline void sip_round(uint64_t& v0, uint64_t& v1, uint64_t& v2, uint64_t& v3) {
+        v0 += v1; v1 = rotl(v1, 13); v1 ^= v0; v0 = rotl(v0, 32);
+        v2 += v3; v3 = rotl(v3, 16); v3 ^= v2;
+        v0 += v3; v3 = rotl(v3, 21); v3 ^= v0;
+        v2 += v1; v1 = rotl(v1, 17); v1 ^= v2; v2 = rotl(v2, 32);
+    }
+
+    /**
+     * @brief ### SipHash-2-4 of a message made of whole 64-bit words.
+     *
+     * Same result as reference SipHash-2-4 over the words' little-endian bytes
+     * (message length 8 * count).
+     */
+    inline uint64_t siphash24(uint64_t k0, uint64_t k1, const uint64_t* words, size_t count) {
+        uint64_t v0 = k0 ^ SIP_INIT_0;
+        uint64_t v1 = k1 ^ SIP_INIT_1;
+        uint64_t v2 = k0 ^ SIP_INIT_2;
+        uint64_t v3 = k1 ^ SIP_INIT_3;
+
+        for (size_t i = 0; i < count; i++) {
+            v3 ^= words[i];
+            sip_round(v0, v1, v2, v3);
+            sip_round(v0, v1, v2, v3);
+            v0 ^= words[i];
+        }
+
+        // Final block: only the length byte (no partial word)
+        uint64_t last = static_cast<uint64_t>(count * 8) << 56;
+        v3 ^= last;
+        sip_round(v0, v1, v2, v3);
+        sip_round(v0, v1, v2, v3);
+        v0 ^= last;
+
+        v2 ^= 0xff;
+        for (int i = 0; i < 4; i++) {
+            sip_round(v0, v1, v2, v3);
+        }
+        return v0 ^ v1 ^ v2 ^ v3;
+    }
+
+    /// True for the client requests that must carry a MAC
+    inline bool requires_mac(uint8_t type) {
+        return type == TRANSACTION_REQUEST || type == SUBSCRIBE || type == CREDIT_NOTIFY_ACK;
+    }
+
+    /// Message of a packet: [type | request_id << 32, payload]
+    inline void message_words(const Packet& packet, uint64_t words[MESSAGE_WORDS]) {
+        words[0] = static_cast<uint64_t>(packet.type) | (static_cast<uint64_t>(packet.request_id) << 32);
+        std::memcpy(&words[1], &packet.payload, sizeof(words[1]));
+    }
+
+    /// MAC of a packet under a session key
+    inline uint64_t mac(uint64_t session_key, const Packet& packet) {
+        uint64_t words[MESSAGE_WORDS];
+        message_words(packet, words);
+        return siphash24(session_key, session_key ^ SESSION_KEY_TWEAK, words, MESSAGE_WORDS);
+    }
+
+    /// Stores the packet's MAC in packet.auth (call after the last field change, e.g. renumbering)
+    inline void sign(Packet& packet, uint64_t session_key) {
+        packet.auth = mac(session_key, packet);
+    }
+}
@@ -0,0 +1,141 @@
+#pragma once
+#include "packet.h"
+#include "udp_socket.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+
+/// Records buffered in memory before the flusher thread falls behind and records get dropped
+constexpr size_t TRACE_RING_CAPACITY = 1 << 16;
+
+/// Flusher thread sleep when the ring is empty (milliseconds)
+constexpr uint32_t TRACE_FLUSH_INTERVAL_MS = 2;
+
+/**
+ * @brief ### Header at the start of every trace file.
+ *
+ * Raw host-endian structs: traces are replayed on the same architecture they were captured on.
+ */
+struct TraceFileHeader {
+    char magic[8];                  ///< "ZIPTRACE"
+    uint32_t version;               ///< TRACE_FORMAT_VERSION
+    uint32_t record_size;           ///< sizeof(TraceRecord) (rejects traces from incompatible builds)
+    uint64_t start_unix_ns;         ///< Wall-clock time of timestamp_ns == 0 (for humans and tools)
+};
+
+/// Current trace file format
+constexpr uint32_t TRACE_FORMAT_VERSION = 2;
+
+/**
+ * @brief ### One received datagram in a trace file (40 bytes).
+ */
+struct TraceRecord {
+    uint64_t timestamp_ns;          ///< Receive time, nanoseconds since the trace was opened (steady clock)
+    uint32_t source_ip;             ///< Sender IP (network byte order, like SocketAddress::ip())
+    uint16_t source_port;           ///< Sender port (host byte order)
+    uint16_t ledger_port;           ///< Port of the ledger that received it (host byte order)
+    Packet packet;                  ///< Packet exactly as received
+};
+
+static_assert(sizeof(TraceRecord) == 40, "TraceRecord layout is part of the trace file format");
+
+/**
+ * @brief ### Captures received packets into a binary trace file without slowing the receiver.
+ *
+ * The receiving thread only copies a 40-byte record into a lock-free single-producer ring
+ * (no lock, no syscall, no allocation); a background thread writes the ring to disk. If
+ * the disk can't keep up and the ring fills, new records are dropped and counted rather
+ * than stalling the receiver.
+ *
+ * Thread safety:
+ * - record() must be called by one thread at a time (the runtime's I/O thread)
+ * - open()/close() must not race record()
+ *
+ * The file is flushed every TRACE_FLUSH_INTERVAL_MS, so a killed server loses at most the
+ * last few milliseconds of traffic.
+ */
+class PacketTraceWriter {
+public:
+    PacketTraceWriter() = default;
+    ~PacketTraceWriter() { close(); }
+
+    PacketTraceWriter(const PacketTraceWriter&) = delete;
+    PacketTraceWriter& operator=(const PacketTraceWriter&) = delete;
+
+    /**
+     * @brief ### Creates the trace file, writes its header and starts the flusher thread.
+     * @param path Output file (truncated if it exists).
+     * @return False if the file couldn't be created or a trace is already open.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief ### Flushes buffered records and closes the file. Idempotent.
+     */
+    void close();
+
+    /// True between a successful open() and close()
+    bool is_open() const { return file != nullptr; }
+
+    /**
+     * @brief ### Appends a received packet to the trace (wait-free, single producer).
+     * @param packet Packet as received.
+     * @param source_addr Sender's address.
+     * @param ledger_port Port of the receiving ledger.
+     */
+    void record(const Packet& packet, const SocketAddress& source_addr, uint16_t ledger_port);
+
+    /// Records dropped because the ring was full
+    uint64_t dropped() const { return dropped_records.load(std::memory_order_relaxed); }
+
+private:
+    /// [Flusher thread] Writes ring contents to the file until close()
+    void run_flusher();
+
+    std::FILE* file = nullptr;                      ///< Output file (owned by the flusher while open)
+    std::chrono::steady_clock::time_point start;    ///< timestamp_ns origin
+    std::unique_ptr<TraceRecord[]> ring;            ///< TRACE_RING_CAPACITY records
+    std::thread flusher;                            ///< Background writer
+    std::atomic<bool> stopping{false};              ///< Tells the flusher to drain and exit
+
+    alignas(64) std::atomic<uint64_t> head{0};      ///< Next slot to fill (written by the producer only)
+    alignas(64) std::atomic<uint64_t> tail{0};      ///< Next slot to write out (written by the flusher only)
+    alignas(64) std::atomic<uint64_t> dropped_records{0};
+};
+
+/**
+ * @brief ### Sequential reader for trace files written by PacketTraceWriter.
+ */
+class PacketTraceReader {
+public:
+    PacketTraceReader() = default;
+    ~PacketTraceReader();
+
+    PacketTraceReader(const PacketTraceReader&) = delete;
+    PacketTraceReader& operator=(const PacketTraceReader&) = delete;
+
+    /**
+     * @brief ### Opens a trace and validates its header.
+     * @param path Trace file.
+     * @return False if the file is missing or not a compatible trace.
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief ### Reads the next record.
+     * @param record [OUT] Next record in capture order.
+     * @return False at end of file (or on a truncated last record).
+     */
+    bool next(TraceRecord& record);
+
+    /// Header of the open trace
+    const TraceFileHeader& header() const { return file_header; }
+
+private:
+    std::FILE* file = nullptr;      ///< Input file
+    TraceFileHeader file_header{};  ///< Validated header
+};
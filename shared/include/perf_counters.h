@@ -0,0 +1,77 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief ### Hot paths measured by hardware performance counters.
+ *
+ * Regions nest (a transaction contains map operations and a socket send), so each region's
+ * totals are inclusive of the regions inside it.
+ */
+enum class PerfRegion : uint8_t {
+    TRANSACTION,    ///< Server::handle_transaction / handle_transaction_group (execution and reply send, one call per request)
+    LOCKED_MAP,     ///< LockedMap lookups, claims, updates and pair operations
+    SOCKET,         ///< UDPSocket::send / UDPSocket::receive
+    COUNT
+};
+
+/// Handled transaction requests (any reply, duplicates and rejections included) between two
+/// counter reports in the server's stats output
+constexpr uint32_t PERF_REPORT_INTERVAL = 1000;
+
+/**
+ * @brief ### Counter totals of one region, summed over all threads.
+ */
+struct PerfTotals {
+    uint64_t calls = 0;             ///< Measured executions
+    uint64_t cycles = 0;            ///< CPU cycles
+    uint64_t instructions = 0;      ///< Retired instructions
+    uint64_t cache_misses = 0;      ///< Last-level cache misses
+    uint64_t branch_misses = 0;     ///< Mispredicted branches
+};
+
+#ifdef ZIP_PERF_COUNTERS
+
+/**
+ * @brief ### Counts cycles, instructions, cache misses and branch misses over its lifetime.
+ *
+ * Linux perf_event_open(): each thread lazily opens one counter group for itself (user and
+ * kernel space if perf_event_paranoid allows it, user space only otherwise) and adds the
+ * deltas of every scope to its per-region totals. Each scope costs two read() syscalls, so
+ * absolute numbers include that overhead; compare regions and builds, not wall time.
+ *
+ * Compiled only with -DZIP_PERF_COUNTERS=ON; otherwise PERF_SCOPE() expands to nothing.
+ */
+class PerfScope {
+public:
+    /// @param calls Executions the scope covers (e.g. the requests of a group measured at once)
+    explicit PerfScope(PerfRegion region, uint64_t calls = 1);
+    ~PerfScope();
+
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+
+private:
+    PerfRegion region;
+    uint64_t calls;
+    uint64_t start[4];      ///< Counter values at construction (cycles, instructions, cache, branch)
+    bool active;            ///< False if this thread has no counters (unsupported or denied)
+};
+
+namespace PerfCounters {
+    /**
+     * @brief ### Returns the totals of every region over all threads.
+     * @param totals [OUT] Indexed by PerfRegion (PerfRegion::COUNT entries).
+     */
+    void snapshot(PerfTotals totals[static_cast<size_t>(PerfRegion::COUNT)]);
+}
+
+#define PERF_SCOPE_CONCAT_(a, b) a##b
+#define PERF_SCOPE_NAME_(line) PERF_SCOPE_CONCAT_(perf_scope_, line)
+#define PERF_SCOPE(...) PerfScope PERF_SCOPE_NAME_(__LINE__)(__VA_ARGS__)
+
+#else
+
+#define PERF_SCOPE(...) ((void)0)
+
+#endif
@@ -1,5 +1,6 @@
 #pragma once
 #include "packet.h"
+#include "perf_counters.h"
 #include <cstdint>
 
 /**
@@ -33,13 +34,77 @@ namespace PrintUtils {
      * 
      * @param client_ip Source client's IP in host byte order (will be converted to dotted notation)
      * @param packet The TRANSACTION_REQUEST packet (contains dest_ip and value)
-     * @param is_duplicate True if request_id <= last_processed_request_id (duplicate retransmission)
+     * @param is_duplicate True if request_id was already claimed (duplicate retransmission)
      * @param num_transactions Current transaction count (unchanged if duplicate)
      * @param total_transferred Current total transferred (unchanged if duplicate)
      * @param total_balance Current total balance (invariant: remains constant across transactions)
      */
     void print_request(uint32_t client_ip, const Packet& packet, bool is_duplicate, uint32_t num_transactions, uint64_t total_transferred, uint64_t total_balance);
 
+    /**
+     * @brief ### [Server] Prints hardware counter averages per transaction (ZIP_PERF_COUNTERS builds).
+     * 
+     * Output format (one line per region):
+     * "YYYY-MM-DD HH:MM:SS perf <region> calls_per_tx X cycles Y instructions Z ipc W cache_misses V branch_misses U"
+     * Every value is the region total divided by the number of measured transactions, so
+     * nested regions (locked_map, socket) show their share of one transaction.
+     * 
+     * @param totals Region totals from PerfCounters::snapshot(), indexed by PerfRegion
+     */
+    void print_perf_counters(const PerfTotals* totals);
+
+    /**
+     * @brief ### [Server] Prints the header of a lock contention report.
+     * 
+     * Output format: "YYYY-MM-DD HH:MM:SS contention port P top N"
+     * 
+     * @param port Ledger port (identifies the ledger in multi-ledger processes)
+     * @param count Accounts listed below (0 = no account ever waited for a lock)
+     */
+    void print_contention_header(uint16_t port, size_t count);
+
+    /**
+     * @brief ### [Server] Prints one account of a lock contention report.
+     * 
+     * Output format: "  #R <IP> contended_reads X contended_writes Y wait_total_us Z max_wait_us W"
+     * 
+     * @param rank Position in the report (1 = longest total wait)
+     * @param client_ip Account IP in network byte order
+     * @param contended_reads lock_read() calls that waited
+     * @param contended_writes lock_write() calls that waited
+     * @param wait_ns Total wait of both modes (nanoseconds)
+     * @param max_wait_ns Longest single wait (nanoseconds)
+     */
+    void print_contention(size_t rank, uint32_t client_ip, uint64_t contended_reads, uint64_t contended_writes, uint64_t wait_ns, uint64_t max_wait_ns);
+
+    /**
+     * @brief ### [Server] Prints the malformed requests a ledger dropped so far, per reason.
+     * 
+     * Output format: "YYYY-MM-DD HH:MM:SS dropped port P size A type B bounds C duplicate D"
+     * 
+     * @param port Ledger port (identifies the ledger in multi-ledger processes)
+     * @param size Datagrams of the wrong size
+     * @param type Requests of a type clients don't send
+     * @param bounds Requests with a field out of protocol range
+     * @param duplicate Copies of an earlier request of the same batch
+     */
+    void print_dropped(uint16_t port, uint64_t size, uint64_t type, uint64_t bounds, uint64_t duplicate);
+
+    /**
+     * @brief ### [Server] Prints the runtime's current batching parameters and the load behind them.
+     * 
+     * Output format: "YYYY-MM-DD HH:MM:SS batching drain D group G wait_us W rate R queue Q latency_us L load H"
+     * 
+     * @param drain_batch Datagrams read from one socket per wakeup
+     * @param worker_batch Most requests a worker takes at once
+     * @param max_wait_us How long an idle worker waits for its group to fill
+     * @param arrival_rate Received datagrams per second
+     * @param queue_depth Requests waiting for a worker
+     * @param latency_us Mean receive-to-reply time
+     * @param load_hint Load sent in replies (LOAD_HINT_TARGET = at the latency target)
+     */
+    void print_batching(size_t drain_batch, size_t worker_batch, uint64_t max_wait_us, uint64_t arrival_rate, uint64_t queue_depth, uint64_t latency_us, uint8_t load_hint);
+
     /**
      * @brief ### [Client] Prints transaction result after receiving TRANSACTION_ACK.
      * 
@@ -53,6 +118,19 @@ namespace PrintUtils {
      * @param new_balance Client's updated balance after debit (from TRANSACTION_ACK payload)
      */
     void print_reply(uint32_t server_ip, uint32_t request_id, uint32_t dest_ip, uint32_t value, uint32_t new_balance);
+
+    /**
+     * @brief ### [Client] Prints a pushed credit notification.
+     * 
+     * Output format: "YYYY-MM-DD HH:MM:SS server <IP> id_notify X credited Y new_balance Z"
+     * Called once per CREDIT_NOTIFY (retransmissions are filtered by the caller).
+     * 
+     * @param server_ip Server's IP in network byte order (will be converted to dotted notation)
+     * @param notify_id Server's notification number (from CREDIT_NOTIFY request_id)
+     * @param credited Sum of the credits covered by the notification
+     * @param new_balance Client's balance when the notification was sent
+     */
+    void print_credit(uint32_t server_ip, uint32_t notify_id, uint32_t credited, uint32_t new_balance);
     
     /**
      * @brief ### [Client] Prints server discovery confirmation.
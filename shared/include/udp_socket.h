@@ -2,6 +2,7 @@
 #include <cstdint>
 #include <mutex>
 #include <string>
+#include <vector>
 
 #ifdef _WIN32
     #include <winsock2.h>
@@ -145,13 +146,15 @@ public:
      * Configuration applied:
      * - Non-blocking mode (receive() returns immediately if no data)
      * - SO_BROADCAST enabled if is_broadcast=true (allows 255.255.255.255)
-     * - Binds to INADDR_ANY (0.0.0.0, accepts packets on all interfaces)
+     * - Binds to bind_ip, INADDR_ANY by default (0.0.0.0, accepts packets on all interfaces)
      * - Binds to specified port (0 = OS assigns random available port)
      * 
      * On Windows: Initializes Winsock2 on first call (process-wide).
      * 
      * @param port Port number to bind (host byte order). Use 0 for random port assignment.
      * @param is_broadcast True to enable broadcast (required for client discovery phase).
+     * @param bind_ip Local IP to bind (network byte order, 0 = all interfaces). Lets one host
+     *                act as several clients, e.g. 127.x.y.z loopback addresses.
      * @return True if socket created and bound successfully, false on any failure.
      * 
      * Failure reasons:
@@ -159,7 +162,7 @@ public:
      * - Insufficient permissions (ports < 1024 require root/admin)
      * - Network subsystem unavailable
      */
-    bool initialize(uint16_t port, bool is_broadcast = false);
+    bool initialize(uint16_t port, bool is_broadcast = false, uint32_t bind_ip = 0);
 
     /**
      * @brief ### Sends UDP datagram to specified destination. Thread-safe.
@@ -177,9 +180,26 @@ public:
      * - Socket not initialized
      * - Network unreachable
      * - Destination port not listening (no error in UDP, packet silently dropped)
+     * 
+     * If network impairment is enabled (ZIP_IMPAIR, see NetImpairment), the datagram may be
+     * dropped, duplicated, delayed or reordered before it reaches the OS.
      */
     bool send(const void* data, size_t size, const SocketAddress& dest_addr);
 
+    /**
+     * @brief ### Sends count datagrams of the same size, each to its own destination. Thread-safe.
+     * 
+     * One sendmmsg() call under one send_mutex acquisition on Linux (one syscall for a whole
+     * reply batch); one send() per datagram on other platforms or with network impairment.
+     * 
+     * @param data count datagrams of size bytes each, back to back.
+     * @param size Bytes per datagram.
+     * @param dest_addrs Destination of each datagram (count entries).
+     * @param count Number of datagrams (0 sends nothing).
+     * @return Number of datagrams written to the OS send buffer (count unless an error occurred).
+     */
+    size_t send_batch(const void* data, size_t size, const SocketAddress* dest_addrs, size_t count);
+
     /**
      * @brief ### Receives UDP datagram from socket (non-blocking). Thread-safe.
      * 
@@ -201,6 +221,19 @@ public:
      */
     int32_t receive(void* buffer, size_t size, SocketAddress& sender_addr);
 
+    /**
+     * @brief ### Blocks until at least one socket has a datagram to read (or timeout).
+     * 
+     * Replaces spinning on receive() for non-blocking sockets: one thread can sleep on
+     * many sockets at once (poll() on Linux, WSAPoll() on Windows).
+     * 
+     * @param sockets Sockets to watch (must be initialized).
+     * @param timeout_ms Maximum wait in milliseconds (-1 = wait indefinitely).
+     * @param ready [OUT] Indices (into sockets) of readable sockets (empty on timeout/interruption).
+     * @return False on a polling error, true otherwise.
+     */
+    static bool wait_readable(const std::vector<const UDPSocket*>& sockets, int32_t timeout_ms, std::vector<size_t>& ready);
+
     /**
      * @brief ### Closes the socket and releases OS resources.
      * 
@@ -215,6 +248,13 @@ public:
     void close_socket();
 
 private:
+    friend class NetImpairment;
+
+    /**
+     * @brief ### Hands the datagram to the OS (send() without impairment).
+     */
+    bool send_direct(const void* data, size_t size, const SocketAddress& dest_addr);
+
     socket_t sock_fd = INVALID_SOCKET_VALUE;  ///< Socket handle (platform-independent)
     
     mutable std::mutex send_mutex;      ///< Serializes send() calls (allows one send at a time)
@@ -0,0 +1,247 @@
+#include "flight_recorder.h"
+#include <algorithm>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+#ifdef _WIN32
+    #include <process.h>
+    #define get_process_id() _getpid()
+#else
+    #include <unistd.h>
+    #define get_process_id() getpid()
+#endif
+
+static const char FLIGHT_MAGIC[8] = {'Z', 'I', 'P', 'F', 'L', 'I', 'T', 'E'};
+
+/// Set by the SIGUSR1 handler, consumed by the dumper thread (lock-free atomics are signal-safe)
+static std::atomic<bool> signal_dump_requested{false};
+
+/// Open record of the calling worker thread and its recorder (nullptr outside a Scope)
+static thread_local FlightRecord* open_record = nullptr;
+static thread_local const FlightRecorder* open_recorder = nullptr;
+
+#ifdef SIGUSR1
+static void on_dump_signal(int) {
+    signal_dump_requested.store(true, std::memory_order_relaxed);
+}
+#endif
+
+// ===== Constructor / Destructor =====
+
+FlightRecorder::FlightRecorder(size_t records_per_thread)
+    : records_per_thread(std::max<size_t>(1, records_per_thread)),
+      origin(std::chrono::steady_clock::now()),
+      origin_unix_ns(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::system_clock::now().time_since_epoch()).count())) {}
+
+FlightRecorder::~FlightRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(dump_mutex);
+        stopping.store(true);
+    }
+    dump_cv.notify_all();
+    if (dumper.joinable()) dumper.join();
+}
+
+void FlightRecorder::set_stall_threshold(uint32_t threshold_ms) {
+    stall_threshold_ns = static_cast<uint64_t>(threshold_ms) * 1000000;
+}
+
+void FlightRecorder::set_dump_directory(const std::string& directory) {
+    dump_directory = directory;
+}
+
+void FlightRecorder::start() {
+#ifdef SIGUSR1
+    std::signal(SIGUSR1, on_dump_signal);
+#endif
+    dumper = std::thread(&FlightRecorder::run_dumper, this);
+}
+
+uint64_t FlightRecorder::now_ns() const {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - origin).count());
+}
+
+// ===== Recording (worker threads) =====
+
+FlightRecorder::Scope::Scope(FlightRecorder& recorder, uint64_t receive_ns, const Packet& packet,
+                             const SocketAddress& client_addr, uint16_t ledger_port)
+    : Scope(recorder, receive_ns, packet, client_addr, ledger_port, recorder.now_ns()) {}
+
+FlightRecorder::Scope::Scope(FlightRecorder& recorder, uint64_t receive_ns, const Packet& packet,
+                             const SocketAddress& client_addr, uint16_t ledger_port, uint64_t dispatch_ns)
+    : recorder(recorder) {
+    record.receive_ns = receive_ns;
+    record.dispatch_ns = dispatch_ns;
+    record.source_ip = client_addr.ip();
+    record.source_port = client_addr.port();
+    record.ledger_port = ledger_port;
+    record.request_type = static_cast<uint8_t>(packet.type);
+    record.request_id = packet.request_id;
+    if (packet.type == TRANSACTION_REQUEST) {
+        record.destination_ip = packet.payload.request.destination_ip;
+        record.value = packet.payload.request.value;
+    }
+
+    open_record = &record;
+    open_recorder = &recorder;
+}
+
+FlightRecorder::Scope::~Scope() {
+    record.done_ns = recorder.now_ns();
+    open_record = nullptr;
+    open_recorder = nullptr;
+    recorder.commit(record);
+}
+
+void FlightRecorder::mark_lock_acquired() {
+    if (open_record) open_record->lock_ns = open_recorder->now_ns();
+}
+
+void FlightRecorder::mark_lock_acquired(uint64_t lock_ns) {
+    if (open_record) open_record->lock_ns = lock_ns;
+}
+
+void FlightRecorder::mark_reply_sent(uint8_t reply_type) {
+    if (!open_record) return;
+    open_record->reply_ns = open_recorder->now_ns();
+    open_record->outcome = reply_type;
+}
+
+FlightRecorder::ThreadRing& FlightRecorder::thread_ring() {
+    static thread_local ThreadRing* ring = nullptr;
+    static thread_local const FlightRecorder* ring_owner = nullptr;
+    if (ring_owner != this) {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        rings.push_back(std::make_unique<ThreadRing>(records_per_thread, static_cast<uint16_t>(rings.size())));
+        ring = rings.back().get();
+        ring_owner = this;
+    }
+    return *ring;
+}
+
+void FlightRecorder::commit(const FlightRecord& finished) {
+    ThreadRing& ring = thread_ring();
+    Slot& slot = ring.slots[ring.next % ring.slots.size()];
+    uint64_t sequence = 2 * ring.next + 1;
+    ring.next++;
+
+    // Odd while writing: a concurrent dump skips the slot instead of copying half a record
+    slot.sequence.store(sequence, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.record = finished;
+    slot.record.thread_index = ring.index;
+    slot.sequence.store(sequence + 1, std::memory_order_release);
+
+    // Stall: ask the dumper for a file (rate-limited, never written from the worker)
+    uint64_t latency_ns = finished.done_ns - finished.receive_ns;
+    if (stall_threshold_ns > 0 && latency_ns > stall_threshold_ns) {
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(dump_mutex);
+        if (!stall_pending && now - last_stall_dump >= std::chrono::milliseconds(FLIGHT_STALL_DUMP_INTERVAL_MS)) {
+            stall_pending = true;
+            stall_latency_ns = latency_ns;
+            last_stall_dump = now;
+            dump_cv.notify_one();
+        }
+    }
+}
+
+// ===== Dumper thread =====
+
+void FlightRecorder::run_dumper() {
+    std::unique_lock<std::mutex> lock(dump_mutex);
+    while (!stopping.load()) {
+        // Timed wait: SIGUSR1 only sets a flag
+        dump_cv.wait_for(lock, std::chrono::milliseconds(FLIGHT_DUMP_POLL_MS));
+
+        if (signal_dump_requested.exchange(false)) {
+            lock.unlock();
+            dump(FlightDumpReason::SIGNAL, 0);
+            lock.lock();
+        }
+        if (stall_pending) {
+            stall_pending = false;
+            uint64_t latency_ns = stall_latency_ns;
+            lock.unlock();
+            dump(FlightDumpReason::STALL, latency_ns);
+            lock.lock();
+        }
+    }
+}
+
+void FlightRecorder::dump(FlightDumpReason reason, uint64_t trigger_latency_ns) {
+    std::vector<FlightRecord> records;
+    uint32_t thread_count;
+    {
+        std::lock_guard<std::mutex> lock(rings_mutex);
+        thread_count = static_cast<uint32_t>(rings.size());
+        for (const auto& ring : rings) {
+            for (const Slot& slot : ring->slots) {
+                // Seqlock read: keep the copy only if no write started or finished meanwhile
+                uint64_t before = slot.sequence.load(std::memory_order_acquire);
+                if (before == 0 || (before & 1)) continue;
+                FlightRecord copy = slot.record;
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.sequence.load(std::memory_order_relaxed) != before) continue;
+                records.push_back(copy);
+            }
+        }
+    }
+    std::sort(records.begin(), records.end(),
+              [](const FlightRecord& a, const FlightRecord& b) { return a.receive_ns < b.receive_ns; });
+
+    std::string path = dump_directory + "/flight-" + std::to_string(get_process_id()) + "-" +
+                       std::to_string(++dump_count) + ".zf";
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        std::cerr << "Flight recorder: cannot create " << path << std::endl;
+        return;
+    }
+
+    FlightDumpHeader header;
+    std::memcpy(header.magic, FLIGHT_MAGIC, sizeof(header.magic));
+    header.version = FLIGHT_FORMAT_VERSION;
+    header.record_size = sizeof(FlightRecord);
+    header.origin_unix_ns = origin_unix_ns;
+    header.reason = static_cast<uint32_t>(reason);
+    header.thread_count = thread_count;
+    header.trigger_latency_ns = trigger_latency_ns;
+    header.record_count = records.size();
+
+    bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+              (records.empty() || std::fwrite(records.data(), sizeof(FlightRecord), records.size(), file) == records.size());
+    ok = std::fclose(file) == 0 && ok;
+
+    std::cerr << "Flight recorder: " << (ok ? "dumped " : "failed to dump ") << records.size() << " records to " << path
+              << (reason == FlightDumpReason::SIGNAL ? " (signal)" : " (stall)") << std::endl;
+}
+
+// ===== FlightDumpReader =====
+
+FlightDumpReader::~FlightDumpReader() {
+    if (file) std::fclose(file);
+}
+
+bool FlightDumpReader::open(const std::string& path) {
+    if (file) std::fclose(file);
+
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    if (std::fread(&file_header, sizeof(file_header), 1, file) != 1 ||
+        std::memcmp(file_header.magic, FLIGHT_MAGIC, sizeof(FLIGHT_MAGIC)) != 0 ||
+        file_header.version != FLIGHT_FORMAT_VERSION ||
+        file_header.record_size != sizeof(FlightRecord)) {
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool FlightDumpReader::next(FlightRecord& record) {
+    return file && std::fread(&record, sizeof(record), 1, file) == 1;
+}
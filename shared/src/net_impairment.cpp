@@ -0,0 +1,244 @@
+#include "net_impairment.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+// ===== ImpairmentConfig =====
+
+/**
+ * @brief Parses a non-negative number, with an optional trailing unit suffix ("%", "ms").
+ */
+static bool parse_number(std::string value, const std::string& suffix, double& out) {
+    if (!suffix.empty() && value.size() > suffix.size() &&
+        value.compare(value.size() - suffix.size(), suffix.size(), suffix) == 0) {
+        value.resize(value.size() - suffix.size());
+    }
+    try {
+        size_t used = 0;
+        double parsed = std::stod(value, &used);
+        if (used != value.size() || parsed < 0) return false;
+        out = parsed;
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+bool ImpairmentConfig::parse(const std::string& spec, ImpairmentConfig& config) {
+    ImpairmentConfig parsed;
+    std::stringstream items(spec);
+    std::string item;
+
+    while (std::getline(items, item, ',')) {
+        if (item.empty()) continue;
+        size_t eq = item.find('=');
+        if (eq == std::string::npos) return false;
+        std::string key = item.substr(0, eq);
+        std::string value = item.substr(eq + 1);
+        double number = 0;
+
+        if (key == "loss" || key == "dup" || key == "reorder") {
+            if (!parse_number(value, "%", number) || number > 100) return false;
+            if (key == "loss") parsed.loss_percent = number;
+            else if (key == "dup") parsed.duplicate_percent = number;
+            else parsed.reorder_percent = number;
+        } else if (key == "delay" || key == "jitter" || key == "gap") {
+            if (!parse_number(value, "ms", number)) return false;
+            uint32_t ms = static_cast<uint32_t>(number);
+            if (key == "delay") parsed.delay_ms = ms;
+            else if (key == "jitter") parsed.jitter_ms = ms;
+            else parsed.reorder_gap_ms = ms;
+        } else if (key == "dist") {
+            if (value == "uniform") parsed.distribution = DelayDistribution::UNIFORM;
+            else if (value == "normal") parsed.distribution = DelayDistribution::NORMAL;
+            else if (value == "pareto") parsed.distribution = DelayDistribution::PARETO;
+            else return false;
+        } else if (key == "seed") {
+            if (!parse_number(value, "", number)) return false;
+            parsed.seed = static_cast<uint64_t>(number);
+        } else {
+            return false;
+        }
+    }
+
+    config = parsed;
+    return true;
+}
+
+bool ImpairmentConfig::enabled() const {
+    return loss_percent > 0 || duplicate_percent > 0 || reorder_percent > 0 || delay_ms > 0 || jitter_ms > 0;
+}
+
+std::string ImpairmentConfig::to_string() const {
+    static const char* distribution_names[] = {"uniform", "normal", "pareto"};
+    std::stringstream out;
+    out << "loss=" << loss_percent << "%,dup=" << duplicate_percent << "%,reorder=" << reorder_percent
+        << "%,delay=" << delay_ms << "ms,jitter=" << jitter_ms << "ms,dist="
+        << distribution_names[static_cast<uint8_t>(distribution)] << ",gap=" << reorder_gap_ms << "ms";
+    return out.str();
+}
+
+// ===== Singleton =====
+
+NetImpairment::NetImpairment() : rng(std::random_device{}()) {
+    const char* spec = std::getenv(IMPAIRMENT_ENV_VAR);
+    if (!spec || !*spec) return;
+
+    ImpairmentConfig parsed;
+    if (!ImpairmentConfig::parse(spec, parsed)) {
+        std::cerr << "Ignoring invalid " << IMPAIRMENT_ENV_VAR << "=\"" << spec << "\"" << std::endl;
+        return;
+    }
+    config = parsed;
+    if (config.seed != 0) rng.seed(config.seed);
+    enabled.store(config.enabled(), std::memory_order_relaxed);
+    if (config.enabled()) {
+        std::cerr << "Network impairment active: " << config.to_string() << std::endl;
+    }
+}
+
+NetImpairment& NetImpairment::instance() {
+    static NetImpairment* impairment = new NetImpairment();
+    return *impairment;
+}
+
+bool NetImpairment::active() {
+    return instance().enabled.load(std::memory_order_relaxed);
+}
+
+void NetImpairment::configure(const ImpairmentConfig& new_config) {
+    NetImpairment& self = instance();
+    std::lock_guard<std::mutex> lock(self.mutex);
+    self.config = new_config;
+    if (new_config.seed != 0) self.rng.seed(new_config.seed);
+    self.enabled.store(new_config.enabled(), std::memory_order_relaxed);
+}
+
+NetImpairment::Stats NetImpairment::stats() {
+    NetImpairment& self = instance();
+    std::lock_guard<std::mutex> lock(self.mutex);
+    return self.counters;
+}
+
+// ===== Random decisions =====
+
+bool NetImpairment::chance(double percent) {
+    if (percent <= 0) return false;
+    return std::uniform_real_distribution<double>(0.0, 100.0)(rng) < percent;
+}
+
+std::chrono::microseconds NetImpairment::draw_delay() {
+    double delay_us = config.delay_ms * 1000.0;
+    double jitter_us = config.jitter_ms * 1000.0;
+
+    if (jitter_us > 0) {
+        switch (config.distribution) {
+            case DelayDistribution::UNIFORM:
+                delay_us += std::uniform_real_distribution<double>(-jitter_us, jitter_us)(rng);
+                break;
+            case DelayDistribution::NORMAL:
+                delay_us += std::normal_distribution<double>(0.0, jitter_us)(rng);
+                break;
+            case DelayDistribution::PARETO: {
+                // Pareto tail (shape 1.5, capped at 100x jitter): mostly small, sometimes huge
+                double u = std::uniform_real_distribution<double>(1e-9, 1.0)(rng);
+                delay_us += std::min(jitter_us * (std::pow(u, -1.0 / 1.5) - 1.0), jitter_us * 100.0);
+                break;
+            }
+        }
+    }
+
+    // Jitter can't make a datagram leave before it was sent
+    return std::chrono::microseconds(static_cast<int64_t>(std::max(0.0, delay_us)));
+}
+
+// ===== Send path =====
+
+bool NetImpairment::impair(UDPSocket& socket, const void* data, size_t size, const SocketAddress& dest_addr) {
+    NetImpairment& self = instance();
+    size_t immediate_copies = 0;
+    {
+        std::lock_guard<std::mutex> lock(self.mutex);
+        self.counters.sent++;
+
+        if (self.chance(self.config.loss_percent)) {
+            self.counters.dropped++;
+            return true;  // Lost on the "wire": the sender can't tell
+        }
+
+        size_t copies = 1;
+        if (self.chance(self.config.duplicate_percent)) {
+            self.counters.duplicated++;
+            copies = 2;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        for (size_t copy = 0; copy < copies; copy++) {
+            std::chrono::microseconds delay = self.draw_delay();
+            if (self.chance(self.config.reorder_percent)) {
+                delay += std::chrono::milliseconds(self.config.reorder_gap_ms);
+                self.counters.reordered++;
+            }
+            if (delay.count() == 0) {
+                immediate_copies++;
+                continue;
+            }
+
+            const uint8_t* bytes = static_cast<const uint8_t*>(data);
+            self.queue.push_back({now + delay, self.next_sequence++, &socket, dest_addr,
+                                  std::vector<uint8_t>(bytes, bytes + size)});
+            std::push_heap(self.queue.begin(), self.queue.end(), std::greater<Pending>());
+            self.counters.delayed++;
+        }
+
+        if (self.counters.delayed > 0 && !self.thread_started) {
+            std::thread(&NetImpairment::run_delay_thread, &self).detach();
+            self.thread_started = true;
+        }
+    }
+    self.queue_cv.notify_one();
+
+    // Undelayed copies leave right away, outside the lock
+    bool ok = true;
+    for (size_t copy = 0; copy < immediate_copies; copy++) {
+        ok = socket.send_direct(data, size, dest_addr) && ok;
+    }
+    return ok;
+}
+
+void NetImpairment::forget(const UDPSocket& socket) {
+    NetImpairment& self = instance();
+    std::lock_guard<std::mutex> lock(self.mutex);
+    auto removed = std::remove_if(self.queue.begin(), self.queue.end(),
+                                  [&](const Pending& pending) { return pending.socket == &socket; });
+    if (removed == self.queue.end()) return;
+    self.queue.erase(removed, self.queue.end());
+    std::make_heap(self.queue.begin(), self.queue.end(), std::greater<Pending>());
+}
+
+// ===== Delay thread =====
+
+void NetImpairment::run_delay_thread() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        if (queue.empty()) {
+            queue_cv.wait(lock);
+            continue;
+        }
+
+        auto due = queue.front().due;
+        if (std::chrono::steady_clock::now() < due) {
+            queue_cv.wait_until(lock, due);
+            continue;  // New earlier entry or spurious wakeup: re-check the front
+        }
+
+        std::pop_heap(queue.begin(), queue.end(), std::greater<Pending>());
+        Pending pending = std::move(queue.back());
+        queue.pop_back();
+
+        // Sent under the lock: forget() can't return while a datagram of its socket is in flight
+        pending.socket->send_direct(pending.data.data(), pending.data.size(), pending.dest_addr);
+    }
+}
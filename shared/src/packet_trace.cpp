@@ -0,0 +1,123 @@
+#include "packet_trace.h"
+#include <algorithm>
+#include <cstring>
+
+static const char TRACE_MAGIC[8] = {'Z', 'I', 'P', 'T', 'R', 'A', 'C', 'E'};
+
+// ===== PacketTraceWriter =====
+
+bool PacketTraceWriter::open(const std::string& path) {
+    if (file) return false;  // Already capturing
+
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    start = std::chrono::steady_clock::now();
+
+    TraceFileHeader header;
+    std::memcpy(header.magic, TRACE_MAGIC, sizeof(header.magic));
+    header.version = TRACE_FORMAT_VERSION;
+    header.record_size = sizeof(TraceRecord);
+    header.start_unix_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    ring = std::make_unique<TraceRecord[]>(TRACE_RING_CAPACITY);
+    head.store(0, std::memory_order_relaxed);
+    tail.store(0, std::memory_order_relaxed);
+    dropped_records.store(0, std::memory_order_relaxed);
+    stopping.store(false, std::memory_order_relaxed);
+    flusher = std::thread(&PacketTraceWriter::run_flusher, this);
+    return true;
+}
+
+void PacketTraceWriter::close() {
+    if (!file) return;
+
+    // Flusher drains everything recorded so far before exiting
+    stopping.store(true, std::memory_order_release);
+    if (flusher.joinable()) flusher.join();
+
+    std::fclose(file);
+    file = nullptr;
+    ring.reset();
+}
+
+void PacketTraceWriter::record(const Packet& packet, const SocketAddress& source_addr, uint16_t ledger_port) {
+    uint64_t slot = head.load(std::memory_order_relaxed);
+
+    // Ring full: drop instead of blocking the receiver
+    if (slot - tail.load(std::memory_order_acquire) >= TRACE_RING_CAPACITY) {
+        dropped_records.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    TraceRecord& entry = ring[slot & (TRACE_RING_CAPACITY - 1)];
+    entry.timestamp_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+    entry.source_ip = source_addr.ip();
+    entry.source_port = source_addr.port();
+    entry.ledger_port = ledger_port;
+    entry.packet = packet;
+
+    // Publish the slot to the flusher
+    head.store(slot + 1, std::memory_order_release);
+}
+
+void PacketTraceWriter::run_flusher() {
+    while (true) {
+        // Read stopping before head: records published before close() are always drained
+        bool stop_requested = stopping.load(std::memory_order_acquire);
+        uint64_t first = tail.load(std::memory_order_relaxed);
+        uint64_t last = head.load(std::memory_order_acquire);
+
+        if (first == last) {
+            if (stop_requested) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(TRACE_FLUSH_INTERVAL_MS));
+            continue;
+        }
+
+        // Write the pending range (at most two contiguous chunks when it wraps around)
+        while (first != last) {
+            size_t offset = static_cast<size_t>(first & (TRACE_RING_CAPACITY - 1));
+            size_t count = static_cast<size_t>(std::min<uint64_t>(last - first, TRACE_RING_CAPACITY - offset));
+            std::fwrite(&ring[offset], sizeof(TraceRecord), count, file);
+            first += count;
+        }
+        std::fflush(file);
+
+        // Slots can be reused by the producer
+        tail.store(last, std::memory_order_release);
+    }
+}
+
+// ===== PacketTraceReader =====
+
+PacketTraceReader::~PacketTraceReader() {
+    if (file) std::fclose(file);
+}
+
+bool PacketTraceReader::open(const std::string& path) {
+    if (file) std::fclose(file);
+
+    file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+
+    if (std::fread(&file_header, sizeof(file_header), 1, file) != 1 ||
+        std::memcmp(file_header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 ||
+        file_header.version != TRACE_FORMAT_VERSION ||
+        file_header.record_size != sizeof(TraceRecord)) {
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool PacketTraceReader::next(TraceRecord& record) {
+    return file && std::fread(&record, sizeof(record), 1, file) == 1;
+}
@@ -0,0 +1,157 @@
+#include "perf_counters.h"
+
+#ifdef ZIP_PERF_COUNTERS
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#ifdef __linux__
+    #include <linux/perf_event.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+constexpr size_t REGION_COUNT = static_cast<size_t>(PerfRegion::COUNT);
+constexpr size_t EVENT_COUNT = 4;
+
+/**
+ * @brief Counter group and region totals of one thread.
+ *
+ * Totals are written by the owning thread only and read by snapshot(): relaxed atomics,
+ * no lock on the measured path.
+ */
+struct ThreadCounters {
+    int group_fd = -1;                                          ///< Group leader (cycles); -1 = unavailable
+    std::atomic<uint64_t> totals[REGION_COUNT][EVENT_COUNT + 1] = {};  ///< [region][calls, events...]
+};
+
+/// Every thread's counters (never freed: snapshot() may run after a thread exits)
+static std::mutex registry_mutex;
+static std::vector<ThreadCounters*> registry;
+
+#ifdef __linux__
+/**
+ * @brief Opens one counter of the calling thread (any CPU), in group_fd's group.
+ */
+static int open_counter(uint32_t type, uint64_t config, int group_fd, bool exclude_kernel) {
+    perf_event_attr attr;
+    std::memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.exclude_kernel = exclude_kernel ? 1 : 0;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, group_fd, 0));
+}
+
+/**
+ * @brief Opens the cycles/instructions/cache-miss/branch-miss group, kernel included if allowed.
+ */
+static int open_group() {
+    static const uint64_t events[EVENT_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+        PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+    };
+
+    for (bool exclude_kernel : {false, true}) {
+        int fds[EVENT_COUNT];
+        size_t opened = 0;
+        for (; opened < EVENT_COUNT; opened++) {
+            fds[opened] = open_counter(PERF_TYPE_HARDWARE, events[opened], opened == 0 ? -1 : fds[0], exclude_kernel);
+            if (fds[opened] < 0) break;
+        }
+        if (opened == EVENT_COUNT) return fds[0];
+
+        // Partial group (event unsupported or denied): release it and retry without kernel
+        for (size_t i = 0; i < opened; i++) close(fds[i]);
+    }
+    return -1;
+}
+
+/**
+ * @brief Reads the whole group at once (values in open order).
+ */
+static bool read_group(int group_fd, uint64_t values[EVENT_COUNT]) {
+    uint64_t buffer[1 + EVENT_COUNT];
+    if (read(group_fd, buffer, sizeof(buffer)) != static_cast<ssize_t>(sizeof(buffer)) || buffer[0] != EVENT_COUNT) {
+        return false;
+    }
+    std::memcpy(values, buffer + 1, sizeof(uint64_t) * EVENT_COUNT);
+    return true;
+}
+#else
+static int open_group() { return -1; }
+static bool read_group(int, uint64_t*) { return false; }
+#endif
+
+/**
+ * @brief Returns the calling thread's counters (opened and registered on first use).
+ */
+static ThreadCounters& thread_counters() {
+    static thread_local ThreadCounters* counters = nullptr;
+    if (!counters) {
+        counters = new ThreadCounters();
+        counters->group_fd = open_group();
+        if (counters->group_fd < 0) {
+            // Typical in VMs without a virtual PMU: say so once instead of printing nothing
+            static std::once_flag warned;
+            int err = errno;
+            std::call_once(warned, [err] {
+                std::cerr << "Performance counters unavailable on this host (perf_event_open: "
+                          << std::strerror(err) << ")" << std::endl;
+            });
+        }
+        std::lock_guard<std::mutex> lock(registry_mutex);
+        registry.push_back(counters);
+    }
+    return *counters;
+}
+
+// ===== PerfScope =====
+
+PerfScope::PerfScope(PerfRegion region, uint64_t calls) : region(region), calls(calls) {
+    ThreadCounters& counters = thread_counters();
+    active = counters.group_fd >= 0 && read_group(counters.group_fd, start);
+}
+
+PerfScope::~PerfScope() {
+    if (!active) return;
+
+    ThreadCounters& counters = thread_counters();
+    uint64_t end[EVENT_COUNT];
+    if (!read_group(counters.group_fd, end)) return;
+
+    // Single writer per thread: load + store instead of a locked read-modify-write
+    std::atomic<uint64_t>* totals = counters.totals[static_cast<size_t>(region)];
+    totals[0].store(totals[0].load(std::memory_order_relaxed) + calls, std::memory_order_relaxed);
+    for (size_t i = 0; i < EVENT_COUNT; i++) {
+        totals[i + 1].store(totals[i + 1].load(std::memory_order_relaxed) + (end[i] - start[i]), std::memory_order_relaxed);
+    }
+}
+
+// ===== Aggregation =====
+
+void PerfCounters::snapshot(PerfTotals totals[REGION_COUNT]) {
+    for (size_t region = 0; region < REGION_COUNT; region++) {
+        totals[region] = PerfTotals();
+    }
+
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    for (const ThreadCounters* counters : registry) {
+        for (size_t region = 0; region < REGION_COUNT; region++) {
+            const std::atomic<uint64_t>* values = counters->totals[region];
+            totals[region].calls += values[0].load(std::memory_order_relaxed);
+            totals[region].cycles += values[1].load(std::memory_order_relaxed);
+            totals[region].instructions += values[2].load(std::memory_order_relaxed);
+            totals[region].cache_misses += values[3].load(std::memory_order_relaxed);
+            totals[region].branch_misses += values[4].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+#endif
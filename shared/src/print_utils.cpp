@@ -43,6 +43,60 @@ void PrintUtils::print_request(uint32_t client_ip, const Packet& packet, bool is
               << " total_balance " << total_balance << std::endl;
 }
 
+void PrintUtils::print_perf_counters(const PerfTotals* totals) {
+    static const char* region_names[] = {"transaction", "locked_map", "socket"};
+    double transactions = static_cast<double>(totals[static_cast<size_t>(PerfRegion::TRANSACTION)].calls);
+    if (transactions == 0) return;
+
+    // One line per region, averaged over transactions (not over the region's own calls)
+    for (size_t region = 0; region < static_cast<size_t>(PerfRegion::COUNT); region++) {
+        const PerfTotals& t = totals[region];
+        print_timestamp();
+        std::cout << std::fixed << std::setprecision(1)
+                  << " perf " << region_names[region]
+                  << " calls_per_tx " << t.calls / transactions
+                  << " cycles " << t.cycles / transactions
+                  << " instructions " << t.instructions / transactions
+                  << std::setprecision(2) << " ipc " << (t.cycles ? static_cast<double>(t.instructions) / t.cycles : 0.0)
+                  << " cache_misses " << t.cache_misses / transactions
+                  << " branch_misses " << t.branch_misses / transactions << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+}
+
+void PrintUtils::print_contention_header(uint16_t port, size_t count) {
+    print_timestamp();
+    std::cout << " contention port " << port << " top " << count << std::endl;
+}
+
+void PrintUtils::print_contention(size_t rank, uint32_t client_ip, uint64_t contended_reads, uint64_t contended_writes, uint64_t wait_ns, uint64_t max_wait_ns) {
+    std::cout << "  #" << rank << " " << SocketAddress(client_ip).ip_string()     // Already in network byte order
+              << " contended_reads " << contended_reads
+              << " contended_writes " << contended_writes
+              << " wait_total_us " << wait_ns / 1000
+              << " max_wait_us " << max_wait_ns / 1000 << std::endl;
+}
+
+void PrintUtils::print_dropped(uint16_t port, uint64_t size, uint64_t type, uint64_t bounds, uint64_t duplicate) {
+    print_timestamp();
+    std::cout << " dropped port " << port
+              << " size " << size
+              << " type " << type
+              << " bounds " << bounds
+              << " duplicate " << duplicate << std::endl;
+}
+
+void PrintUtils::print_batching(size_t drain_batch, size_t worker_batch, uint64_t max_wait_us, uint64_t arrival_rate, uint64_t queue_depth, uint64_t latency_us, uint8_t load_hint) {
+    print_timestamp();
+    std::cout << " batching drain " << drain_batch
+              << " group " << worker_batch
+              << " wait_us " << max_wait_us
+              << " rate " << arrival_rate
+              << " queue " << queue_depth
+              << " latency_us " << latency_us
+              << " load " << static_cast<int>(load_hint) << std::endl;
+}
+
 void PrintUtils::print_reply(uint32_t server_ip, uint32_t request_id, uint32_t dest_ip, uint32_t value, uint32_t new_balance) {
     // Single line: successful transaction confirmation with updated balance
     print_timestamp();
@@ -53,6 +107,15 @@ void PrintUtils::print_reply(uint32_t server_ip, uint32_t request_id, uint32_t d
               << " new_balance " << new_balance << std::endl << std::endl;  // Extra newline for readability
 }
 
+void PrintUtils::print_credit(uint32_t server_ip, uint32_t notify_id, uint32_t credited, uint32_t new_balance) {
+    // Single line: incoming funds pushed by the server
+    print_timestamp();
+    std::cout << " server " << SocketAddress(server_ip).ip_string()      // Already in network byte order
+              << " id_notify " << notify_id
+              << " credited " << credited
+              << " new_balance " << new_balance << std::endl << std::endl;  // Extra newline for readability
+}
+
 void PrintUtils::print_discovery_reply(uint32_t server_ip) {
     // Single line: discovery phase completed
     print_timestamp();
@@ -1,4 +1,7 @@
 #include "udp_socket.h"
+#include "net_impairment.h"
+#include "perf_counters.h"
+#include <algorithm>
 #include <cstring>
 
 #ifdef _WIN32
@@ -22,17 +25,22 @@
     #define set_nonblocking(fd) { u_long mode = 1; ioctlsocket(fd, FIONBIO, &mode); }
     #define is_wouldblock(err) (err == WSAEWOULDBLOCK)
     #define get_socket_error() WSAGetLastError()
+    #define poll_impl(fds, count, timeout) WSAPoll(fds, static_cast<ULONG>(count), timeout)
+    #define is_interrupted(err) (err == WSAEINTR)
 #else
     #include <unistd.h>
     #include <fcntl.h>
     #include <arpa/inet.h>
     #include <errno.h>
+    #include <poll.h>
     
     #define init_winsock() ((void)0)
     #define close_socket_impl(fd) close(fd)
     #define set_nonblocking(fd) { int flags = fcntl(fd, F_GETFL, 0); fcntl(fd, F_SETFL, flags | O_NONBLOCK); }
     #define is_wouldblock(err) (err == EAGAIN || err == EWOULDBLOCK)
     #define get_socket_error() errno
+    #define poll_impl(fds, count, timeout) poll(fds, static_cast<nfds_t>(count), timeout)
+    #define is_interrupted(err) (err == EINTR)
 #endif
 
 // ===== SocketAddress implementation =====
@@ -82,7 +90,7 @@ bool SocketAddress::is_valid() const {
 
 // ===== Socket initialization =====
 
-bool UDPSocket::initialize(uint16_t port, bool is_broadcast) {
+bool UDPSocket::initialize(uint16_t port, bool is_broadcast, uint32_t bind_ip) {
     // Windows: Initialize Winsock library (process-wide, idempotent)
     // Linux: No-op
     init_winsock();
@@ -109,10 +117,10 @@ bool UDPSocket::initialize(uint16_t port, bool is_broadcast) {
         }
     }
 
-    // Bind socket to port and all local interfaces (0.0.0.0)
+    // Bind socket to port and local interface (0.0.0.0 = all interfaces)
     struct sockaddr_in bind_addr {};
     bind_addr.sin_family = AF_INET;
-    bind_addr.sin_addr.s_addr = INADDR_ANY;  // 0.0.0.0 = listen on all interfaces
+    bind_addr.sin_addr.s_addr = bind_ip;     // Already network byte order (INADDR_ANY == 0)
     bind_addr.sin_port = htons(port);        // Convert to network byte order
 
     if (bind(sock_fd, (struct sockaddr*)&bind_addr, sizeof(bind_addr)) < 0) {
@@ -126,11 +134,25 @@ bool UDPSocket::initialize(uint16_t port, bool is_broadcast) {
 // ===== Send data =====
 
 bool UDPSocket::send(const void* data, size_t size, const SocketAddress& dest_addr) {
+    PERF_SCOPE(PerfRegion::SOCKET);
+
     // Validate input parameters
     if (!data || size == 0 || sock_fd == INVALID_SOCKET_VALUE) {
         return false;
     }
 
+    // Testing only: simulated loss/delay/reordering (one relaxed load when disabled)
+    if (NetImpairment::active()) {
+        return NetImpairment::impair(*this, data, size, dest_addr);
+    }
+    return send_direct(data, size, dest_addr);
+}
+
+bool UDPSocket::send_direct(const void* data, size_t size, const SocketAddress& dest_addr) {
+    if (sock_fd == INVALID_SOCKET_VALUE) {
+        return false;
+    }
+
     // Serialize sends (only one thread can send at a time)
     // Note: Doesn't block receives (separate mutex)
     std::lock_guard<std::mutex> lock(send_mutex);
@@ -146,9 +168,62 @@ bool UDPSocket::send(const void* data, size_t size, const SocketAddress& dest_ad
     return sent_bytes == static_cast<ssize_t>(size);
 }
 
+size_t UDPSocket::send_batch(const void* data, size_t size, const SocketAddress* dest_addrs, size_t count) {
+    PERF_SCOPE(PerfRegion::SOCKET);
+
+    if (!data || size == 0 || sock_fd == INVALID_SOCKET_VALUE) {
+        return 0;
+    }
+    const char* datagrams = static_cast<const char*>(data);
+
+#ifdef __linux__
+    if (!NetImpairment::active()) {
+        // Up to SEND_BATCH_MAX datagrams per sendmmsg() call (stack-allocated headers)
+        constexpr size_t SEND_BATCH_MAX = 64;
+        struct mmsghdr messages[SEND_BATCH_MAX];
+        struct iovec buffers[SEND_BATCH_MAX];
+
+        std::lock_guard<std::mutex> lock(send_mutex);
+        size_t sent = 0;
+        while (sent < count) {
+            size_t chunk = std::min(SEND_BATCH_MAX, count - sent);
+            for (size_t i = 0; i < chunk; i++) {
+                buffers[i].iov_base = const_cast<char*>(datagrams + (sent + i) * size);
+                buffers[i].iov_len = size;
+                std::memset(&messages[i], 0, sizeof(messages[i]));
+                messages[i].msg_hdr.msg_name = const_cast<struct sockaddr_in*>(&dest_addrs[sent + i].native());
+                messages[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_in);
+                messages[i].msg_hdr.msg_iov = &buffers[i];
+                messages[i].msg_hdr.msg_iovlen = 1;
+            }
+            int result = sendmmsg(sock_fd, messages, static_cast<unsigned int>(chunk), 0);
+            if (result <= 0) {
+                break;  // Error on the first datagram of the chunk: the rest would fail too
+            }
+            sent += static_cast<size_t>(result);
+        }
+        return sent;
+    }
+#endif
+
+    // Portable path (and impaired sends): one datagram at a time
+    size_t sent = 0;
+    for (size_t i = 0; i < count; i++) {
+        const char* datagram = datagrams + i * size;
+        bool sent_one = NetImpairment::active() ? NetImpairment::impair(*this, datagram, size, dest_addrs[i])
+                                                : send_direct(datagram, size, dest_addrs[i]);
+        if (sent_one) {
+            sent++;
+        }
+    }
+    return sent;
+}
+
 // ===== Receive data =====
 
 int32_t UDPSocket::receive(void* buffer, size_t size, SocketAddress& sender_addr) {
+    PERF_SCOPE(PerfRegion::SOCKET);
+
     // Validate input parameters
     if (!buffer || size == 0 || sock_fd == INVALID_SOCKET_VALUE) {
         return -1;
@@ -182,9 +257,40 @@ int32_t UDPSocket::receive(void* buffer, size_t size, SocketAddress& sender_addr
     return static_cast<int32_t>(received_bytes);
 }
 
+// ===== Wait on multiple sockets =====
+
+bool UDPSocket::wait_readable(const std::vector<const UDPSocket*>& sockets, int32_t timeout_ms, std::vector<size_t>& ready) {
+    // Reused per thread: the caller typically waits in a loop on the same socket set
+    static thread_local std::vector<pollfd> poll_fds;
+    poll_fds.resize(sockets.size());
+    for (size_t i = 0; i < sockets.size(); i++) {
+        poll_fds[i].fd = sockets[i]->sock_fd;
+        poll_fds[i].events = POLLIN;
+        poll_fds[i].revents = 0;
+    }
+
+    ready.clear();
+    int result = poll_impl(poll_fds.data(), poll_fds.size(), timeout_ms);
+    if (result < 0) {
+        // Interrupted by a signal: not an error, caller just waits again
+        return is_interrupted(get_socket_error());
+    }
+
+    // Errors also count as readable: receive() reports them to the caller
+    for (size_t i = 0; i < poll_fds.size() && ready.size() < static_cast<size_t>(result); i++) {
+        if (poll_fds[i].revents & (POLLIN | POLLERR)) {
+            ready.push_back(i);
+        }
+    }
+    return true;
+}
+
 // ===== Close socket =====
 
 void UDPSocket::close_socket() {
+    // Delayed datagrams (network impairment) must not outlive the socket
+    NetImpairment::forget(*this);
+
     // Acquire send_mutex to prevent concurrent send operations during close
     // (receive_mutex not needed since closing invalidates socket for both)
     std::lock_guard<std::mutex> lock(send_mutex);
@@ -0,0 +1,62 @@
+#pragma once
+#include "subprocess.h"
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace proc {
+
+// Acompanha stdout/stdin de muitos filhos numa única thread (epoll no Linux, poll() nos
+// demais POSIX, varredura periódica no Windows). Cada filho tem um prazo opcional que,
+// vencido, gera um evento TIMEOUT.
+class Multiplexer {
+public:
+    enum class EventKind {
+        LINE,       // 'line' recebeu uma linha completa do stdout (com '\n')
+        TIMEOUT,    // prazo de set_deadline() venceu sem clear_deadline()
+        CLOSED      // stdout chegou a EOF (filho terminou); o filho sai do conjunto
+    };
+
+    struct Event {
+        std::size_t id;
+        EventKind kind;
+        std::string line;
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    // Ignora SIGPIPE (POSIX): escrever num filho morto vira EPIPE, não encerra o processo.
+    // Lança std::system_error em falha.
+    Multiplexer();
+    ~Multiplexer();
+
+    Multiplexer(const Multiplexer&) = delete;
+    Multiplexer& operator=(const Multiplexer&) = delete;
+
+    // Registra um filho já iniciado (passa a ser não bloqueante). Retorna o id (0, 1, 2...).
+    // O Subprocess deve viver mais que o Multiplexer. Lança std::system_error em falha.
+    std::size_t add(Subprocess& child);
+
+    // Envia bytes ao stdin sem bloquear; o que não couber no pipe é escrito quando ele
+    // ficar gravável, dentro de wait(). Lança std::system_error em falha.
+    void send(std::size_t id, const std::string& data);
+
+    // Prazo para o próximo evento do filho (substitui o anterior).
+    void set_deadline(std::size_t id, Clock::time_point deadline);
+    void clear_deadline(std::size_t id);
+
+    // Aguarda até 'timeout_ms' (-1 = sem limite, 0 = só verifica) ou o prazo mais próximo.
+    // Acrescenta os eventos a 'events' e retorna quantos foram acrescentados.
+    // Lança std::system_error em falha.
+    std::size_t wait(std::vector<Event>& events, int timeout_ms);
+
+    // Filhos ainda abertos (sem CLOSED).
+    std::size_t active() const noexcept;
+
+private:
+    struct Impl;
+    Impl* pimpl_;
+};
+
+} // namespace proc
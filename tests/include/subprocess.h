@@ -38,10 +38,38 @@ public:
     // Retorna 0 em EOF. Lança std::system_error em falha.
     std::size_t read_stdout(void* buffer, std::size_t max_bytes);
 
-    // Versão conveniente que lê uma linha (terminada por '\n').
-    // Retorna false em EOF sem dados; caso contrário, 'line' recebe os bytes (com '\n' se houver).
+    // Versão conveniente que lê uma linha (terminada por '\n'), sem bloquear.
+    // Retorna false se ainda não há linha completa; em EOF devolve o resto (sem '\n').
+    // Usa o mesmo buffer de fill_stdout()/next_stdout_line(); não misturar com read_stdout().
     bool read_stdout_line(std::string& line);
 
+    // ---- E/S não bloqueante (usada pelo Multiplexer) ----
+
+    // Coloca stdin/stdout do pai em O_NONBLOCK (POSIX; sem efeito no Windows).
+    void set_nonblocking(bool enabled);
+
+    // Descritores para epoll/poll. -1 se fechado (ou no Windows).
+    int stdin_fd() const noexcept;
+    int stdout_fd() const noexcept;
+
+    // Enfileira bytes para o stdin e tenta escrevê-los já.
+    // Retorna true se nada ficou pendente. Lança std::system_error em falha.
+    bool queue_stdin(const void* data, std::size_t size);
+
+    // Escreve o que estiver pendente sem bloquear (em modo não bloqueante).
+    // Retorna true se nada ficou pendente. Filho encerrado (EPIPE) descarta o pendente.
+    bool flush_stdin();
+
+    // Há bytes enfileirados ainda não escritos?
+    bool stdin_pending() const noexcept;
+
+    // Lê tudo que já está disponível no stdout para o buffer interno, sem bloquear.
+    // Retorna false em EOF ou erro (linhas já bufferizadas continuam disponíveis).
+    bool fill_stdout();
+
+    // Retira uma linha completa (com '\n') do buffer interno. false se não há.
+    bool next_stdout_line(std::string& line);
+
     // Leitura bloqueante de stderr (se não redirecionado ao stdout).
     std::size_t read_stderr(void* buffer, std::size_t max_bytes);
     bool read_stderr_line(std::string& line);
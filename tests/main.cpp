@@ -1,13 +1,17 @@
 #include "subprocess.h"
+#include "multiplexer.h"
 #include <iostream>
 #include <thread>
 #include <vector>
 #include <string>
 #include <chrono>
-#include <mutex>
 #include <random>
 #include <memory>
-#include <atomic>
+#include <algorithm>
+
+#ifndef _WIN32
+    #include <sys/resource.h>
+#endif
 
 // Checks if the "new_balance" field in the client response matches the expected value
 bool validate_balance(const std::string& line, const int expected_balance, int &found_balance) {
@@ -29,6 +33,38 @@ bool validate_balance(const std::string& line, const int expected_balance, int &
     return found_balance == expected_balance;
 }
 
+// Per-client progress of the single-threaded driver loop
+struct ClientState {
+    int sent = 0;                                           // Transactions issued so far
+    bool waiting = false;                                   // A command is awaiting its balance line
+    std::chrono::steady_clock::time_point sent_at;          // When the pending command was written
+    std::chrono::steady_clock::time_point next_send;        // Earliest time for the next command
+    long balance = 0;                                       // Expected balance for validation
+};
+
+// Prints command line usage
+static void print_usage(const char* program) {
+    std::cerr << "Usage: " << program << " [TEST_COUNT] [client_ip1 client_ip2 ...] [--clients <n>] [--timeout-ms <ms>] [--quiet]" << std::endl;
+}
+
+// Raises the open file limit: every client keeps two pipes open in this process
+static void raise_fd_limit() {
+#ifndef _WIN32
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+#endif
+}
+
+// Returns the q-quantile (0..1) of sorted samples
+static double quantile(const std::vector<double>& sorted, double q) {
+    if (sorted.empty()) return 0.0;
+    size_t index = static_cast<size_t>(q * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
 int main(int argc, char* argv[]) {
     try {
         // Select program names depending on platform (Windows or Unix)
@@ -43,145 +79,207 @@ int main(int argc, char* argv[]) {
         // Defaults
         std::string server_ip_port = "8080";
         const long INITIAL_BALANCE = 100;
+        const auto SEND_GAP = std::chrono::milliseconds(10);     // Pause between a reply and the next command
 
-        // Read TEST_COUNT and client IPs from command line:
-        // Usage: ./tests [TEST_COUNT] [client_ip1 client_ip2 ...]
+        // Read TEST_COUNT, client IPs and options from command line:
+        // Usage: ./tests [TEST_COUNT] [client_ip1 client_ip2 ...] [--clients <n>] [--timeout-ms <ms>] [--quiet]
+        // --clients starts n client processes, cycling through the IP list
         int TEST_COUNT = 100;
         std::vector<std::string> client_ips = {"192.168.1.156", "192.168.1.156", "192.168.1.156"};
-        if (argc >= 2) {
+        std::vector<std::string> ip_args;
+        int client_count = 0;           // 0 = one client per IP
+        int timeout_ms = 100;           // Reply window per transaction
+        bool quiet = false;             // Summary only (per-transaction lines off)
+        for (int i = 1; i < argc; ++i) {
+            std::string arg = argv[i];
             try {
-                int v = std::stoi(argv[1]);
-                if (v > 0) TEST_COUNT = v;
-            } catch (...) { /* keep default */ }
-        }
-        if (argc >= 3) {
-            client_ips.clear();
-            for (int i = 2; i < argc; ++i) client_ips.emplace_back(argv[i]);
+                if (arg == "--clients" && i + 1 < argc) {
+                    client_count = std::stoi(argv[++i]);
+                } else if (arg == "--timeout-ms" && i + 1 < argc) {
+                    timeout_ms = std::stoi(argv[++i]);
+                } else if (arg == "--quiet") {
+                    quiet = true;
+                } else if (arg.rfind("--", 0) == 0) {
+                    print_usage(argv[0]);
+                    return 1;
+                } else if (i == 1) {
+                    int v = std::stoi(arg);
+                    if (v > 0) TEST_COUNT = v;
+                } else {
+                    ip_args.push_back(arg);
+                }
+            } catch (...) {
+                if (i != 1) {
+                    std::cerr << "Invalid value for " << arg << "\n";
+                    return 1;
+                }
+                /* keep default TEST_COUNT */
+            }
         }
+        if (!ip_args.empty()) client_ips = ip_args;
+        if (client_count <= 0) client_count = static_cast<int>(client_ips.size());
+        if (timeout_ms <= 0) timeout_ms = 100;
 
         // Summary variables for test results
-        std::atomic<int> total_tests{0};
-        std::atomic<int> success_tests{0};
-        std::atomic<int> failed_tests{0};
-        std::atomic<int> timeout_tests{0};
+        int total_tests = 0;
+        int success_tests = 0;
+        int failed_tests = 0;
+        int timeout_tests = 0;
+        std::vector<double> latencies_us;   // Command written -> balance line read
 
-        // Mutex for cout/cerr to avoid interleaved output
-        std::mutex cout_mutex;
+        raise_fd_limit();
 
         // Start the server process with argument 8080
         proc::Subprocess server_proc;
         proc::StartInfo server_si;
         server_si.program = server_prog;
         server_si.args = {server_ip_port};
-        {
-            std::lock_guard<std::mutex> lock(cout_mutex);
-            std::cout << "Starting server: " << server_si.program << " " << server_ip_port << "\n";
-        }
+        server_si.redirect_stderr_to_stdout = true;
+        std::cout << "Starting server: " << server_si.program << " " << server_ip_port << "\n";
         server_proc.start(server_si);
 
         // Give the server a moment to initialize
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
 
         // Number of clients
-        const int NUM_CLIENTS = client_ips.size();
-        std::vector<std::thread> threads;
-
-        // Track each client's balance
-        std::vector<long> client_balances(NUM_CLIENTS, INITIAL_BALANCE);
+        const int NUM_CLIENTS = client_count;
 
-        // Create persistent client processes, one per thread, keep stdin open and send commands in a loop
+        // Create persistent client processes, keep stdin open and send commands from one thread.
+        // stderr joins stdout: an unread stderr pipe would eventually block the client
+        proc::Multiplexer mux;
         std::vector<std::unique_ptr<proc::Subprocess>> client_procs(NUM_CLIENTS);
-        std::vector<proc::StartInfo> cis(NUM_CLIENTS);
+        std::vector<ClientState> clients(NUM_CLIENTS);
         for (int i = 0; i < NUM_CLIENTS; ++i) {
-            cis[i].program = client_prog;
-            cis[i].args = {server_ip_port};
+            proc::StartInfo ci;
+            ci.program = client_prog;
+            ci.args = {server_ip_port};
+            ci.redirect_stderr_to_stdout = true;
             client_procs[i] = std::make_unique<proc::Subprocess>();
-            client_procs[i]->start(cis[i]);
+            client_procs[i]->start(ci);
+            mux.add(*client_procs[i]);
+            clients[i].balance = INITIAL_BALANCE;
         }
+        // The server's log is drained and discarded: a full stdout pipe would stall the server
+        const size_t server_id = mux.add(server_proc);
+        std::cout << "Started " << NUM_CLIENTS << " clients\n";
 
-        // Launch a thread for each client process
-        for (int i = 0; i < NUM_CLIENTS; ++i) {
-            threads.emplace_back([i, &client_procs, &client_ips, &client_balances, NUM_CLIENTS, TEST_COUNT,
-                                  &total_tests, &success_tests, &failed_tests, &timeout_tests, &cout_mutex]() {
-                try {
-                    proc::Subprocess &client = *client_procs[i];
-                    std::string line;
-                    // Random generator per client thread
-                    std::mt19937 rng(static_cast<unsigned>(std::random_device{}()) + i);
-                    std::uniform_int_distribution<int> balance_sent(100, 1000);
-                    std::uniform_int_distribution<int> client_choose(0, NUM_CLIENTS - 1);
-
-                    long client_balance = INITIAL_BALANCE;
-
-                    // Each client sends 100 transactions
-                    for(int count = 0; count < TEST_COUNT; ++count) {
-                        total_tests.fetch_add(1);
-
-                        int money_sent = balance_sent(rng);
-                        int target_client = client_choose(rng);
-
-                        // Update local balance (for validation)
-                        client_balance -= money_sent;
-                        client_balances[i] -= money_sent;
-                        client_balances[i] += money_sent;
-
-                        // Prepare and send command to client process
-                        std::string cmd = std::string(client_ips[i]) + " " + std::to_string(money_sent) + "\n";
-                        client.write_stdin(cmd.data(), cmd.size());
-
-                        {
-                            std::lock_guard<std::mutex> lock(cout_mutex);
-                            std::cout << count+1 << "/" << TEST_COUNT << " [client " << i << " - " << client_ips[i] << "] send to "
-                                      << "[client " << target_client << " - " << client_ips[target_client] << "]: "
-                                      << money_sent << "\n";
-                        }
-
-                        // Wait up to 100ms for a response line from the client
-                        line.clear();
-                        int found_balance = 0;
-                        bool got_balance = false;
-                        auto start = std::chrono::steady_clock::now();
-                        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100)) {
-                            if (client.read_stdout_line(line)) {
-                                if(!line.empty()) {
-                                    std::lock_guard<std::mutex> lock(cout_mutex);
-                                    std::cout << count+1 << "/" << TEST_COUNT << " [client " << i << "] Response: " << line;
-                                }
-                                if (!validate_balance(line, client_balances[i], found_balance)) {
-                                    std::lock_guard<std::mutex> lock(cout_mutex);
-                                    std::cerr << count+1 << "/" << TEST_COUNT << " Balance validation failed for client " << i << "\n";
-                                    failed_tests.fetch_add(1);
-                                    got_balance = true;
-                                    break;
-                                } else if (found_balance != -1) {
-                                    std::lock_guard<std::mutex> lock(cout_mutex);
-                                    std::cout << count+1 << "/" << TEST_COUNT << " [client " << i << " - " << client_ips[i]
-                                            << "] New balance: " << found_balance << " OK!\n";
-                                    success_tests.fetch_add(1);
-                                    got_balance = true;
-                                    break;
-                                }
-                            } else {
-                                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                            }
-                        }
-                        if (!got_balance) {
-                            std::lock_guard<std::mutex> lock(cout_mutex);
-                            std::cerr << count+1 << "/" << TEST_COUNT << " Timeout waiting for balance update for client " << i << "\n";
-                            timeout_tests.fetch_add(1);
-                        }
-                        // Short sleep between commands
-                        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        // Random generator for the whole run
+        std::mt19937 rng(static_cast<unsigned>(std::random_device{}()));
+        std::uniform_int_distribution<int> balance_sent(100, 1000);
+        std::uniform_int_distribution<int> client_choose(0, NUM_CLIENTS - 1);
+
+        auto run_start = std::chrono::steady_clock::now();
+        int finished = 0;
+        std::vector<proc::Multiplexer::Event> events;
+
+        // Closes the current transaction of client i and schedules the next one
+        auto complete = [&](int i, std::chrono::steady_clock::time_point now) {
+            ClientState& client = clients[i];
+            client.waiting = false;
+            client.next_send = now + SEND_GAP;
+            mux.clear_deadline(i);
+            if (client.sent == TEST_COUNT) finished++;
+        };
+
+        bool server_alive = true;
+        while (finished < NUM_CLIENTS && server_alive) {
+            auto now = std::chrono::steady_clock::now();
+
+            // Issue commands for every idle client whose pause has elapsed
+            auto next_wake = now + std::chrono::hours(1);
+            for (int i = 0; i < NUM_CLIENTS; ++i) {
+                ClientState& client = clients[i];
+                if (client.waiting || client.sent == TEST_COUNT) continue;
+                if (client.next_send > now) {
+                    next_wake = std::min(next_wake, client.next_send);
+                    continue;
+                }
+
+                int money_sent = balance_sent(rng);
+                int target_client = client_choose(rng);
+                const std::string& ip = client_ips[i % client_ips.size()];
+                const std::string& target_ip = client_ips[target_client % client_ips.size()];
+
+                // Update local balance (for validation)
+                client.balance -= money_sent;
+                client.balance += money_sent;
+
+                // Prepare and send command to client process
+                std::string cmd = ip + " " + std::to_string(money_sent) + "\n";
+                mux.send(i, cmd);
+                client.sent++;
+                client.waiting = true;
+                client.sent_at = now;
+                mux.set_deadline(i, now + std::chrono::milliseconds(timeout_ms));
+                total_tests++;
+
+                if (!quiet) {
+                    std::cout << client.sent << "/" << TEST_COUNT << " [client " << i << " - " << ip << "] send to "
+                              << "[client " << target_client << " - " << target_ip << "]: "
+                              << money_sent << "\n";
+                }
+            }
+
+            // Sleep until a reply, a reply deadline or the next scheduled command
+            int wait_ms = static_cast<int>(std::chrono::duration_cast<std::chrono::milliseconds>(next_wake - now).count());
+            events.clear();
+            mux.wait(events, std::max(0, wait_ms));
+
+            now = std::chrono::steady_clock::now();
+            for (const proc::Multiplexer::Event& event : events) {
+                if (event.id == server_id) {
+                    if (event.kind == proc::Multiplexer::EventKind::CLOSED) {
+                        std::cerr << "server exited\n";
+                        server_alive = false;
                     }
-                } catch (const std::system_error& e) {
-                    std::lock_guard<std::mutex> lock(cout_mutex);
-                    std::cerr << "client " << i << " error: " << e.code() << " - " << e.what() << "\n";
+                    continue;
                 }
-            });
-        }
 
-        // Wait for all client threads to finish
-        for (auto &t : threads) t.join();
+                int i = static_cast<int>(event.id);
+                ClientState& client = clients[i];
+
+                if (event.kind == proc::Multiplexer::EventKind::CLOSED) {
+                    if (client.sent == TEST_COUNT && !client.waiting) continue;    // Already done
+                    std::cerr << "client " << i << " exited after " << client.sent << " transactions\n";
+                    if (client.waiting) failed_tests++;
+                    failed_tests += TEST_COUNT - client.sent;
+                    client.sent = TEST_COUNT;
+                    client.waiting = false;
+                    finished++;
+                    continue;
+                }
+
+                // A reply read in the same wait wins over its deadline
+                if (!client.waiting) continue;
+
+                if (event.kind == proc::Multiplexer::EventKind::TIMEOUT) {
+                    std::cerr << client.sent << "/" << TEST_COUNT << " Timeout waiting for balance update for client " << i << "\n";
+                    timeout_tests++;
+                    complete(i, now);
+                    continue;
+                }
+
+                const std::string& line = event.line;
+                if (!quiet && !line.empty() && line != "\n") {
+                    std::cout << client.sent << "/" << TEST_COUNT << " [client " << i << "] Response: " << line;
+                }
+                int found_balance = 0;
+                if (!validate_balance(line, client.balance, found_balance)) {
+                    std::cerr << client.sent << "/" << TEST_COUNT << " Balance validation failed for client " << i << "\n";
+                    failed_tests++;
+                    complete(i, now);
+                } else if (found_balance != -1) {
+                    latencies_us.push_back(std::chrono::duration<double, std::micro>(now - client.sent_at).count());
+                    if (!quiet) {
+                        std::cout << client.sent << "/" << TEST_COUNT << " [client " << i << " - " << client_ips[i % client_ips.size()]
+                                  << "] New balance: " << found_balance << " OK!\n";
+                    }
+                    success_tests++;
+                    complete(i, now);
+                }
+            }
+        }
+        double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - run_start).count();
 
         // Terminate all client processes
         for (auto& proc_ptr : client_procs) {
@@ -190,7 +288,6 @@ int main(int argc, char* argv[]) {
                     proc_ptr->terminate(); // send termination signal
                     proc_ptr->wait();      // wait for process to exit
                 } catch (...) {
-                    std::lock_guard<std::mutex> lock(cout_mutex);
                     std::cerr << "Failed to terminate client process.\n";
                 }
             }
@@ -201,20 +298,24 @@ int main(int argc, char* argv[]) {
             server_proc.terminate();
             server_proc.wait();
         } catch (...) {
-            std::lock_guard<std::mutex> lock(cout_mutex);
             std::cerr << "Failed to terminate server process.\n";
         }
 
         // Print test summary
-        {
-            std::lock_guard<std::mutex> lock(cout_mutex);
-            std::cout << "\n=== TEST SUMMARY ===\n";
-            std::cout << "Total tests:      " << total_tests.load() << "\n";
-            std::cout << "Success:          " << success_tests.load() << "\n";
-            std::cout << "Failed:           " << failed_tests.load() << "\n";
-            std::cout << "Timeout:          " << timeout_tests.load() << "\n";
-            std::cout << "====================\n";
+        std::sort(latencies_us.begin(), latencies_us.end());
+        std::cout << "\n=== TEST SUMMARY ===\n";
+        std::cout << "Clients:          " << NUM_CLIENTS << "\n";
+        std::cout << "Total tests:      " << total_tests << "\n";
+        std::cout << "Success:          " << success_tests << "\n";
+        std::cout << "Failed:           " << failed_tests << "\n";
+        std::cout << "Timeout:          " << timeout_tests << "\n";
+        std::cout << "Elapsed:          " << elapsed_s << " s\n";
+        if (!latencies_us.empty()) {
+            std::cout << "Latency (us):     p50 " << quantile(latencies_us, 0.50)
+                      << "  p99 " << quantile(latencies_us, 0.99)
+                      << "  max " << latencies_us.back() << "\n";
         }
+        std::cout << "====================\n";
 
     } catch (const std::system_error& e) {
         std::cerr << "erro: " << e.code() << " - " << e.what() << "\n";
@@ -0,0 +1,288 @@
+#include "multiplexer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <functional>
+#include <queue>
+#include <system_error>
+
+#ifdef _WIN32
+  #define NOMINMAX
+  #include <windows.h>
+#else
+  #include <signal.h>
+  #include <unistd.h>
+  #ifdef __linux__
+    #include <sys/epoll.h>
+  #else
+    #include <poll.h>
+  #endif
+#endif
+
+namespace proc {
+
+static std::system_error sys_err(const char* msg) {
+#ifdef _WIN32
+    return std::system_error((int)GetLastError(), std::system_category(), msg);
+#else
+    return std::system_error(errno, std::system_category(), msg);
+#endif
+}
+
+struct Multiplexer::Impl {
+    struct Child {
+        Subprocess* proc = nullptr;
+        bool open = true;
+        bool write_armed = false;       // stdin com bytes pendentes (aguardando gravável)
+        bool has_deadline = false;
+        std::uint64_t deadline_gen = 0; // invalida entradas antigas do heap
+    };
+
+    struct Deadline {
+        Clock::time_point when;
+        std::size_t id;
+        std::uint64_t gen;
+        bool operator>(const Deadline& o) const { return when > o.when; }
+    };
+
+    std::vector<Child> children;
+    std::size_t open_count = 0;
+    // Heap de prazos com remoção preguiçosa: set/clear só incrementam deadline_gen
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> deadlines;
+
+#ifdef __linux__
+    int epfd = -1;
+    std::vector<epoll_event> ready = std::vector<epoll_event>(256);
+
+    // Chave epoll: id * 2 (+1 para stdin)
+    void watch(int fd, std::uint32_t events, std::uint64_t key) {
+        epoll_event ev{};
+        ev.events = events;
+        ev.data.u64 = key;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == -1) throw sys_err("epoll_ctl(ADD)");
+    }
+    void unwatch(int fd) {
+        // fd pode já ter sido fechado (EPIPE): o kernel já o removeu, erro ignorado
+        if (fd != -1) epoll_ctl(epfd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+#else
+    void watch(int, std::uint32_t, std::uint64_t) {}
+    void unwatch(int) {}
+#endif
+
+    bool deadline_live(const Deadline& d) const {
+        const Child& c = children[d.id];
+        return c.has_deadline && c.deadline_gen == d.gen;
+    }
+
+    void close_child(std::size_t id, std::vector<Event>& events) {
+        Child& c = children[id];
+        unwatch(c.proc->stdout_fd());
+        if (c.write_armed) unwatch(c.proc->stdin_fd());
+        c.open = false;
+        c.write_armed = false;
+        c.has_deadline = false;
+        open_count--;
+        events.push_back({id, EventKind::CLOSED, std::string()});
+    }
+
+    // stdout legível (ou EOF): entrega linhas completas; no EOF, também o resto sem '\n'
+    void read_child(std::size_t id, std::vector<Event>& events) {
+        Child& c = children[id];
+        bool alive = c.proc->fill_stdout();
+        std::string line;
+        while (c.proc->next_stdout_line(line)) {
+            events.push_back({id, EventKind::LINE, line});
+        }
+        if (!alive) {
+            if (c.proc->read_stdout_line(line)) events.push_back({id, EventKind::LINE, line});
+            close_child(id, events);
+        }
+    }
+
+    // stdin gravável: escreve o pendente e ajusta o interesse em gravável
+    void write_child(std::size_t id) {
+        Child& c = children[id];
+        int fd = c.proc->stdin_fd();
+        if (c.proc->flush_stdin()) {
+            if (c.write_armed) unwatch(fd);
+            c.write_armed = false;
+        } else if (!c.write_armed) {
+#ifdef __linux__
+            watch(fd, EPOLLOUT, id * 2 + 1);
+#endif
+            c.write_armed = true;
+        }
+    }
+
+    // Espera do backend: acrescenta LINE/CLOSED a 'events'
+    void wait_io(std::vector<Event>& events, int timeout_ms);
+};
+
+#ifdef __linux__
+
+void Multiplexer::Impl::wait_io(std::vector<Event>& events, int timeout_ms) {
+    int n;
+    do {
+        n = epoll_wait(epfd, ready.data(), (int)ready.size(), timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) throw sys_err("epoll_wait");
+
+    for (int i = 0; i < n; i++) {
+        std::size_t id = (std::size_t)(ready[i].data.u64 / 2);
+        if (!children[id].open) continue;
+        if (ready[i].data.u64 % 2) {
+            write_child(id);
+        } else {
+            read_child(id, events);
+        }
+    }
+}
+
+#elif !defined(_WIN32)
+
+void Multiplexer::Impl::wait_io(std::vector<Event>& events, int timeout_ms) {
+    // poll(): conjunto remontado a cada espera (O(filhos)), suficiente fora do Linux
+    std::vector<pollfd> fds;
+    std::vector<std::size_t> owners;
+    for (std::size_t id = 0; id < children.size(); id++) {
+        const Child& c = children[id];
+        if (!c.open) continue;
+        fds.push_back({c.proc->stdout_fd(), POLLIN, 0});
+        owners.push_back(id * 2);
+        if (c.write_armed) {
+            fds.push_back({c.proc->stdin_fd(), POLLOUT, 0});
+            owners.push_back(id * 2 + 1);
+        }
+    }
+
+    int n;
+    do {
+        n = ::poll(fds.data(), (nfds_t)fds.size(), timeout_ms);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0) throw sys_err("poll");
+
+    for (std::size_t i = 0; i < fds.size() && n > 0; i++) {
+        if (fds[i].revents == 0) continue;
+        n--;
+        std::size_t id = owners[i] / 2;
+        if (!children[id].open) continue;
+        if (owners[i] % 2) {
+            write_child(id);
+        } else {
+            read_child(id, events);
+        }
+    }
+}
+
+#else
+
+void Multiplexer::Impl::wait_io(std::vector<Event>& events, int timeout_ms) {
+    // Windows: pipes anônimos não suportam espera por prontidão; varre a cada 1 ms
+    ULONGLONG start = GetTickCount64();
+    for (;;) {
+        std::size_t before = events.size();
+        for (std::size_t id = 0; id < children.size(); id++) {
+            if (!children[id].open) continue;
+            if (children[id].write_armed) write_child(id);
+            read_child(id, events);
+        }
+        if (events.size() != before || timeout_ms == 0) return;
+        if (timeout_ms > 0 && GetTickCount64() - start >= (ULONGLONG)timeout_ms) return;
+        Sleep(1);
+    }
+}
+
+#endif
+
+Multiplexer::Multiplexer() : pimpl_(new Impl()) {
+#ifndef _WIN32
+    signal(SIGPIPE, SIG_IGN);
+#endif
+#ifdef __linux__
+    pimpl_->epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (pimpl_->epfd == -1) {
+        delete pimpl_;
+        throw sys_err("epoll_create1");
+    }
+#endif
+}
+
+Multiplexer::~Multiplexer() {
+#ifdef __linux__
+    if (pimpl_->epfd != -1) close(pimpl_->epfd);
+#endif
+    delete pimpl_;
+}
+
+std::size_t Multiplexer::add(Subprocess& child) {
+    std::size_t id = pimpl_->children.size();
+    child.set_nonblocking(true);
+#ifdef __linux__
+    pimpl_->watch(child.stdout_fd(), EPOLLIN, id * 2);
+#endif
+    Impl::Child entry;
+    entry.proc = &child;
+    pimpl_->children.push_back(entry);
+    pimpl_->open_count++;
+    return id;
+}
+
+void Multiplexer::send(std::size_t id, const std::string& data) {
+    Impl::Child& c = pimpl_->children.at(id);
+    if (!c.open) return;
+    c.proc->queue_stdin(data.data(), data.size());
+    pimpl_->write_child(id);
+}
+
+void Multiplexer::set_deadline(std::size_t id, Clock::time_point deadline) {
+    Impl::Child& c = pimpl_->children.at(id);
+    if (!c.open) return;
+    c.has_deadline = true;
+    c.deadline_gen++;
+    pimpl_->deadlines.push({deadline, id, c.deadline_gen});
+}
+
+void Multiplexer::clear_deadline(std::size_t id) {
+    Impl::Child& c = pimpl_->children.at(id);
+    c.has_deadline = false;
+    c.deadline_gen++;
+}
+
+std::size_t Multiplexer::wait(std::vector<Event>& events, int timeout_ms) {
+    std::size_t before = events.size();
+
+    // Descarta prazos obsoletos e limita a espera ao mais próximo
+    while (!pimpl_->deadlines.empty() && !pimpl_->deadline_live(pimpl_->deadlines.top())) {
+        pimpl_->deadlines.pop();
+    }
+    if (!pimpl_->deadlines.empty()) {
+        auto until = pimpl_->deadlines.top().when - Clock::now();
+        // Arredonda para cima: acordar antes do prazo só geraria outra espera
+        long long ms = std::chrono::duration_cast<std::chrono::milliseconds>(until + std::chrono::microseconds(999)).count();
+        int deadline_ms = (int)std::max(0LL, std::min(ms, 1LL << 30));
+        timeout_ms = timeout_ms < 0 ? deadline_ms : std::min(timeout_ms, deadline_ms);
+    }
+
+    if (pimpl_->open_count > 0) {
+        pimpl_->wait_io(events, timeout_ms);
+    }
+
+    // Prazos vencidos (depois das linhas: quem recebeu resposta no mesmo ciclo ignora o TIMEOUT)
+    Clock::time_point now = Clock::now();
+    while (!pimpl_->deadlines.empty() && pimpl_->deadlines.top().when <= now) {
+        Impl::Deadline d = pimpl_->deadlines.top();
+        pimpl_->deadlines.pop();
+        if (!pimpl_->deadline_live(d)) continue;
+        pimpl_->children[d.id].has_deadline = false;
+        events.push_back({d.id, EventKind::TIMEOUT, std::string()});
+    }
+
+    return events.size() - before;
+}
+
+std::size_t Multiplexer::active() const noexcept {
+    return pimpl_->open_count;
+}
+
+} // namespace proc
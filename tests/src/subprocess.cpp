@@ -15,6 +15,7 @@
   #include <errno.h>
   #include <fcntl.h>
   #include <signal.h>
+  #include <poll.h>
 #endif
 
 namespace proc {
@@ -48,6 +49,10 @@ struct Subprocess::Impl {
     int stderr_pipe[2]{-1,-1};
 #endif
     bool stderr_redirected = false;
+    bool nonblocking = false;
+    bool stdout_eof = false;
+    std::string stdout_buf;   // lido do stdout, ainda sem '\n' consumido
+    std::string stdin_buf;    // enfileirado para o stdin, ainda não escrito
 
     void reset() {
 #ifdef _WIN32
@@ -68,6 +73,10 @@ struct Subprocess::Impl {
         if (stderr_pipe[1] != -1) { close(stderr_pipe[1]); stderr_pipe[1] = -1; }
         pid = -1;
 #endif
+        nonblocking = false;
+        stdout_eof = false;
+        stdout_buf.clear();
+        stdin_buf.clear();
     }
     ~Impl() { reset(); }
 };
@@ -165,6 +174,12 @@ void Subprocess::start(const StartInfo& si) {
         if (pipe(pimpl_->stderr_pipe) == -1) throw sys_err("pipe(stderr)");
     }
 
+    // Extremidades do pai não vazam para outros filhos (com muitos filhos, um stdin herdado
+    // por um irmão impediria o EOF de close_stdin()); dup2() no filho limpa o FD_CLOEXEC
+    for (int fd : {pimpl_->stdin_pipe[1], pimpl_->stdout_pipe[0], pimpl_->stderr_pipe[0]}) {
+        if (fd != -1 && fcntl(fd, F_SETFD, FD_CLOEXEC) == -1) throw sys_err("fcntl(FD_CLOEXEC)");
+    }
+
     pid_t pid = fork();
     if (pid < 0) throw sys_err("fork");
 
@@ -316,15 +331,140 @@ std::size_t Subprocess::read_stdout(void* buffer, std::size_t max_bytes) {
 }
 
 bool Subprocess::read_stdout_line(std::string& line) {
+    line.clear();
+    fill_stdout();
+    if (next_stdout_line(line)) return true;
+    // EOF: última linha sem '\n'
+    if (pimpl_->stdout_eof && !pimpl_->stdout_buf.empty()) {
+        line.swap(pimpl_->stdout_buf);
+        pimpl_->stdout_buf.clear();
+        return true;
+    }
+    return false;
+}
+
+void Subprocess::set_nonblocking(bool enabled) {
+#ifndef _WIN32
+    for (int fd : {pimpl_->stdin_pipe[1], pimpl_->stdout_pipe[0]}) {
+        if (fd == -1) continue;
+        int flags = fcntl(fd, F_GETFL, 0);
+        if (flags == -1) throw sys_err("fcntl(F_GETFL)");
+        flags = enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK);
+        if (fcntl(fd, F_SETFL, flags) == -1) throw sys_err("fcntl(F_SETFL)");
+    }
+#endif
+    pimpl_->nonblocking = enabled;
+}
+
+int Subprocess::stdin_fd() const noexcept {
+#ifdef _WIN32
+    return -1;
+#else
+    return pimpl_->stdin_pipe[1];
+#endif
+}
+
+int Subprocess::stdout_fd() const noexcept {
+#ifdef _WIN32
+    return -1;
+#else
+    return pimpl_->stdout_pipe[0];
+#endif
+}
+
+bool Subprocess::queue_stdin(const void* data, std::size_t size) {
+    pimpl_->stdin_buf.append(static_cast<const char*>(data), size);
+    return flush_stdin();
+}
+
+bool Subprocess::flush_stdin() {
+    std::string& pending = pimpl_->stdin_buf;
+#ifdef _WIN32
+    if (!pimpl_->hStdinWr) { pending.clear(); return true; }
+    std::size_t off = 0;
+    while (off < pending.size()) {
+        DWORD written = 0;
+        if (!WriteFile(pimpl_->hStdinWr, pending.data() + off, (DWORD)(pending.size() - off), &written, NULL)) {
+            pending.erase(0, off);
+            throw sys_err("WriteFile(stdin)");
+        }
+        off += written;
+    }
+    pending.clear();
+    return true;
+#else
+    if (pimpl_->stdin_pipe[1] == -1) { pending.clear(); return true; }
+    std::size_t off = 0;
+    while (off < pending.size()) {
+        ssize_t w = ::write(pimpl_->stdin_pipe[1], pending.data() + off, pending.size() - off);
+        if (w > 0) { off += (std::size_t)w; continue; }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;   // pipe cheio: resto fica pendente
+        if (errno == EPIPE) {
+            // Filho já fechou o stdin (requer SIGPIPE ignorado); o EOF do stdout avisa o chamador
+            pending.clear();
+            close_stdin();
+            return true;
+        }
+        pending.erase(0, off);
+        throw sys_err("write(stdin)");
+    }
+    pending.erase(0, off);
+    return pending.empty();
+#endif
+}
+
+bool Subprocess::stdin_pending() const noexcept {
+    return !pimpl_->stdin_buf.empty();
+}
+
+bool Subprocess::fill_stdout() {
+    if (pimpl_->stdout_eof) return false;
+    char chunk[4096];
 #ifdef _WIN32
     if (!pimpl_->hStdoutRd) return false;
-    return read_line_from_stream(pimpl_->hStdoutRd, line);
+    for (;;) {
+        DWORD avail = 0;
+        if (!PeekNamedPipe(pimpl_->hStdoutRd, NULL, 0, NULL, &avail, NULL)) { pimpl_->stdout_eof = true; return false; }
+        if (avail == 0) return true;
+        DWORD n = 0;
+        if (!ReadFile(pimpl_->hStdoutRd, chunk, avail < sizeof(chunk) ? avail : (DWORD)sizeof(chunk), &n, NULL) || n == 0) {
+            pimpl_->stdout_eof = true;
+            return false;
+        }
+        pimpl_->stdout_buf.append(chunk, n);
+    }
 #else
-    if (pimpl_->stdout_pipe[0] == -1) return false;
-    return read_line_from_stream(pimpl_->stdout_pipe[0], line);
+    int fd = pimpl_->stdout_pipe[0];
+    if (fd == -1) return false;
+    for (;;) {
+        if (!pimpl_->nonblocking) {
+            // Modo bloqueante: só lê o que poll() garante estar disponível
+            pollfd pfd{fd, POLLIN, 0};
+            int r = ::poll(&pfd, 1, 0);
+            if (r < 0 && errno == EINTR) continue;
+            if (r <= 0) return r == 0;
+        }
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n > 0) { pimpl_->stdout_buf.append(chunk, (std::size_t)n); continue; }
+        if (n == 0) { pimpl_->stdout_eof = true; return false; }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return true;
+        pimpl_->stdout_eof = true;
+        return false;
+    }
 #endif
 }
 
+bool Subprocess::next_stdout_line(std::string& line) {
+    std::string& buf = pimpl_->stdout_buf;
+    std::size_t end = buf.find('\n');
+    if (end == std::string::npos) return false;
+    line.assign(buf, 0, end + 1);
+    buf.erase(0, end + 1);
+    return true;
+}
+
 std::size_t Subprocess::read_stderr(void* buffer, std::size_t max_bytes) {
     if (pimpl_->stderr_redirected) return 0;
 #ifdef _WIN32